@@ -40,6 +40,8 @@ PyAPI_FUNC(struct filedescr *) _PyImport_FindModule(
 PyAPI_FUNC(int) _PyImport_IsScript(struct filedescr *);
 PyAPI_FUNC(void) _PyImport_ReInitLock(void);
 
+PyAPI_FUNC(int) _PyImport_LoadFrozenImage(const char *);
+
 PyAPI_FUNC(PyObject *)_PyImport_FindExtension(char *, char *);
 PyAPI_FUNC(PyObject *)_PyImport_FixupExtension(char *, char *);
 
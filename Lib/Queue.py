@@ -8,7 +8,8 @@ except ImportError:
 from collections import deque
 import heapq
 
-__all__ = ['Empty', 'Full', 'Queue', 'PriorityQueue', 'LifoQueue']
+__all__ = ['Empty', 'Full', 'Queue', 'PriorityQueue', 'LifoQueue',
+           'SimpleQueue']
 
 class Empty(Exception):
     "Exception raised by Queue.get(block=0)/get_nowait()."
@@ -242,3 +243,10 @@ class LifoQueue(Queue):
 
     def _get(self):
         return self.queue.pop()
+
+
+try:
+    from thread import SimpleQueue
+except ImportError:
+    # SimpleQueue's interface is a subset of Queue's
+    SimpleQueue = Queue
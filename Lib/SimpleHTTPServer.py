@@ -172,7 +172,14 @@ class SimpleHTTPRequestHandler(BaseHTTPServer.BaseHTTPRequestHandler):
         to copy binary data as well.
 
         """
-        shutil.copyfileobj(source, outputfile)
+        if (outputfile is self.wfile and hasattr(self.connection, 'sendfile')
+            and hasattr(source, 'tell')):
+            # Let the kernel move the file straight to the socket, from the
+            # current position, which a subclass may have moved.
+            outputfile.flush()
+            self.connection.sendfile(source, source.tell())
+        else:
+            shutil.copyfileobj(source, outputfile)
 
     def guess_type(self, path):
         """Guess the type of a file.
@@ -46,6 +46,7 @@ many of the difficult problems for you, making the task of building
 sophisticated high-performance network servers and clients a snap.
 """
 
+import heapq
 import select
 import socket
 import sys
@@ -54,7 +55,13 @@ import warnings
 
 import os
 from errno import EALREADY, EINPROGRESS, EWOULDBLOCK, ECONNRESET, \
-     ENOTCONN, ESHUTDOWN, EINTR, EISCONN, EBADF, ECONNABORTED, errorcode
+     ENOTCONN, ESHUTDOWN, EINTR, EISCONN, EBADF, ECONNABORTED, errorcode, \
+     EEXIST, ENOENT, EPERM
+
+try:
+    from _asyncore import EventLoop as _EventLoop
+except ImportError:
+    _EventLoop = None
 
 try:
     socket_map
@@ -196,11 +203,240 @@ def poll2(timeout=0.0, map=None):
 
 poll3 = poll2                           # Alias for backward compatibility
 
-def loop(timeout=30.0, use_poll=False, map=None, count=None):
+class _Timer(object):
+    # A callback scheduled with _EpollPoller.call_later(), like
+    # _asyncore.Timer.
+
+    __slots__ = ('when', 'callback', 'args')
+
+    def __init__(self, when, callback, args):
+        self.when = when
+        self.callback = callback
+        self.args = args
+
+    def cancel(self):
+        self.callback = self.args = None
+
+    @property
+    def active(self):
+        return self.callback is not None
+
+class _EpollPoller(object):
+    # The engine of EventLoop.  Unlike poll() and poll2(), it keeps
+    # its registrations from one call to the next and only tells the
+    # kernel about the channels whose readable()/writable() state changed.
+    # _asyncore.EventLoop does the same in C; this is its fallback, with
+    # the same interface.
+
+    def __init__(self, dispatch):
+        self._dispatch = dispatch
+        self._epoll = select.epoll()
+        self._registered = {}   # fd -> (obj, obj.socket, flags)
+        self._always = {}       # fd -> flags, for files epoll can't watch
+        self._timers = []       # heap of (when, seq, timer)
+        self._seq = 0
+        self._running = False
+
+    @property
+    def closed(self):
+        return self._epoll.closed
+
+    def fileno(self):
+        return self._epoll.fileno()
+
+    def close(self):
+        if self._running:
+            raise RuntimeError(
+                "can't close the loop from one of its callbacks")
+        self._epoll.close()
+        self._registered.clear()
+        self._always.clear()
+        del self._timers[:]
+
+    def time(self):
+        return time.time()
+
+    def call_later(self, delay, callback, *args):
+        if not hasattr(callback, '__call__'):
+            raise TypeError("callback must be callable")
+        if self.closed:
+            raise ValueError("I/O operation on closed event loop")
+        timer = _Timer(time.time() + delay, callback, args)
+        heapq.heappush(self._timers, (timer.when, self._seq, timer))
+        self._seq += 1
+        return timer
+
+    def _run_timers(self):
+        # Call the timers which were due when called, but not those
+        # scheduled by the callbacks themselves.
+        now = time.time()
+        seq = self._seq
+        timers = self._timers
+        while timers:
+            when, tseq, timer = timers[0]
+            if timer.active and (when > now or tseq >= seq):
+                break
+            heapq.heappop(timers)
+            callback, args = timer.callback, timer.args
+            timer.cancel()
+            if callback is not None:
+                callback(*args)
+
+    def _unregister(self, fd):
+        del self._registered[fd]
+        self._always.pop(fd, None)
+        try:
+            self._epoll.unregister(fd)
+        except (IOError, OSError):
+            pass
+
+    def _register(self, fd, obj, sock, flags):
+        old = self._registered.get(fd)
+        if not flags:
+            # Like poll2(), don't even check for errors then.
+            if old is not None:
+                self._unregister(fd)
+            return
+        self._registered[fd] = (obj, sock, flags)
+        if fd in self._always:
+            self._always[fd] = flags
+            return
+        try:
+            if old is None:
+                self._epoll.register(fd, flags)
+            else:
+                self._epoll.modify(fd, flags)
+        except IOError, err:
+            if err.errno == EEXIST:
+                # A closed fd whose number was reused by a new channel.
+                self._epoll.modify(fd, flags)
+            elif err.errno == ENOENT:
+                # The kernel dropped the registration on close().
+                self._epoll.register(fd, flags)
+            elif err.errno == EPERM:
+                # Regular files are always ready, as with select().
+                self._always[fd] = flags
+            else:
+                raise
+
+    def run_once(self, timeout, map):
+        if not isinstance(map, dict):
+            raise TypeError("map must be a dict")
+        if self.closed:
+            raise ValueError("I/O operation on closed event loop")
+        if self._running:
+            raise RuntimeError("run_once() called from a callback of the loop")
+        self._running = True
+        try:
+            self._run_once(timeout, map)
+        finally:
+            self._running = False
+
+    def _run_once(self, timeout, map):
+        registered = self._registered
+        for fd in [fd for fd in registered if fd not in map]:
+            self._unregister(fd)
+        for fd, obj in map.items():
+            flags = 0
+            if obj.readable():
+                flags |= select.EPOLLIN | select.EPOLLPRI
+            if obj.writable():
+                flags |= select.EPOLLOUT
+            # A channel which got a new socket must be registered again,
+            # even if it has the same fd: closing the old one dropped
+            # its registration.
+            sock = getattr(obj, 'socket', None)
+            old = registered.get(fd)
+            if (old is None or old[0] is not obj or old[1] is not sock or
+                old[2] != flags):
+                self._register(fd, obj, sock, flags)
+
+        timers = self._timers
+        while timers and not timers[0][2].active:
+            heapq.heappop(timers)
+        if self._always:
+            timeout = 0.0
+        elif timers:
+            delay = timers[0][0] - time.time()
+            if delay > 0.0:
+                # epoll.poll() truncates to milliseconds: round up, not to
+                # wake up just before the timer is due.
+                delay += 0.001
+            else:
+                delay = 0.0
+            if timeout is None or delay < timeout:
+                timeout = delay
+        if timeout is None:
+            timeout = -1
+        try:
+            r = self._epoll.poll(timeout)
+        except IOError, err:
+            if err.errno != EINTR:
+                raise
+            r = []
+        # The EPOLL* flags have the values of their POLL* counterparts,
+        # which readwrite() expects.
+        r.extend(self._always.items())
+        for fd, flags in r:
+            obj = map.get(fd)
+            if obj is None:
+                continue
+            self._dispatch(obj, flags)
+        self._run_timers()
+
+if hasattr(select, 'epoll'):
+
+    class EventLoop(object):
+        """An epoll based event loop for loop().
+
+        Pass it to every loop() call for a map: it keeps the epoll
+        registrations of the channels from one call to the next, and runs
+        the callbacks scheduled with call_later().  close() releases the
+        epoll file descriptor.
+        """
+
+        def __init__(self):
+            self._pid = os.getpid()
+            self._engine = self._new_engine()
+
+        @staticmethod
+        def _new_engine():
+            if _EventLoop is not None:
+                return _EventLoop(readwrite)
+            return _EpollPoller(readwrite)
+
+        @property
+        def closed(self):
+            return self._engine.closed
+
+        def fileno(self):
+            return self._engine.fileno()
+
+        def close(self):
+            self._engine.close()
+
+        def time(self):
+            return self._engine.time()
+
+        def call_later(self, delay, callback, *args):
+            return self._engine.call_later(delay, callback, *args)
+
+        def run_once(self, timeout, map):
+            if self._pid != os.getpid() and not self._engine.closed:
+                # A child must not change the registrations of the epoll
+                # object it shares with its parent, nor run its timers.
+                self._pid = os.getpid()
+                self._engine = self._new_engine()
+            self._engine.run_once(timeout, map)
+
+def loop(timeout=30.0, use_poll=False, map=None, count=None,
+         event_loop=None):
     if map is None:
         map = socket_map
 
-    if use_poll and hasattr(select, 'poll'):
+    if event_loop is not None:
+        poll_fun = event_loop.run_once
+    elif use_poll and hasattr(select, 'poll'):
         poll_fun = poll2
     else:
         poll_fun = poll
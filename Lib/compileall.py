@@ -16,11 +16,12 @@ import sys
 import py_compile
 import struct
 import imp
+import time
 
-__all__ = ["compile_dir","compile_file","compile_path"]
+__all__ = ["compile_dir","compile_file","compile_files","compile_path"]
 
 def compile_dir(dir, maxlevels=10, ddir=None,
-                force=0, rx=None, quiet=0):
+                force=0, rx=None, quiet=0, workers=1):
     """Byte-compile all modules in the given directory tree.
 
     Arguments (only dir is required):
@@ -31,8 +32,13 @@ def compile_dir(dir, maxlevels=10, ddir=None,
                directory name that will show up in error messages)
     force:     if 1, force compilation, even if timestamps are up-to-date
     quiet:     if 1, be quiet during compilation
+    workers:   number of worker processes compiling in parallel; 0 means
+               one per CPU (default 1, compile in this process)
 
     """
+    if workers != 1:
+        files = list(_walk_dir(dir, maxlevels, ddir, quiet))
+        return compile_files(files, force, rx, quiet, workers)
     if not quiet:
         print 'Listing', dir, '...'
     try:
@@ -60,6 +66,114 @@ def compile_dir(dir, maxlevels=10, ddir=None,
                 success = 0
     return success
 
+def _walk_dir(dir, maxlevels, ddir, quiet):
+    """Yield (fullname, ddir) for the files compile_dir() would visit."""
+    if not quiet:
+        print 'Listing', dir, '...'
+    try:
+        names = os.listdir(dir)
+    except os.error:
+        print "Can't list", dir
+        names = []
+    names.sort()
+    for name in names:
+        fullname = os.path.join(dir, name)
+        if ddir is not None:
+            dfile = os.path.join(ddir, name)
+        else:
+            dfile = None
+        if not os.path.isdir(fullname):
+            yield fullname, ddir
+        elif maxlevels > 0 and \
+             name != os.curdir and name != os.pardir and \
+             not os.path.islink(fullname):
+            for item in _walk_dir(fullname, maxlevels - 1, dfile, quiet):
+                yield item
+
+def _is_up_to_date(fullname):
+    """Return true if the compiled file for fullname matches its source.
+
+    This compares the magic number and source mtime stored at the start of
+    the .pyc (or .pyo) file, as the import machinery does.
+    """
+    try:
+        mtime = int(os.stat(fullname).st_mtime)
+        expect = struct.pack('<4sl', imp.get_magic(), mtime)
+        cfile = fullname + (__debug__ and 'c' or 'o')
+        with open(cfile, 'rb') as chandle:
+            actual = chandle.read(8)
+    except (IOError, OSError):
+        return False
+    return expect == actual
+
+def _compile_worker(args):
+    fullname, ddir, quiet = args
+    return compile_file(fullname, ddir, 1, None, quiet)
+
+def compile_files(files, force=0, rx=None, quiet=0, workers=0):
+    """Byte-compile a list of files using a pool of worker processes.
+
+    Arguments (only files is required):
+
+    files:     a list of file names, or of (file name, ddir) pairs where
+               ddir is as for compile_file()
+    force:     if 1, force compilation, even if timestamps are up-to-date
+    rx:        if given, a regular expression of file names to skip
+    quiet:     if 1, be quiet during compilation
+    workers:   number of worker processes; 0 means one per CPU (default)
+
+    Files whose compiled file is up to date are skipped without being
+    handed to a worker.  Unless quiet is set, a summary of the files
+    compiled and the throughput is printed at the end.  If
+    multiprocessing is not available, the files are compiled serially.
+
+    """
+    start = time.time()
+    todo = []
+    skipped = 0
+    for item in files:
+        if isinstance(item, tuple):
+            fullname, ddir = item
+        else:
+            fullname, ddir = item, None
+        if rx is not None and rx.search(fullname):
+            continue
+        if not fullname.endswith('.py') or not os.path.isfile(fullname):
+            continue
+        if not force and _is_up_to_date(fullname):
+            skipped += 1
+            continue
+        todo.append((fullname, ddir, quiet))
+
+    try:
+        from multiprocessing import Pool, cpu_count
+    except ImportError:
+        Pool = None
+    if not workers:
+        workers = cpu_count() if Pool is not None else 1
+    if Pool is None or workers == 1 or len(todo) < 2:
+        results = map(_compile_worker, todo)
+    else:
+        workers = min(workers, len(todo))
+        # Several chunks per worker keep them all busy to the end even
+        # when file sizes vary a lot.
+        chunksize = max(1, len(todo) // (workers * 4))
+        pool = Pool(workers)
+        try:
+            results = list(pool.imap_unordered(_compile_worker, todo,
+                                               chunksize))
+        finally:
+            pool.close()
+            pool.join()
+
+    if not quiet:
+        elapsed = time.time() - start
+        print 'Compiled %d files (%d up to date) in %.2fs' \
+              ' with %d workers: %.1f files/s' % (
+                  len(todo), skipped, elapsed, workers,
+                  len(todo) / elapsed if elapsed > 0 else 0.0)
+    return int(all(results))
+
 def compile_file(fullname, ddir=None, force=0, rx=None, quiet=0):
     """Byte-compile file.
     file:      the file to byte-compile
@@ -83,17 +197,8 @@ def compile_file(fullname, ddir=None, force=0, rx=None, quiet=0):
     if os.path.isfile(fullname):
         head, tail = name[:-3], name[-3:]
         if tail == '.py':
-            if not force:
-                try:
-                    mtime = int(os.stat(fullname).st_mtime)
-                    expect = struct.pack('<4sl', imp.get_magic(), mtime)
-                    cfile = fullname + (__debug__ and 'c' or 'o')
-                    with open(cfile, 'rb') as chandle:
-                        actual = chandle.read(8)
-                    if expect == actual:
-                        return success
-                except IOError:
-                    pass
+            if not force and _is_up_to_date(fullname):
+                return success
             if not quiet:
                 print 'Compiling', fullname, '...'
             try:
@@ -111,7 +216,7 @@ def compile_file(fullname, ddir=None, force=0, rx=None, quiet=0):
                     success = 0
     return success
 
-def compile_path(skip_curdir=1, maxlevels=0, force=0, quiet=0):
+def compile_path(skip_curdir=1, maxlevels=0, force=0, quiet=0, workers=1):
     """Byte-compile all module on sys.path.
 
     Arguments (all optional):
@@ -120,6 +225,7 @@ def compile_path(skip_curdir=1, maxlevels=0, force=0, quiet=0):
     maxlevels:   max recursion level (default 0)
     force: as for compile_dir() (default 0)
     quiet: as for compile_dir() (default 0)
+    workers: as for compile_dir() (default 1)
 
     """
     success = 1
@@ -128,7 +234,8 @@ def compile_path(skip_curdir=1, maxlevels=0, force=0, quiet=0):
             print 'Skipping current directory'
         else:
             success = success and compile_dir(dir, maxlevels, None,
-                                              force, quiet=quiet)
+                                              force, quiet=quiet,
+                                              workers=workers)
     return success
 
 def expand_args(args, flist):
@@ -154,11 +261,11 @@ def main():
     """Script main program."""
     import getopt
     try:
-        opts, args = getopt.getopt(sys.argv[1:], 'lfqd:x:i:')
+        opts, args = getopt.getopt(sys.argv[1:], 'lfqd:x:i:j:')
     except getopt.error, msg:
         print msg
         print "usage: python compileall.py [-l] [-f] [-q] [-d destdir] " \
-              "[-x regexp] [-i list] [directory|file ...]"
+              "[-x regexp] [-i list] [-j workers] [directory|file ...]"
         print "-l: don't recurse down"
         print "-f: force rebuild even if timestamps are up-to-date"
         print "-q: quiet operation"
@@ -167,6 +274,8 @@ def main():
         print "-x regexp: skip files matching the regular expression regexp"
         print "   the regexp is searched for in the full path of the file"
         print "-i list: expand list with its content (file and directory names)"
+        print "-j workers: compile in parallel using that many processes"
+        print "   (0 means one per CPU)"
         sys.exit(2)
     maxlevels = 10
     ddir = None
@@ -174,6 +283,7 @@ def main():
     quiet = 0
     rx = None
     flist = None
+    workers = 1
     for o, a in opts:
         if o == '-l': maxlevels = 0
         if o == '-d': ddir = a
@@ -183,6 +293,14 @@ def main():
             import re
             rx = re.compile(a)
         if o == '-i': flist = a
+        if o == '-j':
+            try:
+                workers = int(a)
+            except ValueError:
+                workers = -1
+            if workers < 0:
+                print "-j workers must be a non-negative integer"
+                sys.exit(2)
     if ddir:
         if len(args) != 1 and not os.path.isdir(args[0]):
             print "-d destdir require exactly one directory argument"
@@ -195,7 +313,15 @@ def main():
                     args = expand_args(args, flist)
             except IOError:
                 success = 0
-            if success:
+            if success and workers != 1:
+                files = []
+                for arg in args:
+                    if os.path.isdir(arg):
+                        files.extend(_walk_dir(arg, maxlevels, ddir, quiet))
+                    else:
+                        files.append((arg, ddir))
+                success = compile_files(files, force, rx, quiet, workers)
+            elif success:
                 for arg in args:
                     if os.path.isdir(arg):
                         if not compile_dir(arg, maxlevels, ddir,
@@ -205,7 +331,7 @@ def main():
                         if not compile_file(arg, ddir, force, rx, quiet):
                             success = 0
         else:
-            success = compile_path()
+            success = compile_path(workers=workers)
     except KeyboardInterrupt:
         print "\n[interrupt]"
         success = 0
@@ -14,7 +14,7 @@ Suggested usage is::
 # Exports only things specified by thread documentation;
 # skipping obsolete synonyms allocate(), start_new(), exit_thread().
 __all__ = ['error', 'start_new_thread', 'exit', 'get_ident', 'allocate_lock',
-           'interrupt_main', 'LockType']
+           'interrupt_main', 'LockType', 'TIMEOUT_MAX']
 
 import traceback as _traceback
 
@@ -68,6 +68,9 @@ def get_ident():
     """
     return -1
 
+# Largest timeout accepted by LockType.acquire()
+TIMEOUT_MAX = 2**31
+
 def allocate_lock():
     """Dummy implementation of thread.allocate_lock()."""
     return LockType()
@@ -92,7 +95,7 @@ class LockType(object):
     def __init__(self):
         self.locked_status = False
 
-    def acquire(self, waitflag=None):
+    def acquire(self, waitflag=None, timeout=-1):
         """Dummy implementation of acquire().
 
         For blocking calls, self.locked_status is automatically set to
@@ -100,10 +103,12 @@ class LockType(object):
         ``waitflag``.  If it is non-blocking, then the value is
         actually checked and not set if it is already acquired.  This
         is all done so that threading.Condition's assert statements
-        aren't triggered and throw a little fit.
+        aren't triggered and throw a little fit.  With a timeout, a
+        lock which is already acquired can't be released while
+        waiting, so this sleeps for the timeout and fails.
 
         """
-        if waitflag is None or waitflag:
+        if (waitflag is None or waitflag) and timeout == -1:
             self.locked_status = True
             return True
         else:
@@ -111,6 +116,9 @@ class LockType(object):
                 self.locked_status = True
                 return True
             else:
+                if timeout > 0:
+                    import time
+                    time.sleep(timeout)
                 return False
 
     __enter__ = acquire
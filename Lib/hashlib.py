@@ -36,6 +36,12 @@ Hash objects have these methods:
  - copy():      Return a copy (clone) of the hash object. This can be used to
                 efficiently compute the digests of strings that share a common
                 initial substring.
+ - digest_many(buffers): Return the list of the digests of the strings
+                passed to update() so far followed by each of the buffers,
+                without changing the hash object.
+
+digest_many(name, buffers) returns the digests of many buffers in one call,
+and, like update() with large strings, releases the GIL while hashing.
 
 For example, to obtain the digest of the string 'Nobody inspects the
 spammish repetition':
@@ -60,7 +66,7 @@ __always_supported = ('md5', 'sha1', 'sha224', 'sha256', 'sha384', 'sha512')
 
 algorithms = __always_supported
 
-__all__ = __always_supported + ('new', 'algorithms')
+__all__ = __always_supported + ('new', 'algorithms', 'digest_many')
 
 
 def __get_builtin_constructor(name):
@@ -121,6 +127,13 @@ def __hash_new(name, string=''):
         return __get_builtin_constructor(name)(string)
 
 
+def digest_many(name, buffers):
+    """digest_many(name, buffers) - Return the list of the digests of each
+    of the buffers, computed with the named algorithm.
+    """
+    return new(name).digest_many(buffers)
+
+
 try:
     import _hashlib
     new = __hash_new
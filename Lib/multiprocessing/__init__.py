@@ -48,7 +48,8 @@ __all__ = [
     'allow_connection_pickling', 'BufferTooShort', 'TimeoutError',
     'Lock', 'RLock', 'Semaphore', 'BoundedSemaphore', 'Condition',
     'Event', 'Queue', 'JoinableQueue', 'Pool', 'Value', 'Array',
-    'RawValue', 'RawArray', 'SUBDEBUG', 'SUBWARNING',
+    'RawValue', 'RawArray', 'SharedArray', 'Channel', 'SUBDEBUG',
+    'SUBWARNING',
     ]
 
 __author__ = 'R. Oudkerk (r.m.oudkerk@gmail.com)'
@@ -219,6 +220,14 @@ def JoinableQueue(maxsize=0):
     from multiprocessing.queues import JoinableQueue
     return JoinableQueue(maxsize)
 
+
+def Channel(size=1048576):
+    '''
+    Returns a message channel over a ring buffer in shared memory
+    '''
+    from _multiprocessing import Channel
+    return Channel(size)
+
 def Pool(processes=None, initializer=None, initargs=(), maxtasksperchild=None):
     '''
     Returns a process pool object
@@ -254,6 +263,13 @@ def Array(typecode_or_type, size_or_initializer, **kwds):
     from multiprocessing.sharedctypes import Array
     return Array(typecode_or_type, size_or_initializer, **kwds)
 
+def SharedArray(typecode, size_or_initializer):
+    '''
+    Returns a shared array which is pickled by handle
+    '''
+    from multiprocessing.sharedctypes import SharedArray
+    return SharedArray(typecode, size_or_initializer)
+
 #
 #
 #
@@ -18,7 +18,7 @@ import itertools
 import collections
 import time
 
-from multiprocessing import Process, cpu_count, TimeoutError
+from multiprocessing import Process, cpu_count, TimeoutError, RawValue
 from multiprocessing.util import Finalize, debug
 
 #
@@ -29,20 +29,49 @@ RUN = 0
 CLOSE = 1
 TERMINATE = 2
 
+#
+# Scheduling parameters
+#
+
+# each worker has about this many messages of tasks in the pipeline, so
+# that tasks are only split up and handed out once a worker is ready
+MESSAGES_PER_WORKER = 2
+
+# tasks which are quick to run are sent, and their results returned, in
+# batches of up to this many which take about BATCH_TIME seconds; only the
+# tasks of a job (or the apply_async() calls of a function) which has been
+# timed are batched together, and timings are kept for up to MAX_TIMED jobs
+MAX_BATCH = 64
+BATCH_TIME = 0.005
+MAX_TIMED = 1000
+
+# map() without a chunksize hands out single items until it knows how long
+# an item takes, then chunks which take about CHUNK_TIME seconds but are
+# no more than a 1/(GUIDED_FACTOR * processes) share of the items left
+GUIDED_FACTOR = 4
+CHUNK_TIME = 0.01
+
 #
 # Miscellaneous
 #
 
 job_counter = itertools.count()
+batch_counter = itertools.count(1)
 
 def mapstar(args):
     return map(*args)
 
+def timed_mapstar(args):
+    start = time.time()
+    result = map(*args)
+    return time.time() - start, result
+
 #
 # Code run by worker processes
 #
 
-def worker(inqueue, outqueue, initializer=None, initargs=(), maxtasks=None):
+def worker(inqueue, outqueue, initializer=None, initargs=(), maxtasks=None,
+           taken=None):
     assert maxtasks is None or (type(maxtasks) == int and maxtasks > 0)
     put = outqueue.put
     get = inqueue.get
@@ -56,22 +85,29 @@ def worker(inqueue, outqueue, initializer=None, initargs=(), maxtasks=None):
     completed = 0
     while maxtasks is None or (maxtasks and completed < maxtasks):
         try:
-            task = get()
+            batch = get()
         except (EOFError, IOError):
             debug('worker got EOFError or IOError -- exiting')
             break
 
-        if task is None:
+        if batch is None:
             debug('worker got sentinel -- exiting')
             break
 
-        job, i, func, args, kwds = task
-        try:
-            result = (True, func(*args, **kwds))
-        except Exception, e:
-            result = (False, e)
-        put((job, i, result))
-        completed += 1
+        seq, batch = batch
+        if taken is not None:
+            # let the pool know which message dies with us, if we do
+            taken.value = seq
+        start = time.time()
+        results = []
+        for job, i, func, args, kwds in batch:
+            try:
+                result = (True, func(*args, **kwds))
+            except Exception, e:
+                result = (False, e)
+            results.append((job, i, result))
+        put((seq, time.time() - start, results))
+        completed += len(batch)
     debug('worker exiting after %d tasks' % completed)
 
 #
@@ -83,6 +119,7 @@ class Pool(object):
     Class which supports an async version of the `apply()` builtin
     '''
     Process = Process
+    _batch_tasks = True
 
     def __init__(self, processes=None, initializer=None, initargs=(),
                  maxtasksperchild=None):
@@ -103,9 +140,16 @@ class Pool(object):
         if initializer is not None and not hasattr(initializer, '__call__'):
             raise TypeError('initializer must be a callable')
 
+        # slots for the messages of tasks which have not been answered yet,
+        # and the sequence numbers of those messages
+        self._inflight = threading.Semaphore(processes * MESSAGES_PER_WORKER)
+        self._unanswered = set()
+
         self._processes = processes
         self._pool = []
         self._repopulate_pool()
+        # average time a task takes, by job or function
+        self._task_times = {}
 
         self._worker_handler = threading.Thread(
             target=Pool._handle_workers,
@@ -118,7 +162,10 @@ class Pool(object):
 
         self._task_handler = threading.Thread(
             target=Pool._handle_tasks,
-            args=(self._taskqueue, self._quick_put, self._outqueue, self._pool)
+            args=(self._taskqueue, self._quick_put, self._outqueue, self._pool,
+                  self._cache, self._inflight, self._unanswered,
+                  self._task_times,
+                  self._batch_tasks and maxtasksperchild is None)
             )
         self._task_handler.daemon = True
         self._task_handler._state = RUN
@@ -126,7 +173,8 @@ class Pool(object):
 
         self._result_handler = threading.Thread(
             target=Pool._handle_results,
-            args=(self._outqueue, self._quick_get, self._cache)
+            args=(self._outqueue, self._quick_get, self._cache,
+                  self._inflight, self._unanswered, self._task_times)
             )
         self._result_handler.daemon = True
         self._result_handler._state = RUN
@@ -136,7 +184,7 @@ class Pool(object):
             self, self._terminate_pool,
             args=(self._taskqueue, self._inqueue, self._outqueue, self._pool,
                   self._worker_handler, self._task_handler,
-                  self._result_handler, self._cache),
+                  self._result_handler, self._cache, self._inflight),
             exitpriority=15
             )
 
@@ -153,6 +201,11 @@ class Pool(object):
                 worker.join()
                 cleaned = True
                 del self._pool[i]
+                if worker.exitcode != 0 and worker._taken is not None:
+                    # if it died with a message of tasks, the message will
+                    # never be answered: give back its slot
+                    Pool._answered(self._unanswered, self._inflight,
+                                   worker._taken.value)
         return cleaned
 
     def _repopulate_pool(self):
@@ -160,17 +213,28 @@ class Pool(object):
         for use after reaping workers which have exited.
         """
         for i in range(self._processes - len(self._pool)):
+            taken = self._new_taken()
             w = self.Process(target=worker,
                              args=(self._inqueue, self._outqueue,
                                    self._initializer,
-                                   self._initargs, self._maxtasksperchild)
+                                   self._initargs, self._maxtasksperchild,
+                                   taken)
                             )
+            w._taken = taken
             self._pool.append(w)
             w.name = w.name.replace('Process', 'PoolWorker')
             w.daemon = True
             w.start()
             debug('added worker')
 
+    def _new_taken(self):
+        # where a worker records the sequence number of its message
+        try:
+            return RawValue('l', 0)
+        except ImportError:
+            # no ctypes: the slots of workers which die are lost
+            return None
+
     def _maintain_pool(self):
         """Clean up any exited workers and start replacements for them.
         """
@@ -240,6 +304,7 @@ class Pool(object):
         '''
         assert self._state == RUN
         result = ApplyResult(self._cache, callback)
+        result._time_key = func
         self._taskqueue.put(([(result._job, None, func, args, kwds)], None))
         return result
 
@@ -251,10 +316,13 @@ class Pool(object):
         if not hasattr(iterable, '__len__'):
             iterable = list(iterable)
 
-        if chunksize is None:
-            chunksize, extra = divmod(len(iterable), len(self._pool) * 4)
-            if extra:
-                chunksize += 1
+        if chunksize is None and len(iterable) > 0:
+            chunker = GuidedChunker(func, iterable, self._processes)
+            result = MapResult(self._cache, 1, len(iterable), callback,
+                               chunker)
+            self._taskqueue.put((((result._job, start, timed_mapstar, (x,), {})
+                                  for start, x in chunker), None))
+            return result
         if len(iterable) == 0:
             chunksize = 0
 
@@ -272,29 +340,66 @@ class Pool(object):
         debug('worker handler exiting')
 
     @staticmethod
-    def _handle_tasks(taskqueue, put, outqueue, pool):
+    def _handle_tasks(taskqueue, put, outqueue, pool, cache, inflight,
+                      unanswered, task_times, batching):
         thread = threading.current_thread()
+        taskseq = set_length = task = None
+        count = 0
+        finished = False
 
-        for taskseq, set_length in iter(taskqueue.get, None):
-            i = -1
-            for i, task in enumerate(taskseq):
-                if thread._state:
-                    debug('task handler found thread._state != RUN')
-                    break
-                try:
-                    put(task)
-                except IOError:
-                    debug('could not put task on queue')
+        while not finished:
+            # wait until a worker is about to need more work
+            inflight.acquire()
+            if thread._state:
+                debug('task handler found thread._state != RUN')
+                break
+
+            # take as many tasks of one job as are quick to run and
+            # already at hand; a task of another job waits for the next
+            # message
+            batch = []
+            while True:
+                if task is None and taskseq is None:
+                    try:
+                        seq = taskqueue.get(not batch)
+                    except Queue.Empty:
+                        break
+                    if seq is None:
+                        debug('task handler got sentinel')
+                        finished = True
+                        break
+                    taskseq, set_length = seq
+                    taskseq = iter(taskseq)
+                    count = 0
+                if task is None:
+                    try:
+                        task = taskseq.next()
+                    except StopIteration:
+                        if set_length:
+                            debug('doing set_length()')
+                            set_length(count)
+                        taskseq = None
+                        continue
+                    count += 1
+                if not batch:
+                    key = Pool._time_key(cache, task[0])
+                    limit = batching and Pool._batch_size(task_times, key) or 1
+                elif (len(batch) >= limit or
+                      Pool._time_key(cache, task[0]) != key):
                     break
-            else:
-                if set_length:
-                    debug('doing set_length()')
-                    set_length(i+1)
-                continue
-            break
-        else:
-            debug('task handler got sentinel')
+                batch.append(task)
+                task = None
 
+            if not batch:
+                inflight.release()
+                continue
+            seq = batch_counter.next()
+            unanswered.add(seq)
+            try:
+                put((seq, batch))
+            except IOError:
+                debug('could not put task on queue')
+                break
 
         try:
             # tell result handler to finish when cache is empty
@@ -311,12 +416,60 @@ class Pool(object):
         debug('task handler exiting')
 
     @staticmethod
-    def _handle_results(outqueue, get, cache):
+    def _time_key(cache, job):
+        # tasks are timed by job, except apply_async() calls, which are
+        # jobs of one task, by function
+        return getattr(cache.get(job), '_time_key', job)
+
+    @staticmethod
+    def _batch_size(task_times, key):
+        seconds = task_times.get(key)
+        if seconds is None:
+            return 1
+        return max(1, min(MAX_BATCH, int(BATCH_TIME / max(seconds, 1e-6))))
+
+    @staticmethod
+    def _record_time(task_times, key, elapsed, ntasks):
+        seconds = elapsed / ntasks
+        average = task_times.get(key)
+        if average is None:
+            if len(task_times) >= MAX_TIMED:
+                task_times.clear()
+            task_times[key] = seconds
+        else:
+            task_times[key] = 0.75 * average + 0.25 * seconds
+
+    @staticmethod
+    def _answered(unanswered, inflight, seq):
+        # the reply and the death of a worker which sent it may both be
+        # seen: only the first gives back the slot
+        try:
+            unanswered.remove(seq)
+        except KeyError:
+            return
+        inflight.release()
+
+    @staticmethod
+    def _handle_results(outqueue, get, cache, inflight, unanswered,
+                        task_times):
         thread = threading.current_thread()
 
+        def set_results(reply):
+            seq, elapsed, results = reply
+            Pool._answered(unanswered, inflight, seq)
+            if results:
+                # the tasks of a batch all have the same key
+                key = Pool._time_key(cache, results[0][0])
+                Pool._record_time(task_times, key, elapsed, len(results))
+            for job, i, obj in results:
+                try:
+                    cache[job]._set(i, obj)
+                except KeyError:
+                    pass
+
         while 1:
             try:
-                task = get()
+                reply = get()
             except (IOError, EOFError):
                 debug('result handler got EOFError/IOError -- exiting')
                 return
@@ -326,31 +479,23 @@ class Pool(object):
                 debug('result handler found thread._state=TERMINATE')
                 break
 
-            if task is None:
+            if reply is None:
                 debug('result handler got sentinel')
                 break
 
-            job, i, obj = task
-            try:
-                cache[job]._set(i, obj)
-            except KeyError:
-                pass
+            set_results(reply)
 
         while cache and thread._state != TERMINATE:
             try:
-                task = get()
+                reply = get()
             except (IOError, EOFError):
                 debug('result handler got EOFError/IOError -- exiting')
                 return
 
-            if task is None:
+            if reply is None:
                 debug('result handler ignoring extra sentinel')
                 continue
-            job, i, obj = task
-            try:
-                cache[job]._set(i, obj)
-            except KeyError:
-                pass
+            set_results(reply)
 
         if hasattr(outqueue, '_reader'):
             debug('ensuring that outqueue is not full')
@@ -415,13 +560,15 @@ class Pool(object):
 
     @classmethod
     def _terminate_pool(cls, taskqueue, inqueue, outqueue, pool,
-                        worker_handler, task_handler, result_handler, cache):
+                        worker_handler, task_handler, result_handler, cache,
+                        inflight):
         # this is guaranteed to only be called once
         debug('finalizing pool')
 
         worker_handler._state = TERMINATE
         task_handler._state = TERMINATE
         taskqueue.put(None)                 # sentinel
+        inflight.release()                  # in case the task handler waits
 
         debug('helping task handler/workers to finish')
         cls._help_stuff_finish(inqueue, task_handler, len(pool))
@@ -508,22 +655,33 @@ class ApplyResult(object):
 
 class MapResult(ApplyResult):
 
-    def __init__(self, cache, chunksize, length, callback):
+    def __init__(self, cache, chunksize, length, callback, chunker=None):
         ApplyResult.__init__(self, cache, callback)
         self._success = True
         self._value = [None] * length
         self._chunksize = chunksize
+        self._chunker = chunker
         if chunksize <= 0:
             self._number_left = 0
             self._ready = True
+        elif chunker is not None:
+            # chunks vary in size, so count the items instead
+            self._number_left = length
         else:
             self._number_left = length//chunksize + bool(length % chunksize)
 
     def _set(self, i, success_result):
         success, result = success_result
         if success:
-            self._value[i*self._chunksize:(i+1)*self._chunksize] = result
-            self._number_left -= 1
+            if self._chunker is None:
+                self._value[i*self._chunksize:(i+1)*self._chunksize] = result
+                self._number_left -= 1
+            else:
+                # i is the index of the first item of the chunk
+                elapsed, result = result
+                self._chunker.record(len(result), elapsed)
+                self._value[i:i+len(result)] = result
+                self._number_left -= len(result)
             if self._number_left == 0:
                 if self._callback:
                     self._callback(self._value)
@@ -546,6 +704,46 @@ class MapResult(ApplyResult):
             finally:
                 self._cond.release()
 
+#
+# Class which splits the work of `Pool.map()` into shrinking chunks
+#
+
+class GuidedChunker(object):
+    '''
+    Iterable of `(start, (func, items))` chunks of a sequence, sized
+    as they are handed out so that the workers finish together
+    '''
+    def __init__(self, func, iterable, processes):
+        self._func = func
+        self._iterable = iterable
+        self._length = len(iterable)
+        self._processes = max(processes, 1)
+        self._item_time = None
+
+    def record(self, nitems, elapsed):
+        if nitems:
+            seconds = elapsed / nitems
+            if self._item_time is None:
+                self._item_time = seconds
+            else:
+                self._item_time = 0.75 * self._item_time + 0.25 * seconds
+
+    def __iter__(self):
+        it = iter(self._iterable)
+        start = 0
+        while start < self._length:
+            if self._item_time is None:
+                size = 1
+            else:
+                size = min(int(CHUNK_TIME / max(self._item_time, 1e-9)),
+                           (self._length - start) //
+                           (GUIDED_FACTOR * self._processes))
+            x = tuple(itertools.islice(it, max(size, 1)))
+            if not x:
+                return
+            yield start, (self._func, x)
+            start += len(x)
+
 #
 # Class whose instances are returned by `Pool.imap()`
 #
@@ -644,9 +842,17 @@ class ThreadPool(Pool):
 
     from .dummy import Process
 
+    # batches only save round trips through pipes, and a thread can't be
+    # terminated in the middle of one
+    _batch_tasks = False
+
     def __init__(self, processes=None, initializer=None, initargs=()):
         Pool.__init__(self, processes, initializer, initargs)
 
+    def _new_taken(self):
+        # threads don't die in the middle of a message
+        return None
+
     def _setup_queues(self):
         self._inqueue = Queue.Queue()
         self._outqueue = Queue.Queue()
@@ -6,14 +6,21 @@
 # Copyright (c) 2007-2008, R Oudkerk --- see COPYING.txt
 #
 
+import os
 import sys
+import mmap
+import array
 import ctypes
 import weakref
+import tempfile
+import itertools
 
 from multiprocessing import heap, RLock
 from multiprocessing.forking import assert_spawning, ForkingPickler
+from multiprocessing.util import Finalize, get_temp_dir
 
-__all__ = ['RawValue', 'RawArray', 'Value', 'Array', 'copy', 'synchronized']
+__all__ = ['RawValue', 'RawArray', 'Value', 'Array', 'SharedArray', 'copy',
+           'synchronized']
 
 #
 #
@@ -93,6 +100,41 @@ def Array(typecode_or_type, size_or_initializer, **kwds):
         raise AttributeError("'%r' has no method 'acquire'" % lock)
     return synchronized(obj, lock)
 
+def SharedArray(typecode, size_or_initializer):
+    '''
+    Returns a ctypes array backed by a shared file mapping which is
+    pickled by handle rather than by value
+    '''
+    if isinstance(size_or_initializer, (int, long)):
+        length, init = size_or_initializer, None
+    else:
+        length, init = len(size_or_initializer), size_or_initializer
+    if length < 0:
+        raise ValueError('array size must not be negative')
+    type_ = _shared_array_type(typecode, length)
+
+    prefix = 'pymp-array-%d-%d-' % (os.getpid(), _shared_array_counter.next())
+    fd, path = tempfile.mkstemp(prefix=prefix, dir=_shared_array_dir())
+    try:
+        try:
+            size = max(ctypes.sizeof(type_), 1)
+            os.lseek(fd, size - 1, os.SEEK_SET)
+            os.write(fd, '\0')
+            obj = _map_shared_array(type_, fd, path)
+        finally:
+            os.close(fd)
+    except:
+        _unlink_shared_array(path)
+        raise
+    Finalize(obj, _unlink_shared_array, args=(path,), exitpriority=0)
+
+    if init is not None:
+        if isinstance(init, array.array) and init.typecode == typecode:
+            ctypes.memmove(obj, init.buffer_info()[0], ctypes.sizeof(obj))
+        else:
+            obj[:] = init
+    return obj
+
 def copy(obj):
     new_obj = _new_value(type(obj))
     ctypes.pointer(new_obj)[0] = obj
@@ -137,6 +179,73 @@ def rebuild_ctype(type_, wrapper, length):
     obj._wrapper = wrapper
     return obj
 
+def rebuild_shared_array(path, typecode, length):
+    obj = _attached_arrays.get(path)
+    if obj is None:
+        type_ = _shared_array_type(typecode, length)
+        fd = os.open(path, os.O_RDWR)
+        try:
+            obj = _map_shared_array(type_, fd, path)
+        finally:
+            os.close(fd)
+    return obj
+
+#
+# Support for SharedArray
+#
+
+class SharedArrayBase(object):
+    '''
+    Base of the ctypes array types returned by SharedArray()
+    '''
+
+    def __reduce__(self):
+        return rebuild_shared_array, (self._path, self.typecode, len(self))
+
+    def tolist(self):
+        return list(self)
+
+    def __repr__(self):
+        return '<SharedArray(%r, %d) at %r>' % (self.typecode, len(self),
+                                                self._path)
+
+_shared_array_counter = itertools.count()
+_shared_array_types = {}
+_attached_arrays = weakref.WeakValueDictionary()
+
+def _shared_array_type(typecode, length):
+    try:
+        return _shared_array_types[typecode, length]
+    except KeyError:
+        pass
+    type_ = typecode_to_type.get(typecode)
+    if type_ is None or ctypes.sizeof(type_) != array.array(typecode).itemsize:
+        raise ValueError('bad typecode %r for a shared array' % (typecode,))
+    d = dict(_type_=type_, _length_=length, typecode=typecode,
+             itemsize=ctypes.sizeof(type_))
+    cls = type('SharedArray', (SharedArrayBase, type_ * length), d)
+    _shared_array_types[typecode, length] = cls
+    return cls
+
+def _shared_array_dir():
+    # a memory backed filesystem saves the pages being written back to disk
+    if os.path.isdir('/dev/shm') and os.access('/dev/shm', os.W_OK | os.X_OK):
+        return '/dev/shm'
+    return get_temp_dir()
+
+def _map_shared_array(type_, fd, path):
+    buf = mmap.mmap(fd, max(ctypes.sizeof(type_), 1))
+    obj = type_.from_buffer(buf)
+    obj._path = path
+    _attached_arrays[path] = obj
+    return obj
+
+def _unlink_shared_array(path):
+    try:
+        os.unlink(path)
+    except OSError:
+        pass
+
 #
 # Function to create properties
 #
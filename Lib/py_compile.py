@@ -120,13 +120,32 @@ def compile(file, cfile=None, dfile=None, doraise=False):
             return
     if cfile is None:
         cfile = file + (__debug__ and 'c' or 'o')
-    with open(cfile, 'wb') as fc:
-        fc.write('\0\0\0\0')
-        wr_long(fc, timestamp)
-        marshal.dump(codeobject, fc)
-        fc.flush()
-        fc.seek(0, 0)
-        fc.write(MAGIC)
+    # Write a new file and rename it over cfile instead of truncating
+    # cfile: the importer maps byte-code files in memory, and a process
+    # with the old file mapped would crash if it shrank under it.
+    tmpfile = '%s.%d.tmp' % (cfile, os.getpid())
+    try:
+        with open(tmpfile, 'wb') as fc:
+            fc.write('\0\0\0\0')
+            wr_long(fc, timestamp)
+            marshal.dump(codeobject, fc)
+            fc.flush()
+            fc.seek(0, 0)
+            fc.write(MAGIC)
+        try:
+            os.rename(tmpfile, cfile)
+        except OSError:
+            # Windows doesn't rename over an existing file
+            if os.name != 'nt' or not os.path.exists(cfile):
+                raise
+            os.unlink(cfile)
+            os.rename(tmpfile, cfile)
+    except:
+        try:
+            os.unlink(tmpfile)
+        except OSError:
+            pass
+        raise
 
 def main(args=None):
     """Compile several source files.
@@ -92,6 +92,7 @@ except ImportError:
     errno = None
 EBADF = getattr(errno, 'EBADF', 9)
 EINTR = getattr(errno, 'EINTR', 4)
+EAGAIN = getattr(errno, 'EAGAIN', 11)
 
 __all__ = ["getfqdn", "create_connection"]
 __all__.extend(os._get_exports_list(_socket))
@@ -159,6 +160,11 @@ if os.name == "nt":
 if sys.platform == "riscos":
     _socketmethods = _socketmethods + ('sleeptaskw',)
 
+# Scatter/gather and batched I/O, where the platform supports it.
+for _m in ('recvmsg', 'recvmsg_into', 'recvmmsg_into', 'sendmsg', 'sendmmsg'):
+    if hasattr(_realsocket, _m):
+        _socketmethods = _socketmethods + (_m,)
+
 # All the method names that must be delegated to either the real socket
 # object or the _closedsocket object.
 _delegate_methods = ("recv", "recvfrom", "recv_into", "recvfrom_into",
@@ -172,6 +178,10 @@ class _closedsocket(object):
     send = recv = recv_into = sendto = recvfrom = recvfrom_into = _dummy
     __getattr__ = _dummy
 
+class _GiveupOnSendfile(Exception):
+    # Raised internally when sendfile() must fall back to send().
+    pass
+
 # Wrapper around platform socket objects. This implements
 # a platform-independent dup() functionality. The
 # implementation currently relies on reference counting
@@ -214,6 +224,108 @@ class _socketobject(object):
         and bufsize arguments are as for the built-in open() function."""
         return _fileobject(self._sock, mode, bufsize)
 
+    def sendfile(self, file, offset=0, count=None):
+        """sendfile(file[, offset[, count]]) -> sent
+
+        Send a file until EOF is reached and return the total number of
+        bytes sent.  file must be a regular file object opened in binary
+        mode.  The data is handed to os.sendfile() so that it never passes
+        through user space; if that is not possible (no os.sendfile(), or
+        file has no usable file descriptor) read() and send() are used
+        instead.  offset tells where to start reading the file; if count
+        is given, only that many bytes are sent.  On return, or in case of
+        error, the file position is left just after the last byte sent.
+        Non-blocking sockets are not supported."""
+        if self.gettimeout() == 0:
+            raise ValueError("non-blocking sockets are not supported")
+        if count is not None and count <= 0:
+            if count < 0:
+                raise ValueError("count must be a positive integer")
+            return 0
+        try:
+            return self._sendfile_use_sendfile(file, offset, count)
+        except _GiveupOnSendfile:
+            return self._sendfile_use_send(file, offset, count)
+
+    def _sendfile_use_sendfile(self, file, offset, count):
+        if not hasattr(os, 'sendfile'):
+            raise _GiveupOnSendfile
+        try:
+            fileno = file.fileno()
+            fsize = os.fstat(fileno).st_size
+        except (AttributeError, EnvironmentError, ValueError):
+            # Not a real file (StringIO, BytesIO...).
+            raise _GiveupOnSendfile
+        if not fsize:
+            # Pipes, sockets and empty files: nothing for sendfile() to map.
+            raise _GiveupOnSendfile
+        # Ask for no more than 1GB at once so that every call returns
+        # reasonably fast even for huge files.
+        blocksize = min(count or fsize, 1 << 30)
+        sock_timeout = self.gettimeout()
+        sockno = self.fileno()
+        total_sent = 0
+        try:
+            while True:
+                if count:
+                    blocksize = min(count - total_sent, blocksize)
+                    if blocksize <= 0:
+                        break
+                try:
+                    sent = os.sendfile(sockno, fileno, offset, blocksize)
+                except OSError, e:
+                    if e.errno == EINTR:
+                        continue
+                    if e.errno == EAGAIN and sock_timeout is not None:
+                        # The socket is non-blocking under the hood because
+                        # a timeout was set; wait for it to drain.
+                        import select
+                        if not select.select([], [sockno], [], sock_timeout)[1]:
+                            raise timeout('timed out')
+                        continue
+                    if total_sent == 0:
+                        # The kernel does not support this combination of
+                        # descriptors; fall back to plain send().
+                        raise _GiveupOnSendfile
+                    raise
+                if not sent:
+                    break  # EOF
+                offset += sent
+                total_sent += sent
+            return total_sent
+        finally:
+            if total_sent > 0 and hasattr(file, 'seek'):
+                file.seek(offset)
+
+    def _sendfile_use_send(self, file, offset, count):
+        if offset:
+            file.seek(offset)
+        blocksize = min(count, 8192) if count else 8192
+        total_sent = 0
+        try:
+            while True:
+                if count:
+                    blocksize = min(count - total_sent, blocksize)
+                    if blocksize <= 0:
+                        break
+                data = file.read(blocksize)
+                if not data:
+                    break
+                view = memoryview(data)
+                while view:
+                    try:
+                        sent = self.send(view)
+                    except error, e:
+                        if e.args[0] == EINTR:
+                            continue
+                        raise
+                    total_sent += sent
+                    view = view[sent:]
+            return total_sent
+        finally:
+            if total_sent > 0 and hasattr(file, 'seek'):
+                file.seek(offset + total_sent)
+
     family = property(lambda self: self._sock.family, doc="the socket family")
     type = property(lambda self: self._sock.type, doc="the socket type")
     proto = property(lambda self: self._sock.proto, doc="the socket protocol")
@@ -208,6 +208,25 @@ class SSLSocket(socket):
         else:
             return socket.sendall(self, data, flags)
 
+    def sendfile(self, file, offset=0, count=None):
+        if self._sslobj:
+            # The data must go through the SSL layer: no zero-copy here.
+            if self.gettimeout() == 0:
+                raise ValueError("non-blocking sockets are not supported")
+            return self._sendfile_use_send(file, offset, count)
+        else:
+            return socket.sendfile(self, file, offset, count)
+
+    def sendmsg(self, *args, **kwargs):
+        # Ancillary data and scatter/gather I/O can't go through the SSL
+        # layer.
+        raise NotImplementedError("sendmsg not allowed on instances of %s" %
+                                  self.__class__)
+
+    def sendmmsg(self, *args, **kwargs):
+        raise NotImplementedError("sendmmsg not allowed on instances of %s" %
+                                  self.__class__)
+
     def recv(self, buflen=1024, flags=0):
         if self._sslobj:
             if flags != 0:
@@ -249,6 +268,18 @@ class SSLSocket(socket):
         else:
             return socket.recvfrom_into(self, buffer, nbytes, flags)
 
+    def recvmsg(self, *args, **kwargs):
+        raise NotImplementedError("recvmsg not allowed on instances of %s" %
+                                  self.__class__)
+
+    def recvmsg_into(self, *args, **kwargs):
+        raise NotImplementedError("recvmsg_into not allowed on instances "
+                                  "of %s" % self.__class__)
+
+    def recvmmsg_into(self, *args, **kwargs):
+        raise NotImplementedError("recvmmsg_into not allowed on instances "
+                                  "of %s" % self.__class__)
+
     def pending(self):
         if self._sslobj:
             return self._sslobj.pending()
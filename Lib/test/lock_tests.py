@@ -4,7 +4,7 @@ Various tests for synchronization primitives.
 
 import sys
 import time
-from thread import start_new_thread, get_ident
+from thread import start_new_thread, get_ident, TIMEOUT_MAX
 import threading
 import unittest
 
@@ -143,6 +143,53 @@ class BaseLockTests(BaseTestCase):
         Bunch(f, 15).wait_for_finished()
         self.assertEqual(n, len(threading.enumerate()))
 
+    def test_timeout(self):
+        lock = self.locktype()
+        # Can't set timeout if not blocking
+        self.assertRaises(ValueError, lock.acquire, 0, 1)
+        # Invalid timeout values
+        self.assertRaises(ValueError, lock.acquire, timeout=-100)
+        self.assertRaises(OverflowError, lock.acquire, timeout=1e100)
+        self.assertRaises(OverflowError, lock.acquire,
+                          timeout=TIMEOUT_MAX + 1)
+        # TIMEOUT_MAX is ok
+        lock.acquire(timeout=TIMEOUT_MAX)
+        lock.release()
+        t1 = time.time()
+        self.assertTrue(lock.acquire(timeout=5))
+        t2 = time.time()
+        # Just a sanity test that it didn't actually wait for the timeout.
+        self.assertLess(t2 - t1, 5)
+        results = []
+        def f():
+            t1 = time.time()
+            results.append(lock.acquire(timeout=0.5))
+            t2 = time.time()
+            results.append(t2 - t1)
+        Bunch(f, 1).wait_for_finished()
+        self.assertFalse(results[0])
+        self.assertGreaterEqual(results[1], 0.5)
+        lock.release()
+
+    def test_timeout_released(self):
+        # A waiter wakes up as soon as the lock is released, well before
+        # its timeout.
+        lock = self.locktype()
+        lock.acquire()
+        results = []
+        def f():
+            t1 = time.time()
+            results.append(lock.acquire(timeout=10))
+            results.append(time.time() - t1)
+            lock.release()
+        b = Bunch(f, 1)
+        b.wait_for_started()
+        _wait()
+        lock.release()
+        b.wait_for_finished()
+        self.assertTrue(results[0])
+        self.assertLess(results[1], 5)
+
 
 class LockTests(BaseLockTests):
     """
@@ -330,27 +377,47 @@ class ConditionTests(BaseTestCase):
         cond = self.condtype()
         self.assertRaises(RuntimeError, cond.wait)
 
+    def test_wait_restores_recursion(self):
+        # wait() releases an RLock completely, and restores its level
+        cond = self.condtype()
+        cond.acquire()
+        cond.acquire()
+        cond.wait(0.01)
+        self.assertTrue(cond._is_owned())
+        cond.release()
+        self.assertTrue(cond._is_owned())
+        cond.release()
+        self.assertFalse(cond._is_owned())
+        self.assertRaises(RuntimeError, cond.release)
+
     def test_unacquired_notify(self):
         cond = self.condtype()
         self.assertRaises(RuntimeError, cond.notify)
 
     def _check_notify(self, cond):
         N = 5
+        # The threads append to ready with the lock held, just before they
+        # wait: once the lock can be acquired again, they are waiting.
+        ready = []
         results1 = []
         results2 = []
         phase_num = 0
         def f():
             cond.acquire()
+            ready.append(phase_num)
             cond.wait()
             cond.release()
             results1.append(phase_num)
             cond.acquire()
+            ready.append(phase_num)
             cond.wait()
             cond.release()
             results2.append(phase_num)
         b = Bunch(f, N)
         b.wait_for_started()
-        _wait()
+        while len(ready) < 5:
+            _wait()
+        del ready[:]
         self.assertEqual(results1, [])
         # Notify 3 threads at first
         cond.acquire()
@@ -362,6 +429,9 @@ class ConditionTests(BaseTestCase):
             _wait()
         self.assertEqual(results1, [1] * 3)
         self.assertEqual(results2, [])
+        # Make sure the awoken threads are waiting again
+        while len(ready) < 3:
+            _wait()
         # Notify 5 threads: they might be in their first or second wait
         cond.acquire()
         cond.notify(5)
@@ -372,6 +442,9 @@ class ConditionTests(BaseTestCase):
             _wait()
         self.assertEqual(results1, [1] * 3 + [2] * 2)
         self.assertEqual(results2, [2] * 3)
+        # Make sure all the threads are in their second wait
+        while len(ready) < 5:
+            _wait()
         # Notify all threads: they are all in their second wait
         cond.acquire()
         cond.notify_all()
@@ -6,7 +6,7 @@
 import unittest
 from test import test_support
 from weakref import proxy
-import array, cStringIO
+import array, cStringIO, io, mmap, operator
 from cPickle import loads, dumps, HIGHEST_PROTOCOL
 
 class ArraySubclass(array.array):
@@ -75,6 +75,9 @@ class BaseTest(unittest.TestCase):
         if a.itemsize in (1, 2, 4, 8):
             b = array.array(self.typecode, self.example)
             b.byteswap()
+            s, n = a.tostring(), a.itemsize
+            self.assertEqual(b.tostring(),
+                ''.join(s[i:i+n][::-1] for i in range(0, len(s), n)))
             if a.itemsize==1:
                 self.assertEqual(a, b)
             else:
@@ -188,6 +191,139 @@ class BaseTest(unittest.TestCase):
                 f.close()
             test_support.unlink(test_support.TESTFN)
 
+    def test_tofromfile_io(self):
+        a = array.array(self.typecode, 2*self.example)
+        n = len(self.example)
+        for buffering in (0, -1):
+            test_support.unlink(test_support.TESTFN)
+            try:
+                with io.open(test_support.TESTFN, 'wb', buffering) as f:
+                    a.tofile(f)
+                with io.open(test_support.TESTFN, 'rb', buffering) as f:
+                    self.assertEqual(f.read(), a.tostring())
+                    f.seek(0)
+                    b = array.array(self.typecode)
+                    b.fromfile(f, n)
+                    self.assertEqual(b, array.array(self.typecode,
+                                                    self.example))
+                    b.fromfile(f, n)
+                    self.assertEqual(a, b)
+                    self.assertRaises(EOFError, b.fromfile, f, 1)
+                    self.assertEqual(a, b)
+            finally:
+                test_support.unlink(test_support.TESTFN)
+        # Items that were read are kept, a partial one is dropped
+        f = io.BytesIO(a.tostring()[:-1])
+        b = array.array(self.typecode)
+        self.assertRaises(EOFError, b.fromfile, f, 2*n)
+        self.assertEqual(b, a[:-1])
+        # Short reads and writes
+        class Trickle(io.RawIOBase):
+            def __init__(self, data=''):
+                self.data = data
+                self.written = []
+            def readable(self):
+                return True
+            def writable(self):
+                return True
+            def readinto(self, b):
+                n = len(self.data[:1])
+                b[:n] = self.data[:n]
+                self.data = self.data[n:]
+                return n
+            def write(self, b):
+                self.written.append(b[:1].tobytes())
+                return 1
+        f = Trickle()
+        a.tofile(f)
+        self.assertEqual(''.join(f.written), a.tostring())
+        b = array.array(self.typecode)
+        b.fromfile(Trickle(a.tostring()), 2*n)
+        self.assertEqual(a, b)
+        # A non-blocking raw file which can't write anything returns None
+        class Blocked(Trickle):
+            def write(self, b):
+                return None
+        self.assertRaises(IOError, a.tofile, Blocked())
+
+    def test_frombuffer(self):
+        a = array.array(self.typecode, self.example)
+        s = a.tostring()
+        b = array.frombuffer(self.typecode, s)
+        self.assertEqual(b, a)
+        self.assertEqual(type(b), array.array)
+        b.reverse()
+        self.assertEqual(b, a[::-1])
+        self.assertEqual(s, a.tostring())
+        b = array.frombuffer(self.typecode, s)
+        b.append(b[0])
+        self.assertEqual(b, a + a[:1])
+        # The items of a writable buffer are copied
+        buf = bytearray(s)
+        b = array.frombuffer(self.typecode, buf)
+        self.assertEqual(b, a)
+        buf[:] = '\0' * len(buf)
+        self.assertEqual(b, a)
+        self.assertEqual(array.frombuffer(self.typecode, ''),
+                         array.array(self.typecode))
+        self.assertRaises(ValueError, array.frombuffer, 'x', s)
+        self.assertRaises(TypeError, array.frombuffer, self.typecode, 42)
+        if a.itemsize > 1:
+            self.assertRaises(ValueError, array.frombuffer,
+                              self.typecode, s[:-1])
+        # Misaligned buffers are copied
+        self.assertEqual(array.frombuffer(self.typecode,
+                                          memoryview('x' + s)[1:]), a)
+
+    def readonly_mmap(self, a):
+        # (the memory of an mmap is aligned for all the item types)
+        test_support.unlink(test_support.TESTFN)
+        self.addCleanup(test_support.unlink, test_support.TESTFN)
+        with open(test_support.TESTFN, 'wb') as f:
+            a.tofile(f)
+        with open(test_support.TESTFN, 'rb') as f:
+            m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        self.addCleanup(m.close)
+        return m
+
+    def test_frombuffer_mmap(self):
+        a = array.array(self.typecode, 2*self.example)
+        m = self.readonly_mmap(a)
+        b = array.frombuffer(self.typecode, m)
+        self.assertEqual(b, a)
+        self.assertEqual(b.buffer_info()[0],
+                         array.frombuffer('c', m).buffer_info()[0])
+        # The mmap stays open while shared, and is never written
+        self.assertRaises(BufferError, m.close)
+        b[0] = b[1]
+        self.assertEqual(m[:], a.tostring())
+        m.close()
+        self.assertEqual(b[1:], a[1:])
+        # Writable mmaps are copied
+        with open(test_support.TESTFN, 'r+b') as f:
+            m = mmap.mmap(f.fileno(), 0)
+        try:
+            b = array.frombuffer(self.typecode, m)
+            m[:] = '\0' * len(m)
+            self.assertEqual(b, a)
+        finally:
+            m.close()
+
+    def test_frombuffer_exports(self):
+        a = array.array(self.typecode, self.example)
+        b = array.frombuffer(self.typecode, self.readonly_mmap(a))
+        m = memoryview(b)
+        self.assertTrue(m.readonly)
+        self.assertEqual(m.tobytes(), a.tostring())
+        # The items can't be copied away from a view of them
+        self.assertRaises(BufferError, b.__setitem__, 0, a[1])
+        self.assertRaises(BufferError, b.byteswap)
+        self.assertEqual(b, a)
+        del m
+        b[0] = a[1]
+        m = memoryview(b)
+        self.assertFalse(m.readonly)
+
     def test_filewrite(self):
         a = array.array(self.typecode, 2*self.example)
         f = open(test_support.TESTFN, 'wb')
@@ -275,6 +411,33 @@ class BaseTest(unittest.TestCase):
         self.assertTrue((a > ab) is False)
         self.assertTrue((a >= ab) is False)
 
+    compare_ops = (('<', operator.lt), ('<=', operator.le),
+                   ('==', operator.eq), ('!=', operator.ne),
+                   ('>', operator.gt), ('>=', operator.ge))
+
+    def check_compare(self, a, x):
+        for op, func in self.compare_ops:
+            mask = a.compare(x, op)
+            self.assertEqual(mask.typecode, 'B')
+            if isinstance(x, array.array):
+                expected = [int(func(y, z)) for y, z in zip(a, x)]
+            else:
+                expected = [int(func(y, x)) for y in a]
+            self.assertEqual(mask.tolist(), expected, (op, x))
+
+    def test_compare_items(self):
+        a = array.array(self.typecode, self.example * 5)
+        self.check_compare(a, a[1])
+        self.check_compare(a, self.outside)
+        self.check_compare(a, array.array(self.typecode,
+                                          self.biggerexample * 5))
+        self.check_compare(array.array(self.typecode), self.outside)
+        self.assertRaises(ValueError, a.compare, a, '<>')
+        self.assertRaises(TypeError, a.compare, a)
+        self.assertRaises(ValueError, a.compare, a[:-1], '<')
+        self.assertRaises(TypeError, a.compare,
+                          array.array(self.badtypecode()), '<')
+
     def test_add(self):
         a = array.array(self.typecode, self.example) \
             + array.array(self.typecode, self.example[::-1])
@@ -753,6 +916,42 @@ class BaseTest(unittest.TestCase):
             b = buffer(a)
         self.assertEqual(b[0], a.tostring()[0])
 
+    def test_memoryview(self):
+        a = array.array(self.typecode, self.example)
+        m = memoryview(a)
+        self.assertEqual(m.format, self.typecode)
+        self.assertEqual(m.itemsize, a.itemsize)
+        self.assertEqual(m.shape, (len(a),))
+        self.assertEqual(m.strides, (a.itemsize,))
+        self.assertFalse(m.readonly)
+        self.assertEqual(m.tolist(), a.tolist())
+        self.assertEqual(m[1:3].tobytes(), a[1:3].tostring())
+        # the items can't move while the buffer is exported
+        self.assertRaises(BufferError, a.append, a[0])
+        self.assertRaises(BufferError, a.extend, a)
+        self.assertRaises(BufferError, a.insert, 0, a[0])
+        self.assertRaises(BufferError, a.pop)
+        self.assertRaises(BufferError, a.remove, a[0])
+        self.assertRaises(BufferError, a.fromlist, [a[0]])
+        self.assertRaises(BufferError, a.fromstring, a.tostring())
+        self.assertRaises(BufferError, a.__iadd__, a)
+        self.assertRaises(BufferError, a.__imul__, 2)
+        self.assertRaises(BufferError, a.__delitem__, 0)
+        self.assertRaises(BufferError, a.__delitem__, slice(0, 2))
+        self.assertRaises(BufferError, a.__setslice__, 0, 1, a[:2])
+        self.assertEqual(a, array.array(self.typecode, self.example))
+        # but they can be changed in place
+        a[0] = a[1]
+        a[:2] = a[1:3]
+        a *= 1
+        self.assertEqual(m.tolist(), a.tolist())
+        m2 = m[2:]
+        del m
+        self.assertRaises(BufferError, a.pop)
+        del m2
+        a.append(a[0])
+        self.assertEqual(len(a), len(self.example) + 1)
+
     def test_weakref(self):
         s = array.array(self.typecode, self.example)
         p = proxy(s)
@@ -782,6 +981,13 @@ class StringTest(BaseTest):
         a = array.array(self.typecode, self.example)
         self.assertRaises(TypeError, a.__setitem__, 0, self.example[:2])
 
+    def test_arithmetic(self):
+        a = array.array(self.typecode, self.example)
+        for name in ('sum', 'min', 'max'):
+            self.assertRaises(TypeError, getattr(a, name))
+        for name in ('dot', 'add', 'mul'):
+            self.assertRaises(TypeError, getattr(a, name), a)
+
 class CharacterTest(StringTest):
     typecode = 'c'
     example = '\x01azAZ\x00\xfe'
@@ -912,6 +1118,62 @@ class NumberTest(BaseTest):
         self.assertEqual(a[-1] in a, True)
         self.assertEqual(b[0] not in a, True)
 
+    def test_reductions(self):
+        for example in (self.example, self.smallerexample,
+                        self.biggerexample, self.example * 50):
+            a = array.array(self.typecode, example)
+            for name, func in (('sum', sum), ('min', min), ('max', max)):
+                result = getattr(a, name)()
+                self.assertEqual(result, func(a))
+                self.assertEqual(type(result), type(func(a)))
+        a = array.array(self.typecode)
+        self.assertEqual(a.sum(), 0)
+        self.assertRaises(ValueError, a.min)
+        self.assertRaises(ValueError, a.max)
+        self.assertRaises(TypeError, a.sum, 1)
+
+    def test_dot(self):
+        a = array.array(self.typecode, self.example)
+        b = array.array(self.typecode, self.biggerexample)
+        self.assertEqual(a.dot(b), sum(x * y for x, y in zip(a, b)))
+        self.assertEqual(a.dot(a), sum(x * x for x in a))
+        empty = array.array(self.typecode)
+        self.assertEqual(empty.dot(empty), 0)
+        self.assertRaises(TypeError, a.dot, list(b))
+        self.assertRaises(TypeError, a.dot, self.othernumbers(a))
+        self.assertRaises(ValueError, a.dot, b[:-1])
+
+    def othernumbers(self, a):
+        # An array of the same numbers with another typecode
+        return array.array('f' if self.typecode == 'd' else 'd', a)
+
+    def test_add_mul(self):
+        a = array.array(self.typecode, [0, 1, 2, 5, 11])
+        b = array.array(self.typecode, [1, 0, 3, 2, 4])
+        c = array.array(self.typecode, a)
+        self.assertEqual(c.add(1), None)
+        self.assertEqual(c, array.array(self.typecode, [x + 1 for x in a]))
+        c.mul(0)
+        self.assertEqual(c, array.array(self.typecode, [0] * len(a)))
+        c.add(a)
+        self.assertEqual(c, a)
+        c.add(c)
+        self.assertEqual(c, array.array(self.typecode, [2 * x for x in a]))
+        c = array.array(self.typecode, a * 50)
+        c.mul(b * 50)
+        self.assertEqual(c, array.array(self.typecode,
+                                        [x * y for x, y in zip(a, b)] * 50))
+        self.assertRaises(TypeError, c.add, 'x')
+        self.assertRaises(TypeError, c.mul, list(c))
+        self.assertRaises(TypeError, c.add, self.othernumbers(c))
+        self.assertRaises(ValueError, c.mul, c[:-1])
+
+    def test_compare_numbers(self):
+        a = array.array(self.typecode, self.example)
+        for x in (-1, 0, 1, 1L, 0.5, -2.5, 2 ** 53 + 1, 10 ** 30,
+                  -10 ** 30, float('inf'), float('-inf'), float('nan')):
+            self.check_compare(a, x)
+
     def check_overflow(self, lower, upper):
         # method to be used by subclasses
 
@@ -959,6 +1221,44 @@ class SignedNumberTest(NumberTest):
         upper = long(pow(2, a.itemsize * 8 - 1)) - 1L
         self.check_overflow(lower, upper)
 
+    def test_arithmetic_overflow(self):
+        a = array.array(self.typecode)
+        lower = -1 * long(pow(2, a.itemsize * 8 - 1))
+        upper = long(pow(2, a.itemsize * 8 - 1)) - 1L
+        a = array.array(self.typecode, [lower, upper] * 3)
+        self.assertEqual(a.min(), lower)
+        self.assertEqual(a.max(), upper)
+        self.assertEqual(a.sum(), 3 * (lower + upper))
+        self.assertEqual(array.array(self.typecode, [upper] * 3).sum(),
+                         3 * upper)
+        self.assertEqual(array.array(self.typecode, [lower] * 3).sum(),
+                         3 * lower)
+        self.assertEqual(a.dot(a), 3 * (lower * lower + upper * upper))
+        # Results that don't fit leave the array unchanged
+        b = array.array(self.typecode, a)
+        self.assertRaises(OverflowError, b.add, 1)
+        self.assertRaises(OverflowError, b.add, -1)
+        self.assertRaises(OverflowError, b.mul, 2)
+        self.assertRaises(OverflowError, b.mul, -1)
+        self.assertRaises(OverflowError, b.add, b)
+        self.assertRaises(OverflowError, b.add, upper + 1)
+        self.assertEqual(b, a)
+        b = array.array(self.typecode, [upper, 0, lower + 1])
+        b.mul(-1)
+        self.assertEqual(b, array.array(self.typecode, [-upper, 0, upper]))
+        # Only the results must fit, not the operand
+        b = array.array(self.typecode, [upper, 0])
+        self.assertRaises(OverflowError, b.add, lower - upper)
+        b[1] = upper
+        b.add(lower - upper)
+        self.assertEqual(b, array.array(self.typecode, [lower, lower]))
+        b = array.array(self.typecode, [0, 0])
+        b.mul(10 ** 30)
+        self.assertEqual(b, array.array(self.typecode, [0, 0]))
+        b = array.array(self.typecode, [lower, upper])
+        self.assertRaises(OverflowError, b.mul, b)
+        self.assertEqual(b, array.array(self.typecode, [lower, upper]))
+
 class UnsignedNumberTest(NumberTest):
     example = [0, 1, 17, 23, 42, 0xff]
     smallerexample = [0, 1, 17, 23, 42, 0xfe]
@@ -971,6 +1271,34 @@ class UnsignedNumberTest(NumberTest):
         upper = long(pow(2, a.itemsize * 8)) - 1L
         self.check_overflow(lower, upper)
 
+    def test_arithmetic_overflow(self):
+        a = array.array(self.typecode)
+        upper = long(pow(2, a.itemsize * 8)) - 1L
+        a = array.array(self.typecode, [0, upper] * 3)
+        self.assertEqual(a.min(), 0)
+        self.assertEqual(a.max(), upper)
+        self.assertEqual(a.sum(), 3 * upper)
+        self.assertEqual(a.dot(a), 3 * upper * upper)
+        # Results that don't fit leave the array unchanged
+        b = array.array(self.typecode, a)
+        self.assertRaises(OverflowError, b.add, 1)
+        self.assertRaises(OverflowError, b.add, -1)
+        self.assertRaises(OverflowError, b.mul, 2)
+        self.assertRaises(OverflowError, b.add, b)
+        self.assertRaises(OverflowError, b.mul, b)
+        self.assertEqual(b, a)
+        b.mul(1)
+        self.assertEqual(b, a)
+        # Only the results must fit, not the operand
+        b = array.array(self.typecode, [upper, 200])
+        b.add(-100)
+        self.assertEqual(b, array.array(self.typecode, [upper - 100, 100]))
+        self.assertRaises(OverflowError, b.add, -101)
+        b = array.array(self.typecode, [0, 0])
+        b.mul(-1)
+        self.assertEqual(b, array.array(self.typecode, [0, 0]))
+        self.assertRaises(OverflowError, b.add, -1)
+
 
 class ByteTest(SignedNumberTest):
     typecode = 'b'
@@ -1021,12 +1349,31 @@ class FPTest(NumberTest):
     def assertEntryEqual(self, entry1, entry2):
         self.assertAlmostEqual(entry1, entry2)
 
+    def test_float_arithmetic(self):
+        nan, inf = float('nan'), float('inf')
+        for example in ([nan, 1.0, -1.0], [1.0, nan, -1.0],
+                        [1.0, -1.0, nan], [0.0, -0.0], [-0.0, 0.0],
+                        [inf, -inf, 2.5]):
+            a = array.array(self.typecode, example)
+            for name, func in (('sum', sum), ('min', min), ('max', max)):
+                self.assertEqual(repr(getattr(a, name)()), repr(func(a)))
+        a = array.array(self.typecode, [0.1, 0.2, 0.3] * 10)
+        self.assertEqual(a.sum(), sum(a))
+        self.assertEqual(a.dot(a), sum(x * x for x in a))
+        a.add(0.5)
+        self.assertEqual(a.sum(), sum(a))
+        a.mul(1e400)
+        self.assertEqual(a.max(), inf)
+
     def test_byteswap(self):
         a = array.array(self.typecode, self.example)
         self.assertRaises(TypeError, a.byteswap, 42)
         if a.itemsize in (1, 2, 4, 8):
             b = array.array(self.typecode, self.example)
             b.byteswap()
+            s, n = a.tostring(), a.itemsize
+            self.assertEqual(b.tostring(),
+                ''.join(s[i:i+n][::-1] for i in range(0, len(s), n)))
             if a.itemsize==1:
                 self.assertEqual(a, b)
             else:
@@ -12,6 +12,11 @@ from test import test_support
 from test.test_support import TESTFN, run_unittest, unlink
 from StringIO import StringIO
 
+try:
+    import _asyncore
+except ImportError:
+    _asyncore = None
+
 try:
     import threading
 except ImportError:
@@ -486,6 +491,7 @@ class BaseClient(BaseTestHandler):
 
 
 class BaseTestAPI(unittest.TestCase):
+    event_loop = None
 
     def tearDown(self):
         asyncore.close_all()
@@ -494,7 +500,8 @@ class BaseTestAPI(unittest.TestCase):
         timeout = float(timeout) / 100
         count = 100
         while asyncore.socket_map and count > 0:
-            asyncore.loop(timeout=0.01, count=1, use_poll=self.use_poll)
+            asyncore.loop(timeout=0.01, count=1, use_poll=self.use_poll,
+                          event_loop=self.event_loop)
             if instance.flag:
                 return
             count -= 1
@@ -632,7 +639,8 @@ class BaseTestAPI(unittest.TestCase):
         self.assertFalse(client.accepting)
 
         # execute some loops so that client connects to server
-        asyncore.loop(timeout=0.01, use_poll=self.use_poll, count=100)
+        asyncore.loop(timeout=0.01, use_poll=self.use_poll, count=100,
+                      event_loop=self.event_loop)
         self.assertFalse(server.connected)
         self.assertTrue(server.accepting)
         self.assertTrue(client.connected)
@@ -694,6 +702,238 @@ class TestAPI_UseSelect(BaseTestAPI):
 class TestAPI_UsePoll(BaseTestAPI):
     use_poll = True
 
+class TestAPI_UseEventLoop(BaseTestAPI):
+    use_poll = False
+
+    def setUp(self):
+        self.event_loop = asyncore.EventLoop()
+
+    def tearDown(self):
+        BaseTestAPI.tearDown(self)
+        self.event_loop.close()
+
+class TestAPI_UseEpollPoller(TestAPI_UseEventLoop):
+    # The pure Python fallback of _asyncore.EventLoop
+
+    def setUp(self):
+        self.saved_loop = asyncore._EventLoop
+        asyncore._EventLoop = None
+        TestAPI_UseEventLoop.setUp(self)
+
+    def tearDown(self):
+        TestAPI_UseEventLoop.tearDown(self)
+        asyncore._EventLoop = self.saved_loop
+
+
+class recorder:
+    def __init__(self, readable=True, writable=False):
+        self.events = []
+        self.r = readable
+        self.w = writable
+    def readable(self):
+        return self.r
+    def writable(self):
+        return self.w
+
+class EventLoopTests(unittest.TestCase):
+
+    def event_loop_class(self, dispatch):
+        return _asyncore.EventLoop(dispatch)
+
+    def setUp(self):
+        self.loop = self.event_loop_class(self.dispatch)
+        self.calls = []
+        self.r, self.w = os.pipe()
+
+    def tearDown(self):
+        self.loop.close()
+        os.close(self.r)
+        os.close(self.w)
+
+    def dispatch(self, obj, flags):
+        obj.events.append(flags)
+
+    def test_dispatch(self):
+        reader = recorder()
+        writer = recorder(readable=False, writable=True)
+        map = {self.r: reader, self.w: writer}
+        self.loop.run_once(0, map)
+        self.assertEqual(reader.events, [])
+        self.assertEqual(writer.events, [select.POLLOUT])
+        os.write(self.w, "x")
+        writer.w = False
+        self.loop.run_once(0, map)
+        self.assertEqual(reader.events, [select.POLLIN])
+        self.assertEqual(writer.events, [select.POLLOUT])
+        # A channel which left the map isn't watched any more
+        del map[self.r]
+        self.loop.run_once(0, map)
+        self.assertEqual(reader.events, [select.POLLIN])
+
+    def test_new_socket_same_fd(self):
+        # A dispatcher whose socket was replaced by one with the same fd
+        # number must be registered again.
+        chan = recorder(readable=False, writable=True)
+        a, b = socket.socketpair()
+        fd = a.fileno()
+        chan.socket = a
+        self.loop.run_once(0, {fd: chan})
+        self.assertEqual(chan.events, [select.POLLOUT])
+        a.close()
+        c = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            if c.fileno() != fd:
+                self.skipTest("fd number not reused")
+            chan.socket = c
+            self.loop.run_once(0, {fd: chan})
+            self.assertEqual(chan.events, [select.POLLOUT] * 2)
+        finally:
+            b.close()
+            c.close()
+
+    def test_regular_file(self):
+        chan = recorder()
+        with open(TESTFN, 'wb') as f:
+            try:
+                self.loop.run_once(5, {f.fileno(): chan})
+                self.assertEqual(chan.events, [select.POLLIN | select.POLLPRI])
+            finally:
+                unlink(TESTFN)
+
+    def test_timers(self):
+        t = self.loop.call_later(0.05, self.calls.append, 2)
+        self.loop.call_later(0.05, self.calls.append, 3)
+        self.loop.call_later(0, self.calls.append, 1)
+        self.loop.call_later(0, self.calls.append, 0).cancel()
+        self.assertTrue(t.active)
+        self.assertGreater(t.when, self.loop.time())
+        self.loop.run_once(0, {})
+        self.assertEqual(self.calls, [1])
+        # The wait is cut short by the next timer
+        start = time.time()
+        self.loop.run_once(5, {})
+        self.assertLess(time.time() - start, 2)
+        self.assertEqual(self.calls, [1, 2, 3])
+        self.assertFalse(t.active)
+
+    def test_timer_scheduled_by_timer(self):
+        def reschedule():
+            self.calls.append(None)
+            self.loop.call_later(0, reschedule)
+        self.loop.call_later(0, reschedule)
+        self.loop.run_once(0, {})
+        self.loop.run_once(0, {})
+        self.assertEqual(len(self.calls), 2)
+
+    def test_errors(self):
+        def reenter():
+            self.loop.run_once(0, {})
+        self.loop.call_later(0, reenter)
+        self.assertRaises(RuntimeError, self.loop.run_once, 0, {})
+        self.loop.call_later(0, self.loop.close)
+        self.assertRaises(RuntimeError, self.loop.run_once, 0, {})
+        self.assertRaises(TypeError, self.loop.run_once, 0, [])
+        self.assertRaises(TypeError, self.loop.call_later, 0, None)
+        self.loop.close()
+        self.assertTrue(self.loop.closed)
+        self.assertRaises(ValueError, self.loop.run_once, 0, {})
+        self.assertRaises(ValueError, self.loop.fileno)
+
+    def test_callback_cycle(self):
+        import gc, weakref
+        class Channel(object):
+            pass
+        chan = Channel()
+        chan.loop = self.event_loop_class(lambda obj, flags: None)
+        chan.loop.call_later(10, setattr, chan, 'x', 1)
+        ref = weakref.ref(chan)
+        del chan
+        gc.collect()
+        self.assertIsNone(ref())
+
+class EpollPollerTests(EventLoopTests):
+
+    def event_loop_class(self, dispatch):
+        return asyncore._EpollPoller(dispatch)
+
+
+class quiet_dispatcher(asyncore.dispatcher):
+    def writable(self):
+        return False
+
+class LoopEventLoopTests(unittest.TestCase):
+
+    def setUp(self):
+        self.a, self.b = socket.socketpair()
+        self.map = {}
+        self.chan = quiet_dispatcher(self.a, map=self.map)
+        self.event_loop = asyncore.EventLoop()
+
+    def tearDown(self):
+        asyncore.close_all(self.map)
+        self.b.close()
+        self.event_loop.close()
+
+    def test_kept_across_calls(self):
+        calls = []
+        fd = self.event_loop.fileno()
+        self.event_loop.call_later(0, calls.append, 1)
+        asyncore.loop(0, map=self.map, count=1, event_loop=self.event_loop)
+        self.assertEqual(calls, [1])
+        asyncore.loop(0, map=self.map, count=1, event_loop=self.event_loop)
+        self.assertEqual(self.event_loop.fileno(), fd)
+        # A timer cuts the wait short
+        self.event_loop.call_later(0.05, self.chan.close)
+        start = time.time()
+        asyncore.loop(5, map=self.map, event_loop=self.event_loop)
+        self.assertLess(time.time() - start, 2)
+        self.assertEqual(self.map, {})
+        # It belongs to the caller, which closes it
+        self.assertFalse(self.event_loop.closed)
+        self.event_loop.close()
+        self.assertTrue(self.event_loop.closed)
+
+    def test_opt_in(self):
+        # Without an event loop, loop() uses select() or poll()
+        calls = []
+        self.event_loop.call_later(0, calls.append, 1)
+        asyncore.loop(0, map=self.map, count=1)
+        asyncore.loop(0, use_poll=True, map=self.map, count=1)
+        self.assertEqual(calls, [])
+        asyncore.loop(0, map=self.map, count=1, event_loop=self.event_loop)
+        self.assertEqual(calls, [1])
+
+    @unittest.skipUnless(hasattr(os, 'fork'), 'requires os.fork()')
+    def test_fork(self):
+        # A child gets an epoll object of its own, without the timers
+        calls = []
+        fd = self.event_loop.fileno()
+        self.event_loop.call_later(0, calls.append, 1)
+        pid = os.fork()
+        if pid == 0:
+            status = 1
+            try:
+                self.event_loop.run_once(0, self.map)
+                if self.event_loop.fileno() != fd and calls == []:
+                    status = 0
+            finally:
+                os._exit(status)
+        self.assertEqual(os.waitpid(pid, 0)[1], 0)
+        self.event_loop.run_once(0, self.map)
+        self.assertEqual(self.event_loop.fileno(), fd)
+        self.assertEqual(calls, [1])
+
+class LoopEventLoopTests_EpollPoller(LoopEventLoopTests):
+
+    def setUp(self):
+        self.saved_loop = asyncore._EventLoop
+        asyncore._EventLoop = None
+        LoopEventLoopTests.setUp(self)
+
+    def tearDown(self):
+        LoopEventLoopTests.tearDown(self)
+        asyncore._EventLoop = self.saved_loop
+
 
 def test_main():
     tests = [HelperFunctionTests, DispatcherTests, DispatcherWithSendTests,
@@ -702,6 +942,12 @@ def test_main():
         tests.append(FileWrapperTest)
     if hasattr(select, 'poll'):
         tests.append(TestAPI_UsePoll)
+    if hasattr(select, 'epoll'):
+        tests += [TestAPI_UseEpollPoller, EpollPollerTests,
+                  LoopEventLoopTests_EpollPoller]
+        if _asyncore is not None:
+            tests += [TestAPI_UseEventLoop, EventLoopTests,
+                      LoopEventLoopTests]
 
     run_unittest(*tests)
 
@@ -55,6 +55,24 @@ class CompileallTests(unittest.TestCase):
         # Test a change in mtime leads to a new .pyc.
         self.recreation_check(b'\0\0\0\0')
 
+    def test_replaced_not_truncated(self):
+        # A process may have the old byte-code file mapped in memory: it
+        # must be replaced by a new file, not rewritten in place.
+        py_compile.compile(self.source_path)
+        with open(self.bc_path, 'rb') as old:
+            data = old.read()
+            old.seek(0)
+            with open(self.source_path, 'a') as file:
+                file.write('y = 456\n')
+            py_compile.compile(self.source_path)
+            self.assertEqual(old.read(), data)
+        with open(self.bc_path, 'rb') as new:
+            self.assertNotEqual(new.read(), data)
+        # and no temporary file is left behind
+        self.assertEqual(sorted(os.listdir(self.directory)),
+                         ['_test.py', os.path.basename(self.bc_path),
+                          '_test2.py'])
+
     def test_compile_files(self):
         # Test compiling a single file, and complete directory
         for fn in (self.bc_path, self.bc_path2):
@@ -72,6 +90,44 @@ class CompileallTests(unittest.TestCase):
         os.unlink(self.bc_path)
         os.unlink(self.bc_path2)
 
+    def test_compile_dir_workers(self):
+        subdir = os.path.join(self.directory, 'sub')
+        os.mkdir(subdir)
+        sub_source = os.path.join(subdir, '_test3.py')
+        shutil.copyfile(self.source_path, sub_source)
+        sub_bc = sub_source + ('c' if __debug__ else 'o')
+        self.assertTrue(compileall.compile_dir(self.directory, quiet=True,
+                                               workers=2))
+        for fn in (self.bc_path, self.bc_path2, sub_bc):
+            self.assertTrue(os.path.isfile(fn))
+        self.assertEqual(*self.data())
+
+    def test_compile_files_skips_up_to_date(self):
+        py_compile.compile(self.source_path)
+        with open(self.bc_path, 'rb') as file:
+            before = file.read()
+        # Corrupt the code but keep the header: the file must be left alone.
+        with open(self.bc_path, 'wb') as file:
+            file.write(before[:8] + 'garbage')
+        self.assertTrue(compileall.compile_files(
+            [self.source_path, self.source_path2], quiet=True, workers=2))
+        with open(self.bc_path, 'rb') as file:
+            self.assertEqual(file.read(), before[:8] + 'garbage')
+        self.assertTrue(os.path.isfile(self.bc_path2))
+        compileall.compile_files([self.source_path], force=True, quiet=True)
+        with open(self.bc_path, 'rb') as file:
+            self.assertEqual(file.read(), before)
+
+    def test_compile_files_failure(self):
+        bad = os.path.join(self.directory, '_bad.py')
+        with open(bad, 'w') as file:
+            file.write('x = (\n')
+        with test_support.captured_stdout():
+            self.assertFalse(compileall.compile_files(
+                [self.source_path, bad], quiet=True, workers=2))
+        self.assertTrue(os.path.isfile(self.bc_path))
+
+
 def test_main():
     test_support.run_unittest(CompileallTests)
 
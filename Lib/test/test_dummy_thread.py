@@ -83,6 +83,16 @@ class LockTests(unittest.TestCase):
         self.assertTrue((end_time - start_time) >= DELAY,
                         "Blocking by unconditional acquiring failed.")
 
+    def test_acquire_timeout(self):
+        #Make sure a timed acquire of a locked lock fails after the timeout.
+        self.assertTrue(self.lock.acquire(1, 1))
+        self.lock.release()
+        self.lock.acquire()
+        start_time = time.time()
+        self.assertFalse(self.lock.acquire(1, 0.1))
+        self.assertTrue(time.time() - start_time >= 0.1)
+        self.assertFalse(self.lock.acquire(0))
+
 class MiscTests(unittest.TestCase):
     """Miscellaneous tests."""
 
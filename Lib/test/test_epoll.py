@@ -214,6 +214,75 @@ class TestEPoll(unittest.TestCase):
         server.close()
         ep.unregister(fd)
 
+    def test_user_data(self):
+        client, server = self._connected_pair()
+        ep = select.epoll(16)
+        tag = object()
+        ep.register(client, select.EPOLLOUT, tag)
+        ep.register(server, select.EPOLLOUT)
+        events = dict(ep.poll(1))
+        self.assertEqual(events, {tag: select.EPOLLOUT,
+                                  server.fileno(): select.EPOLLOUT})
+        # modify() keeps the data, unregister() drops it
+        ep.modify(client, select.EPOLLOUT | select.EPOLLIN)
+        self.assertIn(tag, dict(ep.poll(1)))
+        ep.unregister(client)
+        ep.register(client, select.EPOLLOUT)
+        self.assertIn(client.fileno(), dict(ep.poll(1)))
+
+    def test_user_data_cycle(self):
+        # The epoll object participates in garbage collection
+        import gc, weakref
+        class Channel(object):
+            pass
+        channel = Channel()
+        channel.epoll = select.epoll(16)
+        channel.epoll.register(self.serverSocket, select.EPOLLIN, channel)
+        ref = weakref.ref(channel)
+        del channel
+        gc.collect()
+        self.assertIsNone(ref())
+
+    def test_poll_into(self):
+        import array
+        client, server = self._connected_pair()
+        ep = select.epoll(16)
+        ep.register(client, select.EPOLLOUT, "data not reported")
+        ep.register(server, select.EPOLLOUT)
+        buf = array.array('i', [0] * 8)
+        n = ep.poll_into(buf, 1)
+        self.assertEqual(n, 2)
+        events = dict(zip(buf[0:2*n:2], buf[1:2*n:2]))
+        self.assertEqual(events, {client.fileno(): select.EPOLLOUT,
+                                  server.fileno(): select.EPOLLOUT})
+        # The buffer limits the number of events
+        self.assertEqual(ep.poll_into(array.array('i', [0, 0]), 1), 1)
+        self.assertRaises(ValueError, ep.poll_into, bytearray(4))
+        self.assertRaises(TypeError, ep.poll_into, b"read-only")
+
+    def test_oneshot(self):
+        client, server = self._connected_pair()
+        ep = select.epoll(16)
+        ep.register(client, select.EPOLLOUT | select.EPOLLONESHOT)
+        self.assertEqual(ep.poll(1), [(client.fileno(), select.EPOLLOUT)])
+        self.assertEqual(ep.poll(0), [])
+        # Rearm
+        ep.modify(client, select.EPOLLOUT | select.EPOLLONESHOT)
+        self.assertEqual(ep.poll(1), [(client.fileno(), select.EPOLLOUT)])
+
+    @unittest.skipUnless(hasattr(select, 'EPOLLEXCLUSIVE'),
+                         'test needs EPOLLEXCLUSIVE')
+    def test_exclusive(self):
+        client, server = self._connected_pair()
+        ep = select.epoll(16)
+        try:
+            ep.register(client, select.EPOLLOUT | select.EPOLLEXCLUSIVE)
+        except IOError as e:
+            if e.errno == errno.EINVAL:
+                self.skipTest("kernel doesn't support EPOLLEXCLUSIVE")
+            raise
+        self.assertEqual(ep.poll(1), [(client.fileno(), select.EPOLLOUT)])
+
 def test_main():
     test_support.run_unittest(TestEPoll)
 
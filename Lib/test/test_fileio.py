@@ -71,6 +71,50 @@ class AutoFileTests(unittest.TestCase):
         n = self.f.readinto(a)
         self.assertEquals(array(b'b', [1, 2]), a[:n])
 
+    @unittest.skipUnless(hasattr(_FileIO, 'pwrite'), 'needs pread/pwrite')
+    def testPreadPwrite(self):
+        self.f.close()
+        self.f = _FileIO(TESTFN, 'w+')
+        self.f.write(b"0123456789")
+        self.assertEquals(self.f.pwrite(b"ab", 3), 2)
+        self.assertEquals(self.f.pread(5, 1), b"12ab5")
+        self.assertEquals(self.f.pread(5, 8), b"89")
+        self.assertEquals(self.f.pread(5, 20), b"")
+        # the file position is left alone
+        self.assertEquals(self.f.tell(), 10)
+        self.assertRaises(ValueError, self.f.pread, 1, -1)
+        self.assertRaises(ValueError, self.f.pwrite, b"x", -1)
+        self.assertRaises(ValueError, self.f.pread, -1, 0)
+        self.assertRaises(TypeError, self.f.pread, 1, 0.0)
+
+    @unittest.skipUnless(hasattr(_FileIO, 'writev'), 'needs readv/writev')
+    def testReadvWritev(self):
+        self.f.close()
+        self.f = _FileIO(TESTFN, 'w+')
+        self.assertEquals(self.f.writev([b"abc", bytearray(b"de"), b"",
+                                         memoryview(b"fghi")]), 9)
+        self.assertEquals(self.f.tell(), 9)
+        self.f.seek(0)
+        bufs = [bytearray(4), bytearray(0), array(b'b', b'x'*4)]
+        self.assertEquals(self.f.readv(bufs), 8)
+        self.assertEquals(bufs[0], b"abcd")
+        self.assertEquals(bufs[2].tostring(), b"efgh")
+        self.assertEquals(self.f.readv([bytearray(4)]), 1)
+        self.assertRaises((TypeError, BufferError), self.f.readv,
+                          [b"immutable"])
+        self.assertRaises(TypeError, self.f.writev, [1])
+        self.assertRaises(TypeError, self.f.writev, 1)
+        self.assertRaises(ValueError, self.f.writev, [b"x"] * 100000)
+        self.assertRaises(ValueError, self.f.readv,
+                          [bytearray(1) for i in range(100000)])
+        # old-style buffers from a temporary sequence stay alive
+        self.f.seek(0)
+        self.f.truncate()
+        data = [b"%d" % i * 1000 for i in range(4)]
+        self.assertEquals(self.f.writev(buffer(d) for d in data), 4000)
+        self.f.seek(0)
+        self.assertEquals(self.f.read(), b"".join(data))
+
     def test_none_args(self):
         self.f.write(b"hi\nbye\nabc")
         self.f.close()
@@ -1,6 +1,10 @@
 # Test the frozen module defined in frozen.c.
 
-from test.test_support import captured_stdout, run_unittest
+from test.test_support import captured_stdout, run_unittest, unlink, TESTFN
+import imp
+import marshal
+import os
+import subprocess
 import unittest
 import sys
 
@@ -38,8 +42,67 @@ class FrozenTests(unittest.TestCase):
         del sys.modules['__phello__.spam']
 
 
+class FrozenImageTests(unittest.TestCase):
+
+    def setUp(self):
+        self.addCleanup(unlink, TESTFN)
+
+    def write_image(self, entries, magic=None):
+        with open(TESTFN, 'wb') as f:
+            f.write('FRZI')
+            f.write(magic or imp.get_magic())
+            marshal.dump(tuple(entries), f)
+
+    def compile(self, source, name):
+        return marshal.dumps(compile(source, '<%s>' % name, 'exec'))
+
+    def test_load_frozen_image(self):
+        self.write_image([
+            ('__fimg__', self.compile('x = 1', '__fimg__'), True),
+            ('__fimg__.sub', self.compile('y = 2', '__fimg__.sub'), False),
+        ])
+        imp.load_frozen_image(TESTFN)
+        try:
+            self.assertTrue(imp.is_frozen('__fimg__.sub'))
+            import __fimg__.sub
+            self.assertEqual(__fimg__.x, 1)
+            self.assertEqual(__fimg__.__path__, '__fimg__')
+            self.assertEqual(__fimg__.sub.y, 2)
+            # Modules frozen into the interpreter are still there.
+            self.assertTrue(imp.is_frozen('__hello__'))
+        finally:
+            for name in ('__fimg__', '__fimg__.sub'):
+                sys.modules.pop(name, None)
+
+    def test_bad_images(self):
+        self.write_image([], magic='\0\0\0\0')
+        self.assertRaises(ImportError, imp.load_frozen_image, TESTFN)
+        self.write_image([('__fimg_bad__', 42, False)])
+        self.assertRaises(ImportError, imp.load_frozen_image, TESTFN)
+        with open(TESTFN, 'wb') as f:
+            f.write(imp.get_magic())
+        self.assertRaises(ImportError, imp.load_frozen_image, TESTFN)
+        self.assertRaises(IOError, imp.load_frozen_image, TESTFN + 'x')
+
+    def test_environment_variable(self):
+        self.write_image([
+            ('__fimg_env__', self.compile('z = 3', '__fimg_env__'), False),
+        ])
+        env = os.environ.copy()
+        env['PYTHONFROZENIMAGE'] = TESTFN
+        # Not script_helper: -E would ignore the variable under test.
+        p = subprocess.Popen([sys.executable, '-c',
+                              'import imp, __fimg_env__; '
+                              'print imp.is_frozen("__fimg_env__"), '
+                              '__fimg_env__.z'],
+                             stdout=subprocess.PIPE, env=env)
+        out = p.communicate()[0]
+        self.assertEqual(p.returncode, 0)
+        self.assertEqual(out.strip(), 'True 3')
+
+
 def test_main():
-    run_unittest(FrozenTests)
+    run_unittest(FrozenTests, FrozenImageTests)
 
 
 
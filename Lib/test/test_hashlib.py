@@ -299,6 +299,49 @@ class HashLibTestCase(unittest.TestCase):
           "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"+
           "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b")
 
+    def test_digest_many(self):
+        buffers = ['', 'a', 'spam' * 1000, bytearray('eggs'),
+                   buffer('abcdef', 2), array.array('b', range(10))]
+        for name, constructors in self.constructors_to_test.items():
+            expected = [hashlib.new(name, str(buffer(b))).digest()
+                        for b in buffers]
+            self.assertEqual(hashlib.digest_many(name, buffers), expected)
+            self.assertEqual(hashlib.digest_many(name, []), [])
+            for cons in constructors:
+                # The data hashed so far prefixes each buffer.
+                h = cons('prefix')
+                state = h.digest()
+                self.assertEqual(h.digest_many(buffers),
+                        [hashlib.new(name, 'prefix' + str(buffer(b))).digest()
+                         for b in buffers])
+                self.assertEqual(h.digest(), state)
+                self.assertEqual(h.digest_many(iter(['x'])),
+                                 [hashlib.new(name, 'prefixx').digest()])
+                self.assertRaises(TypeError, h.digest_many, None)
+                self.assertRaises(TypeError, h.digest_many, ['a', 1])
+
+    @unittest.skipUnless(threading, 'Threading required for this test.')
+    @test_support.reap_threads
+    def test_threaded_hashing_all_constructors(self):
+        # Large updates release the GIL, the builtin implementations
+        # included: the objects must serialize the threads using them.
+        data = 'abcdefgh' * 10000
+        for name, constructors in self.constructors_to_test.items():
+            expected = hashlib.new(name, data * 8).hexdigest()
+            for cons in constructors:
+                hasher = cons()
+                def hash_data():
+                    for i in range(2):
+                        hasher.update(data)
+                threads = [threading.Thread(target=hash_data)
+                           for i in range(4)]
+                for t in threads:
+                    t.start()
+                for t in threads:
+                    t.join()
+                self.assertEqual(hasher.hexdigest(), expected,
+                                 '%s from %s' % (name, cons))
+
     @unittest.skipUnless(threading, 'Threading required for this test.')
     @test_support.reap_threads
     def test_threaded_hashing(self):
@@ -193,7 +193,11 @@ class BaseHTTPServerTestCase(BaseTestCase):
 
 class SimpleHTTPServerTestCase(BaseTestCase):
     class request_handler(NoLogRequestHandler, SimpleHTTPRequestHandler):
-        pass
+        def copyfile(self, source, outputfile):
+            # Like a subclass serving byte ranges
+            if self.path.endswith('?skip'):
+                source.seek(7)
+            SimpleHTTPRequestHandler.copyfile(self, source, outputfile)
 
     def setUp(self):
         BaseTestCase.setUp(self)
@@ -256,6 +260,12 @@ class SimpleHTTPServerTestCase(BaseTestCase):
         self.assertEqual(response.getheader('content-type'),
                          'application/octet-stream')
 
+    def test_copyfile_from_position(self):
+        # copyfile() sends the file from where the source was left
+        response = self.request(self.tempdir_name + '/test?skip')
+        self.assertEqual(response.status, 200)
+        self.assertEqual(response.read(len(self.data) - 7), self.data[7:])
+
     def test_invalid_requests(self):
         response = self.request('/', method='FOO')
         self.check_status_and_reason(response, 501)
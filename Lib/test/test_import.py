@@ -6,6 +6,7 @@ import random
 import shutil
 import stat
 import sys
+import time
 import unittest
 from test.test_support import (unlink, TESTFN, unload, run_unittest,
                                is_jython, check_warnings, EnvironmentVarGuard)
@@ -162,6 +163,29 @@ class ImportTests(unittest.TestCase):
         unlink(filename + 'c')
         unlink(filename + 'o')
 
+    def test_large_compiled_module(self):
+        # A .pyc bigger than the old one-gulp read limit (256K) must load
+        # from the compiled file just like a small one.
+        source = TESTFN + os.extsep + "py"
+        compiled = TESTFN + os.extsep + ("pyc" if __debug__ else "pyo")
+        with open(source, "w") as f:
+            f.write("data = %r\n" % ("x" * 300000,))
+            f.write("names = %r\n" % (tuple("n%d" % i for i in range(5000)),))
+        try:
+            py_compile.compile(source)
+            self.assertGreater(os.path.getsize(compiled), 1 << 18)
+            unlink(source)
+            sys.path.insert(0, os.curdir)
+            try:
+                mod = __import__(TESTFN)
+            finally:
+                del sys.path[0]
+            self.assertEqual(os.path.basename(mod.__file__), compiled)
+            self.assertEqual(mod.data, "x" * 300000)
+            self.assertEqual(mod.names[-1], "n4999")
+        finally:
+            remove_files(TESTFN)
+
     def test_failing_import_sticks(self):
         source = TESTFN + os.extsep + "py"
         with open(source, "w") as f:
@@ -366,6 +390,86 @@ class PathsTests(unittest.TestCase):
         self.assertEqual(mod.testdata, 'test_trailing_slash')
         unload("test_trailing_slash")
 
+    def _backdate(self, path):
+        # Make the directory look old enough for its listing to be cached.
+        then = time.time() - 10
+        os.utime(path, (then, then))
+        return then
+
+    def test_module_added_to_cached_directory(self):
+        path = os.path.abspath(self.path)
+        self._backdate(path)
+        sys.path.insert(0, path)
+        self.assertRaises(ImportError, __import__, "test_dircache_mod")
+        with open(os.path.join(path, "test_dircache_mod.py"), "w") as f:
+            f.write("x = 42\n")
+        try:
+            mod = __import__("test_dircache_mod")
+            self.assertEqual(mod.x, 42)
+        finally:
+            unload("test_dircache_mod")
+
+    def test_path_importer_cache_eviction_rescans(self):
+        path = os.path.abspath(self.path)
+        then = self._backdate(path)
+        sys.path.insert(0, path)
+        self.assertRaises(ImportError, __import__, "test_dircache_pkg")
+        os.mkdir(os.path.join(path, "test_dircache_pkg"))
+        with open(os.path.join(path, "test_dircache_pkg", "__init__.py"),
+                  "w") as f:
+            f.write("x = 42\n")
+        # Hide the change from the mtime check; dropping the entry from
+        # sys.path_importer_cache must still force a fresh listing.
+        os.utime(path, (then, then))
+        del sys.path_importer_cache[path]
+        try:
+            mod = __import__("test_dircache_pkg")
+            self.assertEqual(mod.x, 42)
+        finally:
+            unload("test_dircache_pkg")
+
+    def test_cwd_entry_follows_chdir(self):
+        # The listing for '' belongs to the directory it was made in.
+        old = os.path.abspath(os.path.join(self.path, "old"))
+        new = os.path.abspath(os.path.join(self.path, "new"))
+        os.mkdir(old)
+        os.mkdir(new)
+        with open(os.path.join(new, "test_dircache_cwd.py"), "w") as f:
+            f.write("x = 42\n")
+        then = int(time.time()) - 10
+        for path in old, new:
+            os.utime(path, (then, then))
+        sys.path.insert(0, '')
+        cwd = os.getcwd()
+        try:
+            os.chdir(old)
+            self.assertRaises(ImportError, __import__, "test_dircache_cwd")
+            os.chdir(new)
+            mod = __import__("test_dircache_cwd")
+            self.assertEqual(mod.x, 42)
+        finally:
+            os.chdir(cwd)
+            unload("test_dircache_cwd")
+
+    def test_replaced_directory(self):
+        path = os.path.abspath(os.path.join(self.path, "dir"))
+        os.mkdir(path)
+        then = int(time.time()) - 10
+        os.utime(path, (then, then))
+        sys.path.insert(0, path)
+        self.assertRaises(ImportError, __import__, "test_dircache_repl")
+        # Swap in another directory with the very same mtime
+        os.rename(path, path + ".old")
+        os.mkdir(path)
+        with open(os.path.join(path, "test_dircache_repl.py"), "w") as f:
+            f.write("x = 42\n")
+        os.utime(path, (then, then))
+        try:
+            mod = __import__("test_dircache_repl")
+            self.assertEqual(mod.x, 42)
+        finally:
+            unload("test_dircache_repl")
+
     # Regression test for http://bugs.python.org/issue3677.
     def _test_UNC_path(self):
         with open(os.path.join(self.path, 'test_trailing_slash.py'), 'w') as f:
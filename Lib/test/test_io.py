@@ -738,6 +738,32 @@ class BufferedReaderTest(unittest.TestCase, CommonBufferedTests):
         self.assertEquals(bufio().readlines(5), [b"abc\n", b"d\n"])
         self.assertEquals(bufio().readlines(None), [b"abc\n", b"d\n", b"ef"])
 
+    def test_readlines_across_buffers(self):
+        lines = [b"x" * (i % 13) + b"\n" for i in range(200)] + [b"tail"]
+        data = b"".join(lines)
+        def bufio():
+            return self.tp(self.MockFileIO(data), buffer_size=16)
+        self.assertEquals(bufio().readlines(), lines)
+        self.assertEquals(bufio().readlines(20), lines[:6])
+        self.assertEquals(bufio().readlines(len(data)), lines)
+        b = bufio()
+        self.assertEquals(b.read(3), b"\nx\n")
+        self.assertEquals(b.readline(), lines[2])
+        self.assertEquals(b.readlines(), lines[3:])
+        self.assertEquals(b.readlines(), [])
+        b.close()
+        self.assertRaises(ValueError, b.readlines)
+        class LineCounter(self.tp):
+            count = 0
+            def readline(self, limit=-1):
+                LineCounter.count += 1
+                return super(LineCounter, self).readline(limit)
+            def __iter__(self):
+                return iter(self.readline, b"")
+        b = LineCounter(self.MockFileIO(data), buffer_size=16)
+        self.assertEquals(b.readlines(), lines)
+        self.assertEquals(LineCounter.count, len(lines) + 1)
+
     def test_buffering(self):
         data = b"abcdefghi"
         dlen = len(data)
@@ -1116,6 +1142,24 @@ class CBufferedWriterTest(BufferedWriterTest):
         self.assertRaises(ValueError, bufio.__init__, rawio, buffer_size=-1)
         self.assertRaises(ValueError, bufio.write, b"def")
 
+    def test_large_write_after_buffered(self):
+        # Pending data and a large write are merged into a single system
+        # call when possible; check the result against the plain path.
+        rawio = self.FileIO(support.TESTFN, "w+b")
+        with self.tp(rawio, 8) as bufio:
+            data = []
+            for i in range(20):
+                small = b"s" * (i % 5)
+                large = bytes(bytearray(range(i, i + 8 + i * 3)))
+                self.assertEqual(bufio.write(small), len(small))
+                self.assertEqual(bufio.write(large), len(large))
+                data.extend((small, large))
+                self.assertEqual(bufio.tell(), len(b"".join(data)))
+            bufio.flush()
+            self.assertEqual(rawio.tell(), len(b"".join(data)))
+        with self.open(support.TESTFN, "rb") as f:
+            self.assertEqual(f.read(), b"".join(data))
+
     def test_garbage_collection(self):
         # C BufferedWriter objects are collected, and collecting them flushes
         # all data to disk.
@@ -2119,6 +2163,50 @@ class TextIOWrapperTest(unittest.TestCase):
             with self.open(filename, 'rb') as f:
                 self.assertEquals(f.read(), 'bbbzzz'.encode(charset))
 
+    def test_decode_across_chunks(self):
+        # Multibyte sequences and \r\n pairs split between chunks
+        text = "a\u20acb\r\n\xe9\r\rc\n\U00010348\r\n" * 5
+        for enc in "utf-8", "latin-1", "ascii":
+            try:
+                data = text.encode(enc)
+            except UnicodeEncodeError:
+                data = text.encode(enc, "replace")
+            expected = data.decode(enc)
+            for chunksize in range(1, 8):
+                with self.open(support.TESTFN, "wb") as f:
+                    f.write(data)
+                with self.open(support.TESTFN, "r", encoding=enc) as f:
+                    f._CHUNK_SIZE = chunksize
+                    lines = []
+                    cookies = []
+                    while True:
+                        cookies.append(f.tell())
+                        line = f.readline()
+                        if not line:
+                            break
+                        lines.append(line)
+                    self.assertEquals("".join(lines),
+                                      expected.replace("\r\n", "\n")
+                                              .replace("\r", "\n"))
+                    for cookie, line in zip(cookies, lines):
+                        f.seek(cookie)
+                        self.assertEquals(f.readline(), line)
+
+    def test_decoding_errors(self):
+        for enc, data, replaced in (
+                ("ascii", b"ab\xffc\n", "ab\ufffdc\n"),
+                ("utf-8", b"ab\xffc\n", "ab\ufffdc\n"),
+                ("utf-8", b"ab\n\xe2\x82", "ab\n\ufffd")):
+            with self.open(support.TESTFN, "wb") as f:
+                f.write(data)
+            with self.open(support.TESTFN, "r", encoding=enc) as f:
+                f._CHUNK_SIZE = 2
+                self.assertRaises(UnicodeDecodeError, f.read)
+            with self.open(support.TESTFN, "r", encoding=enc,
+                           errors="replace") as f:
+                f._CHUNK_SIZE = 2
+                self.assertEquals(f.read(), replaced)
+
     def test_errors_property(self):
         with self.open(support.TESTFN, "w") as f:
             self.assertEqual(f.errors, "strict")
@@ -2188,6 +2276,45 @@ class CTextIOWrapperTest(TextIOWrapperTest):
         with self.open(support.TESTFN, "rb") as f:
             self.assertEqual(f.read(), b"456def")
 
+    def test_fast_tell(self):
+        # utf-8, latin-1 and ascii compute tell() cookies without replaying
+        # the decoder; they must match the ones the generic code computes
+        # for the same codec under another name.
+        def search(name):
+            if name.startswith("slow_"):
+                ci = codecs.lookup(name[5:])
+                return codecs.CodecInfo(ci.encode, ci.decode,
+                    incrementalencoder=ci.incrementalencoder,
+                    incrementaldecoder=ci.incrementaldecoder,
+                    name="slow-" + ci.name)
+        codecs.register(search)
+        rand = random.Random(0)
+        pieces = ["a", "xyz", "\n", "\r", "\r\n", "\xe9", "\u20ac",
+                  "\U00010348"]
+        for i in range(200):
+            text = "".join(rand.choice(pieces) for j in range(30))
+            enc = rand.choice(["utf-8", "latin-1", "ascii"])
+            data = text.encode(enc, "replace")
+            newline = rand.choice([None, "", "\n", "\r", "\r\n"])
+            chunksize = rand.randint(1, 9)
+            results = []
+            for encoding in enc, "slow_" + enc:
+                t = self.TextIOWrapper(self.BytesIO(data), encoding=encoding,
+                                       newline=newline)
+                t._CHUNK_SIZE = chunksize
+                cookies = []
+                while True:
+                    cookies.append(t.tell())
+                    if not t.read(1):
+                        break
+                rest = []
+                for cookie in cookies:
+                    t.seek(cookie)
+                    rest.append(t.read())
+                results.append((cookies, rest))
+            self.assertEqual(results[0], results[1],
+                             (text, enc, newline, chunksize))
+
 class PyTextIOWrapperTest(TextIOWrapperTest):
     pass
 
@@ -536,6 +536,114 @@ class MmapTests(unittest.TestCase):
         m.seek(8)
         self.assertRaises(ValueError, m.write, "bar")
 
+    def test_find_large(self):
+        # searches this long run without the GIL
+        n = 256 * PAGESIZE
+        m = mmap.mmap(-1, n)
+        m[:] = "ab" * (n // 2)
+        m[PAGESIZE - 2:PAGESIZE + 3] = "abxab"
+        m[n - 4:] = "abxy"
+        self.assertEqual(m.find("abx"), PAGESIZE - 2)
+        self.assertEqual(m.find(bytearray("abx")), PAGESIZE - 2)
+        self.assertEqual(m.find("abx", PAGESIZE), n - 4)
+        self.assertEqual(m.find("abxy"), n - 4)
+        self.assertEqual(m.find("abxyz"), -1)
+        self.assertEqual(m.find("abxy", 0, n - 1), -1)
+        self.assertEqual(m.rfind("abx"), n - 4)
+        self.assertEqual(m.rfind("abx", 0, n - 2), PAGESIZE - 2)
+        self.assertEqual(m.rfind("ba"), n - 5)
+        self.assertEqual(m.find(""), 0)
+        self.assertEqual(m.rfind(""), n)
+        m.close()
+
+    def test_prefetch(self):
+        data = "0123456789" * PAGESIZE
+        open(TESTFN, "wb").write(data)
+        f = open(TESTFN, "rb")
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        f.close()
+        self.assertEqual(m.prefetch(), None)
+        m.prefetch(1, 10)
+        m.prefetch(PAGESIZE + 1, len(data))
+        m.prefetch(len(data))
+        self.assertRaises(ValueError, m.prefetch, -1)
+        self.assertRaises(ValueError, m.prefetch, len(data) + 1)
+        self.assertRaises(ValueError, m.prefetch, 0, -1)
+        self.assertEqual(m[:], data)
+        m.close()
+        self.assertRaises(ValueError, m.prefetch)
+
+    @unittest.skipUnless(hasattr(mmap.mmap, 'madvise'), 'needs madvise')
+    def test_madvise(self):
+        size = 8 * PAGESIZE
+        m = mmap.mmap(-1, size, flags=mmap.MAP_PRIVATE)
+        m[:] = "x" * size
+        for option in (mmap.MADV_SEQUENTIAL, mmap.MADV_RANDOM,
+                       mmap.MADV_WILLNEED, mmap.MADV_NORMAL):
+            self.assertEqual(m.madvise(option), None)
+        m.madvise(mmap.MADV_WILLNEED, PAGESIZE)
+        m.madvise(mmap.MADV_WILLNEED, PAGESIZE, size)
+        m.madvise(mmap.MADV_WILLNEED, size)
+        self.assertRaises(ValueError, m.madvise, mmap.MADV_NORMAL, -1)
+        self.assertRaises(ValueError, m.madvise, mmap.MADV_NORMAL, size + 1)
+        self.assertRaises(ValueError, m.madvise, mmap.MADV_NORMAL, 0, -1)
+        # the kernel insists on whole pages
+        self.assertRaises(mmap.error, m.madvise, mmap.MADV_NORMAL, 1)
+        # private anonymous memory reads as zeros after MADV_DONTNEED
+        m.madvise(mmap.MADV_DONTNEED, PAGESIZE, PAGESIZE)
+        self.assertTrue(m[PAGESIZE:2 * PAGESIZE] == "\0" * PAGESIZE)
+        self.assertTrue(m[:PAGESIZE] == "x" * PAGESIZE)
+        m.close()
+
+    @unittest.skipUnless(hasattr(mmap, 'MAP_POPULATE'), 'needs MAP_POPULATE')
+    def test_populate(self):
+        data = "x" * (4 * PAGESIZE)
+        open(TESTFN, "wb").write(data)
+        f = open(TESTFN, "r+b")
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ,
+                      flags=mmap.MAP_SHARED | mmap.MAP_POPULATE)
+        self.assertEqual(m[:], data)
+        self.assertRaises(TypeError, m.write, "foo")
+        m.close()
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_COPY,
+                      flags=mmap.MAP_SHARED | mmap.MAP_POPULATE)
+        m[:3] = "foo"
+        m.close()
+        self.assertRaises(ValueError, mmap.mmap, f.fileno(), 0,
+                          access=mmap.ACCESS_READ, flags=mmap.MAP_PRIVATE)
+        f.close()
+        self.assertEqual(open(TESTFN, "rb").read(), data)
+
+    def test_memoryview(self):
+        m = mmap.mmap(-1, 100)
+        m[:] = "x" * 100
+        view = memoryview(m)
+        self.assertEqual(view.format, 'B')
+        self.assertEqual(view.itemsize, 1)
+        self.assertEqual(view.shape, (100,))
+        self.assertFalse(view.readonly)
+        part = view[10:20]
+        part[:3] = "abc"
+        self.assertEqual(m[10:13], "abc")
+        # the mapping can't go away under an exported buffer
+        self.assertRaises(BufferError, m.close)
+        self.assertRaises(BufferError, m.resize, 200)
+        del view
+        self.assertRaises(BufferError, m.close)
+        del part
+        m.close()
+
+        open(TESTFN, "wb").write("abcdef")
+        f = open(TESTFN, "rb")
+        m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        f.close()
+        view = memoryview(m)
+        self.assertTrue(view.readonly)
+        self.assertEqual(view[2:4].tobytes(), "cd")
+        self.assertRaises(TypeError, view.__setitem__, 0, "x")
+        del view
+        m.close()
+
     if os.name == 'nt':
         def test_tagname(self):
             data1 = "0123456789"
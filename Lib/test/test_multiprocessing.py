@@ -928,6 +928,71 @@ class _TestArray(BaseTestCase):
         self.assertFalse(hasattr(arr5, 'get_lock'))
         self.assertFalse(hasattr(arr5, 'get_obj'))
 
+
+def _scale_shared(args):
+    src, dst, start, stop = args
+    for i in xrange(start, stop):
+        dst[i] = src[i] * 2
+    return sum(dst[start:stop])
+
+class _TestSharedArray(BaseTestCase):
+
+    ALLOWED_TYPES = ('processes',)
+
+    @unittest.skipIf(c_int is None, "requires _ctypes")
+    def test_shared_array(self):
+        arr = self.SharedArray('d', 10)
+        self.assertEqual(arr.tolist(), [0.0] * 10)
+        self.assertEqual((arr.typecode, arr.itemsize), ('d', 8))
+
+        view = memoryview(arr)
+        self.assertEqual(view.itemsize, 8)
+        self.assertEqual(view.shape, (10,))
+        self.assertEqual(len(view.tobytes()), 80)
+
+        seq = [680, 626, 934, 821, 150]
+        arr = self.SharedArray('i', array.array('i', seq))
+        self.assertEqual(arr.tolist(), seq)
+        arr = self.SharedArray('h', seq)
+        self.assertEqual(arr[1:3], seq[1:3])
+        arr = self.SharedArray('c', latin('abc'))
+        self.assertEqual(arr.raw, latin('abc'))
+        self.assertEqual(len(self.SharedArray('B', 0)), 0)
+
+        self.assertRaises(ValueError, self.SharedArray, 'x', 10)
+        self.assertRaises(ValueError, self.SharedArray, 'i', -1)
+
+    @unittest.skipIf(c_int is None, "requires _ctypes")
+    def test_pickle_by_handle(self):
+        import cPickle
+        arr = self.SharedArray('i', range(1000))
+        data = cPickle.dumps(arr, cPickle.HIGHEST_PROTOCOL)
+        self.assertLess(len(data), 200)
+        self.assertIs(cPickle.loads(data), arr)
+
+    @unittest.skipIf(c_int is None, "requires _ctypes")
+    def test_pool(self):
+        src = self.SharedArray('l', range(1000))
+        dst = self.SharedArray('l', 1000)
+        tasks = [(src, dst, i, i + 100) for i in range(0, 1000, 100)]
+        pool = multiprocessing.Pool(2)
+        try:
+            sums = pool.map(_scale_shared, tasks)
+        finally:
+            pool.terminate()
+            pool.join()
+        self.assertEqual(sum(sums), sum(range(1000)) * 2)
+        self.assertEqual(dst.tolist(), [i * 2 for i in range(1000)])
+
+    @unittest.skipIf(c_int is None, "requires _ctypes")
+    def test_unlink(self):
+        arr = self.SharedArray('i', 10)
+        path = arr._path
+        self.assertTrue(os.path.exists(path))
+        del arr
+        gc.collect()
+        self.assertFalse(os.path.exists(path))
+
 #
 #
 #
@@ -995,6 +1060,10 @@ class _TestContainers(BaseTestCase):
 def sqr(x, wait=0.0):
     time.sleep(wait)
     return x*x
+
+def reciprocal(x):
+    return 1.0 / x
+
 class _TestPool(BaseTestCase):
 
     def test_apply(self):
@@ -1008,6 +1077,19 @@ class _TestPool(BaseTestCase):
         self.assertEqual(pmap(sqr, range(100), chunksize=20),
                          map(sqr, range(100)))
 
+    def test_map_adaptive(self):
+        pmap = self.pool.map
+        self.assertEqual(pmap(sqr, range(1000)), map(sqr, range(1000)))
+        self.assertEqual(pmap(sqr, xrange(1000)), map(sqr, xrange(1000)))
+        d = dict.fromkeys(range(100))
+        self.assertEqual(pmap(sqr, d), map(sqr, d))
+        self.assertRaises(ZeroDivisionError, pmap, reciprocal, range(-10, 10))
+
+    def test_apply_async_many(self):
+        results = [self.pool.apply_async(sqr, (i,)) for i in range(1000)]
+        self.assertEqual([r.get(timeout=TIMEOUT3 * 10) for r in results],
+                         map(sqr, range(1000)))
+
     def test_map_chunksize(self):
         try:
             self.pool.map_async(sqr, [], chunksize=1).get(timeout=TIMEOUT1)
@@ -1071,6 +1153,109 @@ class _TestPool(BaseTestCase):
         join()
         self.assertTrue(join.elapsed < 0.2)
 
+class _TestGuidedChunker(BaseTestCase):
+
+    ALLOWED_TYPES = ('processes', )
+
+    def chunk_sizes(self, chunker):
+        sizes = []
+        start = 0
+        for i, (func, items) in chunker:
+            self.assertEqual(i, start)
+            self.assertIs(func, sqr)
+            sizes.append(len(items))
+            start += len(items)
+        return sizes
+
+    def test_probe(self):
+        # nothing is known about the items, so they are handed out singly
+        chunker = multiprocessing.pool.GuidedChunker(sqr, range(100), 4)
+        self.assertEqual(self.chunk_sizes(chunker), [1] * 100)
+
+    def test_shrinking(self):
+        chunker = multiprocessing.pool.GuidedChunker(sqr, xrange(10000), 4)
+        chunker.record(10, 0.0)
+        sizes = self.chunk_sizes(chunker)
+        self.assertEqual(sum(sizes), 10000)
+        self.assertEqual(sizes[0], 10000 // 16)
+        self.assertEqual(sizes, sorted(sizes, reverse=True))
+        self.assertEqual(sizes[-1], 1)
+
+    def test_chunk_time(self):
+        # slow items get chunks which take about CHUNK_TIME seconds
+        chunker = multiprocessing.pool.GuidedChunker(sqr, range(10000), 4)
+        item_time = multiprocessing.pool.CHUNK_TIME / 8
+        chunker.record(10, 10 * item_time)
+        sizes = self.chunk_sizes(chunker)
+        self.assertEqual(sum(sizes), 10000)
+        self.assertIn(sizes[0], (7, 8))
+
+class _TestPoolScheduling(BaseTestCase):
+
+    ALLOWED_TYPES = ('processes', )
+
+    def test_batching_per_job(self):
+        # tasks are only batched with tasks of a job which has been timed
+        Pool = multiprocessing.pool.Pool
+        p = multiprocessing.Pool(2)
+        try:
+            p.map(sqr, range(1000), chunksize=1)
+            res = p.apply_async(sqr, (3, 0.1))
+            key = Pool._time_key(p._cache, res._job)
+            self.assertIs(key, sqr)
+            self.assertEqual(Pool._batch_size(p._task_times, key), 1)
+            self.assertEqual(res.get(timeout=10), 9)
+            self.assertEqual(Pool._batch_size(p._task_times, key), 1)
+        finally:
+            p.terminate()
+            p.join()
+
+    def test_killed_workers(self):
+        # the messages lost with killed workers don't use up the pool's
+        # slots for messages in flight
+        p = multiprocessing.Pool(2)
+        try:
+            for i in range(3):
+                for j in range(2):
+                    p.apply_async(sqr, (j, 60))
+                time.sleep(0.5)
+                for w in p._pool:
+                    os.kill(w.pid, signal.SIGKILL)
+                countdown = 50
+                while countdown and (len(p._pool) < 2 or
+                                     not all(w.is_alive() for w in p._pool)
+                                     or any(w.exitcode for w in p._pool)):
+                    countdown -= 1
+                    time.sleep(0.1)
+            self.assertEqual(p.apply_async(sqr, (5,)).get(timeout=10), 25)
+        finally:
+            p.terminate()
+            p.join()
+
+    def test_dead_worker_slots(self):
+        # only a worker which died holding a message gives back its slot
+        # (really killing an idle worker may leave the queue's lock held)
+        class DeadWorker(object):
+            exitcode = -signal.SIGKILL
+            def __init__(self, seq):
+                self._taken = multiprocessing.RawValue('l', seq)
+            def join(self):
+                pass
+        class Stub(object):
+            pass
+        join_exited = multiprocessing.pool.Pool._join_exited_workers.im_func
+        stub = Stub()
+        stub._inflight = threading.Semaphore(2)
+        stub._inflight.acquire()
+        stub._unanswered = set([2])
+        # one died after its last message was answered, one with a message
+        # (seen twice, like a reply racing with the death: one slot only)
+        stub._pool = [DeadWorker(1), DeadWorker(2), DeadWorker(2)]
+        self.assertTrue(join_exited(stub))
+        self.assertEqual(stub._pool, [])
+        self.assertEqual(stub._unanswered, set())
+        self.assertEqual(stub._inflight._Semaphore__value, 2)
+
 class _TestPoolWorkerLifetime(BaseTestCase):
 
     ALLOWED_TYPES = ('processes', )
@@ -1433,6 +1618,144 @@ class _TestConnection(BaseTestCase):
 
         self.assertRaises(ValueError, a.send_bytes, msg, 4, -1)
 
+#
+# Test shared memory channels
+#
+
+@unittest.skipUnless(hasattr(_multiprocessing, 'Channel'),
+                     'requires _multiprocessing.Channel')
+class _TestChannel(BaseTestCase):
+
+    ALLOWED_TYPES = ('processes',)
+
+    def test_send_recv(self):
+        ch = self.Channel(4096)
+        self.assertGreaterEqual(ch.size, 4096)
+        self.assertEqual(ch.poll(), False)
+
+        ch.send([1, 'two', None])
+        self.assertEqual(ch.poll(), True)
+        self.assertEqual(ch.recv(), [1, 'two', None])
+
+        msg = latin('abcdefghijklmnopqrstuvwxyz')
+        ch.send_bytes(msg)
+        ch.send_bytes(msg, 5)
+        ch.send_bytes(bytearray(msg), 7, 8)
+        ch.send_bytes(msg, 26)
+        self.assertEqual(ch.recv_bytes(), msg)
+        self.assertEqual(ch.recv_bytes(), msg[5:])
+        self.assertEqual(ch.recv_bytes(), msg[7:7+8])
+        self.assertEqual(ch.recv_bytes(), latin(''))
+        self.assertEqual(ch.poll(TIMEOUT1), False)
+
+        self.assertRaises(ValueError, ch.send_bytes, msg, 27)
+        self.assertRaises(ValueError, ch.send_bytes, msg, 22, 5)
+        self.assertRaises(ValueError, ch.send_bytes, msg, -1)
+        self.assertRaises(ValueError, ch.send_bytes, latin('x') * ch.size)
+        self.assertRaises(ValueError, self.Channel, 100)
+
+        ch.send_bytes(msg)
+        self.assertRaises(IOError, ch.recv_bytes, 10)
+        self.assertEqual(ch.poll(), False)
+
+    def test_recv_bytes_into(self):
+        ch = self.Channel(4096)
+        buf = bytearray(10)
+        ch.send_bytes(latin('abcd'))
+        self.assertEqual(ch.recv_bytes_into(buf, 3), 4)
+        self.assertEqual(buf, bytearray(latin('\0\0\0abcd\0\0\0')))
+
+        ch.send_bytes(latin('0123456789'))
+        try:
+            ch.recv_bytes_into(buf, 1)
+        except multiprocessing.BufferTooShort, e:
+            self.assertEqual(e.args, (latin('0123456789'),))
+        else:
+            self.fail('expected BufferTooShort')
+        self.assertRaises(ValueError, ch.recv_bytes_into, buf, 11)
+
+    def test_recv_buffer(self):
+        ch = self.Channel(4096)
+        ch.send_bytes(latin('hello'))
+        msg = ch.recv_buffer()
+        self.assertEqual(len(msg), 5)
+        self.assertEqual(msg.tobytes(), latin('hello'))
+        view = memoryview(msg)
+        self.assertTrue(view.readonly)
+        self.assertEqual(view[1:3].tobytes(), latin('el'))
+        self.assertRaises(BufferError, msg.release)
+        del view
+        msg.release()
+        msg.release()
+        self.assertRaises(ValueError, msg.tobytes)
+        self.assertRaises(ValueError, memoryview, msg)
+
+        ch.send_bytes(latin('world'))
+        with ch.recv_buffer() as msg:
+            self.assertEqual(memoryview(msg).tobytes(), latin('world'))
+        self.assertRaises(ValueError, len, msg)
+
+    def test_wraparound(self):
+        # Messages which are still being read keep their place in the
+        # ring while later ones wrap around it.
+        ch = self.Channel(4096)
+        rand = random.Random(1)
+        queued, held = [], []
+        for i in range(3000):
+            data = latin(str(i % 10)) * rand.randint(0, 400)
+            ch.send_bytes(data)
+            queued.append(data)
+            while len(queued) > 3 or (queued and rand.random() < 0.3):
+                expected = queued.pop(0)
+                if rand.random() < 0.5:
+                    held.append((ch.recv_buffer(), expected))
+                else:
+                    self.assertEqual(ch.recv_bytes(), expected)
+            if i % 4 == 3:
+                # release them out of order
+                for msg, expected in reversed(held):
+                    self.assertEqual(msg.tobytes(), expected)
+                    msg.release()
+                del held[:]
+
+    @classmethod
+    def _send_numbers(cls, ch, start, stop):
+        for i in xrange(start, stop):
+            ch.send_bytes(latin(str(i)) * (i % 50))
+
+    @classmethod
+    def _recv_numbers(cls, ch, results):
+        total = 0
+        for obj in iter(ch.recv_bytes, latin('END')):
+            total += len(obj)
+        results.send(total)
+
+    def test_processes(self):
+        # two senders and two receivers through a channel which is much
+        # smaller than the data, so that both sides block
+        ch = self.Channel(4096)
+        results = self.Channel(4096)
+        senders = [self.Process(target=self._send_numbers,
+                                args=(ch, i * 1000, (i + 1) * 1000))
+                   for i in range(2)]
+        receivers = [self.Process(target=self._recv_numbers,
+                                  args=(ch, results))
+                     for i in range(2)]
+        for p in senders + receivers:
+            p.daemon = True
+            p.start()
+
+        for p in senders:
+            p.join()
+        for p in receivers:
+            ch.send_bytes(latin('END'))
+        for p in receivers:
+            p.join()
+
+        expected = sum(len(str(i)) * (i % 50) for i in xrange(2000))
+        self.assertEqual(results.recv() + results.recv(), expected)
+        self.assertEqual(ch.poll(), False)
+
 class _TestListenerClient(BaseTestCase):
 
     ALLOWED_TYPES = ('processes', 'threads')
@@ -1841,7 +2164,7 @@ class ProcessesMixin(object):
         'Queue', 'Lock', 'RLock', 'Semaphore', 'BoundedSemaphore',
         'Condition', 'Event', 'Value', 'Array', 'RawValue',
         'RawArray', 'current_process', 'active_children', 'Pipe',
-        'connection', 'JoinableQueue'
+        'connection', 'JoinableQueue', 'Channel', 'SharedArray'
         )))
 
 testcases_processes = create_test_cases(ProcessesMixin, type='processes')
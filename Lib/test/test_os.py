@@ -48,6 +48,54 @@ class FileTests(unittest.TestCase):
         os.closerange(first, first + 2)
         self.assertRaises(OSError, os.write, first, "a")
 
+    @unittest.skipUnless(hasattr(os, 'sendfile'), 'test needs os.sendfile()')
+    def test_sendfile(self):
+        data = b"0123456789" * 1000
+        with open(test_support.TESTFN, "wb") as f:
+            f.write(data)
+        src = os.open(test_support.TESTFN, os.O_RDONLY)
+        self.addCleanup(os.close, src)
+        dst_name = test_support.TESTFN + "2"
+        self.addCleanup(test_support.unlink, dst_name)
+        dst = os.open(dst_name, os.O_CREAT|os.O_TRUNC|os.O_WRONLY)
+        self.addCleanup(os.close, dst)
+        try:
+            # Explicit offset: the source position is left alone.
+            sent = os.sendfile(dst, src, 5, 100)
+        except OSError as e:
+            if e.errno in (errno.EINVAL, errno.ENOSYS):
+                self.skipTest("sendfile() to a regular file not supported")
+            raise
+        self.assertEqual(sent, 100)
+        self.assertEqual(os.lseek(src, 0, 1), 0)
+        # None: the source position is used and updated.
+        os.lseek(src, 9990, 0)
+        self.assertEqual(os.sendfile(dst, src, None, 100), 10)
+        self.assertEqual(os.lseek(src, 0, 1), 10000)
+        self.assertEqual(os.sendfile(dst, src, len(data), 100), 0)
+        with open(dst_name, "rb") as f:
+            self.assertEqual(f.read(), data[5:105] + data[-10:])
+        self.assertRaises(ValueError, os.sendfile, dst, src, -1, 10)
+        self.assertRaises(TypeError, os.sendfile, dst, src, 1.0, 10)
+
+    @unittest.skipUnless(hasattr(os, 'splice'), 'test needs os.splice()')
+    def test_splice(self):
+        data = b"spliced data" * 100
+        with open(test_support.TESTFN, "wb") as f:
+            f.write(data)
+        src = os.open(test_support.TESTFN, os.O_RDONLY)
+        self.addCleanup(os.close, src)
+        r, w = os.pipe()
+        self.addCleanup(os.close, r)
+        self.addCleanup(os.close, w)
+        self.assertEqual(os.splice(src, w, 100, 12), 100)
+        self.assertEqual(os.lseek(src, 0, 1), 0)
+        self.assertEqual(os.read(r, 200), data[12:112])
+        self.assertEqual(os.splice(src, w, 50, None, None,
+                                   os.SPLICE_F_MOVE), 50)
+        self.assertEqual(os.lseek(src, 0, 1), 50)
+        self.assertEqual(os.read(r, 200), data[:50])
+
     @test_support.cpython_only
     def test_rename(self):
         path = unicode(test_support.TESTFN)
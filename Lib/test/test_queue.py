@@ -3,6 +3,7 @@
 import Queue
 import time
 import unittest
+import weakref
 from test import test_support
 threading = test_support.import_module('threading')
 
@@ -92,6 +93,7 @@ class BaseQueueTest(unittest.TestCase, BlockingTestMixin):
         q.put(333)
         q.put(222)
         target_order = dict(Queue = [111, 333, 222],
+                            SimpleQueue = [111, 333, 222],
                             LifoQueue = [222, 333, 111],
                             PriorityQueue = [111, 222, 333])
         actual_order = [q.get(), q.get(), q.get()]
@@ -200,6 +202,78 @@ class LifoQueueTest(BaseQueueTest):
 class PriorityQueueTest(BaseQueueTest):
     type2test = Queue.PriorityQueue
 
+class SimpleQueueTest(BaseQueueTest):
+    type2test = Queue.SimpleQueue
+
+    def test_nowait(self):
+        q = self.type2test(2)
+        q.put_nowait(1)
+        q.put_nowait(2)
+        self.assertRaises(Queue.Full, q.put_nowait, 3)
+        self.assertEqual(q.qsize(), 2)
+        self.assertEqual(q.get_nowait(), 1)
+        self.assertEqual(q.get_nowait(), 2)
+        self.assertRaises(Queue.Empty, q.get_nowait)
+
+    def test_bad_timeout(self):
+        q = self.type2test(1)
+        q.put(1)
+        self.assertRaises(ValueError, q.put, 2, True, -1)
+        q.get()
+        self.assertRaises(ValueError, q.get, True, -1)
+
+    def test_unbounded(self):
+        q = self.type2test()
+        self.assertEqual(q.maxsize, 0)
+        for i in range(1000):
+            q.put(i)
+            if i % 3 == 0:
+                self.assertEqual(q.get(), i // 3)
+        self.assertFalse(q.full())
+        self.assertEqual([q.get() for i in range(q.qsize())],
+                         range(334, 1000))
+        self.assertEqual(q.unfinished_tasks, 1000)
+
+    def test_task_done_too_many(self):
+        q = self.type2test()
+        q.put(1)
+        q.task_done()
+        self.assertRaises(ValueError, q.task_done)
+
+    def test_many_threads(self):
+        # Several producers and consumers hand items over
+        q = self.type2test(3)
+        results = []
+        def produce(start):
+            for i in range(start, start + 200):
+                q.put(i)
+        def consume():
+            while True:
+                x = q.get()
+                if x is None:
+                    return
+                results.append(x)
+        consumers = [threading.Thread(target=consume) for i in range(3)]
+        producers = [threading.Thread(target=produce, args=(i * 200,))
+                     for i in range(3)]
+        for t in consumers + producers:
+            t.start()
+        for t in producers:
+            t.join()
+        for t in consumers:
+            q.put(None)
+        for t in consumers:
+            t.join()
+        self.assertEqual(sorted(results), range(600))
+
+    def test_gc_cycle(self):
+        q = self.type2test()
+        q.put(q)
+        ref = weakref.ref(q)
+        del q
+        test_support.gc_collect()
+        self.assertIsNone(ref())
+
 
 
 # A Queue subclass that can provoke failure at a moment's notice :)
@@ -315,7 +389,7 @@ class FailingQueueTest(unittest.TestCase, BlockingTestMixin):
 
 def test_main():
     test_support.run_unittest(QueueTest, LifoQueueTest, PriorityQueueTest,
-                              FailingQueueTest)
+                              SimpleQueueTest, FailingQueueTest)
 
 
 if __name__ == "__main__":
@@ -7,6 +7,7 @@ import sys
 import stat
 import os
 import os.path
+import io
 from os.path import splitdrive
 from distutils.spawn import find_executable, spawn
 from shutil import (_make_tarball, _make_zipfile, make_archive,
@@ -305,6 +306,41 @@ class TestShutil(unittest.TestCase):
             finally:
                 shutil.rmtree(TESTFN, ignore_errors=True)
 
+    def test_copyfile_contents(self):
+        data = b"abcdefgh" * 20000
+        self.addCleanup(test_support.unlink, TESTFN)
+        self.addCleanup(test_support.unlink, TESTFN2)
+        with open(TESTFN, "wb") as f:
+            f.write(data)
+        shutil.copyfile(TESTFN, TESTFN2)
+        with open(TESTFN2, "rb") as f:
+            self.assertEqual(f.read(), data)
+
+    def test_copyfileobj_unbuffered_files(self):
+        # Unbuffered files may be copied inside the kernel; the result and
+        # the file positions must be the same as with the read/write loop.
+        data = b"0123456789" * 10000
+        self.addCleanup(test_support.unlink, TESTFN)
+        self.addCleanup(test_support.unlink, TESTFN2)
+        with open(TESTFN, "wb") as f:
+            f.write(data)
+        with io.open(TESTFN, "rb", buffering=0) as fsrc:
+            with io.open(TESTFN2, "wb", buffering=0) as fdst:
+                fsrc.seek(100)
+                fdst.write(b"head")
+                shutil.copyfileobj(fsrc, fdst)
+                self.assertEqual(fsrc.tell(), len(data))
+                self.assertEqual(fdst.tell(), len(data) - 100 + 4)
+                fdst.write(b"tail")
+        with open(TESTFN2, "rb") as f:
+            self.assertEqual(f.read(), b"head" + data[100:] + b"tail")
+        # Appending: sendfile() may refuse, copyfileobj() must not.
+        with io.open(TESTFN, "rb", buffering=0) as fsrc:
+            with io.open(TESTFN2, "ab", buffering=0) as fdst:
+                shutil.copyfileobj(fsrc, fdst)
+        with open(TESTFN2, "rb") as f:
+            self.assertEqual(f.read(), b"head" + data[100:] + b"tail" + data)
+
     if hasattr(os, "mkfifo"):
         # Issue #3002: copyfile and copytree block indefinitely on named pipes
         def test_copyfile_named_pipe(self):
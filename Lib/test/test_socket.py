@@ -12,6 +12,7 @@ import Queue
 import sys
 import os
 import array
+import io
 from weakref import proxy
 import signal
 
@@ -522,6 +523,22 @@ class GeneralModuleTests(unittest.TestCase):
         sock.close()
         self.assertRaises(socket.error, sock.send, "spam")
 
+    @unittest.skipUnless(hasattr(socket, 'CMSG_LEN'), 'test needs CMSG_LEN()')
+    def testCMSGLenAndSpace(self):
+        self.assertEqual(socket.CMSG_LEN(10) - socket.CMSG_LEN(0), 10)
+        self.assertGreaterEqual(socket.CMSG_SPACE(10), socket.CMSG_LEN(10))
+        self.assertGreaterEqual(socket.CMSG_SPACE(0), socket.CMSG_LEN(0))
+        self.assertRaises(OverflowError, socket.CMSG_LEN, -1)
+        self.assertRaises(OverflowError, socket.CMSG_SPACE, sys.maxsize)
+
+    @unittest.skipUnless(hasattr(socket.socket, 'sendmsg'),
+                         'test needs socket.sendmsg()')
+    def testSendmsgOnClosedSocket(self):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.close()
+        self.assertRaises(socket.error, sock.sendmsg, [b"data"])
+        self.assertRaises(socket.error, sock.recvmsg, 10)
+
     def testNewAttributes(self):
         # testing .family, .type and .protocol
         sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
@@ -666,6 +683,74 @@ class BasicUDPTest(ThreadedUDPSocketTest):
     def _testRecvFromNegative(self):
         self.cli.sendto(MSG, 0, (HOST, self.port))
 
+@unittest.skipUnless(hasattr(socket.socket, 'sendmsg'),
+                     'test needs socket.sendmsg()')
+class MsgUDPTest(ThreadedUDPSocketTest):
+
+    def __init__(self, methodName='runTest'):
+        ThreadedUDPSocketTest.__init__(self, methodName=methodName)
+
+    def testSendmsgAndRecvmsg(self):
+        data, ancdata, flags, addr = self.serv.recvmsg(1024)
+        self.assertEqual(data, MSG)
+        self.assertEqual(ancdata, [])
+        self.assertEqual(flags, 0)
+        self.assertEqual(addr[0], socket.gethostbyname(HOST))
+
+    def _testSendmsgAndRecvmsg(self):
+        # Gather the message from several buffers
+        parts = [MSG[:5], bytearray(MSG[5:10]), memoryview(MSG[10:])]
+        self.assertEqual(self.cli.sendmsg(parts, [], 0, (HOST, self.port)),
+                         len(MSG))
+
+    def testSendmsgFromIterator(self):
+        data, ancdata, flags, addr = self.serv.recvmsg(1024)
+        self.assertEqual(data, MSG * 20)
+
+    def _testSendmsgFromIterator(self):
+        # The buffers must outlive the temporary sequence of old-style
+        # buffer objects
+        parts = (buffer(MSG * 5) for i in range(4))
+        self.assertEqual(self.cli.sendmsg(parts, [], 0, (HOST, self.port)),
+                         len(MSG) * 20)
+
+    def testRecvmsgInto(self):
+        bufs = [bytearray(5), bytearray(3), bytearray(1024)]
+        nbytes, ancdata, flags, addr = self.serv.recvmsg_into(bufs)
+        self.assertEqual(nbytes, len(MSG))
+        self.assertEqual(bytes(bufs[0] + bufs[1] + bufs[2][:nbytes - 8]), MSG)
+        self.assertEqual(ancdata, [])
+
+    def _testRecvmsgInto(self):
+        self.cli.sendmsg([MSG], None, 0, (HOST, self.port))
+
+    def testRecvmsgTruncated(self):
+        data, ancdata, flags, addr = self.serv.recvmsg(5)
+        self.assertEqual(data, MSG[:5])
+        self.assertTrue(flags & socket.MSG_TRUNC)
+        self.assertRaises(ValueError, self.serv.recvmsg, -1)
+        self.assertRaises(TypeError, self.serv.recvmsg_into, [b"readonly"])
+
+    def _testRecvmsgTruncated(self):
+        self.cli.sendmsg([MSG], [], 0, (HOST, self.port))
+
+    @unittest.skipUnless(hasattr(socket.socket, 'recvmmsg_into'),
+                         'test needs socket.recvmmsg_into()')
+    def testSendmmsgAndRecvmmsg(self):
+        bufs = [bytearray(64) for i in range(8)]
+        received = []
+        while len(received) < 5:
+            results = self.serv.recvmmsg_into(bufs, socket.MSG_WAITFORONE)
+            self.assertTrue(1 <= len(results) <= len(bufs))
+            for buf, (nbytes, addr) in zip(bufs, results):
+                received.append(bytes(buf[:nbytes]))
+        self.assertEqual(received, [b"x" * i for i in range(1, 6)])
+
+    def _testSendmmsgAndRecvmmsg(self):
+        msgs = [(b"x" * i, (HOST, self.port)) for i in range(1, 6)]
+        self.assertEqual(self.cli.sendmmsg(msgs), 5)
+
+
 @unittest.skipUnless(thread, 'Threading required for this test.')
 class TCPCloserTest(ThreadedTCPSocketTest):
 
@@ -683,6 +768,50 @@ class TCPCloserTest(ThreadedTCPSocketTest):
         time.sleep(1.0)
 
 @unittest.skipUnless(thread, 'Threading required for this test.')
+@unittest.skipUnless(hasattr(socket.socket, 'sendmsg') and
+                     hasattr(socket, 'SCM_RIGHTS'),
+                     'test needs socket.sendmsg() and SCM_RIGHTS')
+class MsgSocketPairTest(SocketPairTest):
+
+    def __init__(self, methodName='runTest'):
+        SocketPairTest.__init__(self, methodName=methodName)
+
+    def testPassFileDescriptor(self):
+        fdsize = array.array('i').itemsize
+        data, ancdata, flags, addr = self.serv.recvmsg(
+            1024, socket.CMSG_SPACE(fdsize))
+        self.assertEqual(data, MSG)
+        self.assertEqual(flags, 0)
+        self.assertEqual(len(ancdata), 1)
+        level, type, fddata = ancdata[0]
+        self.assertEqual((level, type), (socket.SOL_SOCKET, socket.SCM_RIGHTS))
+        fd = array.array('i', fddata)[0]
+        try:
+            self.assertEqual(os.read(fd, 100), b"through the socket")
+        finally:
+            os.close(fd)
+
+    def _testPassFileDescriptor(self):
+        r, w = os.pipe()
+        try:
+            os.write(w, b"through the socket")
+            fds = array.array('i', [r])
+            self.cli.sendmsg([MSG], [(socket.SOL_SOCKET, socket.SCM_RIGHTS,
+                                      fds.tostring())])
+        finally:
+            os.close(r)
+            os.close(w)
+
+    def testAncillaryTruncated(self):
+        # No room for the descriptor: it is dropped, and MSG_CTRUNC set
+        data, ancdata, flags, addr = self.serv.recvmsg(1024)
+        self.assertEqual(data, MSG)
+        self.assertEqual(ancdata, [])
+        self.assertTrue(flags & socket.MSG_CTRUNC)
+
+    _testAncillaryTruncated = _testPassFileDescriptor
+
+
 class BasicSocketPairTest(SocketPairTest):
 
     def __init__(self, methodName='runTest'):
@@ -1303,6 +1432,74 @@ class BufferIOTest(SocketConnectedTest):
     _testRecvFromIntoMemoryview = _testRecvFromIntoArray
 
 
+class SendfileTest(SocketConnectedTest):
+    """
+    Test socket.sendfile(), both through os.sendfile() and the send()
+    fallback.
+    """
+    FILEDATA = b"".join(chr(i % 251) for i in xrange(256 * 1024)) * 4
+
+    @classmethod
+    def setUpClass(cls):
+        with open(test_support.TESTFN, "wb") as f:
+            f.write(cls.FILEDATA)
+
+    @classmethod
+    def tearDownClass(cls):
+        test_support.unlink(test_support.TESTFN)
+
+    def recvAll(self):
+        chunks = []
+        while True:
+            data = self.cli_conn.recv(65536)
+            if not data:
+                break
+            chunks.append(data)
+        return b"".join(chunks)
+
+    def testSendfile(self):
+        self.assertEqual(self.recvAll(), self.FILEDATA)
+
+    def _testSendfile(self):
+        with open(test_support.TESTFN, "rb") as f:
+            self.assertEqual(self.serv_conn.sendfile(f), len(self.FILEDATA))
+            self.assertEqual(f.tell(), len(self.FILEDATA))
+
+    def testSendfileOffsetCount(self):
+        self.assertEqual(self.recvAll(), self.FILEDATA[5000:8000])
+
+    def _testSendfileOffsetCount(self):
+        with open(test_support.TESTFN, "rb") as f:
+            self.assertEqual(self.serv_conn.sendfile(f, 5000, 3000), 3000)
+            self.assertEqual(f.tell(), 8000)
+
+    def testSendfileWithTimeout(self):
+        self.assertEqual(self.recvAll(), self.FILEDATA)
+
+    def _testSendfileWithTimeout(self):
+        self.serv_conn.settimeout(30)
+        with open(test_support.TESTFN, "rb") as f:
+            self.assertEqual(self.serv_conn.sendfile(f), len(self.FILEDATA))
+
+    def testSendfileFallback(self):
+        self.assertEqual(self.recvAll(), self.FILEDATA[10:])
+
+    def _testSendfileFallback(self):
+        # No file descriptor: read() and send() are used.
+        f = io.BytesIO(self.FILEDATA)
+        self.assertEqual(self.serv_conn.sendfile(f, 10),
+                         len(self.FILEDATA) - 10)
+        self.assertEqual(f.tell(), len(self.FILEDATA))
+
+    def testSendfileNonBlocking(self):
+        self.assertEqual(self.recvAll(), b"")
+
+    def _testSendfileNonBlocking(self):
+        self.serv_conn.setblocking(False)
+        with open(test_support.TESTFN, "rb") as f:
+            self.assertRaises(ValueError, self.serv_conn.sendfile, f)
+
+
 TIPC_STYPE = 2000
 TIPC_LOWER = 200
 TIPC_UPPER = 210
@@ -1384,7 +1581,7 @@ class TIPCThreadableTest (unittest.TestCase, ThreadableTest):
 def test_main():
     tests = [GeneralModuleTests, BasicTCPTest, TCPCloserTest, TCPTimeoutTest,
              TestExceptions, BufferIOTest, BasicTCPTest2, BasicUDPTest,
-             UDPTimeoutTest ]
+             UDPTimeoutTest, SendfileTest, MsgUDPTest ]
 
     tests.extend([
         NonBlockingTCPTests,
@@ -1400,6 +1597,7 @@ def test_main():
     ])
     if hasattr(socket, "socketpair"):
         tests.append(BasicSocketPairTest)
+        tests.append(MsgSocketPairTest)
     if sys.platform == 'linux2':
         tests.append(TestLinuxAbstractNamespace)
     if isTipcAvailable():
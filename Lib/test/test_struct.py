@@ -490,6 +490,59 @@ class StructTest(unittest.TestCase):
 
             self.test_unpack_from(cls=buffer)
 
+    def test_memoryview(self):
+        self.test_unpack_from(cls=memoryview)
+        data = bytearray('\x00\x00\x12\x34\x56\x78')
+        view = memoryview(data)
+        self.assertEqual(struct.unpack('>I', view[2:]), (0x12345678,))
+        self.assertEqual(struct.unpack_from('>H', view, 4), (0x5678,))
+        struct.pack_into('>H', view, 0, 0x9abc)
+        self.assertEqual(data[:2], '\x9a\xbc')
+        struct.Struct('>H').pack_into(view[2:], 2, 1)
+        self.assertEqual(data, '\x9a\xbc\x12\x34\x00\x01')
+        self.assertRaises(TypeError, struct.pack_into, '>H',
+                          memoryview('abcd'), 0, 1)
+        # arrays export their buffer without being copied
+        a = array.array('B', [0] * 4)
+        struct.pack_into('>I', memoryview(a), 0, 0x01020304)
+        self.assertEqual(a.tolist(), [1, 2, 3, 4])
+
+    def test_iter_unpack(self):
+        s = struct.Struct('>iB')
+        data = ''.join(s.pack(i, i & 0xff) for i in range(-5, 300))
+        it = s.iter_unpack(data)
+        self.assertEqual(it.__length_hint__(), 305)
+        self.assertEqual(iter(it), it)
+        self.assertEqual(it.next(), (-5, 251))
+        self.assertEqual(it.__length_hint__(), 304)
+        # tuples which are kept are not reused
+        rest = list(it)
+        self.assertEqual(rest, [(i, i & 0xff) for i in range(-4, 300)])
+        self.assertEqual(it.__length_hint__(), 0)
+        self.assertRaises(StopIteration, it.next)
+        # tuples which are dropped may be, without changing the values
+        total = 0
+        for i, b in s.iter_unpack(data):
+            total += i
+        self.assertEqual(total, sum(range(-5, 300)))
+        self.assertEqual(list(struct.iter_unpack('>iB', data)), [(-5, 251)] +
+                         rest)
+
+        self.assertEqual(list(s.iter_unpack('')), [])
+        self.assertEqual(list(s.iter_unpack(buffer(data, 5, 10))),
+                         [(-4, 252), (-3, 253)])
+        self.assertRaises(struct.error, s.iter_unpack, data[:-1])
+        self.assertRaises(struct.error, struct.iter_unpack, '', data)
+        self.assertRaises(TypeError, s.iter_unpack, 5)
+
+        # the buffer is exported until the iterator is exhausted
+        data = bytearray(s.pack(1, 2) * 2)
+        it = s.iter_unpack(memoryview(data))
+        self.assertEqual(it.next(), (1, 2))
+        self.assertRaises(BufferError, data.extend, 'x')
+        self.assertEqual(list(it), [(1, 2)])
+        data.extend('x')
+
     def test_bool(self):
         for prefix in tuple("<>!=")+('',):
             false = (), [], [], '', 0
@@ -197,6 +197,20 @@ class LockTests(lock_tests.LockTests):
     locktype = thread.allocate_lock
 
 
+class RLockTests(lock_tests.RLockTests):
+    locktype = thread.RLock
+
+
+class ConditionTests(lock_tests.ConditionTests):
+    condtype = thread.Condition
+
+    def test_lock_types(self):
+        self.assertIsInstance(thread.Condition()._is_owned(), bool)
+        thread.Condition(thread.allocate_lock())
+        thread.Condition(thread.RLock())
+        self.assertRaises(TypeError, thread.Condition, object())
+
+
 class TestForkInThread(unittest.TestCase):
     def setUp(self):
         self.read_fd, self.write_fd = os.pipe()
@@ -236,7 +250,7 @@ class TestForkInThread(unittest.TestCase):
 
 def test_main():
     test_support.run_unittest(ThreadRunningTests, BarrierTest, LockTests,
-                              TestForkInThread)
+                              RLockTests, ConditionTests, TestForkInThread)
 
 if __name__ == "__main__":
     test_main()
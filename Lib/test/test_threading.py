@@ -518,6 +518,9 @@ class LockTests(lock_tests.LockTests):
 class RLockTests(lock_tests.RLockTests):
     locktype = staticmethod(threading.RLock)
 
+class PyRLockTests(lock_tests.RLockTests):
+    locktype = staticmethod(threading._RLock)
+
 class EventTests(lock_tests.EventTests):
     eventtype = staticmethod(threading.Event)
 
@@ -528,6 +531,12 @@ class ConditionAsRLockTests(lock_tests.RLockTests):
 class ConditionTests(lock_tests.ConditionTests):
     condtype = staticmethod(threading.Condition)
 
+class PyConditionAsRLockTests(lock_tests.RLockTests):
+    locktype = staticmethod(threading._Condition)
+
+class PyConditionTests(lock_tests.ConditionTests):
+    condtype = staticmethod(threading._Condition)
+
 class SemaphoreTests(lock_tests.SemaphoreTests):
     semtype = staticmethod(threading.Semaphore)
 
@@ -536,8 +545,10 @@ class BoundedSemaphoreTests(lock_tests.BoundedSemaphoreTests):
 
 
 def test_main():
-    test.test_support.run_unittest(LockTests, RLockTests, EventTests,
+    test.test_support.run_unittest(LockTests, RLockTests, PyRLockTests,
+                                   EventTests,
                                    ConditionAsRLockTests, ConditionTests,
+                                   PyConditionAsRLockTests, PyConditionTests,
                                    SemaphoreTests, BoundedSemaphoreTests,
                                    ThreadTests,
                                    ThreadJoinOnShutdown,
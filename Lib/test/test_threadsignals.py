@@ -4,6 +4,7 @@ import unittest
 import signal
 import os
 import sys
+import time
 from test.test_support import run_unittest, import_module
 thread = import_module('thread')
 
@@ -67,6 +68,79 @@ class ThreadSignals(unittest.TestCase):
         thread.start_new_thread(send_signals, ())
 
 
+class BlockingCallSignalTests(unittest.TestCase):
+    """Test that signal handlers run while the main thread waits for a
+       lock, and that an exception they raise ends the wait.
+    """
+    def alarm_interrupt(self, sig, frame):
+        raise KeyboardInterrupt
+
+    def assertInterrupted(self, func, *args, **kwargs):
+        oldalrm = signal.signal(signal.SIGALRM, self.alarm_interrupt)
+        try:
+            signal.alarm(1)
+            t1 = time.time()
+            self.assertRaises(KeyboardInterrupt, func, *args, **kwargs)
+            self.assertLess(time.time() - t1, 3.0)
+        finally:
+            signal.alarm(0)
+            signal.signal(signal.SIGALRM, oldalrm)
+
+    def test_lock_acquire_interruption(self):
+        lock = thread.allocate_lock()
+        lock.acquire()
+        self.assertInterrupted(lock.acquire, timeout=5)
+        self.assertInterrupted(lock.acquire)
+
+    def test_rlock_acquire_interruption(self):
+        rlock = thread.RLock()
+        held = thread.allocate_lock()
+        done = thread.allocate_lock()
+        held.acquire()
+        done.acquire()
+        def other_thread():
+            with rlock:
+                held.release()
+                done.acquire()
+        thread.start_new_thread(other_thread, ())
+        held.acquire()
+        try:
+            self.assertInterrupted(rlock.acquire, timeout=5)
+        finally:
+            done.release()
+
+    def test_condition_wait_interruption(self):
+        cond = thread.Condition()
+        with cond:
+            self.assertInterrupted(cond.wait, 5)
+            self.assertTrue(cond._is_owned())
+
+    def test_queue_get_interruption(self):
+        q = thread.SimpleQueue()
+        self.assertInterrupted(q.get, timeout=5)
+        q.put(1)
+        self.assertEqual(q.get(), 1)
+
+    def test_lock_acquire_retries_on_intr(self):
+        # A handler which doesn't raise doesn't end the wait early.
+        tripped = []
+        def handler(sig, frame):
+            tripped.append(sig)
+        oldalrm = signal.signal(signal.SIGALRM, handler)
+        try:
+            lock = thread.allocate_lock()
+            lock.acquire()
+            signal.alarm(1)
+            t1 = time.time()
+            self.assertFalse(lock.acquire(timeout=2))
+            dt = time.time() - t1
+            self.assertEqual(tripped, [signal.SIGALRM])
+            self.assertGreaterEqual(dt, 1.9)
+        finally:
+            signal.alarm(0)
+            signal.signal(signal.SIGALRM, oldalrm)
+
+
 def test_main():
     global signal_blackboard
 
@@ -76,7 +150,7 @@ def test_main():
 
     oldsigs = registerSignals(handle_signals, handle_signals, handle_signals)
     try:
-        run_unittest(ThreadSignals)
+        run_unittest(ThreadSignals, BlockingCallSignalTests)
     finally:
         registerSignals(*oldsigs)
 
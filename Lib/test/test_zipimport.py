@@ -302,6 +302,51 @@ class UncompressedZipImportTestCase(ImportHooksBaseTestCase):
             z.close()
             os.remove(TEMP_ZIP)
 
+    def testGetDataRewrittenArchive(self):
+        # Members are read through a descriptor of the archive shared by
+        # all importers; replacing the archive must not serve stale data.
+        try:
+            for data in ("first version", "second, longer version" * 100):
+                z = ZipFile(TEMP_ZIP, "w")
+                z.compression = self.compression
+                z.writestr("testdata.dat", data)
+                z.close()
+                zipimport._zip_directory_cache.clear()
+                zi = zipimport.zipimporter(TEMP_ZIP)
+                self.assertEquals(zi.get_data("testdata.dat"), data)
+                self.assertEquals(
+                    zipimport.zipimporter(TEMP_ZIP).get_data("testdata.dat"),
+                    data)
+        finally:
+            os.remove(TEMP_ZIP)
+
+    def testGetDataArchiveChangedInPlace(self):
+        # The shared descriptor sees writes to the archive, and a
+        # truncated archive gives an error rather than a crash.
+        def archive(data):
+            f = StringIO.StringIO()
+            z = ZipFile(f, "w")
+            z.writestr("testdata.dat", data)
+            z.close()
+            return f.getvalue()
+        try:
+            with open(TEMP_ZIP, "wb") as f:
+                f.write(archive("first version"))
+            zi = zipimport.zipimporter(TEMP_ZIP)
+            self.assertEquals(zi.get_data("testdata.dat"), "first version")
+            with open(TEMP_ZIP, "r+b") as f:
+                f.write(archive("other version"))
+            self.assertEquals(zi.get_data("testdata.dat"), "other version")
+            with open(TEMP_ZIP, "r+b") as f:
+                f.truncate(40)
+            self.assertRaises(IOError, zi.get_data, "testdata.dat")
+            with open(TEMP_ZIP, "r+b") as f:
+                f.truncate(10)
+            self.assertRaises(zipimport.ZipImportError,
+                              zi.get_data, "testdata.dat")
+        finally:
+            os.remove(TEMP_ZIP)
+
     def testImporterAttr(self):
         src = """if 1:  # indent hack
         def get_file():
@@ -434,6 +479,40 @@ class BadFileZipImportTestCase(unittest.TestCase):
         fp.close()
         self.assertZipFailure(TESTMOD)
 
+    def testBadCentralDirectory(self):
+        test_support.unlink(TESTMOD)
+        fp = open(TESTMOD, 'wb')
+        # End of central directory record claiming a directory larger
+        # than the file.
+        fp.write(struct.pack('<IHHHHIIH', 0x06054B50, 0, 0, 1, 1,
+                             1000, 0, 0))
+        fp.close()
+        try:
+            self.assertZipFailure(TESTMOD)
+        finally:
+            test_support.unlink(TESTMOD)
+
+    def testBadHeaderSize(self):
+        # A central directory entry whose extra field and comment lengths
+        # would make its header size zero if read as signed shorts.
+        test_support.unlink(TESTMOD)
+        name = 'x.py'
+        cdir = struct.pack('<IHHHHHHIIIHHHHHII', 0x02014B50, 20, 20, 0, 0,
+                           0, 0, 0, 0, 0, len(name), 0x8000,
+                           0x10000 - 0x8000 - 46 - len(name), 0, 0, 0, 0)
+        cdir += name
+        fp = open(TESTMOD, 'wb')
+        fp.write(cdir)
+        fp.write(struct.pack('<IHHHHIIH', 0x06054B50, 0, 0, 1, 1,
+                             len(cdir), 0, 0))
+        fp.close()
+        try:
+            z = zipimport.zipimporter(TESTMOD)
+            self.assertEqual(z._files, {})
+        finally:
+            zipimport._zip_directory_cache.clear()
+            test_support.unlink(TESTMOD)
+
     # XXX: disabled until this works on Big-endian machines
     def _testBogusZipFile(self):
         test_support.unlink(TESTMOD)
@@ -1,10 +1,15 @@
 import unittest
 from test import test_support
+import array
 import binascii
 import random
 from test.test_support import precisionbigmemtest, _1G
 
 zlib = test_support.import_module('zlib')
+try:
+    import threading
+except ImportError:
+    threading = None
 
 
 class ChecksumTestCase(unittest.TestCase):
@@ -142,6 +147,80 @@ class CompressTestCase(BaseCompressTestCase, unittest.TestCase):
             "Error -5 while decompressing data: incomplete or truncated stream",
             zlib.decompress, x[:-1])
 
+    def test_buffer_inputs(self):
+        data = HAMLET_SCENE * 8
+        x = zlib.compress(data)
+        self.assertEqual(zlib.compress(memoryview(data)), x)
+        self.assertEqual(zlib.decompress(memoryview(x)), data)
+        self.assertEqual(zlib.decompress(bytearray(x)), data)
+        self.assertEqual(zlib.crc32(memoryview(data)[10:]),
+                         zlib.crc32(data[10:]))
+        self.assertEqual(zlib.adler32(memoryview(data)), zlib.adler32(data))
+        a = array.array('c', data)
+        self.assertEqual(zlib.compress(a), x)
+        self.assertEqual(zlib.crc32(memoryview(a)), zlib.crc32(data))
+        co = zlib.compressobj()
+        y = co.compress(memoryview(data)) + co.flush()
+        dco = zlib.decompressobj()
+        self.assertEqual(dco.decompress(memoryview(y)) + dco.flush(), data)
+
+    def test_compress_into(self):
+        data = HAMLET_SCENE * 8
+        buf = bytearray(len(data) + 64)
+        n = zlib.compress_into(data, buf)
+        self.assertEqual(str(buf[:n]), zlib.compress(data))
+        self.assertEqual(zlib.decompress(str(buf[:n])), data)
+        n = zlib.compress_into(data, buf, 9)
+        self.assertEqual(str(buf[:n]), zlib.compress(data, 9))
+
+    def test_compress_into_too_small(self):
+        buf = bytearray(10)
+        self.assertRaisesRegexp(zlib.error, "output buffer too small",
+                                zlib.compress_into, HAMLET_SCENE, buf)
+        self.assertRaises(TypeError, zlib.compress_into, HAMLET_SCENE,
+                          "read-only")
+
+    def test_decompress_into(self):
+        data = HAMLET_SCENE * 8
+        x = zlib.compress(data)
+        buf = bytearray(len(data) + 10)
+        n = zlib.decompress_into(x, buf)
+        self.assertEqual(n, len(data))
+        self.assertEqual(str(buf[:n]), data)
+        self.assertRaisesRegexp(zlib.error, "output buffer too small",
+                                zlib.decompress_into, x,
+                                bytearray(len(data) - 1))
+        self.assertRaises(zlib.error, zlib.decompress_into, x[:-1], buf)
+
+    def test_compress_parallel(self):
+        # each block is a compression stream: keep the tiny ones few
+        short = HAMLET_SCENE[:300]
+        data = HAMLET_SCENE * 300
+        for blocksize, source in ((1, short), (100, short), (4096, data),
+                                  (32768, data), (1 << 20, data)):
+            for threads in (1, 3):
+                x = zlib.compress_parallel(source, 6, threads, blocksize)
+                self.assertEqual(zlib.decompress(x), source)
+                dco = zlib.decompressobj()
+                self.assertEqual(dco.decompress(x) + dco.flush(), source)
+                self.assertEqual(dco.unused_data, "")
+        for level in (-1, 0, 1, 9):
+            x = zlib.compress_parallel(data, level)
+            self.assertEqual(zlib.decompress(x), data)
+        self.assertEqual(zlib.decompress(zlib.compress_parallel("")), "")
+        # random data, so the dictionaries matter less than the block ends
+        data = genblock(1, 100000)
+        x = zlib.compress_parallel(data, 1, 4, 16384)
+        self.assertEqual(zlib.decompress(x), data)
+
+    def test_compress_parallel_bad_args(self):
+        self.assertRaises(zlib.error, zlib.compress_parallel, "x", 10)
+        self.assertRaises(ValueError, zlib.compress_parallel, "x", 6, -1)
+        self.assertRaises(ValueError, zlib.compress_parallel, "x", 6, 1, 0)
+
+    if not hasattr(zlib, 'compress_parallel'):
+        del test_compress_parallel, test_compress_parallel_bad_args
+
     # Memory use of the following functions takes into account overallocation
 
     @precisionbigmemtest(size=_1G + 1024 * 1024, memuse=3)
@@ -441,6 +520,45 @@ class CompressObjectTestCase(BaseCompressTestCase, unittest.TestCase):
             d.flush()
             self.assertRaises(ValueError, d.copy)
 
+    def test_decompress_into(self):
+        data = HAMLET_SCENE * 8
+        x = zlib.compress(data)
+        dco = zlib.decompressobj()
+        buf = bytearray(100)
+        out = []
+        while x:
+            n = dco.decompress_into(x, buf)
+            out.append(str(buf[:n]))
+            x = dco.unconsumed_tail
+        self.assertEqual(''.join(out), data)
+        self.assertEqual(dco.unused_data, "")
+
+    def test_decompress_into_unused_data(self):
+        x = zlib.compress(HAMLET_SCENE) + "tail"
+        dco = zlib.decompressobj()
+        buf = bytearray(len(HAMLET_SCENE))
+        n = dco.decompress_into(x, buf)
+        self.assertEqual(str(buf[:n]), HAMLET_SCENE)
+        self.assertEqual(dco.unused_data, "tail")
+
+    @unittest.skipUnless(threading, 'requires threading')
+    def test_threaded_objects(self):
+        # each thread uses its own objects, with the GIL released
+        data = [genblock(i, 20000) + HAMLET_SCENE * 50 for i in range(4)]
+        results = [None] * len(data)
+        def work(i):
+            co = zlib.compressobj(6)
+            x = co.compress(data[i]) + co.flush()
+            dco = zlib.decompressobj()
+            results[i] = dco.decompress(x) + dco.flush()
+        threads = [threading.Thread(target=work, args=(i,))
+                   for i in range(len(data))]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(results, data)
+
     # Memory use of the following functions takes into account overallocation
 
     @precisionbigmemtest(size=_1G + 1024 * 1024, memuse=3)
@@ -35,6 +35,16 @@ _start_new_thread = thread.start_new_thread
 _allocate_lock = thread.allocate_lock
 _get_ident = thread.get_ident
 ThreadError = thread.error
+try:
+    _TIMEOUT_MAX = thread.TIMEOUT_MAX
+except AttributeError:
+    _TIMEOUT_MAX = 2**31
+try:
+    _CRLock = thread.RLock
+    _CCondition = thread.Condition
+    _CLockTypes = (thread.LockType, thread.RLock)
+except AttributeError:
+    _CRLock = _CCondition = None
 del thread
 
 
@@ -93,7 +103,10 @@ def settrace(func):
 Lock = _allocate_lock
 
 def RLock(*args, **kwargs):
-    return _RLock(*args, **kwargs)
+    # The C implementation doesn't support the verbose argument
+    if _CRLock is None or args or kwargs:
+        return _RLock(*args, **kwargs)
+    return _CRLock()
 
 class _RLock(_Verbose):
 
@@ -112,14 +125,17 @@ class _RLock(_Verbose):
         return "<%s owner=%r count=%d>" % (
                 self.__class__.__name__, owner, self.__count)
 
-    def acquire(self, blocking=1):
+    def acquire(self, blocking=1, timeout=-1):
         me = _get_ident()
         if self.__owner == me:
             self.__count = self.__count + 1
             if __debug__:
                 self._note("%s.acquire(%s): recursive success", self, blocking)
             return 1
-        rc = self.__block.acquire(blocking)
+        if timeout == -1:
+            rc = self.__block.acquire(blocking)
+        else:
+            rc = self.__block.acquire(blocking, timeout)
         if rc:
             self.__owner = me
             self.__count = 1
@@ -173,6 +189,11 @@ class _RLock(_Verbose):
 
 
 def Condition(*args, **kwargs):
+    # The C implementation works with the C locks only
+    if _CCondition is not None and not kwargs and len(args) <= 1:
+        lock = args[0] if args else None
+        if lock is None or type(lock) in _CLockTypes:
+            return _CCondition(lock)
     return _Condition(*args, **kwargs)
 
 class _Condition(_Verbose):
@@ -239,22 +260,10 @@ class _Condition(_Verbose):
                 if __debug__:
                     self._note("%s.wait(): got it", self)
             else:
-                # Balancing act:  We can't afford a pure busy loop, so we
-                # have to sleep; but if we sleep the whole timeout time,
-                # we'll be unresponsive.  The scheme here sleeps very
-                # little at first, longer as time goes on, but never longer
-                # than 20 times per second (or the timeout time remaining).
-                endtime = _time() + timeout
-                delay = 0.0005 # 500 us -> initial delay of 1 ms
-                while True:
-                    gotit = waiter.acquire(0)
-                    if gotit:
-                        break
-                    remaining = endtime - _time()
-                    if remaining <= 0:
-                        break
-                    delay = min(delay * 2, remaining, .05)
-                    _sleep(delay)
+                if timeout > 0:
+                    gotit = waiter.acquire(True, min(timeout, _TIMEOUT_MAX))
+                else:
+                    gotit = waiter.acquire(False)
                 if not gotit:
                     if __debug__:
                         self._note("%s.wait(%s): timed out", self, timeout)
@@ -0,0 +1,961 @@
+/* Event loop engine for asyncore.
+
+   asyncore.loop() spends most of its time turning the socket map into
+   select() or poll() arguments on every iteration.  EventLoop keeps the
+   channels registered with an epoll object instead, and on each run_once()
+   only asks the kernel to change the registrations of the channels whose
+   readable()/writable() answer changed.  The events of one epoll_wait() are
+   dispatched in a single pass, and a binary heap of timers bounds the time
+   spent waiting.  The dispatchers themselves are not touched: events are
+   still delivered through asyncore.readwrite().
+*/
+
+#include "Python.h"
+#include "structmember.h"
+
+#include <math.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+
+#define EV_READ (EPOLLIN | EPOLLPRI)
+#define EV_WRITE EPOLLOUT
+
+static PyObject *str_readable = NULL;
+static PyObject *str_writable = NULL;
+static PyObject *str_socket = NULL;
+
+static double
+floattime(void)
+{
+    struct timeval t;
+#ifdef GETTIMEOFDAY_NO_TZ
+    gettimeofday(&t);
+#else
+    gettimeofday(&t, (struct timezone *)NULL);
+#endif
+    return (double)t.tv_sec + t.tv_usec * 0.000001;
+}
+
+/* Timer objects, returned by EventLoop.call_later() */
+
+typedef struct {
+    PyObject_HEAD
+    double when;
+    unsigned long seq;          /* breaks ties between equal deadlines */
+    PyObject *callback;         /* NULL once called or cancelled */
+    PyObject *args;
+} TimerObject;
+
+static PyTypeObject Timer_Type;
+
+static int
+timer_traverse(TimerObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->callback);
+    Py_VISIT(self->args);
+    return 0;
+}
+
+static int
+timer_clear(TimerObject *self)
+{
+    Py_CLEAR(self->callback);
+    Py_CLEAR(self->args);
+    return 0;
+}
+
+static void
+timer_dealloc(TimerObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    timer_clear(self);
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+timer_cancel(TimerObject *self)
+{
+    timer_clear(self);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(timer_cancel_doc,
+"cancel() -> None\n\
+\n\
+Don't call the callback.  Does nothing if it was already called.");
+
+static PyObject *
+timer_get_active(TimerObject *self, void *closure)
+{
+    return PyBool_FromLong(self->callback != NULL);
+}
+
+static PyMethodDef timer_methods[] = {
+    {"cancel",          (PyCFunction)timer_cancel,
+     METH_NOARGS,       timer_cancel_doc},
+    {NULL,              NULL},
+};
+
+static PyMemberDef timer_members[] = {
+    {"when", T_DOUBLE, offsetof(TimerObject, when), READONLY,
+     "time at which the callback is due, as returned by EventLoop.time()"},
+    {NULL}
+};
+
+static PyGetSetDef timer_getsetlist[] = {
+    {"active", (getter)timer_get_active, NULL,
+     "True if the callback is still to be called"},
+    {NULL}
+};
+
+PyDoc_STRVAR(timer_doc,
+"A callback scheduled with EventLoop.call_later().");
+
+static PyTypeObject Timer_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_asyncore.Timer",                                  /* tp_name */
+    sizeof(TimerObject),                                /* tp_basicsize */
+    0,                                                  /* tp_itemsize */
+    (destructor)timer_dealloc,                          /* tp_dealloc */
+    0,                                                  /* tp_print */
+    0,                                                  /* tp_getattr */
+    0,                                                  /* tp_setattr */
+    0,                                                  /* tp_compare */
+    0,                                                  /* tp_repr */
+    0,                                                  /* tp_as_number */
+    0,                                                  /* tp_as_sequence */
+    0,                                                  /* tp_as_mapping */
+    0,                                                  /* tp_hash */
+    0,                                                  /* tp_call */
+    0,                                                  /* tp_str */
+    PyObject_GenericGetAttr,                            /* tp_getattro */
+    0,                                                  /* tp_setattro */
+    0,                                                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,            /* tp_flags */
+    timer_doc,                                          /* tp_doc */
+    (traverseproc)timer_traverse,                       /* tp_traverse */
+    (inquiry)timer_clear,                               /* tp_clear */
+    0,                                                  /* tp_richcompare */
+    0,                                                  /* tp_weaklistoffset */
+    0,                                                  /* tp_iter */
+    0,                                                  /* tp_iternext */
+    timer_methods,                                      /* tp_methods */
+    timer_members,                                      /* tp_members */
+    timer_getsetlist,                                   /* tp_getset */
+};
+
+/* EventLoop objects */
+
+/* What the kernel knows about an fd of the map */
+#define REG_NONE   0    /* nothing, the entry is unused */
+#define REG_IDLE   1    /* neither readable() nor writable(): not registered */
+#define REG_EPOLL  2    /* registered with the flags of the entry */
+#define REG_ALWAYS 3    /* a regular file, which epoll refuses: always ready */
+
+typedef struct {
+    PyObject *key;              /* the key of the map, normally the fd */
+    PyObject *obj;              /* the channel */
+    PyObject *sock;             /* obj.socket, to notice a new socket */
+    unsigned int flags;
+    unsigned long gen;          /* last run_once() which found it in the map */
+    int state;
+} regentry;
+
+typedef struct {
+    PyObject_HEAD
+    int epfd;
+    PyObject *dispatch;         /* called as dispatch(obj, flags) */
+    int running;
+    unsigned long gen;
+    /* registrations, indexed by fd */
+    regentry *regs;
+    int nregs;
+    int nepoll;                 /* number of REG_EPOLL entries */
+    int nalways;                /* number of REG_ALWAYS entries */
+    /* snapshot of the map, reused from one run_once() to the next */
+    PyObject **snap;
+    Py_ssize_t snap_size;
+    struct epoll_event *evs;
+    int evs_size;
+    /* timers, a binary heap ordered by (when, seq) */
+    TimerObject **heap;
+    Py_ssize_t heap_len;
+    Py_ssize_t heap_size;
+    unsigned long seq;
+} EventLoopObject;
+
+static PyTypeObject EventLoop_Type;
+
+static PyObject *
+eventloop_err_closed(void)
+{
+    PyErr_SetString(PyExc_ValueError,
+                    "I/O operation on closed event loop");
+    return NULL;
+}
+
+static void
+regentry_clear(regentry *r)
+{
+    Py_CLEAR(r->key);
+    Py_CLEAR(r->obj);
+    Py_CLEAR(r->sock);
+    r->flags = 0;
+    r->state = REG_NONE;
+}
+
+static void
+eventloop_internal_close(EventLoopObject *self)
+{
+    int i;
+
+    if (self->epfd >= 0) {
+        int epfd = self->epfd;
+        self->epfd = -1;
+        Py_BEGIN_ALLOW_THREADS
+        close(epfd);
+        Py_END_ALLOW_THREADS
+    }
+    for (i = 0; i < self->nregs; i++)
+        regentry_clear(&self->regs[i]);
+    self->nepoll = self->nalways = 0;
+    while (self->heap_len > 0) {
+        TimerObject *t = self->heap[--self->heap_len];
+        Py_DECREF(t);
+    }
+}
+
+static PyObject *
+eventloop_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    EventLoopObject *self;
+    PyObject *dispatch;
+    static char *kwlist[] = {"dispatch", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O:EventLoop", kwlist,
+                                     &dispatch))
+        return NULL;
+    if (!PyCallable_Check(dispatch)) {
+        PyErr_SetString(PyExc_TypeError, "dispatch must be callable");
+        return NULL;
+    }
+
+    self = (EventLoopObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    Py_INCREF(dispatch);
+    self->dispatch = dispatch;
+
+    Py_BEGIN_ALLOW_THREADS
+    self->epfd = epoll_create(FD_SETSIZE - 1);
+    Py_END_ALLOW_THREADS
+    if (self->epfd < 0) {
+        Py_DECREF(self);
+        PyErr_SetFromErrno(PyExc_IOError);
+        return NULL;
+    }
+    return (PyObject *)self;
+}
+
+static int
+eventloop_traverse(EventLoopObject *self, visitproc visit, void *arg)
+{
+    int i;
+    Py_ssize_t j;
+
+    Py_VISIT(self->dispatch);
+    for (i = 0; i < self->nregs; i++) {
+        Py_VISIT(self->regs[i].key);
+        Py_VISIT(self->regs[i].obj);
+        Py_VISIT(self->regs[i].sock);
+    }
+    for (j = 0; j < self->heap_len; j++)
+        Py_VISIT(self->heap[j]);
+    return 0;
+}
+
+static int
+eventloop_clear(EventLoopObject *self)
+{
+    int i;
+
+    Py_CLEAR(self->dispatch);
+    for (i = 0; i < self->nregs; i++)
+        regentry_clear(&self->regs[i]);
+    while (self->heap_len > 0) {
+        TimerObject *t = self->heap[--self->heap_len];
+        Py_DECREF(t);
+    }
+    return 0;
+}
+
+static void
+eventloop_dealloc(EventLoopObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    eventloop_internal_close(self);
+    eventloop_clear(self);
+    PyMem_Free(self->regs);
+    PyMem_Free(self->snap);
+    PyMem_Free(self->evs);
+    PyMem_Free(self->heap);
+    Py_TYPE(self)->tp_free(self);
+}
+
+/* Timer heap */
+
+#define TIMER_LT(a, b) \
+    ((a)->when < (b)->when || ((a)->when == (b)->when && (a)->seq < (b)->seq))
+
+static int
+heap_push(EventLoopObject *self, TimerObject *t)
+{
+    Py_ssize_t pos;
+
+    if (self->heap_len == self->heap_size) {
+        Py_ssize_t size = self->heap_size ? self->heap_size * 2 : 16;
+        TimerObject **heap = self->heap;
+        if (PyMem_Resize(heap, TimerObject *, size) == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->heap = heap;
+        self->heap_size = size;
+    }
+    pos = self->heap_len++;
+    while (pos > 0) {
+        Py_ssize_t parent = (pos - 1) >> 1;
+        if (!TIMER_LT(t, self->heap[parent]))
+            break;
+        self->heap[pos] = self->heap[parent];
+        pos = parent;
+    }
+    Py_INCREF(t);
+    self->heap[pos] = t;
+    return 0;
+}
+
+/* Remove the first timer and return the reference the heap had */
+static TimerObject *
+heap_pop(EventLoopObject *self)
+{
+    TimerObject *result = self->heap[0];
+    TimerObject *last = self->heap[--self->heap_len];
+    Py_ssize_t n = self->heap_len, pos = 0;
+
+    if (n > 0) {
+        for (;;) {
+            Py_ssize_t child = 2 * pos + 1;
+            if (child >= n)
+                break;
+            if (child + 1 < n &&
+                TIMER_LT(self->heap[child + 1], self->heap[child]))
+                child++;
+            if (!TIMER_LT(self->heap[child], last))
+                break;
+            self->heap[pos] = self->heap[child];
+            pos = child;
+        }
+        self->heap[pos] = last;
+    }
+    return result;
+}
+
+/* Drop the cancelled timers at the top of the heap, so that they don't
+   shorten the wait. */
+static void
+heap_discard_cancelled(EventLoopObject *self)
+{
+    while (self->heap_len > 0 && self->heap[0]->callback == NULL) {
+        TimerObject *t = heap_pop(self);
+        Py_DECREF(t);
+    }
+}
+
+/* Registrations */
+
+static int
+eventloop_grow_regs(EventLoopObject *self, int fd)
+{
+    regentry *regs = self->regs;
+    int n = self->nregs ? self->nregs : 64;
+
+    while (n <= fd) {
+        if (n > INT_MAX / 2) {
+            n = INT_MAX;
+            break;
+        }
+        n *= 2;
+    }
+    if (PyMem_Resize(regs, regentry, n) == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    memset(regs + self->nregs, 0, (n - self->nregs) * sizeof(regentry));
+    self->regs = regs;
+    self->nregs = n;
+    return 0;
+}
+
+static int
+eventloop_ctl(EventLoopObject *self, int op, int fd, unsigned int flags)
+{
+    struct epoll_event ev;
+    int result;
+
+    ev.events = flags;
+    ev.data.u64 = 0;
+    ev.data.fd = fd;
+    Py_BEGIN_ALLOW_THREADS
+    result = epoll_ctl(self->epfd, op, fd, &ev);
+    Py_END_ALLOW_THREADS
+    return result;
+}
+
+static void
+eventloop_forget(EventLoopObject *self, int fd)
+{
+    regentry *r = &self->regs[fd];
+
+    if (r->state == REG_EPOLL) {
+        /* Fails if the fd was closed already; that's fine. */
+        eventloop_ctl(self, EPOLL_CTL_DEL, fd, 0);
+        self->nepoll--;
+    }
+    else if (r->state == REG_ALWAYS)
+        self->nalways--;
+    regentry_clear(r);
+}
+
+/* Tell the kernel that fd, now served by obj, wants the given events */
+static int
+eventloop_update(EventLoopObject *self, int fd, PyObject *key,
+                 PyObject *obj, PyObject *sock, unsigned int flags)
+{
+    regentry *r = &self->regs[fd];
+    int state = r->state;
+
+    if (flags == 0) {
+        /* Like poll2(), don't even check for errors then. */
+        if (state == REG_EPOLL) {
+            eventloop_ctl(self, EPOLL_CTL_DEL, fd, 0);
+            self->nepoll--;
+        }
+        else if (state == REG_ALWAYS)
+            self->nalways--;
+        state = REG_IDLE;
+    }
+    else if (state != REG_ALWAYS || r->obj != obj || r->sock != sock) {
+        int op = state == REG_EPOLL ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        int result = eventloop_ctl(self, op, fd, flags);
+
+        if (result < 0 && errno == EEXIST)
+            /* A closed fd whose number was reused by a new channel */
+            result = eventloop_ctl(self, EPOLL_CTL_MOD, fd, flags);
+        else if (result < 0 && errno == ENOENT)
+            /* The kernel dropped the registration on close() */
+            result = eventloop_ctl(self, EPOLL_CTL_ADD, fd, flags);
+        if (state == REG_EPOLL)
+            self->nepoll--;
+        else if (state == REG_ALWAYS)
+            self->nalways--;
+        if (result == 0) {
+            state = REG_EPOLL;
+            self->nepoll++;
+        }
+        else if (errno == EPERM) {
+            /* Regular files are always ready, as with select() */
+            state = REG_ALWAYS;
+            self->nalways++;
+        }
+        else {
+            PyErr_SetFromErrno(PyExc_IOError);
+            regentry_clear(r);
+            return -1;
+        }
+    }
+
+    if (r->key != key) {
+        PyObject *tmp = r->key;
+        Py_INCREF(key);
+        r->key = key;
+        Py_XDECREF(tmp);
+    }
+    if (r->obj != obj) {
+        PyObject *tmp = r->obj;
+        Py_INCREF(obj);
+        r->obj = obj;
+        Py_XDECREF(tmp);
+    }
+    if (r->sock != sock) {
+        PyObject *tmp = r->sock;
+        Py_XINCREF(sock);
+        r->sock = sock;
+        Py_XDECREF(tmp);
+    }
+    r->flags = flags;
+    r->state = state;
+    return 0;
+}
+
+static int
+eventloop_ask(PyObject *obj, PyObject *name)
+{
+    PyObject *res = PyObject_CallMethodObjArgs(obj, name, NULL);
+    int istrue;
+
+    if (res == NULL)
+        return -1;
+    istrue = PyObject_IsTrue(res);
+    Py_DECREF(res);
+    return istrue;
+}
+
+/* Bring the registrations in line with the map */
+static int
+eventloop_sync(EventLoopObject *self, PyObject *map)
+{
+    Py_ssize_t n, pos, i;
+    PyObject *key, *value;
+    int fd, result = 0;
+
+    /* readable() and writable() may change the map: work on a copy. */
+    n = PyDict_Size(map);
+    if (2 * n > self->snap_size) {
+        PyObject **snap = self->snap;
+        if (PyMem_Resize(snap, PyObject *, 2 * n) == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->snap = snap;
+        self->snap_size = 2 * n;
+    }
+    pos = i = 0;
+    while (i < n && PyDict_Next(map, &pos, &key, &value)) {
+        Py_INCREF(key);
+        Py_INCREF(value);
+        self->snap[2 * i] = key;
+        self->snap[2 * i + 1] = value;
+        i++;
+    }
+    n = i;
+
+    self->gen++;
+    for (i = 0; i < n; i++) {
+        PyObject *obj = self->snap[2 * i + 1], *sock;
+        unsigned int flags = 0;
+        regentry *r;
+        int rd, wr;
+
+        key = self->snap[2 * i];
+        fd = PyObject_AsFileDescriptor(key);
+        if (fd < 0)
+            goto error;
+        if (fd >= self->nregs && eventloop_grow_regs(self, fd) < 0)
+            goto error;
+        if ((rd = eventloop_ask(obj, str_readable)) < 0)
+            goto error;
+        if ((wr = eventloop_ask(obj, str_writable)) < 0)
+            goto error;
+        if (rd)
+            flags |= EV_READ;
+        if (wr)
+            flags |= EV_WRITE;
+        sock = PyObject_GetAttr(obj, str_socket);
+        if (sock == NULL) {
+            if (!PyErr_ExceptionMatches(PyExc_AttributeError))
+                goto error;
+            PyErr_Clear();
+        }
+
+        r = &self->regs[fd];
+        if (r->state == REG_NONE || r->obj != obj || r->sock != sock ||
+            r->flags != flags || r->key != key) {
+            if (eventloop_update(self, fd, key, obj, sock, flags) < 0) {
+                Py_XDECREF(sock);
+                goto error;
+            }
+        }
+        Py_XDECREF(sock);
+        r->gen = self->gen;
+    }
+
+    /* Forget the channels which left the map */
+    for (fd = 0; fd < self->nregs; fd++) {
+        regentry *r = &self->regs[fd];
+        if (r->state != REG_NONE && r->gen != self->gen)
+            eventloop_forget(self, fd);
+    }
+    goto done;
+
+  error:
+    result = -1;
+  done:
+    for (i = 0; i < 2 * n; i++)
+        Py_DECREF(self->snap[i]);
+    return result;
+}
+
+/* Call dispatch(obj, flags) for the channel registered for fd, if it
+   is still in the map. */
+static int
+eventloop_dispatch(EventLoopObject *self, PyObject *map, int fd,
+                   unsigned int flags)
+{
+    PyObject *obj, *pyflags, *res;
+
+    if (fd < 0 || fd >= self->nregs || self->regs[fd].key == NULL)
+        return 0;
+    obj = PyDict_GetItem(map, self->regs[fd].key);
+    if (obj == NULL)
+        return 0;
+    pyflags = PyInt_FromLong((long)flags);
+    if (pyflags == NULL)
+        return -1;
+    Py_INCREF(obj);
+    res = PyObject_CallFunctionObjArgs(self->dispatch, obj, pyflags, NULL);
+    Py_DECREF(obj);
+    Py_DECREF(pyflags);
+    if (res == NULL)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Call the timers which were due when called, but not those scheduled
+   by the callbacks themselves. */
+static int
+eventloop_run_timers(EventLoopObject *self)
+{
+    double now = floattime();
+    unsigned long seq = self->seq;
+
+    while (self->heap_len > 0) {
+        TimerObject *t = self->heap[0];
+        PyObject *callback, *args, *res;
+
+        if (t->callback != NULL && (t->when > now || t->seq >= seq))
+            break;
+        t = heap_pop(self);
+        callback = t->callback;
+        args = t->args;
+        t->callback = t->args = NULL;
+        Py_DECREF(t);
+        if (callback == NULL)
+            continue;
+        res = PyObject_Call(callback, args, NULL);
+        Py_DECREF(callback);
+        Py_DECREF(args);
+        if (res == NULL)
+            return -1;
+        Py_DECREF(res);
+    }
+    return 0;
+}
+
+static PyObject *
+eventloop_run_once(EventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *pytimeout = Py_None, *map;
+    double dtimeout = -1.0;
+    int timeout, nfds, maxevents, i;
+    static char *kwlist[] = {"timeout", "map", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO!:run_once", kwlist,
+                                     &pytimeout, &PyDict_Type, &map))
+        return NULL;
+    if (pytimeout != Py_None) {
+        dtimeout = PyFloat_AsDouble(pytimeout);
+        if (dtimeout == -1.0 && PyErr_Occurred())
+            return NULL;
+    }
+    if (self->epfd < 0)
+        return eventloop_err_closed();
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "run_once() called from a callback of the loop");
+        return NULL;
+    }
+
+    self->running = 1;
+    if (eventloop_sync(self, map) < 0)
+        goto error;
+
+    heap_discard_cancelled(self);
+    if (self->nalways > 0)
+        dtimeout = 0.0;
+    else if (self->heap_len > 0) {
+        double delay = self->heap[0]->when - floattime();
+        if (delay < 0.0)
+            delay = 0.0;
+        if (dtimeout < 0.0 || delay < dtimeout)
+            dtimeout = delay;
+    }
+    if (dtimeout < 0.0)
+        timeout = -1;
+    else if (dtimeout * 1000.0 > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "timeout is too large");
+        goto error;
+    }
+    else
+        /* Round up, not to wake up just before a timer is due. */
+        timeout = (int)ceil(dtimeout * 1000.0);
+
+    maxevents = self->nepoll > 0 ? self->nepoll : 1;
+    if (maxevents > self->evs_size) {
+        PyMem_Free(self->evs);
+        self->evs_size = 0;
+        self->evs = PyMem_New(struct epoll_event, maxevents);
+        if (self->evs == NULL) {
+            PyErr_NoMemory();
+            goto error;
+        }
+        self->evs_size = maxevents;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    nfds = epoll_wait(self->epfd, self->evs, maxevents, timeout);
+    Py_END_ALLOW_THREADS
+    if (nfds < 0) {
+        if (errno != EINTR) {
+            PyErr_SetFromErrno(PyExc_IOError);
+            goto error;
+        }
+        if (PyErr_CheckSignals() < 0)
+            goto error;
+        nfds = 0;
+    }
+
+    /* The EPOLL* flags have the values of their POLL* counterparts,
+       which readwrite() expects. */
+    for (i = 0; i < nfds; i++) {
+        if (eventloop_dispatch(self, map, self->evs[i].data.fd,
+                               self->evs[i].events) < 0)
+            goto error;
+    }
+    if (self->nalways > 0) {
+        int nregs = self->nregs;
+        for (i = 0; i < nregs; i++) {
+            regentry *r = &self->regs[i];
+            if (r->state == REG_ALWAYS &&
+                eventloop_dispatch(self, map, i, r->flags) < 0)
+                goto error;
+        }
+    }
+
+    if (eventloop_run_timers(self) < 0)
+        goto error;
+    self->running = 0;
+    Py_RETURN_NONE;
+
+  error:
+    self->running = 0;
+    return NULL;
+}
+
+PyDoc_STRVAR(eventloop_run_once_doc,
+"run_once(timeout, map) -> None\n\
+\n\
+Run one iteration of the loop over the channels of map, a dict mapping\n\
+fds to asyncore dispatchers: update the registrations of the channels,\n\
+wait at most timeout seconds (None for no limit) for an event or the next\n\
+timer, call dispatch(obj, flags) for each ready channel, then the due\n\
+timers.");
+
+static PyObject *
+eventloop_call_later(EventLoopObject *self, PyObject *args)
+{
+    PyObject *callback, *cbargs;
+    TimerObject *t;
+    double delay;
+    Py_ssize_t n = PyTuple_GET_SIZE(args);
+
+    if (n < 2) {
+        PyErr_SetString(PyExc_TypeError,
+                        "call_later() takes at least 2 arguments");
+        return NULL;
+    }
+    delay = PyFloat_AsDouble(PyTuple_GET_ITEM(args, 0));
+    if (delay == -1.0 && PyErr_Occurred())
+        return NULL;
+    callback = PyTuple_GET_ITEM(args, 1);
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+    if (self->epfd < 0)
+        return eventloop_err_closed();
+
+    cbargs = PyTuple_GetSlice(args, 2, n);
+    if (cbargs == NULL)
+        return NULL;
+    t = PyObject_GC_New(TimerObject, &Timer_Type);
+    if (t == NULL) {
+        Py_DECREF(cbargs);
+        return NULL;
+    }
+    t->when = floattime() + delay;
+    t->seq = self->seq++;
+    Py_INCREF(callback);
+    t->callback = callback;
+    t->args = cbargs;
+    PyObject_GC_Track(t);
+
+    if (heap_push(self, t) < 0) {
+        Py_DECREF(t);
+        return NULL;
+    }
+    return (PyObject *)t;
+}
+
+PyDoc_STRVAR(eventloop_call_later_doc,
+"call_later(delay, callback, *args) -> Timer\n\
+\n\
+Arrange for callback(*args) to be called by run_once() once delay\n\
+seconds have passed.  Callbacks due at the same time are called in the\n\
+order they were scheduled.");
+
+static PyObject *
+eventloop_time(EventLoopObject *self)
+{
+    return PyFloat_FromDouble(floattime());
+}
+
+PyDoc_STRVAR(eventloop_time_doc,
+"time() -> float\n\
+\n\
+Return the current time on the clock of the timers.");
+
+static PyObject *
+eventloop_close(EventLoopObject *self)
+{
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "can't close the loop from one of its callbacks");
+        return NULL;
+    }
+    eventloop_internal_close(self);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(eventloop_close_doc,
+"close() -> None\n\
+\n\
+Close the epoll file descriptor and drop the channels and the timers.");
+
+static PyObject *
+eventloop_fileno(EventLoopObject *self)
+{
+    if (self->epfd < 0)
+        return eventloop_err_closed();
+    return PyInt_FromLong(self->epfd);
+}
+
+PyDoc_STRVAR(eventloop_fileno_doc,
+"fileno() -> int\n\
+\n\
+Return the epoll control file descriptor.");
+
+static PyObject *
+eventloop_get_closed(EventLoopObject *self, void *closure)
+{
+    return PyBool_FromLong(self->epfd < 0);
+}
+
+static PyMethodDef eventloop_methods[] = {
+    {"run_once",        (PyCFunction)eventloop_run_once,
+     METH_VARARGS | METH_KEYWORDS,      eventloop_run_once_doc},
+    {"call_later",      (PyCFunction)eventloop_call_later,
+     METH_VARARGS,      eventloop_call_later_doc},
+    {"time",            (PyCFunction)eventloop_time,
+     METH_NOARGS,       eventloop_time_doc},
+    {"close",           (PyCFunction)eventloop_close,
+     METH_NOARGS,       eventloop_close_doc},
+    {"fileno",          (PyCFunction)eventloop_fileno,
+     METH_NOARGS,       eventloop_fileno_doc},
+    {NULL,              NULL},
+};
+
+static PyGetSetDef eventloop_getsetlist[] = {
+    {"closed", (getter)eventloop_get_closed, NULL,
+     "True if the event loop is closed"},
+    {NULL}
+};
+
+PyDoc_STRVAR(eventloop_doc,
+"EventLoop(dispatch)\n\
+\n\
+An epoll based event loop for asyncore.  dispatch(obj, flags) is called\n\
+for each ready channel, normally with asyncore.readwrite.");
+
+static PyTypeObject EventLoop_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_asyncore.EventLoop",                              /* tp_name */
+    sizeof(EventLoopObject),                            /* tp_basicsize */
+    0,                                                  /* tp_itemsize */
+    (destructor)eventloop_dealloc,                      /* tp_dealloc */
+    0,                                                  /* tp_print */
+    0,                                                  /* tp_getattr */
+    0,                                                  /* tp_setattr */
+    0,                                                  /* tp_compare */
+    0,                                                  /* tp_repr */
+    0,                                                  /* tp_as_number */
+    0,                                                  /* tp_as_sequence */
+    0,                                                  /* tp_as_mapping */
+    0,                                                  /* tp_hash */
+    0,                                                  /* tp_call */
+    0,                                                  /* tp_str */
+    PyObject_GenericGetAttr,                            /* tp_getattro */
+    0,                                                  /* tp_setattro */
+    0,                                                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,            /* tp_flags */
+    eventloop_doc,                                      /* tp_doc */
+    (traverseproc)eventloop_traverse,                   /* tp_traverse */
+    (inquiry)eventloop_clear,                           /* tp_clear */
+    0,                                                  /* tp_richcompare */
+    0,                                                  /* tp_weaklistoffset */
+    0,                                                  /* tp_iter */
+    0,                                                  /* tp_iternext */
+    eventloop_methods,                                  /* tp_methods */
+    0,                                                  /* tp_members */
+    eventloop_getsetlist,                               /* tp_getset */
+    0,                                                  /* tp_base */
+    0,                                                  /* tp_dict */
+    0,                                                  /* tp_descr_get */
+    0,                                                  /* tp_descr_set */
+    0,                                                  /* tp_dictoffset */
+    0,                                                  /* tp_init */
+    0,                                                  /* tp_alloc */
+    eventloop_new,                                      /* tp_new */
+    0,                                                  /* tp_free */
+};
+
+PyDoc_STRVAR(module_doc,
+"Event loop engine for asyncore.");
+
+PyMODINIT_FUNC
+init_asyncore(void)
+{
+    PyObject *m;
+
+    Py_TYPE(&Timer_Type) = &PyType_Type;
+    if (PyType_Ready(&Timer_Type) < 0)
+        return;
+    Py_TYPE(&EventLoop_Type) = &PyType_Type;
+    if (PyType_Ready(&EventLoop_Type) < 0)
+        return;
+
+    str_readable = PyString_InternFromString("readable");
+    str_writable = PyString_InternFromString("writable");
+    str_socket = PyString_InternFromString("socket");
+    if (str_readable == NULL || str_writable == NULL || str_socket == NULL)
+        return;
+
+    m = Py_InitModule3("_asyncore", NULL, module_doc);
+    if (m == NULL)
+        return;
+    Py_INCREF(&EventLoop_Type);
+    PyModule_AddObject(m, "EventLoop", (PyObject *)&EventLoop_Type);
+    Py_INCREF(&Timer_Type);
+    PyModule_AddObject(m, "Timer", (PyObject *)&Timer_Type);
+}
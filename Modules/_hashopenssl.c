@@ -15,35 +15,13 @@
 
 #include "Python.h"
 #include "structmember.h"
-
-#ifdef WITH_THREAD
-#include "pythread.h"
-    #define ENTER_HASHLIB(obj) \
-        if ((obj)->lock) { \
-            if (!PyThread_acquire_lock((obj)->lock, 0)) { \
-                Py_BEGIN_ALLOW_THREADS \
-                PyThread_acquire_lock((obj)->lock, 1); \
-                Py_END_ALLOW_THREADS \
-            } \
-        }
-    #define LEAVE_HASHLIB(obj) \
-        if ((obj)->lock) { \
-            PyThread_release_lock((obj)->lock); \
-        }
-#else
-    #define ENTER_HASHLIB(obj)
-    #define LEAVE_HASHLIB(obj)
-#endif
+#include "hashlib.h"
 
 /* EVP is the preferred interface to hashing in OpenSSL */
 #include <openssl/evp.h>
 
 #define MUNCH_SIZE INT_MAX
 
-/* TODO(gps): We should probably make this a module or EVPobject attribute
- * to allow the user to optimize based on the platform they're using. */
-#define HASHLIB_GIL_MINSIZE 2048
-
 #ifndef HASH_OBJ_CONSTRUCTOR
 #define HASH_OBJ_CONSTRUCTOR 0
 #endif
@@ -99,7 +77,7 @@ newEVPobject(PyObject *name)
 }
 
 static void
-EVP_hash(EVPobject *self, const void *vp, Py_ssize_t len)
+EVP_hash_ctx(EVP_MD_CTX *ctx, const void *vp, Py_ssize_t len)
 {
     unsigned int process;
     const unsigned char *cp = (const unsigned char *)vp;
@@ -109,12 +87,18 @@ EVP_hash(EVPobject *self, const void *vp, Py_ssize_t len)
             process = MUNCH_SIZE;
         else
             process = Py_SAFE_DOWNCAST(len, Py_ssize_t, unsigned int);
-        EVP_DigestUpdate(&self->ctx, (const void*)cp, process);
+        EVP_DigestUpdate(ctx, (const void*)cp, process);
         len -= process;
         cp += process;
     }
 }
 
+static void
+EVP_hash(EVPobject *self, const void *vp, Py_ssize_t len)
+{
+    EVP_hash_ctx(&self->ctx, vp, len);
+}
+
 /* Internal methods for a hash object */
 
 static void
@@ -252,11 +236,53 @@ EVP_update(EVPobject *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+EVP_digest_many(EVPobject *self, PyObject *buffers)
+{
+    PyObject *fast, *result;
+    Py_buffer *views;
+    Py_ssize_t n, i, total;
+    EVP_MD_CTX base_ctx, temp_ctx;
+    PyThreadState *_save = NULL;
+
+    fast = PySequence_Fast(buffers, "digest_many() needs a sequence");
+    if (fast == NULL)
+        return NULL;
+    views = hashlib_get_views(fast, &n, &total);
+    if (views == NULL) {
+        Py_DECREF(fast);
+        return NULL;
+    }
+    result = hashlib_new_digests(n, EVP_MD_CTX_size(&self->ctx));
+    if (result != NULL) {
+        locked_EVP_MD_CTX_copy(&base_ctx, self);
+
+        if (total >= HASHLIB_GIL_MINSIZE)
+            _save = PyEval_SaveThread();
+        for (i = 0; i < n; i++) {
+            EVP_MD_CTX_copy(&temp_ctx, &base_ctx);
+            EVP_hash_ctx(&temp_ctx, views[i].buf, views[i].len);
+            EVP_DigestFinal(&temp_ctx, (unsigned char *)
+                            PyString_AS_STRING(PyList_GET_ITEM(result, i)),
+                            NULL);
+            EVP_MD_CTX_cleanup(&temp_ctx);
+        }
+        if (_save != NULL)
+            PyEval_RestoreThread(_save);
+        EVP_MD_CTX_cleanup(&base_ctx);
+    }
+    hashlib_release_views(views, n);
+    Py_DECREF(fast);
+    return result;
+}
+
 static PyMethodDef EVP_methods[] = {
     {"update",    (PyCFunction)EVP_update,    METH_VARARGS, EVP_update__doc__},
     {"digest",    (PyCFunction)EVP_digest,    METH_NOARGS,  EVP_digest__doc__},
     {"hexdigest", (PyCFunction)EVP_hexdigest, METH_NOARGS,  EVP_hexdigest__doc__},
     {"copy",      (PyCFunction)EVP_copy,      METH_NOARGS,  EVP_copy__doc__},
+    {"digest_many", (PyCFunction)EVP_digest_many, METH_O,
+     hashlib_digest_many__doc__},
     {NULL,        NULL}         /* sentinel */
 };
 
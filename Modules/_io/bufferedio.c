@@ -694,6 +694,10 @@ buffered_peek(buffered *self, PyObject *args)
         return NULL;
     }
 
+    /* Fast path: a reader with buffered data doesn't need the lock. */
+    if (!self->writable && READAHEAD(self) > 0)
+        return _bufferedreader_peek_unlocked(self, n);
+
     ENTER_BUFFERED(self)
 
     if (self->writable) {
@@ -765,6 +769,13 @@ buffered_read1(buffered *self, PyObject *args)
     if (n == 0)
         return PyBytes_FromStringAndSize(NULL, 0);
 
+    /* Fast path: a reader with buffered data doesn't need the lock. */
+    if (!self->writable) {
+        have = Py_SAFE_DOWNCAST(READAHEAD(self), Py_off_t, Py_ssize_t);
+        if (have > 0)
+            return _bufferedreader_read_fast(self, n > have ? have : n);
+    }
+
     ENTER_BUFFERED(self)
     
     if (self->writable) {
@@ -954,6 +965,79 @@ buffered_readline(buffered *self, PyObject *args)
     return _buffered_readline(self, limit);
 }
 
+static PyObject *
+buffered_readlines(buffered *self, PyObject *args)
+{
+    Py_ssize_t hint = -1, length = 0;
+    PyObject *result, *line;
+    PyTypeObject *tp;
+
+    CHECK_INITIALIZED(self)
+    if (!PyArg_ParseTuple(args, "|O&:readlines",
+                          &_PyIO_ConvertSsize_t, &hint))
+        return NULL;
+
+    /* Subclasses may override readline() or __iter__(). */
+    tp = Py_TYPE(self);
+    if (tp != &PyBufferedReader_Type && tp != &PyBufferedRandom_Type)
+        return PyObject_CallMethod((PyObject *) &PyIOBase_Type,
+                                   "readlines", "On", self, hint);
+
+    CHECK_CLOSED(self, "readline of closed file")
+
+    result = PyList_New(0);
+    if (result == NULL)
+        return NULL;
+
+    for (;;) {
+        const char *start, *s, *end;
+
+        /* Split all the complete lines in the buffer at once.  Like the
+           fast path of _buffered_readline(), this can run unlocked. */
+        start = self->buffer + self->pos;
+        end = start + Py_SAFE_DOWNCAST(READAHEAD(self), Py_off_t, Py_ssize_t);
+        while ((s = memchr(start, '\n', end - start)) != NULL) {
+            s++;
+            line = PyBytes_FromStringAndSize(start, s - start);
+            if (line == NULL)
+                goto error;
+            if (PyList_Append(result, line) < 0) {
+                Py_DECREF(line);
+                goto error;
+            }
+            Py_DECREF(line);
+            self->pos += s - start;
+            length += s - start;
+            if (hint > 0 && length > hint)
+                return result;
+            start = s;
+        }
+
+        /* The rest of the buffer is an incomplete line: let readline()
+           refill the buffer and complete it. */
+        line = _buffered_readline(self, -1);
+        if (line == NULL)
+            goto error;
+        if (PyBytes_GET_SIZE(line) == 0) {
+            Py_DECREF(line);
+            break;
+        }
+        if (PyList_Append(result, line) < 0) {
+            Py_DECREF(line);
+            goto error;
+        }
+        length += PyBytes_GET_SIZE(line);
+        Py_DECREF(line);
+        if (hint > 0 && length > hint)
+            break;
+    }
+    return result;
+
+error:
+    Py_DECREF(result);
+    return NULL;
+}
+
 
 static PyObject *
 buffered_tell(buffered *self, PyObject *args)
@@ -1466,6 +1550,7 @@ static PyMethodDef bufferedreader_methods[] = {
     {"peek", (PyCFunction)buffered_peek, METH_VARARGS},
     {"read1", (PyCFunction)buffered_read1, METH_VARARGS},
     {"readline", (PyCFunction)buffered_readline, METH_VARARGS},
+    {"readlines", (PyCFunction)buffered_readlines, METH_VARARGS},
     {"seek", (PyCFunction)buffered_seek, METH_VARARGS},
     {"tell", (PyCFunction)buffered_tell, METH_NOARGS},
     {"truncate", (PyCFunction)buffered_truncate, METH_VARARGS},
@@ -1724,6 +1809,41 @@ bufferedwriter_write(buffered *self, PyObject *args)
         written = buf.len;
         goto end;
     }
+    written = 0;
+
+#ifdef HAVE_WRITEV
+    /* If the raw stream is a FileIO already positioned at the end of the
+       pending data, write that data and buf together with a single writev()
+       call instead of flushing first.  A short write just leaves the rest
+       to the generic code below. */
+    if (self->fast_closed_checks && VALID_WRITE_BUFFER(self) &&
+        self->write_pos < self->write_end && self->pos == self->write_end &&
+        RAW_OFFSET(self) + (self->pos - self->write_pos) == 0 &&
+        buf.len >= self->buffer_size) {
+        struct iovec iov[2];
+        Py_ssize_t n, pending;
+
+        pending = Py_SAFE_DOWNCAST(self->write_end - self->write_pos,
+                                   Py_off_t, Py_ssize_t);
+        iov[0].iov_base = self->buffer + self->write_pos;
+        iov[0].iov_len = pending;
+        iov[1].iov_base = buf.buf;
+        iov[1].iov_len = buf.len;
+        n = _PyFileIO_writev(self->raw, iov, 2);
+        if (n < 0)
+            goto error;
+        if (n > 0 && self->abs_pos != -1)
+            self->abs_pos += n;
+        if (n < pending) {
+            self->write_pos += n;
+        }
+        else {
+            self->write_pos = self->write_end;
+            written = n - pending;
+        }
+        self->raw_pos = self->write_pos;
+    }
+#endif
 
     /* First write the current buffer */
     res = _bufferedwriter_flush_unlocked(self, 0);
@@ -1775,8 +1895,7 @@ bufferedwriter_write(buffered *self, PyObject *args)
     }
 
     /* Then write buf itself. At this point the buffer has been emptied. */
-    remaining = buf.len;
-    written = 0;
+    remaining = buf.len - written;
     while (remaining > self->buffer_size) {
         Py_ssize_t n = _bufferedwriter_raw_write(
             self, (char *) buf.buf + written, buf.len - written);
@@ -2227,6 +2346,7 @@ static PyMethodDef bufferedrandom_methods[] = {
     {"read1", (PyCFunction)buffered_read1, METH_VARARGS},
     {"readinto", (PyCFunction)buffered_readinto, METH_VARARGS},
     {"readline", (PyCFunction)buffered_readline, METH_VARARGS},
+    {"readlines", (PyCFunction)buffered_readlines, METH_VARARGS},
     {"peek", (PyCFunction)buffered_peek, METH_VARARGS},
     {"write", (PyCFunction)bufferedwriter_write, METH_VARARGS},
     {NULL, NULL}
@@ -11,6 +11,10 @@
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#include <limits.h> /* For IOV_MAX */
 #include <stddef.h> /* For offsetof */
 #include "_iomodule.h"
 
@@ -48,6 +52,11 @@
 #define BIGCHUNK  (512 * 1024)
 #endif
 
+/* readv() and writev() take at most IOV_MAX buffers; POSIX guarantees 16. */
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
 typedef struct {
     PyObject_HEAD
     int fd;
@@ -677,6 +686,320 @@ fileio_write(fileio *self, PyObject *args)
     return PyLong_FromSsize_t(n);
 }
 
+#if defined(HAVE_PREAD) || defined(HAVE_PWRITE)
+/* Converts a file offset for pread() and pwrite(), which don't accept
+   negative values. */
+static int
+offset_converter(PyObject *obj, void *addr)
+{
+    Py_off_t offset;
+
+    if (PyFloat_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError, "an integer is required");
+        return 0;
+    }
+    offset = PyNumber_AsOff_t(obj, PyExc_OverflowError);
+    if (offset == -1 && PyErr_Occurred())
+        return 0;
+    if (offset < 0) {
+        PyErr_SetString(PyExc_ValueError, "negative offset");
+        return 0;
+    }
+    *((Py_off_t *)addr) = offset;
+    return 1;
+}
+#endif
+
+#ifdef HAVE_PREAD
+static PyObject *
+fileio_pread(fileio *self, PyObject *args)
+{
+    Py_ssize_t n, size;
+    Py_off_t offset;
+    PyObject *bytes;
+
+    if (self->fd < 0)
+        return err_closed();
+    if (!self->readable)
+        return err_mode("reading");
+
+    if (!PyArg_ParseTuple(args, "nO&:pread", &size,
+                          offset_converter, &offset))
+        return NULL;
+    if (size < 0) {
+        PyErr_SetString(PyExc_ValueError, "negative size");
+        return NULL;
+    }
+
+    bytes = PyBytes_FromStringAndSize(NULL, size);
+    if (bytes == NULL)
+        return NULL;
+
+    if (_PyVerify_fd(self->fd)) {
+        Py_BEGIN_ALLOW_THREADS
+        errno = 0;
+        n = pread(self->fd, PyBytes_AS_STRING(bytes), size, offset);
+        Py_END_ALLOW_THREADS
+    } else
+        n = -1;
+
+    if (n < 0) {
+        Py_DECREF(bytes);
+        if (errno == EAGAIN)
+            Py_RETURN_NONE;
+        PyErr_SetFromErrno(PyExc_IOError);
+        return NULL;
+    }
+
+    if (n != size) {
+        if (_PyBytes_Resize(&bytes, n) < 0) {
+            Py_DECREF(bytes);
+            return NULL;
+        }
+    }
+
+    return bytes;
+}
+#endif /* HAVE_PREAD */
+
+#ifdef HAVE_PWRITE
+static PyObject *
+fileio_pwrite(fileio *self, PyObject *args)
+{
+    Py_buffer pbuf;
+    Py_ssize_t n;
+    Py_off_t offset;
+
+    if (self->fd < 0)
+        return err_closed();
+    if (!self->writable)
+        return err_mode("writing");
+
+    if (!PyArg_ParseTuple(args, "s*O&:pwrite", &pbuf,
+                          offset_converter, &offset))
+        return NULL;
+
+    if (_PyVerify_fd(self->fd)) {
+        Py_BEGIN_ALLOW_THREADS
+        errno = 0;
+        n = pwrite(self->fd, pbuf.buf, pbuf.len, offset);
+        Py_END_ALLOW_THREADS
+    } else
+        n = -1;
+
+    PyBuffer_Release(&pbuf);
+
+    if (n < 0) {
+        if (errno == EAGAIN)
+            Py_RETURN_NONE;
+        PyErr_SetFromErrno(PyExc_IOError);
+        return NULL;
+    }
+
+    return PyLong_FromSsize_t(n);
+}
+#endif /* HAVE_PWRITE */
+
+#if defined(HAVE_READV) || defined(HAVE_WRITEV)
+/* Acquires the buffers of the objects of the sequence seq and points an
+   iovec at each.  Returns the number of buffers, or -1 with an exception
+   set.  On success the buffers must be released with iov_release(); each
+   one holds a reference to its object, which keeps the memory alive even
+   when seq was a temporary. */
+static int
+iov_setup(PyObject *seq, struct iovec **piov, Py_buffer **pbufs, int writable)
+{
+    PyObject *fast;
+    Py_ssize_t len;
+    int i, cnt;
+    struct iovec *iov;
+    Py_buffer *bufs;
+
+    fast = PySequence_Fast(seq, "expected a sequence of buffers");
+    if (fast == NULL)
+        return -1;
+    len = PySequence_Fast_GET_SIZE(fast);
+    if (len > IOV_MAX) {
+        PyErr_Format(PyExc_ValueError,
+                     "at most %d buffers can be used", IOV_MAX);
+        Py_DECREF(fast);
+        return -1;
+    }
+    cnt = (int) len;
+
+    iov = PyMem_New(struct iovec, cnt > 0 ? cnt : 1);
+    bufs = PyMem_New(Py_buffer, cnt > 0 ? cnt : 1);
+    if (iov == NULL || bufs == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    for (i = 0; i < cnt; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        int res;
+        if (PyObject_CheckBuffer(item))
+            res = PyObject_GetBuffer(item, &bufs[i], writable ?
+                                     PyBUF_WRITABLE : PyBUF_SIMPLE);
+        else {
+            /* Old-style buffer, like the "w*" and "s*" formats accept */
+            void *ptr;
+            Py_ssize_t size;
+            if (writable)
+                res = PyObject_AsWriteBuffer(item, &ptr, &size);
+            else
+                res = PyObject_AsReadBuffer(item, (const void **) &ptr,
+                                            &size);
+            if (res == 0)
+                res = PyBuffer_FillInfo(&bufs[i], item, ptr, size,
+                                        !writable, PyBUF_SIMPLE);
+        }
+        if (res < 0) {
+            while (--i >= 0)
+                PyBuffer_Release(&bufs[i]);
+            goto error;
+        }
+        iov[i].iov_base = bufs[i].buf;
+        iov[i].iov_len = bufs[i].len;
+    }
+    Py_DECREF(fast);
+    *piov = iov;
+    *pbufs = bufs;
+    return cnt;
+
+error:
+    Py_DECREF(fast);
+    PyMem_Free(iov);
+    PyMem_Free(bufs);
+    return -1;
+}
+
+static void
+iov_release(struct iovec *iov, Py_buffer *bufs, int cnt)
+{
+    int i;
+
+    for (i = 0; i < cnt; i++)
+        PyBuffer_Release(&bufs[i]);
+    PyMem_Free(iov);
+    PyMem_Free(bufs);
+}
+#endif
+
+#ifdef HAVE_READV
+static PyObject *
+fileio_readv(fileio *self, PyObject *args)
+{
+    PyObject *seq;
+    struct iovec *iov;
+    Py_buffer *bufs;
+    Py_ssize_t n;
+    int cnt;
+
+    if (self->fd < 0)
+        return err_closed();
+    if (!self->readable)
+        return err_mode("reading");
+
+    if (!PyArg_ParseTuple(args, "O:readv", &seq))
+        return NULL;
+    cnt = iov_setup(seq, &iov, &bufs, 1);
+    if (cnt < 0)
+        return NULL;
+
+    if (_PyVerify_fd(self->fd)) {
+        Py_BEGIN_ALLOW_THREADS
+        errno = 0;
+        n = readv(self->fd, iov, cnt);
+        Py_END_ALLOW_THREADS
+    } else
+        n = -1;
+
+    iov_release(iov, bufs, cnt);
+
+    if (n < 0) {
+        if (errno == EAGAIN)
+            Py_RETURN_NONE;
+        PyErr_SetFromErrno(PyExc_IOError);
+        return NULL;
+    }
+
+    return PyLong_FromSsize_t(n);
+}
+#endif /* HAVE_READV */
+
+#ifdef HAVE_WRITEV
+Py_ssize_t
+_PyFileIO_writev(PyObject *oself, const struct iovec *iov, int iovcnt)
+{
+    fileio *self = (fileio *) oself;
+    Py_ssize_t n;
+
+    if (self->fd < 0) {
+        err_closed();
+        return -1;
+    }
+    if (!self->writable) {
+        err_mode("writing");
+        return -1;
+    }
+
+    if (_PyVerify_fd(self->fd)) {
+        Py_BEGIN_ALLOW_THREADS
+        errno = 0;
+        n = writev(self->fd, iov, iovcnt);
+        Py_END_ALLOW_THREADS
+    } else
+        n = -1;
+
+    if (n < 0) {
+        if (errno == EAGAIN)
+            return 0;
+        PyErr_SetFromErrno(PyExc_IOError);
+        return -1;
+    }
+    return n;
+}
+
+static PyObject *
+fileio_writev(fileio *self, PyObject *args)
+{
+    PyObject *seq;
+    struct iovec *iov;
+    Py_buffer *bufs;
+    Py_ssize_t n;
+    int cnt;
+
+    if (self->fd < 0)
+        return err_closed();
+    if (!self->writable)
+        return err_mode("writing");
+
+    if (!PyArg_ParseTuple(args, "O:writev", &seq))
+        return NULL;
+    cnt = iov_setup(seq, &iov, &bufs, 0);
+    if (cnt < 0)
+        return NULL;
+
+    if (_PyVerify_fd(self->fd)) {
+        Py_BEGIN_ALLOW_THREADS
+        errno = 0;
+        n = writev(self->fd, iov, cnt);
+        Py_END_ALLOW_THREADS
+    } else
+        n = -1;
+
+    iov_release(iov, bufs, cnt);
+
+    if (n < 0) {
+        if (errno == EAGAIN)
+            Py_RETURN_NONE;
+        PyErr_SetFromErrno(PyExc_IOError);
+        return NULL;
+    }
+
+    return PyLong_FromSsize_t(n);
+}
+#endif /* HAVE_WRITEV */
+
 /* XXX Windows support below is likely incomplete */
 
 /* Cribbed from posix_lseek() */
@@ -948,6 +1271,46 @@ PyDoc_STRVAR(write_doc,
 "Only makes one system call, so not all of the data may be written.\n"
 "The number of bytes actually written is returned.");
 
+#ifdef HAVE_PREAD
+PyDoc_STRVAR(pread_doc,
+"pread(size: int, offset: int) -> bytes.  read at most size bytes\n"
+"starting at offset.\n"
+"\n"
+"The file position is neither used nor changed.  Only makes one system\n"
+"call, so less data may be returned than requested.  In non-blocking\n"
+"mode, returns None if no data is available.");
+#endif
+
+#ifdef HAVE_PWRITE
+PyDoc_STRVAR(pwrite_doc,
+"pwrite(b: bytes, offset: int) -> int.  Write bytes b at offset.\n"
+"\n"
+"The file position is neither used nor changed.  Only makes one system\n"
+"call, so not all of the data may be written.  The number of bytes\n"
+"actually written is returned.");
+#endif
+
+#ifdef HAVE_READV
+PyDoc_STRVAR(readv_doc,
+"readv(buffers) -> int.  read into a sequence of writable buffers.\n"
+"\n"
+"The buffers are filled in order with a single system call, and the\n"
+"number of bytes read is returned.  ValueError is raised if there are\n"
+"more than IOV_MAX buffers.\n"
+"\n"
+"In non-blocking mode, returns None if no data is available.");
+#endif
+
+#ifdef HAVE_WRITEV
+PyDoc_STRVAR(writev_doc,
+"writev(buffers) -> int.  Write a sequence of buffers, return number\n"
+"written.\n"
+"\n"
+"The buffers are written in order with a single system call, so not all\n"
+"of the data may be written.  ValueError is raised if there are more\n"
+"than IOV_MAX buffers.");
+#endif
+
 PyDoc_STRVAR(fileno_doc,
 "fileno() -> int. \"file descriptor\".\n"
 "\n"
@@ -1001,6 +1364,18 @@ static PyMethodDef fileio_methods[] = {
     {"readall",  (PyCFunction)fileio_readall,  METH_NOARGS,  readall_doc},
     {"readinto", (PyCFunction)fileio_readinto, METH_VARARGS, readinto_doc},
     {"write",    (PyCFunction)fileio_write,        METH_VARARGS, write_doc},
+#ifdef HAVE_PREAD
+    {"pread",    (PyCFunction)fileio_pread,        METH_VARARGS, pread_doc},
+#endif
+#ifdef HAVE_PWRITE
+    {"pwrite",   (PyCFunction)fileio_pwrite,       METH_VARARGS, pwrite_doc},
+#endif
+#ifdef HAVE_READV
+    {"readv",    (PyCFunction)fileio_readv,        METH_VARARGS, readv_doc},
+#endif
+#ifdef HAVE_WRITEV
+    {"writev",   (PyCFunction)fileio_writev,       METH_VARARGS, writev_doc},
+#endif
     {"seek",     (PyCFunction)fileio_seek,         METH_VARARGS, seek_doc},
     {"tell",     (PyCFunction)fileio_tell,         METH_VARARGS, tell_doc},
 #ifdef HAVE_FTRUNCATE
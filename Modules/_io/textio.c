@@ -186,6 +186,13 @@ PyDoc_STRVAR(incrementalnewlinedecoder_doc,
     "decoder.\n"
     );
 
+/* Codecs that TextIOWrapper decodes in C, without going through the
+   Python-level incremental decoder (see nldecoder_fast_decode()). */
+#define CODEC_GENERIC 0
+#define CODEC_ASCII   1
+#define CODEC_LATIN1  2
+#define CODEC_UTF8    3
+
 typedef struct {
     PyObject_HEAD
     PyObject *decoder;
@@ -193,6 +200,11 @@ typedef struct {
     signed int pendingcr: 1;
     signed int translate: 1;
     unsigned int seennl: 3;
+    /* When codec isn't CODEC_GENERIC, decoder is never called and the
+       decoding state is kept here instead. */
+    int codec;
+    PyObject *codec_errors;     /* bytes */
+    PyObject *undecoded;        /* bytes, or NULL if empty */
 } nldecoder_object;
 
 static int
@@ -224,6 +236,9 @@ incrementalnewlinedecoder_init(nldecoder_object *self,
     self->translate = translate;
     self->seennl = 0;
     self->pendingcr = 0;
+    self->codec = CODEC_GENERIC;
+    Py_CLEAR(self->codec_errors);
+    Py_CLEAR(self->undecoded);
 
     return 0;
 }
@@ -233,9 +248,59 @@ incrementalnewlinedecoder_dealloc(nldecoder_object *self)
 {
     Py_CLEAR(self->decoder);
     Py_CLEAR(self->errors);
+    Py_CLEAR(self->codec_errors);
+    Py_CLEAR(self->undecoded);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
+/* Decode input with the C codec chosen by textiowrapper_init().  Only
+   UTF-8 may leave an incomplete sequence for the next call, as its
+   Python-level incremental decoder would. */
+static PyObject *
+nldecoder_fast_decode(nldecoder_object *self, PyObject *input, int final)
+{
+    const char *data, *errors;
+    Py_ssize_t len, consumed;
+    PyObject *joined = NULL, *output;
+
+    if (PyObject_AsReadBuffer(input, (const void **) &data, &len) < 0)
+        return NULL;
+    errors = PyBytes_AS_STRING(self->codec_errors);
+
+    if (self->codec == CODEC_ASCII)
+        return PyUnicode_DecodeASCII(data, len, errors);
+    if (self->codec == CODEC_LATIN1)
+        return PyUnicode_DecodeLatin1(data, len, errors);
+
+    assert(self->codec == CODEC_UTF8);
+    if (self->undecoded != NULL) {
+        Py_ssize_t pending = PyBytes_GET_SIZE(self->undecoded);
+        joined = PyBytes_FromStringAndSize(NULL, pending + len);
+        if (joined == NULL)
+            return NULL;
+        memcpy(PyBytes_AS_STRING(joined),
+               PyBytes_AS_STRING(self->undecoded), pending);
+        memcpy(PyBytes_AS_STRING(joined) + pending, data, len);
+        data = PyBytes_AS_STRING(joined);
+        len += pending;
+    }
+    consumed = len;
+    output = PyUnicode_DecodeUTF8Stateful(data, len, errors,
+                                          final ? NULL : &consumed);
+    if (output != NULL) {
+        /* On error, keep the previous state like the Python decoder. */
+        Py_CLEAR(self->undecoded);
+        if (consumed < len) {
+            self->undecoded = PyBytes_FromStringAndSize(data + consumed,
+                                                        len - consumed);
+            if (self->undecoded == NULL)
+                Py_CLEAR(output);
+        }
+    }
+    Py_XDECREF(joined);
+    return output;
+}
+
 #define SEEN_CR   1
 #define SEEN_LF   2
 #define SEEN_CRLF 4
@@ -256,7 +321,10 @@ _PyIncrementalNewlineDecoder_decode(PyObject *_self,
     }
 
     /* decode input (with the eventual \r from a previous pass) */
-    if (self->decoder != Py_None) {
+    if (self->codec != CODEC_GENERIC) {
+        output = nldecoder_fast_decode(self, input, final);
+    }
+    else if (self->decoder != Py_None) {
         output = PyObject_CallMethodObjArgs(self->decoder,
             _PyIO_str_decode, input, final ? Py_True : Py_False, NULL);
     }
@@ -479,7 +547,18 @@ incrementalnewlinedecoder_getstate(nldecoder_object *self, PyObject *args)
     PyObject *buffer;
     unsigned PY_LONG_LONG flag;
 
-    if (self->decoder != Py_None) {
+    if (self->codec != CODEC_GENERIC) {
+        if (self->undecoded != NULL) {
+            buffer = self->undecoded;
+            Py_INCREF(buffer);
+        }
+        else
+            buffer = PyBytes_FromString("");
+        if (buffer == NULL)
+            return NULL;
+        flag = 0;
+    }
+    else if (self->decoder != Py_None) {
         PyObject *state = PyObject_CallMethodObjArgs(self->decoder,
            _PyIO_str_getstate, NULL);
         if (state == NULL)
@@ -513,7 +592,20 @@ incrementalnewlinedecoder_setstate(nldecoder_object *self, PyObject *state)
     self->pendingcr = (int) flag & 1;
     flag >>= 1;
 
-    if (self->decoder != Py_None)
+    if (self->codec != CODEC_GENERIC) {
+        if (!PyBytes_Check(buffer)) {
+            PyErr_SetString(PyExc_TypeError,
+                            "decoder state buffer should be bytes");
+            return NULL;
+        }
+        Py_CLEAR(self->undecoded);
+        if (PyBytes_GET_SIZE(buffer) > 0) {
+            Py_INCREF(buffer);
+            self->undecoded = buffer;
+        }
+        Py_RETURN_NONE;
+    }
+    else if (self->decoder != Py_None)
         return PyObject_CallMethod(self->decoder,
                                    "setstate", "((OK))", buffer, flag);
     else
@@ -525,7 +617,10 @@ incrementalnewlinedecoder_reset(nldecoder_object *self, PyObject *args)
 {
     self->seennl = 0;
     self->pendingcr = 0;
-    if (self->decoder != Py_None)
+    Py_CLEAR(self->undecoded);
+    if (self->codec != CODEC_GENERIC)
+        Py_RETURN_NONE;
+    else if (self->decoder != Py_None)
         return PyObject_CallMethodObjArgs(self->decoder, _PyIO_str_reset, NULL);
     else
         Py_RETURN_NONE;
@@ -803,6 +898,20 @@ static encodefuncentry encodefuncs[] = {
     {NULL, NULL}
 };
 
+/* Map normalized encoding names onto the codecs decoded in C */
+
+typedef struct {
+    const char *name;
+    int codec;
+} decodecodecentry;
+
+static decodecodecentry decodecodecs[] = {
+    {"ascii",       CODEC_ASCII},
+    {"iso8859-1",   CODEC_LATIN1},
+    {"utf-8",       CODEC_UTF8},
+    {NULL, CODEC_GENERIC}
+};
+
 
 static int
 textiowrapper_init(textio *self, PyObject *args, PyObject *kwds)
@@ -810,7 +919,7 @@ textiowrapper_init(textio *self, PyObject *args, PyObject *kwds)
     char *kwlist[] = {"buffer", "encoding", "errors",
                       "newline", "line_buffering",
                       NULL};
-    PyObject *buffer, *raw;
+    PyObject *buffer, *raw, *ci, *codecname = NULL;
     char *encoding = NULL;
     char *errors = NULL;
     char *newline = NULL;
@@ -919,6 +1028,21 @@ textiowrapper_init(textio *self, PyObject *args, PyObject *kwds)
         self->writenl = "\r\n";
 #endif
 
+    /* Get the normalized name of the codec */
+    ci = _PyCodec_Lookup(encoding);
+    if (ci == NULL)
+        goto error;
+    codecname = PyObject_GetAttrString(ci, "name");
+    Py_DECREF(ci);
+    if (codecname == NULL) {
+        if (PyErr_ExceptionMatches(PyExc_AttributeError))
+            PyErr_Clear();
+        else
+            goto error;
+    }
+    else if (!PyString_Check(codecname))
+        Py_CLEAR(codecname);
+
     /* Build the decoder object */
     res = PyObject_CallMethod(buffer, "readable", NULL);
     if (res == NULL)
@@ -941,6 +1065,21 @@ textiowrapper_init(textio *self, PyObject *args, PyObject *kwds)
                 goto error;
             Py_CLEAR(self->decoder);
             self->decoder = incrementalDecoder;
+
+            /* Decode the most common encodings in C */
+            if (codecname != NULL) {
+                nldecoder_object *nl = (nldecoder_object *) incrementalDecoder;
+                decodecodecentry *e = decodecodecs;
+                while (e->name != NULL) {
+                    if (!strcmp(PyString_AS_STRING(codecname), e->name)) {
+                        nl->codec = e->codec;
+                        Py_INCREF(self->errors);
+                        nl->codec_errors = self->errors;
+                        break;
+                    }
+                    e++;
+                }
+            }
         }
     }
 
@@ -953,35 +1092,22 @@ textiowrapper_init(textio *self, PyObject *args, PyObject *kwds)
     if (r == -1)
         goto error;
     if (r == 1) {
-        PyObject *ci;
         self->encoder = PyCodec_IncrementalEncoder(
             encoding, errors);
         if (self->encoder == NULL)
             goto error;
-        /* Get the normalized named of the codec */
-        ci = _PyCodec_Lookup(encoding);
-        if (ci == NULL)
-            goto error;
-        res = PyObject_GetAttrString(ci, "name");
-        Py_DECREF(ci);
-        if (res == NULL) {
-            if (PyErr_ExceptionMatches(PyExc_AttributeError))
-                PyErr_Clear();
-            else
-                goto error;
-        }
-        else if (PyString_Check(res)) {
+        if (codecname != NULL) {
             encodefuncentry *e = encodefuncs;
             while (e->name != NULL) {
-                if (!strcmp(PyString_AS_STRING(res), e->name)) {
+                if (!strcmp(PyString_AS_STRING(codecname), e->name)) {
                     self->encodefunc = e->encodefunc;
                     break;
                 }
                 e++;
             }
         }
-        Py_XDECREF(res);
     }
+    Py_CLEAR(codecname);
 
     self->buffer = buffer;
     Py_INCREF(buffer);
@@ -1040,6 +1166,7 @@ textiowrapper_init(textio *self, PyObject *args, PyObject *kwds)
     return 0;
 
   error:
+    Py_XDECREF(codecname);
     return -1;
 }
 
@@ -2126,6 +2253,135 @@ textiowrapper_seek(textio *self, PyObject *args)
 
 }
 
+/* tell() for the codecs decoded in C (see nldecoder_fast_decode()).
+
+   Instead of replaying the decoder a byte at a time from the snapshot
+   point, work the cookie out from the input bytes, following the same
+   rules as the generic code in textiowrapper_tell().  When the decoded
+   characters map one to one onto the input bytes, which is the common
+   case of ASCII text with \n newlines, there is nothing to scan.
+
+   Returns 1 with the cookie filled in, or 0 if the generic code has to be
+   used instead (invalid input, non-strict error handler...). */
+static int
+_textiowrapper_fast_tell(textio *self, cookie_type *cookie,
+                         PyObject *next_input, Py_ssize_t chars_to_skip)
+{
+    nldecoder_object *nl = (nldecoder_object *) self->decoder;
+    cookie_type c = *cookie;
+    const unsigned char *input, *input_end;
+    unsigned char lead = 0;
+    Py_ssize_t len, chars_decoded;
+    int pendingcr, pending, need = 0;
+
+    if (Py_TYPE(nl) != &PyIncrementalNewlineDecoder_Type ||
+        nl->codec == CODEC_GENERIC ||
+        strcmp(PyBytes_AS_STRING(nl->codec_errors), "strict") != 0 ||
+        (c.dec_flags & ~1) != 0)
+        return 0;
+
+    input = (const unsigned char *) PyBytes_AS_STRING(next_input);
+    len = PyBytes_GET_SIZE(next_input);
+    input_end = input + len;
+
+    /* Decoding never yields more characters than bytes, so equal lengths
+       mean one character per byte.  Without a \r, the position is then a
+       plain byte offset. */
+    if (c.dec_flags == 0 && self->decoded_chars != NULL &&
+        PyUnicode_GET_SIZE(self->decoded_chars) == len &&
+        chars_to_skip <= len &&
+        memchr(input, '\r', chars_to_skip) == NULL) {
+        cookie->start_pos += chars_to_skip;
+        return 1;
+    }
+
+    pendingcr = c.dec_flags & 1;
+    pending = 0;    /* bytes of an incomplete UTF-8 sequence */
+    chars_decoded = 0;
+    while (input < input_end) {
+        unsigned char ch = *input;
+        int decoded, is_cr = 0, is_lf = 0, n;
+
+        if (nl->codec == CODEC_UTF8 && (pending > 0 || ch >= 0x80)) {
+            if (pending == 0) {
+                if (ch >= 0xC2 && ch <= 0xDF)
+                    need = 2;
+                else if (ch >= 0xE0 && ch <= 0xEF)
+                    need = 3;
+                else if (ch >= 0xF0 && ch <= 0xF4)
+                    need = 4;
+                else
+                    return 0;
+                lead = ch;
+            }
+            else if ((ch & 0xC0) != 0x80)
+                return 0;
+            else if (pending == 1 &&
+                     ((lead == 0xE0 && ch < 0xA0) ||
+                      (lead == 0xF0 && ch < 0x90) ||
+                      (lead == 0xF4 && ch > 0x8F)))
+                return 0;
+            if (++pending < need)
+                decoded = 0;
+            else {
+                pending = 0;
+#ifdef Py_UNICODE_WIDE
+                decoded = 1;
+#else
+                decoded = (need == 4) ? 2 : 1;
+#endif
+            }
+        }
+        else if (nl->codec == CODEC_ASCII && ch >= 0x80)
+            return 0;
+        else {
+            decoded = 1;
+            is_cr = (ch == '\r');
+            is_lf = (ch == '\n');
+        }
+
+        /* Same bookkeeping as _PyIncrementalNewlineDecoder_decode(): a
+           trailing \r is held back, and \r\n becomes one character when
+           translating. */
+        n = 0;
+        if (decoded > 0) {
+            n = decoded + pendingcr;
+            if (pendingcr && is_lf && nl->translate)
+                n--;
+            pendingcr = is_cr;
+            if (is_cr)
+                n--;
+        }
+
+        chars_decoded += n;
+        c.bytes_to_feed += 1;
+        if (pending == 0 && chars_decoded <= chars_to_skip) {
+            /* Nothing left undecoded, so this is a safe start point. */
+            c.start_pos += c.bytes_to_feed;
+            chars_to_skip -= chars_decoded;
+            c.dec_flags = pendingcr;
+            c.bytes_to_feed = 0;
+            chars_decoded = 0;
+        }
+        if (chars_decoded >= chars_to_skip)
+            break;
+        input++;
+    }
+    if (input == input_end) {
+        /* Signalling EOF flushes a held back \r */
+        if (pending > 0)
+            return 0;
+        chars_decoded += pendingcr;
+        c.need_eof = 1;
+        if (chars_decoded < chars_to_skip)
+            return 0;
+    }
+
+    c.chars_to_skip = Py_SAFE_DOWNCAST(chars_to_skip, Py_ssize_t, int);
+    *cookie = c;
+    return 1;
+}
+
 static PyObject *
 textiowrapper_tell(textio *self, PyObject *args)
 {
@@ -2192,6 +2448,11 @@ textiowrapper_tell(textio *self, PyObject *args)
 
     chars_to_skip = self->decoded_chars_used;
 
+    if (_textiowrapper_fast_tell(self, &cookie, next_input, chars_to_skip)) {
+        Py_DECREF(posobj);
+        return textiowrapper_build_cookie(&cookie);
+    }
+
     /* Starting from the snapshot position, we will walk the decoder
      * forward until it gives us enough decoded characters.
      */
@@ -0,0 +1,970 @@
+/*
+ * A message channel over a ring buffer in shared memory
+ *
+ * channel.c
+ *
+ * Messages are length prefixed records in an anonymous shared mapping
+ * which is inherited by child processes.  Writers reserve a record,
+ * copy their data straight into it and then commit it; readers claim
+ * the oldest committed record and release it once its data has been
+ * used.  Space is only reclaimed from the tail of the ring, so a
+ * record which is still being written or read stays put.
+ *
+ * A SemLock used as a mutex protects the indices in the shared header,
+ * and two more SemLocks are used to wake up readers and writers which
+ * are blocked waiting for data or space.
+ */
+
+#include "multiprocessing.h"
+
+#ifdef HAVE_MP_CHANNEL
+
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* records are aligned to this, and a record header must fit in it */
+#define CHANNEL_ALIGN 16
+#define ALIGN_UP(n) \
+    (((n) + CHANNEL_ALIGN - 1) & ~(Py_ssize_t)(CHANNEL_ALIGN - 1))
+
+/* copies of at least this many bytes release the GIL */
+#define CHANNEL_GIL_MINSIZE 16384
+
+#define CHANNEL_MIN_SIZE 4096
+
+enum { REC_RESERVED, REC_READY, REC_CLAIMED, REC_DONE, REC_SKIP };
+
+typedef struct {
+    Py_ssize_t length;          /* length of the data which follows */
+    int state;
+} chan_record;
+
+#define REC_HEADER ALIGN_UP((Py_ssize_t)sizeof(chan_record))
+#define REC_SIZE(length) (REC_HEADER + ALIGN_UP(length))
+
+typedef struct {
+    Py_ssize_t capacity;        /* size of the data area */
+    Py_ssize_t head;            /* where the next record is reserved */
+    Py_ssize_t read;            /* next record to be claimed */
+    Py_ssize_t tail;            /* oldest record not yet released */
+    Py_ssize_t used;            /* bytes in use from tail to head */
+    Py_ssize_t unclaimed;       /* records reserved but not claimed */
+    int readers_waiting;
+    int writers_waiting;
+} chan_header;
+
+#define HEADER_SIZE ALIGN_UP((Py_ssize_t)sizeof(chan_header))
+
+typedef struct {
+    PyObject_HEAD
+    chan_header *header;
+    char *data;
+    Py_ssize_t mapsize;
+    SemLockObject *mutex;
+    SemLockObject *readable;
+    SemLockObject *writable;
+    PyObject *weakreflist;
+} ChannelObject;
+
+typedef struct {
+    PyObject_HEAD
+    ChannelObject *channel;     /* NULL once released */
+    Py_ssize_t offset;          /* offset of the record */
+    Py_ssize_t length;
+    Py_ssize_t exports;
+} MessageObject;
+
+#define RECORD(self, off) ((chan_record *)((self)->data + (off)))
+#define RECORD_DATA(self, off) ((self)->data + (off) + REC_HEADER)
+
+/*
+ * Functions on the shared state.  They never touch Python objects, so
+ * the blocking ones can be called with the GIL released; nothing ever
+ * waits for the GIL while holding the mutex.  Failures return -1 with
+ * errno set -- EAGAIN if a nonblocking call would have to wait,
+ * ETIMEDOUT or EINTR if a wait was cut short.
+ */
+
+static int
+chan_lock(ChannelObject *self, int blocking)
+{
+    int res;
+
+    if (!blocking)
+        return sem_trywait(self->mutex->handle);
+    do {
+        res = sem_wait(self->mutex->handle);
+    } while (res < 0 && errno == EINTR);
+    return res;
+}
+
+#define chan_unlock(self) sem_post((self)->mutex->handle)
+
+/* Wake up everybody waiting on sem; called with the mutex held */
+static void
+chan_wake(int *waiting, SemLockObject *sem)
+{
+    while (*waiting > 0) {
+        --*waiting;
+        sem_post(sem->handle);
+    }
+}
+
+/* Called with the mutex held.  Releases it and waits to be woken up
+   through sem, returning without the mutex. */
+static int
+chan_wait(ChannelObject *self, int *waiting, SemLockObject *sem,
+          struct timespec *deadline)
+{
+    int res, err;
+
+    ++*waiting;
+    chan_unlock(self);
+    if (deadline == NULL)
+        res = sem_wait(sem->handle);
+    else
+        res = sem_timedwait(sem->handle, deadline);
+    if (res < 0) {
+        /* If a waker has already counted us out, its post stays in the
+           semaphore and just gives somebody a spurious wakeup. */
+        err = errno;
+        chan_lock(self, 1);
+        if (*waiting > 0)
+            --*waiting;
+        chan_unlock(self);
+        errno = err;
+    }
+    return res;
+}
+
+/* Advance the tail over released records; called with the mutex held.
+   Stops at the read position while there are unclaimed records, since
+   a skip record there has not been stepped over yet. */
+static void
+chan_reclaim(ChannelObject *self)
+{
+    chan_header *h = self->header;
+    chan_record *rec;
+    Py_ssize_t size;
+    int freed = 0;
+
+    while (h->used > 0) {
+        if (h->tail == h->read && h->unclaimed > 0)
+            break;
+        rec = RECORD(self, h->tail);
+        if (rec->state == REC_SKIP)
+            size = h->capacity - h->tail;
+        else if (rec->state == REC_DONE)
+            size = REC_SIZE(rec->length);
+        else
+            break;
+        h->tail = (h->tail + size) % h->capacity;
+        h->used -= size;
+        freed = 1;
+    }
+    if (freed)
+        chan_wake(&h->writers_waiting, self->writable);
+}
+
+/* Find room for a record of the given size; called with the mutex held.
+   Returns its offset, or -1 if the ring is too full. */
+static Py_ssize_t
+chan_find_space(ChannelObject *self, Py_ssize_t size)
+{
+    chan_header *h = self->header;
+    Py_ssize_t end;
+
+    if (h->used == 0)
+        h->head = h->read = h->tail = 0;
+
+    if (h->used == 0 || h->head > h->tail) {
+        end = h->capacity - h->head;
+        if (size <= end)
+            return h->head;
+        if (size > h->tail)
+            return -1;
+        /* pad out the end of the ring and start again at the front */
+        RECORD(self, h->head)->state = REC_SKIP;
+        if (h->read == h->head)
+            h->read = 0;
+        h->used += end;
+        h->head = 0;
+        return 0;
+    }
+    if (h->head < h->tail && size <= h->tail - h->head)
+        return h->head;
+    return -1;
+}
+
+static int
+chan_reserve(ChannelObject *self, Py_ssize_t length, Py_ssize_t *offset,
+             int blocking)
+{
+    chan_header *h = self->header;
+    Py_ssize_t off, size = REC_SIZE(length);
+    chan_record *rec;
+
+    if (chan_lock(self, blocking) < 0)
+        return -1;
+    while ((off = chan_find_space(self, size)) < 0) {
+        if (!blocking) {
+            chan_unlock(self);
+            errno = EAGAIN;
+            return -1;
+        }
+        if (chan_wait(self, &h->writers_waiting, self->writable, NULL) < 0)
+            return -1;
+        chan_lock(self, 1);
+    }
+    rec = RECORD(self, off);
+    rec->length = length;
+    rec->state = REC_RESERVED;
+    h->head = (off + size) % h->capacity;
+    h->used += size;
+    ++h->unclaimed;
+    chan_unlock(self);
+    *offset = off;
+    return 0;
+}
+
+static int
+chan_commit(ChannelObject *self, Py_ssize_t offset, int blocking)
+{
+    if (chan_lock(self, blocking) < 0)
+        return -1;
+    RECORD(self, offset)->state = REC_READY;
+    chan_wake(&self->header->readers_waiting, self->readable);
+    chan_unlock(self);
+    return 0;
+}
+
+/* Return the offset of the next committed record, or -1 if there is
+   none yet; called with the mutex held. */
+static Py_ssize_t
+chan_next(ChannelObject *self)
+{
+    chan_header *h = self->header;
+    chan_record *rec;
+
+    while (h->unclaimed > 0) {
+        rec = RECORD(self, h->read);
+        if (rec->state == REC_SKIP) {
+            h->read = 0;
+            chan_reclaim(self);
+            continue;
+        }
+        if (rec->state == REC_READY)
+            return h->read;
+        break;
+    }
+    return -1;
+}
+
+/* Wait until there is a committed record.  If offset is not NULL the
+   record is claimed and its offset stored there. */
+static int
+chan_claim(ChannelObject *self, Py_ssize_t *offset, int blocking,
+           struct timespec *deadline)
+{
+    chan_header *h = self->header;
+    Py_ssize_t off;
+    chan_record *rec;
+
+    if (chan_lock(self, blocking) < 0)
+        return -1;
+    while ((off = chan_next(self)) < 0) {
+        if (!blocking) {
+            chan_unlock(self);
+            errno = EAGAIN;
+            return -1;
+        }
+        if (chan_wait(self, &h->readers_waiting, self->readable,
+                      deadline) < 0)
+            return -1;
+        chan_lock(self, 1);
+    }
+    if (offset != NULL) {
+        rec = RECORD(self, off);
+        rec->state = REC_CLAIMED;
+        h->read = (off + REC_SIZE(rec->length)) % h->capacity;
+        --h->unclaimed;
+        *offset = off;
+    }
+    chan_unlock(self);
+    return 0;
+}
+
+static int
+chan_release(ChannelObject *self, Py_ssize_t offset, int blocking)
+{
+    if (chan_lock(self, blocking) < 0)
+        return -1;
+    RECORD(self, offset)->state = REC_DONE;
+    chan_reclaim(self);
+    chan_unlock(self);
+    return 0;
+}
+
+/*
+ * Wrappers which deal with the GIL, signals and errors
+ */
+
+/* Try without releasing the GIL first, since the mutex is only ever
+   held briefly and there is usually room or data. */
+#define CHANNEL_CALL(res, call_nonblocking, call_blocking)               \
+    do {                                                                \
+        res = call_nonblocking;                                         \
+        if (res < 0 && errno == EAGAIN) {                               \
+            do {                                                        \
+                Py_BEGIN_ALLOW_THREADS                                  \
+                res = call_blocking;                                    \
+                Py_END_ALLOW_THREADS                                    \
+            } while (res < 0 && errno == EINTR &&                       \
+                     !PyErr_CheckSignals());                            \
+        }                                                               \
+    } while (0)
+
+static int
+channel_check_length(ChannelObject *self, Py_ssize_t length)
+{
+    if (length > self->header->capacity - REC_HEADER ||
+        REC_SIZE(length) > self->header->capacity) {
+        PyErr_SetString(PyExc_ValueError, "message too large for channel");
+        return -1;
+    }
+    return 0;
+}
+
+static int
+channel_write(ChannelObject *self, const char *buffer, Py_ssize_t length)
+{
+    Py_ssize_t offset;
+    int res;
+
+    if (channel_check_length(self, length) < 0)
+        return -1;
+
+    CHANNEL_CALL(res, chan_reserve(self, length, &offset, 0),
+                 chan_reserve(self, length, &offset, 1));
+    if (res < 0) {
+        if (!PyErr_Occurred())
+            PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    /* the record has to be committed whatever happens now, and taking
+       the mutex with blocking set never fails */
+    if (length >= CHANNEL_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        memcpy(RECORD_DATA(self, offset), buffer, length);
+        chan_commit(self, offset, 1);
+        Py_END_ALLOW_THREADS
+    } else {
+        memcpy(RECORD_DATA(self, offset), buffer, length);
+        if (chan_commit(self, offset, 0) < 0) {
+            Py_BEGIN_ALLOW_THREADS
+            chan_commit(self, offset, 1);
+            Py_END_ALLOW_THREADS
+        }
+    }
+    return 0;
+}
+
+/* Claim the next message, returning its offset or -1 on error */
+static Py_ssize_t
+channel_read(ChannelObject *self)
+{
+    Py_ssize_t offset;
+    int res;
+
+    CHANNEL_CALL(res, chan_claim(self, &offset, 0, NULL),
+                 chan_claim(self, &offset, 1, NULL));
+    if (res < 0) {
+        if (!PyErr_Occurred())
+            PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+    return offset;
+}
+
+static void
+channel_done(ChannelObject *self, Py_ssize_t offset)
+{
+    if (chan_release(self, offset, 0) < 0) {
+        Py_BEGIN_ALLOW_THREADS
+        chan_release(self, offset, 1);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+/*
+ * Channel methods
+ */
+
+static PyObject *
+newsemaphore(void)
+{
+    return PyObject_CallFunction((PyObject *)&SemLockType, "iii",
+                                 SEMAPHORE, 0, (int)SEM_VALUE_MAX);
+}
+
+static PyObject *
+channel_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    ChannelObject *self;
+    Py_ssize_t size = 1 << 20, pagesize;
+    void *map;
+    static char *kwlist[] = {"size", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|" F_PY_SSIZE_T, kwlist,
+                                     &size))
+        return NULL;
+
+    if (size < CHANNEL_MIN_SIZE) {
+        PyErr_Format(PyExc_ValueError,
+                     "channel size must be at least %d", CHANNEL_MIN_SIZE);
+        return NULL;
+    }
+    pagesize = sysconf(_SC_PAGESIZE);
+    if (pagesize <= 0)
+        pagesize = 4096;
+    if (size > PY_SSIZE_T_MAX - HEADER_SIZE - pagesize) {
+        PyErr_SetString(PyExc_OverflowError, "channel size is too large");
+        return NULL;
+    }
+    size = (HEADER_SIZE + size + pagesize - 1) / pagesize * pagesize;
+
+    self = (ChannelObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+
+    self->mutex = (SemLockObject *)PyObject_CallFunction(
+        (PyObject *)&SemLockType, "iii", SEMAPHORE, 1, 1);
+    if (self->mutex == NULL)
+        goto failure;
+    self->readable = (SemLockObject *)newsemaphore();
+    if (self->readable == NULL)
+        goto failure;
+    self->writable = (SemLockObject *)newsemaphore();
+    if (self->writable == NULL)
+        goto failure;
+
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        goto failure;
+    }
+    self->mapsize = size;
+    self->header = (chan_header *)map;
+    self->data = (char *)map + HEADER_SIZE;
+    memset(self->header, 0, sizeof(chan_header));
+    self->header->capacity = (size - HEADER_SIZE) & ~(CHANNEL_ALIGN - 1);
+
+    return (PyObject *)self;
+
+  failure:
+    Py_DECREF(self);
+    return NULL;
+}
+
+static void
+channel_dealloc(ChannelObject *self)
+{
+    if (self->weakreflist != NULL)
+        PyObject_ClearWeakRefs((PyObject *)self);
+    if (self->header != NULL)
+        munmap((void *)self->header, self->mapsize);
+    Py_XDECREF(self->mutex);
+    Py_XDECREF(self->readable);
+    Py_XDECREF(self->writable);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+channel_sendbytes(ChannelObject *self, PyObject *args)
+{
+    Py_buffer pbuf;
+    Py_ssize_t offset = 0, size = PY_SSIZE_T_MIN;
+    PyObject *result = NULL;
+
+    if (!PyArg_ParseTuple(args, "s*|" F_PY_SSIZE_T F_PY_SSIZE_T,
+                          &pbuf, &offset, &size))
+        return NULL;
+
+    if (offset < 0) {
+        PyErr_SetString(PyExc_ValueError, "offset is negative");
+        goto done;
+    }
+    if (pbuf.len < offset) {
+        PyErr_SetString(PyExc_ValueError, "buffer length < offset");
+        goto done;
+    }
+
+    if (size == PY_SSIZE_T_MIN) {
+        size = pbuf.len - offset;
+    } else {
+        if (size < 0) {
+            PyErr_SetString(PyExc_ValueError, "size is negative");
+            goto done;
+        }
+        if (offset + size > pbuf.len) {
+            PyErr_SetString(PyExc_ValueError,
+                            "buffer length < offset + size");
+            goto done;
+        }
+    }
+
+    if (channel_write(self, (char *)pbuf.buf + offset, size) == 0) {
+        result = Py_None;
+        Py_INCREF(result);
+    }
+
+  done:
+    PyBuffer_Release(&pbuf);
+    return result;
+}
+
+static PyObject *
+channel_recvbytes(ChannelObject *self, PyObject *args)
+{
+    Py_ssize_t offset, length, maxlength = PY_SSIZE_T_MAX;
+    PyObject *result;
+
+    if (!PyArg_ParseTuple(args, "|" F_PY_SSIZE_T, &maxlength))
+        return NULL;
+
+    if (maxlength < 0) {
+        PyErr_SetString(PyExc_ValueError, "maxlength < 0");
+        return NULL;
+    }
+
+    offset = channel_read(self);
+    if (offset < 0)
+        return NULL;
+
+    length = RECORD(self, offset)->length;
+    if (length > maxlength)
+        result = mp_SetError(PyExc_IOError, MP_BAD_MESSAGE_LENGTH);
+    else
+        result = PyString_FromStringAndSize(RECORD_DATA(self, offset),
+                                            length);
+    channel_done(self, offset);
+    return result;
+}
+
+static PyObject *
+channel_recvbytes_into(ChannelObject *self, PyObject *args)
+{
+    Py_ssize_t offset, length, start = 0;
+    PyObject *result = NULL;
+    Py_buffer pbuf;
+
+    if (!PyArg_ParseTuple(args, "w*|" F_PY_SSIZE_T, &pbuf, &start))
+        return NULL;
+
+    if (start < 0) {
+        PyErr_SetString(PyExc_ValueError, "negative offset");
+        goto done;
+    }
+    if (start > pbuf.len) {
+        PyErr_SetString(PyExc_ValueError, "offset too large");
+        goto done;
+    }
+
+    offset = channel_read(self);
+    if (offset < 0)
+        goto done;
+
+    length = RECORD(self, offset)->length;
+    if (length <= pbuf.len - start) {
+        if (length >= CHANNEL_GIL_MINSIZE) {
+            Py_BEGIN_ALLOW_THREADS
+            memcpy((char *)pbuf.buf + start, RECORD_DATA(self, offset),
+                   length);
+            Py_END_ALLOW_THREADS
+        } else {
+            memcpy((char *)pbuf.buf + start, RECORD_DATA(self, offset),
+                   length);
+        }
+        result = PyInt_FromSsize_t(length);
+    } else {
+        result = PyObject_CallFunction(BufferTooShort, F_RBUFFER "#",
+                                       RECORD_DATA(self, offset), length);
+        if (result) {
+            PyErr_SetObject(BufferTooShort, result);
+            Py_DECREF(result);
+            result = NULL;
+        }
+    }
+    channel_done(self, offset);
+
+  done:
+    PyBuffer_Release(&pbuf);
+    return result;
+}
+
+static PyObject *
+channel_recvbuffer(ChannelObject *self)
+{
+    MessageObject *msg;
+    Py_ssize_t offset;
+
+    msg = PyObject_New(MessageObject, &ChannelMessageType);
+    if (msg == NULL)
+        return NULL;
+    msg->channel = NULL;
+    msg->exports = 0;
+
+    offset = channel_read(self);
+    if (offset < 0) {
+        Py_DECREF(msg);
+        return NULL;
+    }
+    Py_INCREF(self);
+    msg->channel = self;
+    msg->offset = offset;
+    msg->length = RECORD(self, offset)->length;
+    return (PyObject *)msg;
+}
+
+static PyObject *
+channel_send_obj(ChannelObject *self, PyObject *obj)
+{
+    char *buffer;
+    Py_ssize_t length;
+    PyObject *pickled_string;
+    int res;
+
+    pickled_string = PyObject_CallFunctionObjArgs(pickle_dumps, obj,
+                                                  pickle_protocol, NULL);
+    if (!pickled_string)
+        return NULL;
+
+    if (PyString_AsStringAndSize(pickled_string, &buffer, &length) < 0) {
+        Py_DECREF(pickled_string);
+        return NULL;
+    }
+
+    res = channel_write(self, buffer, length);
+    Py_DECREF(pickled_string);
+    if (res < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+channel_recv_obj(ChannelObject *self)
+{
+    Py_ssize_t offset;
+    PyObject *temp, *result = NULL;
+
+    offset = channel_read(self);
+    if (offset < 0)
+        return NULL;
+
+    temp = PyString_FromStringAndSize(RECORD_DATA(self, offset),
+                                      RECORD(self, offset)->length);
+    channel_done(self, offset);
+
+    if (temp)
+        result = PyObject_CallFunctionObjArgs(pickle_loads, temp, NULL);
+    Py_XDECREF(temp);
+    return result;
+}
+
+static PyObject *
+channel_poll(ChannelObject *self, PyObject *args)
+{
+    PyObject *timeout_obj = NULL;
+    double timeout = 0.0;
+    struct timespec deadline = {0};
+    struct timeval now;
+    long sec, nsec;
+    int res;
+
+    if (!PyArg_ParseTuple(args, "|O", &timeout_obj))
+        return NULL;
+
+    if (timeout_obj == Py_None) {
+        CHANNEL_CALL(res, chan_claim(self, NULL, 0, NULL),
+                     chan_claim(self, NULL, 1, NULL));
+    } else {
+        if (timeout_obj != NULL) {
+            timeout = PyFloat_AsDouble(timeout_obj);
+            if (PyErr_Occurred())
+                return NULL;
+            if (timeout < 0.0)
+                timeout = 0.0;
+        }
+        if (timeout == 0.0) {
+            res = chan_claim(self, NULL, 0, NULL);
+        } else {
+            if (gettimeofday(&now, NULL) < 0) {
+                PyErr_SetFromErrno(PyExc_OSError);
+                return NULL;
+            }
+            sec = (long) timeout;
+            nsec = (long) (1e9 * (timeout - sec) + 0.5);
+            deadline.tv_sec = now.tv_sec + sec;
+            deadline.tv_nsec = now.tv_usec * 1000 + nsec;
+            deadline.tv_sec += (deadline.tv_nsec / 1000000000);
+            deadline.tv_nsec %= 1000000000;
+
+            CHANNEL_CALL(res, chan_claim(self, NULL, 0, NULL),
+                         chan_claim(self, NULL, 1, &deadline));
+        }
+    }
+
+    if (res < 0) {
+        if (PyErr_Occurred())
+            return NULL;
+        if (errno == EAGAIN || errno == ETIMEDOUT)
+            Py_RETURN_FALSE;
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    Py_RETURN_TRUE;
+}
+
+static PyObject *
+channel_size(ChannelObject *self, void *closure)
+{
+    return PyInt_FromSsize_t(self->header->capacity);
+}
+
+static PyObject *
+channel_repr(ChannelObject *self)
+{
+    return FROM_FORMAT("<Channel, size=%zd>", self->header->capacity);
+}
+
+static PyMethodDef channel_methods[] = {
+    {"send_bytes", (PyCFunction)channel_sendbytes, METH_VARARGS,
+     "send the byte data from a readable buffer-like object"},
+    {"recv_bytes", (PyCFunction)channel_recvbytes, METH_VARARGS,
+     "receive byte data as a string"},
+    {"recv_bytes_into",(PyCFunction)channel_recvbytes_into,METH_VARARGS,
+     "receive byte data into a writeable buffer-like object\n"
+     "returns the number of bytes read"},
+    {"recv_buffer", (PyCFunction)channel_recvbuffer, METH_NOARGS,
+     "receive byte data as a message object which exposes it in place\n"
+     "through the buffer interface until it is released"},
+    {"send", (PyCFunction)channel_send_obj, METH_O,
+     "send a (picklable) object"},
+    {"recv", (PyCFunction)channel_recv_obj, METH_NOARGS,
+     "receive a (picklable) object"},
+    {"poll", (PyCFunction)channel_poll, METH_VARARGS,
+     "whether there is any input available to be read"},
+    {NULL}  /* Sentinel */
+};
+
+static PyGetSetDef channel_getset[] = {
+    {"size", (getter)channel_size, NULL,
+     "the number of bytes in the ring buffer", NULL},
+    {NULL}
+};
+
+PyDoc_STRVAR(channel_doc,
+             "Channel(size=1048576)\n"
+             "\n"
+             "Message channel over a ring buffer in shared memory.  It is\n"
+             "inherited by child processes and may have any number of\n"
+             "senders and receivers.");
+
+PyTypeObject ChannelType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    /* tp_name           */ "_multiprocessing.Channel",
+    /* tp_basicsize      */ sizeof(ChannelObject),
+    /* tp_itemsize       */ 0,
+    /* tp_dealloc        */ (destructor)channel_dealloc,
+    /* tp_print          */ 0,
+    /* tp_getattr        */ 0,
+    /* tp_setattr        */ 0,
+    /* tp_compare        */ 0,
+    /* tp_repr           */ (reprfunc)channel_repr,
+    /* tp_as_number      */ 0,
+    /* tp_as_sequence    */ 0,
+    /* tp_as_mapping     */ 0,
+    /* tp_hash           */ 0,
+    /* tp_call           */ 0,
+    /* tp_str            */ 0,
+    /* tp_getattro       */ 0,
+    /* tp_setattro       */ 0,
+    /* tp_as_buffer      */ 0,
+    /* tp_flags          */ Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE |
+                            Py_TPFLAGS_HAVE_WEAKREFS,
+    /* tp_doc            */ channel_doc,
+    /* tp_traverse       */ 0,
+    /* tp_clear          */ 0,
+    /* tp_richcompare    */ 0,
+    /* tp_weaklistoffset */ offsetof(ChannelObject, weakreflist),
+    /* tp_iter           */ 0,
+    /* tp_iternext       */ 0,
+    /* tp_methods        */ channel_methods,
+    /* tp_members        */ 0,
+    /* tp_getset         */ channel_getset,
+    /* tp_base           */ 0,
+    /* tp_dict           */ 0,
+    /* tp_descr_get      */ 0,
+    /* tp_descr_set      */ 0,
+    /* tp_dictoffset     */ 0,
+    /* tp_init           */ 0,
+    /* tp_alloc          */ 0,
+    /* tp_new            */ channel_new,
+};
+
+/*
+ * Message objects returned by recv_buffer()
+ */
+
+#define CHECK_MESSAGE(self, ret)                                        \
+    if ((self)->channel == NULL) {                                      \
+        PyErr_SetString(PyExc_ValueError,                               \
+                        "operation on released message");               \
+        return ret;                                                     \
+    }
+
+static void
+message_dorelease(MessageObject *self)
+{
+    ChannelObject *channel = self->channel;
+
+    self->channel = NULL;
+    channel_done(channel, self->offset);
+    Py_DECREF(channel);
+}
+
+static void
+message_dealloc(MessageObject *self)
+{
+    if (self->channel != NULL)
+        message_dorelease(self);
+    PyObject_Del(self);
+}
+
+static PyObject *
+message_release(MessageObject *self, PyObject *args)
+{
+    if (self->channel != NULL) {
+        if (self->exports > 0) {
+            PyErr_SetString(PyExc_BufferError,
+                            "cannot release a message with exported "
+                            "buffers");
+            return NULL;
+        }
+        message_dorelease(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+message_enter(MessageObject *self)
+{
+    CHECK_MESSAGE(self, NULL);
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *
+message_tobytes(MessageObject *self)
+{
+    CHECK_MESSAGE(self, NULL);
+    return PyString_FromStringAndSize(RECORD_DATA(self->channel,
+                                                  self->offset),
+                                      self->length);
+}
+
+static Py_ssize_t
+message_length(MessageObject *self)
+{
+    CHECK_MESSAGE(self, -1);
+    return self->length;
+}
+
+static int
+message_getbuffer(MessageObject *self, Py_buffer *view, int flags)
+{
+    CHECK_MESSAGE(self, -1);
+    if (PyBuffer_FillInfo(view, (PyObject *)self,
+                          RECORD_DATA(self->channel, self->offset),
+                          self->length, 1, flags) < 0)
+        return -1;
+    self->exports++;
+    return 0;
+}
+
+static void
+message_releasebuffer(MessageObject *self, Py_buffer *view)
+{
+    self->exports--;
+}
+
+static PyObject *
+message_repr(MessageObject *self)
+{
+    if (self->channel == NULL)
+        return FROM_FORMAT("<released ChannelMessage>");
+    return FROM_FORMAT("<ChannelMessage, length=%zd>", self->length);
+}
+
+static PyMethodDef message_methods[] = {
+    {"release", (PyCFunction)message_release, METH_NOARGS,
+     "give the message's space in the channel back to the senders"},
+    {"tobytes", (PyCFunction)message_tobytes, METH_NOARGS,
+     "return a copy of the data as a string"},
+    {"__enter__", (PyCFunction)message_enter, METH_NOARGS,
+     "enter the message"},
+    {"__exit__", (PyCFunction)message_release, METH_VARARGS,
+     "release the message"},
+    {NULL}  /* Sentinel */
+};
+
+static PySequenceMethods message_as_sequence = {
+    (lenfunc)message_length,            /* sq_length */
+};
+
+static PyBufferProcs message_as_buffer = {
+    0,                                  /* bf_getreadbuffer */
+    0,                                  /* bf_getwritebuffer */
+    0,                                  /* bf_getsegcount */
+    0,                                  /* bf_getcharbuffer */
+    (getbufferproc)message_getbuffer,
+    (releasebufferproc)message_releasebuffer,
+};
+
+PyTypeObject ChannelMessageType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    /* tp_name           */ "_multiprocessing.ChannelMessage",
+    /* tp_basicsize      */ sizeof(MessageObject),
+    /* tp_itemsize       */ 0,
+    /* tp_dealloc        */ (destructor)message_dealloc,
+    /* tp_print          */ 0,
+    /* tp_getattr        */ 0,
+    /* tp_setattr        */ 0,
+    /* tp_compare        */ 0,
+    /* tp_repr           */ (reprfunc)message_repr,
+    /* tp_as_number      */ 0,
+    /* tp_as_sequence    */ &message_as_sequence,
+    /* tp_as_mapping     */ 0,
+    /* tp_hash           */ 0,
+    /* tp_call           */ 0,
+    /* tp_str            */ 0,
+    /* tp_getattro       */ 0,
+    /* tp_setattro       */ 0,
+    /* tp_as_buffer      */ &message_as_buffer,
+    /* tp_flags          */ Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER,
+    /* tp_doc            */ "Message received from a channel, "
+                            "exposing its data in place",
+    /* tp_traverse       */ 0,
+    /* tp_clear          */ 0,
+    /* tp_richcompare    */ 0,
+    /* tp_weaklistoffset */ 0,
+    /* tp_iter           */ 0,
+    /* tp_iternext       */ 0,
+    /* tp_methods        */ message_methods,
+};
+
+#endif /* HAVE_MP_CHANNEL */
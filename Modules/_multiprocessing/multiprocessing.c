@@ -261,6 +261,16 @@ init_multiprocessing(void)
     PyModule_AddObject(module, "SemLock", (PyObject*)&SemLockType);
 #endif
 
+#ifdef HAVE_MP_CHANNEL
+    /* Add Channel type to module */
+    if (PyType_Ready(&ChannelType) < 0)
+        return;
+    if (PyType_Ready(&ChannelMessageType) < 0)
+        return;
+    Py_INCREF(&ChannelType);
+    PyModule_AddObject(module, "Channel", (PyObject*)&ChannelType);
+#endif
+
 #ifdef MS_WINDOWS
     /* Add PipeConnection to module */
     if (PyType_Ready(&PipeConnectionType) < 0)
@@ -137,6 +137,8 @@ extern PyObject *BufferTooShort;
 extern PyTypeObject SemLockType;
 extern PyTypeObject ConnectionType;
 extern PyTypeObject PipeConnectionType;
+extern PyTypeObject ChannelType;
+extern PyTypeObject ChannelMessageType;
 extern HANDLE sigint_event;
 
 /*
@@ -175,6 +177,35 @@ typedef struct {
     char buffer[CONNECTION_BUFFER_SIZE];
 } ConnectionObject;
 
+/*
+ * Semaphore definition
+ */
+
+#if defined(MS_WINDOWS) ||                                              \
+  (defined(HAVE_SEM_OPEN) && !defined(POSIX_SEMAPHORES_NOT_ENABLED))
+
+enum { RECURSIVE_MUTEX, SEMAPHORE };
+
+typedef struct {
+    PyObject_HEAD
+    SEM_HANDLE handle;
+    long last_tid;
+    int count;
+    int maxvalue;
+    int kind;
+} SemLockObject;
+
+#endif
+
+/*
+ * Shared memory channels need process-shared semaphores with timed waits
+ */
+
+#if !defined(MS_WINDOWS) && defined(HAVE_SEM_OPEN) &&                   \
+  !defined(POSIX_SEMAPHORES_NOT_ENABLED) && defined(HAVE_SEM_TIMEDWAIT)
+#  define HAVE_MP_CHANNEL 1
+#endif
+
 /*
  * Miscellaneous
  */
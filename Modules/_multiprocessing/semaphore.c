@@ -8,17 +8,6 @@
 
 #include "multiprocessing.h"
 
-enum { RECURSIVE_MUTEX, SEMAPHORE };
-
-typedef struct {
-    PyObject_HEAD
-    SEM_HANDLE handle;
-    long last_tid;
-    int count;
-    int maxvalue;
-    int kind;
-} SemLockObject;
-
 #define ISMINE(o) (o->count > 0 && PyThread_get_thread_ident() == o->last_tid)
 
 
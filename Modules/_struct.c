@@ -1386,16 +1386,17 @@ s_dealloc(PyStructObject *s)
     Py_TYPE(s)->tp_free((PyObject *)s);
 }
 
-static PyObject *
-s_unpack_internal(PyStructObject *soself, char *startfrom) {
+/* Unpack the values at startfrom into the tuple result, which has s_len
+   items.  Items already in the tuple (when it is being reused) are
+   replaced. */
+static int
+s_unpack_fill(PyStructObject *soself, const char *startfrom, PyObject *result)
+{
     formatcode *code;
     Py_ssize_t i = 0;
-    PyObject *result = PyTuple_New(soself->s_len);
-    if (result == NULL)
-        return NULL;
 
     for (code = soself->s_codes; code->fmtdef != NULL; code++) {
-        PyObject *v;
+        PyObject *v, *old;
         const formatdef *e = code->fmtdef;
         const char *res = startfrom + code->offset;
         if (e->format == 's') {
@@ -1409,14 +1410,24 @@ s_unpack_internal(PyStructObject *soself, char *startfrom) {
             v = e->unpack(res, e);
         }
         if (v == NULL)
-            goto fail;
+            return -1;
+        old = PyTuple_GET_ITEM(result, i);
         PyTuple_SET_ITEM(result, i++, v);
+        Py_XDECREF(old);
     }
+    return 0;
+}
 
+static PyObject *
+s_unpack_internal(PyStructObject *soself, char *startfrom) {
+    PyObject *result = PyTuple_New(soself->s_len);
+    if (result == NULL)
+        return NULL;
+    if (s_unpack_fill(soself, startfrom, result) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
     return result;
-fail:
-    Py_DECREF(result);
-    return NULL;
 }
 
 
@@ -1430,9 +1441,8 @@ strings.");
 static PyObject *
 s_unpack(PyObject *self, PyObject *inputstr)
 {
-    char *start;
-    Py_ssize_t len;
-    PyObject *args=NULL, *result;
+    Py_buffer buf;
+    PyObject *result;
     PyStructObject *soself = (PyStructObject *)self;
     assert(PyStruct_Check(self));
     assert(soself->s_codes != NULL);
@@ -1442,19 +1452,17 @@ s_unpack(PyObject *self, PyObject *inputstr)
         PyString_GET_SIZE(inputstr) == soself->s_size) {
             return s_unpack_internal(soself, PyString_AS_STRING(inputstr));
     }
-    args = PyTuple_Pack(1, inputstr);
-    if (args == NULL)
-        return NULL;
-    if (!PyArg_ParseTuple(args, "s#:unpack", &start, &len))
+    if (!PyArg_Parse(inputstr, "s*:unpack", &buf))
         goto fail;
-    if (soself->s_size != len)
+    if (soself->s_size != buf.len) {
+        PyBuffer_Release(&buf);
         goto fail;
-    result = s_unpack_internal(soself, start);
-    Py_DECREF(args);
+    }
+    result = s_unpack_internal(soself, buf.buf);
+    PyBuffer_Release(&buf);
     return result;
 
 fail:
-    Py_XDECREF(args);
     PyErr_Format(StructError,
         "unpack requires a string argument of length %zd",
         soself->s_size);
@@ -1473,37 +1481,196 @@ static PyObject *
 s_unpack_from(PyObject *self, PyObject *args, PyObject *kwds)
 {
     static char *kwlist[] = {"buffer", "offset", 0};
-#if (PY_VERSION_HEX < 0x02050000)
-    static char *fmt = "z#|i:unpack_from";
-#else
-    static char *fmt = "z#|n:unpack_from";
-#endif
-    Py_ssize_t buffer_len = 0, offset = 0;
-    char *buffer = NULL;
+    static char *fmt = "z*|n:unpack_from";
+    Py_buffer buf;
+    Py_ssize_t offset = 0;
+    PyObject *result;
     PyStructObject *soself = (PyStructObject *)self;
     assert(PyStruct_Check(self));
     assert(soself->s_codes != NULL);
 
     if (!PyArg_ParseTupleAndKeywords(args, kwds, fmt, kwlist,
-                                     &buffer, &buffer_len, &offset))
+                                     &buf, &offset))
         return NULL;
 
-    if (buffer == NULL) {
+    if (buf.buf == NULL) {
         PyErr_Format(StructError,
             "unpack_from requires a buffer argument");
+        PyBuffer_Release(&buf);
         return NULL;
     }
 
     if (offset < 0)
-        offset += buffer_len;
+        offset += buf.len;
 
-    if (offset < 0 || (buffer_len - offset) < soself->s_size) {
+    if (offset < 0 || (buf.len - offset) < soself->s_size) {
         PyErr_Format(StructError,
             "unpack_from requires a buffer of at least %zd bytes",
             soself->s_size);
+        PyBuffer_Release(&buf);
         return NULL;
     }
-    return s_unpack_internal(soself, buffer + offset);
+    result = s_unpack_internal(soself, (char *)buf.buf + offset);
+    PyBuffer_Release(&buf);
+    return result;
+}
+
+
+/* Iterator returned by iter_unpack().  It keeps a view of the buffer for
+   its whole life, and gives back the same tuple again when the caller has
+   dropped its reference to the previous one, as izip() does. */
+
+typedef struct {
+    PyObject_HEAD
+    PyStructObject *so;
+    Py_buffer buf;
+    Py_ssize_t index;
+    PyObject *result;   /* last tuple returned */
+} unpackiterobject;
+
+static PyTypeObject unpackiter_type;
+
+static void
+unpackiter_dealloc(unpackiterobject *self)
+{
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(self->so);
+    Py_XDECREF(self->result);
+    PyBuffer_Release(&self->buf);
+    PyObject_GC_Del(self);
+}
+
+static int
+unpackiter_traverse(unpackiterobject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->so);
+    Py_VISIT(self->buf.obj);
+    Py_VISIT(self->result);
+    return 0;
+}
+
+static PyObject *
+unpackiter_len(unpackiterobject *self)
+{
+    Py_ssize_t len = 0;
+    if (self->so != NULL)
+        len = (self->buf.len - self->index) / self->so->s_size;
+    return PyInt_FromSsize_t(len);
+}
+
+static PyMethodDef unpackiter_methods[] = {
+    {"__length_hint__", (PyCFunction)unpackiter_len, METH_NOARGS, NULL},
+    {NULL,       NULL}          /* sentinel */
+};
+
+static PyObject *
+unpackiter_iternext(unpackiterobject *self)
+{
+    PyObject *result;
+
+    if (self->so == NULL)
+        return NULL;
+    if (self->index >= self->buf.len) {
+        /* Iterator exhausted */
+        Py_CLEAR(self->so);
+        Py_CLEAR(self->result);
+        PyBuffer_Release(&self->buf);
+        return NULL;
+    }
+    result = self->result;
+    if (result == NULL || Py_REFCNT(result) != 1) {
+        result = PyTuple_New(self->so->s_len);
+        if (result == NULL)
+            return NULL;
+        Py_XDECREF(self->result);
+        self->result = result;
+    }
+    if (s_unpack_fill(self->so, (char *)self->buf.buf + self->index,
+                      result) < 0) {
+        Py_CLEAR(self->result);
+        return NULL;
+    }
+    self->index += self->so->s_size;
+    Py_INCREF(result);
+    return result;
+}
+
+static PyTypeObject unpackiter_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "unpack_iterator",                          /* tp_name */
+    sizeof(unpackiterobject),                   /* tp_basicsize */
+    0,                                          /* tp_itemsize */
+    (destructor)unpackiter_dealloc,             /* tp_dealloc */
+    0,                                          /* tp_print */
+    0,                                          /* tp_getattr */
+    0,                                          /* tp_setattr */
+    0,                                          /* tp_compare */
+    0,                                          /* tp_repr */
+    0,                                          /* tp_as_number */
+    0,                                          /* tp_as_sequence */
+    0,                                          /* tp_as_mapping */
+    0,                                          /* tp_hash */
+    0,                                          /* tp_call */
+    0,                                          /* tp_str */
+    PyObject_GenericGetAttr,                    /* tp_getattro */
+    0,                                          /* tp_setattro */
+    0,                                          /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,    /* tp_flags */
+    0,                                          /* tp_doc */
+    (traverseproc)unpackiter_traverse,          /* tp_traverse */
+    0,                                          /* tp_clear */
+    0,                                          /* tp_richcompare */
+    0,                                          /* tp_weaklistoffset */
+    PyObject_SelfIter,                          /* tp_iter */
+    (iternextfunc)unpackiter_iternext,          /* tp_iternext */
+    unpackiter_methods                          /* tp_methods */
+};
+
+PyDoc_STRVAR(s_iter_unpack__doc__,
+"S.iter_unpack(buffer) -> iterator(v1, v2, ...)\n\
+\n\
+Return an iterator yielding tuples unpacked from the buffer according to\n\
+this Struct's format, one after the other.  Requires that len(buffer)\n\
+be a multiple of self.size.  A tuple may be reused for the next item if\n\
+no reference to it is kept.");
+
+static PyObject *
+s_iter_unpack(PyObject *self, PyObject *buffer)
+{
+    PyStructObject *soself = (PyStructObject *)self;
+    unpackiterobject *iter;
+
+    assert(PyStruct_Check(self));
+    assert(soself->s_codes != NULL);
+
+    if (soself->s_size == 0) {
+        PyErr_Format(StructError,
+                     "cannot iteratively unpack with a struct of length 0");
+        return NULL;
+    }
+    iter = PyObject_GC_New(unpackiterobject, &unpackiter_type);
+    if (iter == NULL)
+        return NULL;
+    iter->so = NULL;
+    iter->result = NULL;
+    iter->index = 0;
+    iter->buf.obj = NULL;
+    if (!PyArg_Parse(buffer, "s*:iter_unpack", &iter->buf)) {
+        Py_DECREF(iter);
+        return NULL;
+    }
+    if (iter->buf.len % soself->s_size != 0) {
+        PyErr_Format(StructError,
+                     "iterative unpacking requires a buffer of "
+                     "a multiple of %zd bytes",
+                     soself->s_size);
+        Py_DECREF(iter);
+        return NULL;
+    }
+    Py_INCREF(soself);
+    iter->so = soself;
+    PyObject_GC_Track(iter);
+    return (PyObject *)iter;
 }
 
 
@@ -1624,8 +1791,8 @@ static PyObject *
 s_pack_into(PyObject *self, PyObject *args)
 {
     PyStructObject *soself;
-    char *buffer;
-    Py_ssize_t buffer_len, offset;
+    Py_buffer buf;
+    Py_ssize_t offset;
 
     /* Validate arguments.  +1 is for the first arg as buffer. */
     soself = (PyStructObject *)self;
@@ -1640,34 +1807,37 @@ s_pack_into(PyObject *self, PyObject *args)
     }
 
     /* Extract a writable memory buffer from the first argument */
-    if ( PyObject_AsWriteBuffer(PyTuple_GET_ITEM(args, 0),
-                                                            (void**)&buffer, &buffer_len) == -1 ) {
+    if (!PyArg_Parse(PyTuple_GET_ITEM(args, 0), "w*:pack_into", &buf))
         return NULL;
-    }
-    assert( buffer_len >= 0 );
+    assert( buf.len >= 0 );
 
     /* Extract the offset from the first argument */
     offset = PyInt_AsSsize_t(PyTuple_GET_ITEM(args, 1));
-    if (offset == -1 && PyErr_Occurred())
+    if (offset == -1 && PyErr_Occurred()) {
+        PyBuffer_Release(&buf);
         return NULL;
+    }
 
     /* Support negative offsets. */
     if (offset < 0)
-        offset += buffer_len;
+        offset += buf.len;
 
     /* Check boundaries */
-    if (offset < 0 || (buffer_len - offset) < soself->s_size) {
+    if (offset < 0 || (buf.len - offset) < soself->s_size) {
         PyErr_Format(StructError,
                      "pack_into requires a buffer of at least %zd bytes",
                      soself->s_size);
+        PyBuffer_Release(&buf);
         return NULL;
     }
 
     /* Call the guts */
-    if ( s_pack_internal(soself, args, 2, buffer + offset) != 0 ) {
+    if ( s_pack_internal(soself, args, 2, (char *)buf.buf + offset) != 0 ) {
+        PyBuffer_Release(&buf);
         return NULL;
     }
 
+    PyBuffer_Release(&buf);
     Py_RETURN_NONE;
 }
 
@@ -1692,6 +1862,7 @@ static struct PyMethodDef s_methods[] = {
     {"unpack",          s_unpack,       METH_O, s_unpack__doc__},
     {"unpack_from",     (PyCFunction)s_unpack_from, METH_VARARGS|METH_KEYWORDS,
                     s_unpack_from__doc__},
+    {"iter_unpack",     s_iter_unpack,  METH_O, s_iter_unpack__doc__},
     {NULL,       NULL}          /* sentinel */
 };
 
@@ -1916,6 +2087,27 @@ unpack_from(PyObject *self, PyObject *args, PyObject *kwds)
     return result;
 }
 
+PyDoc_STRVAR(iter_unpack_doc,
+"Return an iterator yielding tuples unpacked from the buffer, containing\n\
+packed C structures one after the other, according to fmt.\n\
+Requires len(buffer) to be a multiple of calcsize(fmt).");
+
+static PyObject *
+iter_unpack(PyObject *self, PyObject *args)
+{
+    PyObject *s_object, *fmt, *buffer, *result;
+
+    if (!PyArg_UnpackTuple(args, "iter_unpack", 2, 2, &fmt, &buffer))
+        return NULL;
+
+    s_object = cache_struct(fmt);
+    if (s_object == NULL)
+        return NULL;
+    result = s_iter_unpack(s_object, buffer);
+    Py_DECREF(s_object);
+    return result;
+}
+
 static struct PyMethodDef module_functions[] = {
     {"_clearcache",     (PyCFunction)clearcache,        METH_NOARGS,    clearcache_doc},
     {"calcsize",        calcsize,       METH_O, calcsize_doc},
@@ -1924,6 +2116,7 @@ static struct PyMethodDef module_functions[] = {
     {"unpack",          unpack, METH_VARARGS,   unpack_doc},
     {"unpack_from",     (PyCFunction)unpack_from,
                     METH_VARARGS|METH_KEYWORDS,         unpack_from_doc},
+    {"iter_unpack",     iter_unpack,    METH_VARARGS,   iter_unpack_doc},
     {NULL,       NULL}          /* sentinel */
 };
 
@@ -1975,6 +2168,9 @@ init_struct(void)
     Py_TYPE(&PyStructType) = &PyType_Type;
     if (PyType_Ready(&PyStructType) < 0)
         return;
+    Py_TYPE(&unpackiter_type) = &PyType_Type;
+    if (PyType_Ready(&unpackiter_type) < 0)
+        return;
 
     /* This speed trick can't be used until overflow masking goes
        away, because native endian always raises exceptions
@@ -26,6 +26,7 @@ struct arraydescr {
     int itemsize;
     PyObject * (*getitem)(struct arrayobject *, Py_ssize_t);
     int (*setitem)(struct arrayobject *, Py_ssize_t, PyObject *);
+    char *formats;  /* struct format of the items, for buffer exports */
 };
 
 typedef struct arrayobject {
@@ -34,6 +35,8 @@ typedef struct arrayobject {
     Py_ssize_t allocated;
     struct arraydescr *ob_descr;
     PyObject *weakreflist; /* List of weak references */
+    Py_ssize_t ob_exports;  /* Number of exported buffers */
+    Py_buffer *ob_shared;   /* Buffer holding the items, or NULL */
 } arrayobject;
 
 static PyTypeObject Arraytype;
@@ -41,12 +44,62 @@ static PyTypeObject Arraytype;
 #define array_Check(op) PyObject_TypeCheck(op, &Arraytype)
 #define array_CheckExact(op) (Py_TYPE(op) == &Arraytype)
 
+/* The items of an array must stay where they are while its buffer is
+   exported through the new buffer interface. */
+static int
+array_check_exports(arrayobject *self)
+{
+    if (self->ob_exports > 0) {
+        PyErr_SetString(PyExc_BufferError,
+                        "cannot resize an array that is exporting buffers");
+        return -1;
+    }
+    return 0;
+}
+
+/* Arrays made by frombuffer() from a read-only buffer share its memory
+   until they are first modified: then they copy their items to memory of
+   their own and release the buffer. */
+static int
+array_unshare(arrayobject *self)
+{
+    Py_buffer *shared = self->ob_shared;
+    size_t nbytes;
+    char *items;
+
+    if (shared == NULL)
+        return 0;
+    if (self->ob_exports > 0) {
+        PyErr_SetString(PyExc_BufferError,
+            "cannot modify an array sharing a buffer while it is "
+            "exporting buffers");
+        return -1;
+    }
+    nbytes = Py_SIZE(self) * self->ob_descr->itemsize;
+    items = PyMem_NEW(char, nbytes);
+    if (items == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    memcpy(items, self->ob_item, nbytes);
+    self->ob_item = items;
+    self->allocated = Py_SIZE(self);
+    self->ob_shared = NULL;
+    PyBuffer_Release(shared);
+    PyMem_DEL(shared);
+    return 0;
+}
+
 static int
 array_resize(arrayobject *self, Py_ssize_t newsize)
 {
     char *items;
     size_t _new_size;
 
+    if (newsize != Py_SIZE(self) &&
+        (array_check_exports(self) < 0 || array_unshare(self) < 0))
+        return -1;
+
     /* Bypass realloc() when a previous overallocation is large enough
        to accommodate the newsize.  If the newsize is 16 smaller than the
        current size, then proceed with the realloc() to shrink the list.
@@ -391,21 +444,21 @@ d_setitem(arrayobject *ap, Py_ssize_t i, PyObject *v)
 
 /* Description of types */
 static struct arraydescr descriptors[] = {
-    {'c', sizeof(char), c_getitem, c_setitem},
-    {'b', sizeof(char), b_getitem, b_setitem},
-    {'B', sizeof(char), BB_getitem, BB_setitem},
+    {'c', sizeof(char), c_getitem, c_setitem, "c"},
+    {'b', sizeof(char), b_getitem, b_setitem, "b"},
+    {'B', sizeof(char), BB_getitem, BB_setitem, "B"},
 #ifdef Py_USING_UNICODE
-    {'u', sizeof(Py_UNICODE), u_getitem, u_setitem},
+    {'u', sizeof(Py_UNICODE), u_getitem, u_setitem, "u"},
 #endif
-    {'h', sizeof(short), h_getitem, h_setitem},
-    {'H', sizeof(short), HH_getitem, HH_setitem},
-    {'i', sizeof(int), i_getitem, i_setitem},
-    {'I', sizeof(int), II_getitem, II_setitem},
-    {'l', sizeof(long), l_getitem, l_setitem},
-    {'L', sizeof(long), LL_getitem, LL_setitem},
-    {'f', sizeof(float), f_getitem, f_setitem},
-    {'d', sizeof(double), d_getitem, d_setitem},
-    {'\0', 0, 0, 0} /* Sentinel */
+    {'h', sizeof(short), h_getitem, h_setitem, "h"},
+    {'H', sizeof(short), HH_getitem, HH_setitem, "H"},
+    {'i', sizeof(int), i_getitem, i_setitem, "i"},
+    {'I', sizeof(int), II_getitem, II_setitem, "I"},
+    {'l', sizeof(long), l_getitem, l_setitem, "l"},
+    {'L', sizeof(long), LL_getitem, LL_setitem, "L"},
+    {'f', sizeof(float), f_getitem, f_setitem, "f"},
+    {'d', sizeof(double), d_getitem, d_setitem, "d"},
+    {'\0', 0, 0, 0, 0} /* Sentinel */
 };
 
 /****************************************************************************
@@ -435,6 +488,8 @@ newarrayobject(PyTypeObject *type, Py_ssize_t size, struct arraydescr *descr)
     op->ob_descr = descr;
     op->allocated = size;
     op->weakreflist = NULL;
+    op->ob_exports = 0;
+    op->ob_shared = NULL;
     Py_SIZE(op) = size;
     if (size <= 0) {
         op->ob_item = NULL;
@@ -496,7 +551,11 @@ array_dealloc(arrayobject *op)
 {
     if (op->weakreflist != NULL)
         PyObject_ClearWeakRefs((PyObject *) op);
-    if (op->ob_item != NULL)
+    if (op->ob_shared != NULL) {
+        PyBuffer_Release(op->ob_shared);
+        PyMem_DEL(op->ob_shared);
+    }
+    else if (op->ob_item != NULL)
         PyMem_DEL(op->ob_item);
     Py_TYPE(op)->tp_free((PyObject *)op);
 }
@@ -735,8 +794,12 @@ array_ass_slice(arrayobject *a, Py_ssize_t ilow, Py_ssize_t ihigh, PyObject *v)
         ihigh = ilow;
     else if (ihigh > Py_SIZE(a))
         ihigh = Py_SIZE(a);
-    item = a->ob_item;
     d = n - (ihigh-ilow);
+    if (d != 0 && array_check_exports(a) < 0)
+        return -1;
+    if ((d != 0 || n > 0) && array_unshare(a) < 0)
+        return -1;
+    item = a->ob_item;
     if (d < 0) { /* Delete -d items */
         memmove(item + (ihigh+d)*a->ob_descr->itemsize,
             item + ihigh*a->ob_descr->itemsize,
@@ -778,6 +841,8 @@ array_ass_item(arrayobject *a, Py_ssize_t i, PyObject *v)
     }
     if (v == NULL)
         return array_ass_slice(a, i, i+1, v);
+    if (array_unshare(a) < 0)
+        return -1;
     return (*a->ob_descr->setitem)(a, i, v);
 }
 
@@ -830,6 +895,10 @@ array_do_extend(arrayobject *self, PyObject *bb)
         PyErr_NoMemory();
         return -1;
     }
+    if (Py_SIZE(b) == 0)
+        return 0;
+    if (array_check_exports(self) < 0 || array_unshare(self) < 0)
+        return -1;
     size = Py_SIZE(self) + Py_SIZE(b);
     old_item = self->ob_item;
     PyMem_RESIZE(self->ob_item, char, size*self->ob_descr->itemsize);
@@ -868,9 +937,11 @@ array_inplace_repeat(arrayobject *self, Py_ssize_t n)
     char *items, *p;
     Py_ssize_t size, i;
 
-    if (Py_SIZE(self) > 0) {
+    if (Py_SIZE(self) > 0 && n != 1) {
         if (n < 0)
             n = 0;
+        if (array_check_exports(self) < 0 || array_unshare(self) < 0)
+            return NULL;
         items = self->ob_item;
         if ((self->ob_descr->itemsize != 0) &&
             (Py_SIZE(self) > PY_SSIZE_T_MAX / self->ob_descr->itemsize)) {
@@ -1103,20 +1174,42 @@ static PyObject *
 array_byteswap(arrayobject *self, PyObject *unused)
 {
     char *p;
-    Py_ssize_t i;
+    Py_ssize_t i, n = Py_SIZE(self);
 
+    if (array_unshare(self) < 0)
+        return NULL;
+
+    /* Swap whole items with shifts where there is a type of their size;
+       compilers turn these loops into vector shuffles. */
     switch (self->ob_descr->itemsize) {
     case 1:
         break;
     case 2:
-        for (p = self->ob_item, i = Py_SIZE(self); --i >= 0; p += 2) {
+        if (sizeof(unsigned short) == 2) {
+            unsigned short *q = (unsigned short *)self->ob_item;
+            for (i = 0; i < n; i++)
+                q[i] = (unsigned short)((q[i] >> 8) | (q[i] << 8));
+            break;
+        }
+        for (p = self->ob_item, i = n; --i >= 0; p += 2) {
             char p0 = p[0];
             p[0] = p[1];
             p[1] = p0;
         }
         break;
     case 4:
-        for (p = self->ob_item, i = Py_SIZE(self); --i >= 0; p += 4) {
+#ifdef HAVE_UINT32_T
+        {
+            PY_UINT32_T *q = (PY_UINT32_T *)self->ob_item;
+            for (i = 0; i < n; i++) {
+                PY_UINT32_T x = q[i];
+                x = ((x & 0x00FF00FFU) << 8) | ((x >> 8) & 0x00FF00FFU);
+                q[i] = (x << 16) | (x >> 16);
+            }
+            break;
+        }
+#endif
+        for (p = self->ob_item, i = n; --i >= 0; p += 4) {
             char p0 = p[0];
             char p1 = p[1];
             p[0] = p[3];
@@ -1126,7 +1219,21 @@ array_byteswap(arrayobject *self, PyObject *unused)
         }
         break;
     case 8:
-        for (p = self->ob_item, i = Py_SIZE(self); --i >= 0; p += 8) {
+#ifdef HAVE_UINT64_T
+        {
+            PY_UINT64_T *q = (PY_UINT64_T *)self->ob_item;
+            const PY_UINT64_T m8 = ((PY_UINT64_T)0x00FF00FFU << 32) | 0x00FF00FFU;
+            const PY_UINT64_T m16 = ((PY_UINT64_T)0x0000FFFFU << 32) | 0x0000FFFFU;
+            for (i = 0; i < n; i++) {
+                PY_UINT64_T x = q[i];
+                x = ((x & m8) << 8) | ((x >> 8) & m8);
+                x = ((x & m16) << 16) | ((x >> 16) & m16);
+                q[i] = (x << 32) | (x >> 32);
+            }
+            break;
+        }
+#endif
+        for (p = self->ob_item, i = n; --i >= 0; p += 8) {
             char p0 = p[0];
             char p1 = p[1];
             char p2 = p[2];
@@ -1166,6 +1273,8 @@ array_reverse(arrayobject *self, PyObject *unused)
     assert((size_t)itemsize <= sizeof(tmp));
 
     if (Py_SIZE(self) > 1) {
+        if (array_unshare(self) < 0)
+            return NULL;
         for (p = self->ob_item,
              q = self->ob_item + (Py_SIZE(self) - 1)*itemsize;
              p < q;
@@ -1188,6 +1297,88 @@ PyDoc_STRVAR(reverse_doc,
 \n\
 Reverse the order of the items in the array.");
 
+/* Return a memoryview of the nbytes bytes of the items from byte offset
+   start, writable if flags has PyBUF_WRITABLE, to hand to a file object's
+   readinto() or write().  It counts as an export, so that the array isn't
+   resized under it. */
+static PyObject *
+array_bytes_view(arrayobject *self, int flags,
+                 Py_ssize_t start, Py_ssize_t nbytes)
+{
+    Py_buffer buf;
+    PyObject *view;
+
+    if (PyObject_GetBuffer((PyObject *)self, &buf, flags) < 0)
+        return NULL;
+    buf.buf = (char *)buf.buf + start;
+    buf.len = nbytes;
+    buf.itemsize = 1;
+    buf.format = "B";
+    buf.ndim = 1;
+    buf.shape = &buf.len;
+    buf.strides = &buf.itemsize;
+    view = PyMemoryView_FromBuffer(&buf);
+    if (view == NULL)
+        PyBuffer_Release(&buf);
+    return view;
+}
+
+/* fromfile() for file objects of the io module, or anything with a
+   readinto() method: read the items straight into the array. */
+static PyObject *
+array_fromfile_readinto(arrayobject *self, PyObject *f, Py_ssize_t n)
+{
+    Py_ssize_t itemsize = self->ob_descr->itemsize;
+    Py_ssize_t oldsize = Py_SIZE(self);
+    Py_ssize_t nbytes, done = 0, got;
+    PyObject *view, *res;
+
+    if (n > PY_SSIZE_T_MAX / itemsize - oldsize)
+        return PyErr_NoMemory();
+    nbytes = n * itemsize;
+    if (array_resize(self, oldsize + n) < 0)
+        return NULL;
+    /* Raw files may read less than asked for before the end of the file */
+    while (done < nbytes) {
+        view = array_bytes_view(self, PyBUF_WRITABLE,
+                                oldsize * itemsize + done, nbytes - done);
+        if (view == NULL)
+            break;
+        res = PyObject_CallMethod(f, "readinto", "O", view);
+        Py_DECREF(view);
+        if (res == NULL)
+            break;
+        got = res == Py_None ? 0 : PyNumber_AsSsize_t(res, PyExc_OverflowError);
+        Py_DECREF(res);
+        if (got == -1 && PyErr_Occurred())
+            break;
+        if (got < 0 || got > nbytes - done) {
+            PyErr_Format(PyExc_IOError,
+                         "readinto() returned %zd bytes, "
+                         "%zd were asked for", got, nbytes - done);
+            break;
+        }
+        if (got == 0)
+            break;
+        done += got;
+    }
+    if (done < nbytes) {
+        /* Keep the items that were read, as fread() would */
+        char *tail = self->ob_item + oldsize * itemsize + done;
+        int failed = PyErr_Occurred() != NULL;
+
+        if (array_resize(self, oldsize + done / itemsize) < 0) {
+            /* readinto() kept the view: don't leave garbage behind */
+            memset(tail, 0, nbytes - done);
+            return NULL;
+        }
+        if (!failed)
+            PyErr_SetString(PyExc_EOFError, "not enough items in file");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
 static PyObject *
 array_fromfile(arrayobject *self, PyObject *args)
 {
@@ -1198,9 +1389,16 @@ array_fromfile(arrayobject *self, PyObject *args)
         return NULL;
     fp = PyFile_AsFile(f);
     if (fp == NULL) {
+        if (!PyFile_Check(f) && PyObject_HasAttrString(f, "readinto")) {
+            if (n <= 0)
+                Py_RETURN_NONE;
+            return array_fromfile_readinto(self, f, n);
+        }
         PyErr_SetString(PyExc_TypeError, "arg1 must be open file");
         return NULL;
     }
+    if (n > 0 && (array_check_exports(self) < 0 || array_unshare(self) < 0))
+        return NULL;
     if (n > 0) {
         char *item = self->ob_item;
         Py_ssize_t itemsize = self->ob_descr->itemsize;
@@ -1241,7 +1439,9 @@ PyDoc_STRVAR(fromfile_doc,
 "fromfile(f, n)\n\
 \n\
 Read n objects from the file object f and append them to the end of the\n\
-array.  Also called as read.");
+array.  f may also be a file of the io module, or any object with a\n\
+readinto() method, which then reads into the array directly.  Also called\n\
+as read.");
 
 
 static PyObject *
@@ -1254,6 +1454,42 @@ array_fromfile_as_read(arrayobject *self, PyObject *args)
 }
 
 
+/* tofile() for file objects of the io module, or anything with a write()
+   method accepting buffers: write from the array's memory. */
+static PyObject *
+array_tofile_write(arrayobject *self, PyObject *f)
+{
+    Py_ssize_t nbytes = Py_SIZE(self) * self->ob_descr->itemsize;
+    Py_ssize_t done = 0, put;
+    PyObject *view, *res;
+
+    /* Raw files may write less than asked for, and return None if they
+       are non-blocking and wrote nothing; buffered files write it all */
+    while (done < nbytes) {
+        view = array_bytes_view(self, PyBUF_SIMPLE, done, nbytes - done);
+        if (view == NULL)
+            break;
+        res = PyObject_CallMethod(f, "write", "O", view);
+        Py_DECREF(view);
+        if (res == NULL)
+            break;
+        put = res == Py_None ? 0 : PyNumber_AsSsize_t(res, PyExc_OverflowError);
+        Py_DECREF(res);
+        if (put == -1 && PyErr_Occurred())
+            break;
+        if (put <= 0 || put > nbytes - done) {
+            PyErr_Format(PyExc_IOError,
+                         "write() returned %zd bytes, "
+                         "%zd were given", put, nbytes - done);
+            break;
+        }
+        done += put;
+    }
+    if (done < nbytes)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
 static PyObject *
 array_tofile(arrayobject *self, PyObject *f)
 {
@@ -1261,6 +1497,8 @@ array_tofile(arrayobject *self, PyObject *f)
 
     fp = PyFile_AsFile(f);
     if (fp == NULL) {
+        if (!PyFile_Check(f) && PyObject_HasAttrString(f, "write"))
+            return array_tofile_write(self, f);
         PyErr_SetString(PyExc_TypeError, "arg must be open file");
         return NULL;
     }
@@ -1279,7 +1517,9 @@ array_tofile(arrayobject *self, PyObject *f)
 PyDoc_STRVAR(tofile_doc,
 "tofile(f)\n\
 \n\
-Write all items (as machine values) to the file object f.  Also called as\n\
+Write all items (as machine values) to the file object f.  f may also be a\n\
+file of the io module, or any object with a write() method accepting\n\
+buffers, which then writes from the array directly.  Also called as\n\
 write.");
 
 
@@ -1304,6 +1544,8 @@ array_fromlist(arrayobject *self, PyObject *list)
         return NULL;
     }
     n = PyList_Size(list);
+    if (n > 0 && (array_check_exports(self) < 0 || array_unshare(self) < 0))
+        return NULL;
     if (n > 0) {
         char *item = self->ob_item;
         Py_ssize_t i;
@@ -1380,6 +1622,8 @@ array_fromstring(arrayobject *self, PyObject *args)
         return NULL;
     }
     n = n / itemsize;
+    if (n > 0 && (array_check_exports(self) < 0 || array_unshare(self) < 0))
+        return NULL;
     if (n > 0) {
         char *item = self->ob_item;
         if ((n > PY_SSIZE_T_MAX - Py_SIZE(self)) ||
@@ -1442,6 +1686,8 @@ array_fromunicode(arrayobject *self, PyObject *args)
             "type 'u' arrays");
         return NULL;
     }
+    if (n > 0 && (array_check_exports(self) < 0 || array_unshare(self) < 0))
+        return NULL;
     if (n > 0) {
         Py_UNICODE *item = (Py_UNICODE *) self->ob_item;
         if (Py_SIZE(self) > PY_SSIZE_T_MAX - n) {
@@ -1547,19 +1793,860 @@ static PyGetSetDef array_getsets [] = {
     {NULL}
 };
 
+/* Bulk arithmetic.
+
+   sum(), min(), max(), dot(), add(), mul() and compare() work on the items
+   in place, without making a Python object for each of them, in loops
+   simple enough for the compiler to vectorize.  The results are those of
+   the same Python operations on the items: integers are computed in a long
+   long or with overflow checks, and floats are summed in order, as sum()
+   does.  An integer sum() or dot() too large for a long long is redone
+   with Python arithmetic; add() and mul() raise OverflowError, leaving the
+   array unchanged, if a result doesn't fit in the item type.  Operands the
+   loops can't handle exactly go through Python objects too. */
+
+/* Items of up to 32 bits (or products of 16-bit items) summed in a long
+   long between overflow checks. */
+#define BULK_BLOCK ((Py_ssize_t)1 << 24)
+
+static int
+array_check_numeric(arrayobject *self, const char *name)
+{
+    char c = self->ob_descr->typecode;
+
+    if (c == 'c' || c == 'u') {
+        PyErr_Format(PyExc_TypeError,
+                     "%s() requires an array of numbers", name);
+        return -1;
+    }
+    return 0;
+}
+
+/* The array operand of dot(), add() and mul() must have the same type and
+   length as self. */
+static int
+array_check_operand(arrayobject *self, arrayobject *other, const char *name)
+{
+    if (other->ob_descr != self->ob_descr) {
+        PyErr_Format(PyExc_TypeError,
+                     "%s() requires an array with typecode '%c'",
+                     name, self->ob_descr->typecode);
+        return -1;
+    }
+    if (Py_SIZE(other) != Py_SIZE(self)) {
+        PyErr_Format(PyExc_ValueError,
+                     "%s() requires arrays of the same length", name);
+        return -1;
+    }
+    return 0;
+}
+
+/* sum() (other == NULL) and dot() with Python arithmetic.  Like those of
+   the fast paths, the results are longs for 'I' and 'L' arrays, whose
+   items are longs. */
+static PyObject *
+array_slow_dot(arrayobject *self, arrayobject *other)
+{
+    PyObject *total, *x, *y, *t;
+    Py_ssize_t i;
+
+    total = PyInt_FromLong(0);
+    for (i = 0; total != NULL && i < Py_SIZE(self); i++) {
+        x = getarrayitem((PyObject *)self, i);
+        if (x != NULL && other != NULL) {
+            y = getarrayitem((PyObject *)other, i);
+            t = y == NULL ? NULL : PyNumber_Multiply(x, y);
+            Py_XDECREF(y);
+            Py_DECREF(x);
+            x = t;
+        }
+        if (x == NULL) {
+            Py_DECREF(total);
+            return NULL;
+        }
+        t = PyNumber_Add(total, x);
+        Py_DECREF(x);
+        Py_DECREF(total);
+        total = t;
+    }
+    return total;
+}
+
+/* add() and mul() with Python arithmetic, into a copy that replaces the
+   items only if all of them could be stored */
+static PyObject *
+array_slow_op(arrayobject *self, PyObject *other, int mul)
+{
+    Py_ssize_t i, n = Py_SIZE(self);
+    PyObject *res, *x, *y, *t;
+
+    res = newarrayobject(&Arraytype, n, self->ob_descr);
+    if (res == NULL)
+        return NULL;
+    for (i = 0; i < n; i++) {
+        x = getarrayitem((PyObject *)self, i);
+        if (x == NULL)
+            goto error;
+        if (array_Check(other))
+            y = getarrayitem(other, i);
+        else {
+            y = other;
+            Py_INCREF(y);
+        }
+        t = y == NULL ? NULL :
+            mul ? PyNumber_Multiply(x, y) : PyNumber_Add(x, y);
+        Py_DECREF(x);
+        Py_XDECREF(y);
+        if (t == NULL)
+            goto error;
+        if (setarrayitem(res, i, t) < 0) {
+            Py_DECREF(t);
+            goto error;
+        }
+        Py_DECREF(t);
+    }
+    if (n > 0) {
+        if (array_unshare(self) < 0)
+            goto error;
+        memcpy(self->ob_item, ((arrayobject *)res)->ob_item,
+               n * self->ob_descr->itemsize);
+    }
+    Py_DECREF(res);
+    Py_RETURN_NONE;
+  error:
+    Py_DECREF(res);
+    return NULL;
+}
+
+#ifdef HAVE_LONG_LONG
+
+static PyObject *
+bulk_from_ll(PY_LONG_LONG v)
+{
+    if (v >= LONG_MIN && v <= LONG_MAX)
+        return PyInt_FromLong((long)v);
+    return PyLong_FromLongLong(v);
+}
+
+/* *acc += v; returns -1 on overflow */
+static int
+ll_add(PY_LONG_LONG *acc, PY_LONG_LONG v)
+{
+    if (v > 0 ? *acc > PY_LLONG_MAX - v : *acc < PY_LLONG_MIN - v)
+        return -1;
+    *acc += v;
+    return 0;
+}
+
+static int
+ull_add(unsigned PY_LONG_LONG *acc, unsigned PY_LONG_LONG v)
+{
+    if (*acc > PY_ULLONG_MAX - v)
+        return -1;
+    *acc += v;
+    return 0;
+}
+
+/* *r = x * y; returns -1 on overflow */
+static int
+ll_mul(PY_LONG_LONG x, PY_LONG_LONG y, PY_LONG_LONG *r)
+{
+    if (x > 0 ? (y > 0 ? x > PY_LLONG_MAX / y : y < PY_LLONG_MIN / x)
+              : (y > 0 ? x < PY_LLONG_MIN / y
+                       : x != 0 && y < PY_LLONG_MAX / x))
+        return -1;
+    *r = x * y;
+    return 0;
+}
+
+static int
+ull_mul(unsigned PY_LONG_LONG x, unsigned PY_LONG_LONG y,
+        unsigned PY_LONG_LONG *r)
+{
+    if (y != 0 && x > PY_ULLONG_MAX / y)
+        return -1;
+    *r = x * y;
+    return 0;
+}
+
+#endif /* HAVE_LONG_LONG */
+
+PyDoc_STRVAR(sum_doc,
+"sum()\n\
+\n\
+Return the sum of the items, as sum(array) would.");
+
+static PyObject *
+array_sum(arrayobject *self, PyObject *unused)
+{
+    Py_ssize_t i, n = Py_SIZE(self);
+
+    if (array_check_numeric(self, "sum") < 0)
+        return NULL;
+    if (n == 0)
+        return PyInt_FromLong(0);
+
+#define SUM_FLOAT(T) {                                          \
+        const T *p = (const T *)self->ob_item;                  \
+        double acc = 0.0;                                       \
+        for (i = 0; i < n; i++)                                 \
+            acc += p[i];                                        \
+        return PyFloat_FromDouble(acc);                         \
+    }
+#define SUM_SMALL(T, RESULT) {                                  \
+        const T *p = (const T *)self->ob_item;                  \
+        PY_LONG_LONG acc = 0, part;                             \
+        Py_ssize_t end;                                         \
+        for (i = 0; i < n; ) {                                  \
+            end = n - i > BULK_BLOCK ? i + BULK_BLOCK : n;      \
+            for (part = 0; i < end; i++)                        \
+                part += p[i];                                   \
+            if (ll_add(&acc, part) < 0)                         \
+                return array_slow_dot(self, NULL);              \
+        }                                                       \
+        return RESULT(acc);                                     \
+    }
+
+    switch (self->ob_descr->typecode) {
+    case 'f': SUM_FLOAT(float)
+    case 'd': SUM_FLOAT(double)
+#ifdef HAVE_LONG_LONG
+    case 'b': SUM_SMALL(signed char, bulk_from_ll)
+    case 'B': SUM_SMALL(unsigned char, bulk_from_ll)
+    case 'h': SUM_SMALL(short, bulk_from_ll)
+    case 'H': SUM_SMALL(unsigned short, bulk_from_ll)
+    case 'i': SUM_SMALL(int, bulk_from_ll)
+    case 'I': SUM_SMALL(unsigned int, PyLong_FromLongLong)
+    case 'l': {
+        const long *p = (const long *)self->ob_item;
+        PY_LONG_LONG acc = 0;
+        for (i = 0; i < n; i++)
+            if (ll_add(&acc, p[i]) < 0)
+                return array_slow_dot(self, NULL);
+        return bulk_from_ll(acc);
+    }
+    case 'L': {
+        const unsigned long *p = (const unsigned long *)self->ob_item;
+        unsigned PY_LONG_LONG acc = 0;
+        for (i = 0; i < n; i++)
+            if (ull_add(&acc, p[i]) < 0)
+                return array_slow_dot(self, NULL);
+        return PyLong_FromUnsignedLongLong(acc);
+    }
+#endif
+    }
+#undef SUM_FLOAT
+#undef SUM_SMALL
+    return array_slow_dot(self, NULL);
+}
+
+/* Index of the smallest (op == Py_LT) or largest (Py_GT) item, the first
+   one if there are several, as min() and max() would pick it. */
+static Py_ssize_t
+array_extreme(arrayobject *self, int op)
+{
+    Py_ssize_t i, k = 0, n = Py_SIZE(self);
+
+    /* Integers: find the value in a vectorizable loop, then its index */
+#define EXTREME_INT(T) {                                        \
+        const T *p = (const T *)self->ob_item;                  \
+        T best = p[0];                                          \
+        if (op == Py_LT) {                                      \
+            for (i = 1; i < n; i++)                             \
+                best = p[i] < best ? p[i] : best;               \
+        }                                                       \
+        else {                                                  \
+            for (i = 1; i < n; i++)                             \
+                best = p[i] > best ? p[i] : best;               \
+        }                                                       \
+        while (p[k] != best)                                    \
+            k++;                                                \
+        break;                                                  \
+    }
+    /* Floats: compare in order, so that NaNs are treated as by min() */
+#define EXTREME_FLOAT(T) {                                      \
+        const T *p = (const T *)self->ob_item;                  \
+        if (op == Py_LT) {                                      \
+            for (i = 1; i < n; i++)                             \
+                if (p[i] < p[k])                                \
+                    k = i;                                      \
+        }                                                       \
+        else {                                                  \
+            for (i = 1; i < n; i++)                             \
+                if (p[i] > p[k])                                \
+                    k = i;                                      \
+        }                                                       \
+        break;                                                  \
+    }
+
+    switch (self->ob_descr->typecode) {
+    case 'b': EXTREME_INT(signed char)
+    case 'B': EXTREME_INT(unsigned char)
+    case 'h': EXTREME_INT(short)
+    case 'H': EXTREME_INT(unsigned short)
+    case 'i': EXTREME_INT(int)
+    case 'I': EXTREME_INT(unsigned int)
+    case 'l': EXTREME_INT(long)
+    case 'L': EXTREME_INT(unsigned long)
+    case 'f': EXTREME_FLOAT(float)
+    case 'd': EXTREME_FLOAT(double)
+    }
+#undef EXTREME_INT
+#undef EXTREME_FLOAT
+    return k;
+}
+
+static PyObject *
+array_minmax(arrayobject *self, int op, const char *name)
+{
+    if (array_check_numeric(self, name) < 0)
+        return NULL;
+    if (Py_SIZE(self) == 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "%s() arg is an empty sequence", name);
+        return NULL;
+    }
+    return getarrayitem((PyObject *)self, array_extreme(self, op));
+}
+
+PyDoc_STRVAR(min_doc,
+"min()\n\
+\n\
+Return the smallest item, as min(array) would.");
+
+static PyObject *
+array_min(arrayobject *self, PyObject *unused)
+{
+    return array_minmax(self, Py_LT, "min");
+}
+
+PyDoc_STRVAR(max_doc,
+"max()\n\
+\n\
+Return the largest item, as max(array) would.");
+
+static PyObject *
+array_max(arrayobject *self, PyObject *unused)
+{
+    return array_minmax(self, Py_GT, "max");
+}
+
+PyDoc_STRVAR(dot_doc,
+"dot(array)\n\
+\n\
+Return the sum of the products of the items of both arrays, which must\n\
+have the same typecode and length.");
+
+static PyObject *
+array_dot(arrayobject *self, PyObject *arg)
+{
+    arrayobject *other = (arrayobject *)arg;
+    Py_ssize_t i, n = Py_SIZE(self);
+
+    if (array_check_numeric(self, "dot") < 0)
+        return NULL;
+    if (!array_Check(arg)) {
+        PyErr_Format(PyExc_TypeError,
+                     "dot() argument must be an array, not %.200s",
+                     Py_TYPE(arg)->tp_name);
+        return NULL;
+    }
+    if (array_check_operand(self, other, "dot") < 0)
+        return NULL;
+    if (n == 0)
+        return PyInt_FromLong(0);
+
+#define DOT_FLOAT(T) {                                          \
+        const T *p = (const T *)self->ob_item;                  \
+        const T *q = (const T *)other->ob_item;                 \
+        double acc = 0.0;                                       \
+        for (i = 0; i < n; i++)                                 \
+            acc += (double)p[i] * q[i];                         \
+        return PyFloat_FromDouble(acc);                         \
+    }
+    /* The products of 16-bit items fit in 32 bits */
+#define DOT_SMALL(T) {                                          \
+        const T *p = (const T *)self->ob_item;                  \
+        const T *q = (const T *)other->ob_item;                 \
+        PY_LONG_LONG acc = 0, part;                             \
+        Py_ssize_t end;                                         \
+        for (i = 0; i < n; ) {                                  \
+            end = n - i > BULK_BLOCK ? i + BULK_BLOCK : n;      \
+            for (part = 0; i < end; i++)                        \
+                part += (PY_LONG_LONG)p[i] * q[i];              \
+            if (ll_add(&acc, part) < 0)                         \
+                return array_slow_dot(self, other);             \
+        }                                                       \
+        return bulk_from_ll(acc);                               \
+    }
+
+    switch (self->ob_descr->typecode) {
+    case 'f': DOT_FLOAT(float)
+    case 'd': DOT_FLOAT(double)
+#ifdef HAVE_LONG_LONG
+    case 'b': DOT_SMALL(signed char)
+    case 'B': DOT_SMALL(unsigned char)
+    case 'h': DOT_SMALL(short)
+    case 'H': DOT_SMALL(unsigned short)
+    case 'i': {
+        const int *p = (const int *)self->ob_item;
+        const int *q = (const int *)other->ob_item;
+        PY_LONG_LONG acc = 0;
+        for (i = 0; i < n; i++)
+            if (ll_add(&acc, (PY_LONG_LONG)p[i] * q[i]) < 0)
+                return array_slow_dot(self, other);
+        return bulk_from_ll(acc);
+    }
+    case 'I': {
+        const unsigned int *p = (const unsigned int *)self->ob_item;
+        const unsigned int *q = (const unsigned int *)other->ob_item;
+        unsigned PY_LONG_LONG acc = 0;
+        for (i = 0; i < n; i++)
+            if (ull_add(&acc, (unsigned PY_LONG_LONG)p[i] * q[i]) < 0)
+                return array_slow_dot(self, other);
+        return PyLong_FromUnsignedLongLong(acc);
+    }
+    case 'l': {
+        const long *p = (const long *)self->ob_item;
+        const long *q = (const long *)other->ob_item;
+        PY_LONG_LONG acc = 0, r;
+        for (i = 0; i < n; i++)
+            if (ll_mul(p[i], q[i], &r) < 0 || ll_add(&acc, r) < 0)
+                return array_slow_dot(self, other);
+        return bulk_from_ll(acc);
+    }
+    case 'L': {
+        const unsigned long *p = (const unsigned long *)self->ob_item;
+        const unsigned long *q = (const unsigned long *)other->ob_item;
+        unsigned PY_LONG_LONG acc = 0, r;
+        for (i = 0; i < n; i++)
+            if (ull_mul(p[i], q[i], &r) < 0 || ull_add(&acc, r) < 0)
+                return array_slow_dot(self, other);
+        return PyLong_FromUnsignedLongLong(acc);
+    }
+#endif
+    }
+#undef DOT_FLOAT
+#undef DOT_SMALL
+    return array_slow_dot(self, other);
+}
+
+/* Run BODY for each item p[i], with y bound to the scalar operand s or to
+   the item q[i] of the array operand. */
+#define BULK_EACH(YT, BODY)                                     \
+    if (q == NULL) {                                            \
+        for (i = 0; i < n; i++) {                               \
+            const YT y = s;                                     \
+            BODY                                                \
+        }                                                       \
+    }                                                           \
+    else {                                                      \
+        for (i = 0; i < n; i++) {                               \
+            const YT y = q[i];                                  \
+            BODY                                                \
+        }                                                       \
+    }
+
+#ifdef HAVE_LONG_LONG
+
+/* x * y for an 'I' item x: the product of two unsigned ints may not fit in
+   a long long, so it is computed unsigned.  Any result out of range is
+   returned as -1. */
+static PY_LONG_LONG
+uint_mul(unsigned int x, PY_LONG_LONG y)
+{
+    unsigned PY_LONG_LONG r;
+
+    if (y < 0)
+        return x == 0 ? 0 : -1;
+    r = (unsigned PY_LONG_LONG)x * (unsigned PY_LONG_LONG)y;
+    return r > UINT_MAX ? -1 : (PY_LONG_LONG)r;
+}
+
+#define SMALL_MUL(x, y) ((PY_LONG_LONG)(x) * (y))
+
+/* Convert the integer operand of add(), mul() or compare() to a long long
+   in *v.  Only the results must fit in the array, not the operand itself,
+   so any int or long will do.  Return 0 if it isn't an integer, or is out
+   of the range the loops for the array's typecode can handle: the caller
+   then falls back to Python arithmetic.  Return -1 on error. */
+static int
+bulk_int_operand(arrayobject *self, PyObject *arg, PY_LONG_LONG *v)
+{
+    char typecode = self->ob_descr->typecode;
+    int overflow;
+
+    if (!PyInt_Check(arg) && !PyLong_Check(arg))
+        return 0;
+    *v = PyLong_AsLongLongAndOverflow(arg, &overflow);
+    if (*v == -1 && PyErr_Occurred())
+        return -1;
+    if (overflow)
+        return 0;
+    switch (typecode) {
+    case 'l':
+        return 1;
+    case 'L':
+        return *v >= 0;
+    default:
+        /* Keeps the products of the smaller items within a long long */
+        return *v >= INT_MIN && *v <= INT_MAX;
+    }
+}
+
+#endif /* HAVE_LONG_LONG */
+
+static PyObject *
+array_bulk_op(arrayobject *self, PyObject *arg, int mul)
+{
+    const char *name = mul ? "mul" : "add";
+    char typecode = self->ob_descr->typecode;
+    Py_ssize_t i, n = Py_SIZE(self);
+    const char *operand = NULL;     /* items of an array operand */
+    double fscalar = 0.0;
+#ifdef HAVE_LONG_LONG
+    PY_LONG_LONG lscalar = 0;
+#endif
+    int overflow = 0;
+
+    if (array_check_numeric(self, name) < 0)
+        return NULL;
+    if (array_Check(arg)) {
+        if (array_check_operand(self, (arrayobject *)arg, name) < 0)
+            return NULL;
+        operand = ((arrayobject *)arg)->ob_item;
+    }
+    else if (typecode == 'f' || typecode == 'd') {
+        fscalar = PyFloat_AsDouble(arg);
+        if (fscalar == -1.0 && PyErr_Occurred())
+            return NULL;
+    }
+    else {
+#ifdef HAVE_LONG_LONG
+        int r = bulk_int_operand(self, arg, &lscalar);
+        if (r < 0)
+            return NULL;
+        if (r == 0)
+#endif
+            return array_slow_op(self, arg, mul);
+    }
+    if (n == 0)
+        Py_RETURN_NONE;
+    if (array_unshare(self) < 0)
+        return NULL;
+
+#define OP_FLOAT(T) {                                           \
+        T *p = (T *)self->ob_item;                              \
+        const T *q = (const T *)operand;                        \
+        const double s = fscalar;                               \
+        if (mul) {                                              \
+            BULK_EACH(double, p[i] = (T)(p[i] * y);)            \
+        }                                                       \
+        else {                                                  \
+            BULK_EACH(double, p[i] = (T)(p[i] + y);)            \
+        }                                                       \
+        break;                                                  \
+    }
+    /* Check all the results in a long long, then store them */
+#define OP_SMALL(T, T_MIN, T_MAX, MUL) {                        \
+        T *p = (T *)self->ob_item;                              \
+        const T *q = (const T *)operand;                        \
+        const PY_LONG_LONG s = lscalar;                         \
+        PY_LONG_LONG r;                                         \
+        if (mul) {                                              \
+            BULK_EACH(PY_LONG_LONG, r = MUL(p[i], y);           \
+                      overflow |= (r < (T_MIN)) | (r > (T_MAX));) \
+            if (overflow)                                       \
+                break;                                          \
+            BULK_EACH(PY_LONG_LONG, p[i] = (T)MUL(p[i], y);)    \
+        }                                                       \
+        else {                                                  \
+            BULK_EACH(PY_LONG_LONG, r = (PY_LONG_LONG)p[i] + y; \
+                      overflow |= (r < (T_MIN)) | (r > (T_MAX));) \
+            if (overflow)                                       \
+                break;                                          \
+            BULK_EACH(PY_LONG_LONG, p[i] = (T)(p[i] + y);)      \
+        }                                                       \
+        break;                                                  \
+    }
+
+    switch (typecode) {
+    case 'f': OP_FLOAT(float)
+    case 'd': OP_FLOAT(double)
+#ifdef HAVE_LONG_LONG
+    case 'b': OP_SMALL(signed char, SCHAR_MIN, SCHAR_MAX, SMALL_MUL)
+    case 'B': OP_SMALL(unsigned char, 0, UCHAR_MAX, SMALL_MUL)
+    case 'h': OP_SMALL(short, SHRT_MIN, SHRT_MAX, SMALL_MUL)
+    case 'H': OP_SMALL(unsigned short, 0, USHRT_MAX, SMALL_MUL)
+    case 'i': OP_SMALL(int, INT_MIN, INT_MAX, SMALL_MUL)
+    case 'I': OP_SMALL(unsigned int, 0, UINT_MAX, uint_mul)
+    case 'l': {
+        long *p = (long *)self->ob_item;
+        const long *q = (const long *)operand;
+        const PY_LONG_LONG s = lscalar;
+        PY_LONG_LONG r;
+        BULK_EACH(PY_LONG_LONG,
+                  r = p[i];
+                  if ((mul ? ll_mul(r, y, &r) : ll_add(&r, y)) < 0 ||
+                      r < LONG_MIN || r > LONG_MAX) {
+                      overflow = 1;
+                      break;
+                  })
+        if (overflow)
+            break;
+        if (mul) {
+            BULK_EACH(PY_LONG_LONG, p[i] = (long)(p[i] * y);)
+        }
+        else {
+            BULK_EACH(PY_LONG_LONG, p[i] = (long)(p[i] + y);)
+        }
+        break;
+    }
+    case 'L': {
+        unsigned long *p = (unsigned long *)self->ob_item;
+        const unsigned long *q = (const unsigned long *)operand;
+        const unsigned PY_LONG_LONG s = (unsigned PY_LONG_LONG)lscalar;
+        unsigned PY_LONG_LONG r;
+        BULK_EACH(unsigned PY_LONG_LONG,
+                  r = p[i];
+                  if ((mul ? ull_mul(r, y, &r) : ull_add(&r, y)) < 0 ||
+                      r > ULONG_MAX) {
+                      overflow = 1;
+                      break;
+                  })
+        if (overflow)
+            break;
+        if (mul) {
+            BULK_EACH(unsigned PY_LONG_LONG,
+                      p[i] = (unsigned long)(p[i] * y);)
+        }
+        else {
+            BULK_EACH(unsigned PY_LONG_LONG,
+                      p[i] = (unsigned long)(p[i] + y);)
+        }
+        break;
+    }
+#endif
+    default:
+        return array_slow_op(self, arg, mul);
+    }
+#undef OP_FLOAT
+#undef OP_SMALL
+
+    if (overflow) {
+        PyErr_Format(PyExc_OverflowError,
+                     "result of %s() out of range for array of type '%c'",
+                     name, typecode);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(add_doc,
+"add(x)\n\
+\n\
+Add x to each item, in place.  x is a number or an array with the same\n\
+typecode and length, whose items are added to the items at the same\n\
+positions.  OverflowError is raised, leaving the array unchanged, if a\n\
+result doesn't fit in the item type.");
+
+static PyObject *
+array_add(arrayobject *self, PyObject *arg)
+{
+    return array_bulk_op(self, arg, 0);
+}
+
+PyDoc_STRVAR(mul_doc,
+"mul(x)\n\
+\n\
+Multiply each item by x, in place.  x is a number or an array with the\n\
+same typecode and length, whose items multiply the items at the same\n\
+positions.");
+
+static PyObject *
+array_mul(arrayobject *self, PyObject *arg)
+{
+    return array_bulk_op(self, arg, 1);
+}
+
+/* compare() with Python comparisons, into mask */
+static PyObject *
+array_slow_compare(arrayobject *self, PyObject *other, int op,
+                   arrayobject *mask)
+{
+    Py_ssize_t i, n = Py_SIZE(self);
+    PyObject *x, *y;
+    int r;
+
+    for (i = 0; i < n; i++) {
+        x = getarrayitem((PyObject *)self, i);
+        if (x == NULL)
+            goto error;
+        if (array_Check(other))
+            y = getarrayitem(other, i);
+        else {
+            y = other;
+            Py_INCREF(y);
+        }
+        r = y == NULL ? -1 : PyObject_RichCompareBool(x, y, op);
+        Py_DECREF(x);
+        Py_XDECREF(y);
+        if (r < 0)
+            goto error;
+        ((unsigned char *)mask->ob_item)[i] = (unsigned char)r;
+    }
+    return (PyObject *)mask;
+  error:
+    Py_DECREF(mask);
+    return NULL;
+}
+
+PyDoc_STRVAR(compare_doc,
+"compare(x, op) -> array\n\
+\n\
+Compare each item with x, using the operator op: one of '<', '<=', '==',\n\
+'!=', '>' and '>='.  x is a number or an array with the same typecode and\n\
+length, whose items are compared with the items at the same positions.\n\
+Return an array of type 'B' with 1 where the comparison is true and 0\n\
+elsewhere.");
+
+static PyObject *
+array_compare(arrayobject *self, PyObject *args)
+{
+    /* In the order of Py_LT to Py_GE */
+    static const char *ops[] = {"<", "<=", "==", "!=", ">", ">=", NULL};
+    char typecode = self->ob_descr->typecode;
+    Py_ssize_t i, n = Py_SIZE(self);
+    PyObject *arg;
+    const char *opname;
+    const char *operand = NULL;     /* items of an array operand */
+    struct arraydescr *descr;
+    arrayobject *mask;
+    unsigned char *m;
+    double fscalar = 0.0;
+#ifdef HAVE_LONG_LONG
+    PY_LONG_LONG lscalar = 0;
+#endif
+    int op, slow = 0;
+
+    if (!PyArg_ParseTuple(args, "Os:compare", &arg, &opname))
+        return NULL;
+    for (op = 0; ops[op] != NULL; op++) {
+        if (strcmp(opname, ops[op]) == 0)
+            break;
+    }
+    if (ops[op] == NULL) {
+        PyErr_Format(PyExc_ValueError,
+                     "unknown comparison operator '%.10s'", opname);
+        return NULL;
+    }
+    if (array_Check(arg)) {
+        if (array_check_operand(self, (arrayobject *)arg, "compare") < 0)
+            return NULL;
+        operand = ((arrayobject *)arg)->ob_item;
+    }
+    else if (typecode == 'c' || typecode == 'u')
+        slow = 1;
+    else if (typecode == 'f' || typecode == 'd') {
+        /* An int is only compared as a double if that's exact, that is
+           if it's within +/- 2**53 */
+        if (PyFloat_Check(arg))
+            fscalar = PyFloat_AS_DOUBLE(arg);
+        else if (PyInt_Check(arg) &&
+                 (fscalar = (double)PyInt_AS_LONG(arg),
+                  fscalar > -9007199254740992.0 &&
+                  fscalar < 9007199254740992.0))
+            ;
+        else
+            slow = 1;
+    }
+    else {
+#ifdef HAVE_LONG_LONG
+        int r = bulk_int_operand(self, arg, &lscalar);
+        if (r < 0)
+            return NULL;
+        slow = r == 0;
+#else
+        slow = 1;
+#endif
+    }
+
+    for (descr = descriptors; descr->typecode != 'B'; descr++)
+        ;
+    mask = (arrayobject *)newarrayobject(&Arraytype, n, descr);
+    if (mask == NULL)
+        return NULL;
+    if (slow)
+        return array_slow_compare(self, arg, op, mask);
+    m = (unsigned char *)mask->ob_item;
+
+#define CMP_EACH(YT) {                                          \
+        switch (op) {                                           \
+        case Py_LT: BULK_EACH(YT, m[i] = p[i] < y;) break;      \
+        case Py_LE: BULK_EACH(YT, m[i] = p[i] <= y;) break;     \
+        case Py_EQ: BULK_EACH(YT, m[i] = p[i] == y;) break;     \
+        case Py_NE: BULK_EACH(YT, m[i] = p[i] != y;) break;     \
+        case Py_GT: BULK_EACH(YT, m[i] = p[i] > y;) break;      \
+        case Py_GE: BULK_EACH(YT, m[i] = p[i] >= y;) break;     \
+        }                                                       \
+        break;                                                  \
+    }
+#define CMP_FLOAT(T) {                                          \
+        const T *p = (const T *)self->ob_item;                  \
+        const T *q = (const T *)operand;                        \
+        const double s = fscalar;                               \
+        CMP_EACH(double)                                        \
+    }
+#define CMP_INT(T, YT) {                                        \
+        const T *p = (const T *)self->ob_item;                  \
+        const T *q = (const T *)operand;                        \
+        const YT s = (YT)lscalar;                               \
+        CMP_EACH(YT)                                            \
+    }
+
+    switch (typecode) {
+    case 'f': CMP_FLOAT(float)
+    case 'd': CMP_FLOAT(double)
+#ifdef HAVE_LONG_LONG
+    case 'b': CMP_INT(signed char, PY_LONG_LONG)
+    case 'B': CMP_INT(unsigned char, PY_LONG_LONG)
+    case 'h': CMP_INT(short, PY_LONG_LONG)
+    case 'H': CMP_INT(unsigned short, PY_LONG_LONG)
+    case 'i': CMP_INT(int, PY_LONG_LONG)
+    case 'I': CMP_INT(unsigned int, PY_LONG_LONG)
+    case 'l': CMP_INT(long, PY_LONG_LONG)
+    case 'L': CMP_INT(unsigned long, unsigned PY_LONG_LONG)
+#endif
+    default:
+        return array_slow_compare(self, arg, op, mask);
+    }
+#undef CMP_INT
+#undef CMP_FLOAT
+#undef CMP_EACH
+    return (PyObject *)mask;
+}
+
+#undef BULK_EACH
+
 static PyMethodDef array_methods[] = {
+    {"add",             (PyCFunction)array_add,         METH_O,
+     add_doc},
     {"append",          (PyCFunction)array_append,      METH_O,
      append_doc},
     {"buffer_info", (PyCFunction)array_buffer_info, METH_NOARGS,
      buffer_info_doc},
     {"byteswap",        (PyCFunction)array_byteswap,    METH_NOARGS,
      byteswap_doc},
+    {"compare",         (PyCFunction)array_compare,     METH_VARARGS,
+     compare_doc},
     {"__copy__",        (PyCFunction)array_copy,        METH_NOARGS,
      copy_doc},
     {"count",           (PyCFunction)array_count,       METH_O,
      count_doc},
     {"__deepcopy__",(PyCFunction)array_copy,            METH_O,
      copy_doc},
+    {"dot",             (PyCFunction)array_dot,         METH_O,
+     dot_doc},
     {"extend",      (PyCFunction)array_extend,          METH_O,
      extend_doc},
     {"fromfile",        (PyCFunction)array_fromfile,    METH_VARARGS,
@@ -1576,6 +2663,12 @@ static PyMethodDef array_methods[] = {
      index_doc},
     {"insert",          (PyCFunction)array_insert,      METH_VARARGS,
      insert_doc},
+    {"max",             (PyCFunction)array_max,         METH_NOARGS,
+     max_doc},
+    {"min",             (PyCFunction)array_min,         METH_NOARGS,
+     min_doc},
+    {"mul",             (PyCFunction)array_mul,         METH_O,
+     mul_doc},
     {"pop",             (PyCFunction)array_pop,         METH_VARARGS,
      pop_doc},
     {"read",            (PyCFunction)array_fromfile_as_read,    METH_VARARGS,
@@ -1588,6 +2681,8 @@ static PyMethodDef array_methods[] = {
      reverse_doc},
 /*      {"sort",        (PyCFunction)array_sort,        METH_VARARGS,
     sort_doc},*/
+    {"sum",             (PyCFunction)array_sum,         METH_NOARGS,
+     sum_doc},
     {"tofile",          (PyCFunction)array_tofile,      METH_O,
      tofile_doc},
     {"tolist",          (PyCFunction)array_tolist,      METH_NOARGS,
@@ -1720,6 +2815,8 @@ array_ass_subscr(arrayobject* self, PyObject* item, PyObject* value)
             step = 1;
             slicelength = 1;
         }
+        else if (array_unshare(self) < 0)
+            return -1;
         else
             return (*self->ob_descr->setitem)(self, i, value);
     }
@@ -1768,7 +2865,11 @@ array_ass_subscr(arrayobject* self, PyObject* item, PyObject* value)
     if ((step > 0 && stop < start) ||
         (step < 0 && stop > start))
         stop = start;
+    if ((slicelength > 0 || needed > 0) && array_unshare(self) < 0)
+        return -1;
     if (step == 1) {
+        if (slicelength != needed && array_check_exports(self) < 0)
+            return -1;
         if (slicelength > needed) {
             memmove(self->ob_item + (start + needed) * itemsize,
                 self->ob_item + stop * itemsize,
@@ -1795,6 +2896,9 @@ array_ass_subscr(arrayobject* self, PyObject* item, PyObject* value)
         size_t cur;
         Py_ssize_t i;
 
+        if (slicelength > 0 && array_check_exports(self) < 0)
+            return -1;
+
         if (step < 0) {
             stop = start + 1;
             start = stop + step * (slicelength - 1) - 1;
@@ -1870,6 +2974,8 @@ array_buffer_getwritebuf(arrayobject *self, Py_ssize_t index, const void **ptr)
                         "Accessing non-existent array segment");
         return -1;
     }
+    if (array_unshare(self) < 0)
+        return -1;
     *ptr = (void *)self->ob_item;
     if (*ptr == NULL)
         *ptr = emptybuf;
@@ -1884,6 +2990,118 @@ array_buffer_getsegcount(arrayobject *self, Py_ssize_t *lenp)
     return 1;
 }
 
+/* Buffers exported through the new buffer interface are owned by one of
+   these rather than by the array, so that the array can count its exports
+   without a bf_releasebuffer slot (which would make "s#" and friends refuse
+   arrays).  The array may not be resized while any of them is alive. */
+
+typedef struct {
+    PyObject_HEAD
+    arrayobject *ao;
+} arrayexportobject;
+
+static PyTypeObject ArrayExport_Type;
+
+static int
+array_buffer_getbuf(arrayobject *self, Py_buffer *view, int flags)
+{
+    arrayexportobject *export;
+
+    if (view == NULL) {
+        PyErr_SetString(PyExc_BufferError,
+            "array_buffer_getbuf: view==NULL argument is obsolete");
+        return -1;
+    }
+    /* The memory of a shared buffer is only exported read-only */
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE &&
+        array_unshare(self) < 0)
+        return -1;
+    export = PyObject_GC_New(arrayexportobject, &ArrayExport_Type);
+    if (export == NULL)
+        return -1;
+    Py_INCREF(self);
+    export->ao = self;
+    self->ob_exports++;
+    PyObject_GC_Track(export);
+
+    view->obj = (PyObject *)export;
+    view->buf = self->ob_item != NULL ? self->ob_item : (void *)emptybuf;
+    view->len = Py_SIZE(self) * self->ob_descr->itemsize;
+    view->readonly = self->ob_shared != NULL;
+    view->itemsize = self->ob_descr->itemsize;
+    view->format = NULL;
+    if ((flags & PyBUF_FORMAT) == PyBUF_FORMAT)
+        view->format = self->ob_descr->formats;
+    view->ndim = 1;
+    view->shape = NULL;
+    if ((flags & PyBUF_ND) == PyBUF_ND)
+        view->shape = &Py_SIZE(self);
+    view->strides = NULL;
+    if ((flags & PyBUF_STRIDES) == PyBUF_STRIDES)
+        view->strides = &view->itemsize;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static int
+arrayexport_getbuf(arrayexportobject *export, Py_buffer *view, int flags)
+{
+    return array_buffer_getbuf(export->ao, view, flags);
+}
+
+static void
+arrayexport_dealloc(arrayexportobject *export)
+{
+    PyObject_GC_UnTrack(export);
+    export->ao->ob_exports--;
+    Py_DECREF(export->ao);
+    PyObject_GC_Del(export);
+}
+
+static int
+arrayexport_traverse(arrayexportobject *export, visitproc visit, void *arg)
+{
+    Py_VISIT(export->ao);
+    return 0;
+}
+
+static PyBufferProcs arrayexport_as_buffer = {
+    0,                                          /* bf_getreadbuffer */
+    0,                                          /* bf_getwritebuffer */
+    0,                                          /* bf_getsegcount */
+    0,                                          /* bf_getcharbuffer */
+    (getbufferproc)arrayexport_getbuf,          /* bf_getbuffer */
+    0,                                          /* bf_releasebuffer */
+};
+
+static PyTypeObject ArrayExport_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "array.export",                         /* tp_name */
+    sizeof(arrayexportobject),              /* tp_basicsize */
+    0,                                      /* tp_itemsize */
+    /* methods */
+    (destructor)arrayexport_dealloc,        /* tp_dealloc */
+    0,                                      /* tp_print */
+    0,                                      /* tp_getattr */
+    0,                                      /* tp_setattr */
+    0,                                      /* tp_compare */
+    0,                                      /* tp_repr */
+    0,                                      /* tp_as_number */
+    0,                                      /* tp_as_sequence */
+    0,                                      /* tp_as_mapping */
+    0,                                      /* tp_hash */
+    0,                                      /* tp_call */
+    0,                                      /* tp_str */
+    PyObject_GenericGetAttr,                /* tp_getattro */
+    0,                                      /* tp_setattro */
+    &arrayexport_as_buffer,                 /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC |
+        Py_TPFLAGS_HAVE_NEWBUFFER,          /* tp_flags */
+    0,                                      /* tp_doc */
+    (traverseproc)arrayexport_traverse,     /* tp_traverse */
+};
+
 static PySequenceMethods array_as_sequence = {
     (lenfunc)array_length,                      /*sq_length*/
     (binaryfunc)array_concat,               /*sq_concat*/
@@ -1902,6 +3120,8 @@ static PyBufferProcs array_as_buffer = {
     (writebufferproc)array_buffer_getwritebuf,
     (segcountproc)array_buffer_getsegcount,
     NULL,
+    (getbufferproc)array_buffer_getbuf,
+    NULL,
 };
 
 static PyObject *
@@ -2037,6 +3257,10 @@ is a single character.  The following type codes are defined:\n\
 The constructor is:\n\
 \n\
 array(typecode [, initializer]) -- create a new array\n\
+\n\
+and arrays sharing the memory of a buffer are made by:\n\
+\n\
+frombuffer(typecode, buffer) -- create an array from a buffer\n\
 ");
 
 PyDoc_STRVAR(arraytype_doc,
@@ -2051,20 +3275,27 @@ the type of objects stored in them is constrained.\n\
 \n\
 Methods:\n\
 \n\
+add() -- add a number or an array to the items, in place\n\
 append() -- append a new item to the end of the array\n\
 buffer_info() -- return information giving the current memory info\n\
 byteswap() -- byteswap all the items of the array\n\
+compare() -- compare the items with a value or an array, giving a mask\n\
 count() -- return number of occurrences of an object\n\
+dot() -- return the sum of the products of the items of two arrays\n\
 extend() -- extend array by appending multiple elements from an iterable\n\
 fromfile() -- read items from a file object\n\
 fromlist() -- append items from the list\n\
 fromstring() -- append items from the string\n\
 index() -- return index of first occurrence of an object\n\
 insert() -- insert a new item into the array at a provided position\n\
+max() -- return the largest item\n\
+min() -- return the smallest item\n\
+mul() -- multiply the items by a number or an array, in place\n\
 pop() -- remove and return item (default last)\n\
 read() -- DEPRECATED, use fromfile()\n\
 remove() -- remove first occurrence of an object\n\
 reverse() -- reverse the order of the items in the array\n\
+sum() -- return the sum of the items\n\
 tofile() -- write all items to a file object\n\
 tolist() -- return the array converted to an ordinary list\n\
 tostring() -- return the array converted to a string\n\
@@ -2098,7 +3329,8 @@ static PyTypeObject Arraytype = {
     PyObject_GenericGetAttr,                    /* tp_getattro */
     0,                                          /* tp_setattro */
     &array_as_buffer,                           /* tp_as_buffer*/
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_WEAKREFS,  /* tp_flags */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_WEAKREFS |
+        Py_TPFLAGS_HAVE_NEWBUFFER,                  /* tp_flags */
     arraytype_doc,                              /* tp_doc */
     0,                                          /* tp_traverse */
     0,                                          /* tp_clear */
@@ -2215,8 +3447,80 @@ static PyTypeObject PyArrayIter_Type = {
 
 /*********************** Install Module **************************/
 
-/* No functions in array module. */
+PyDoc_STRVAR(frombuffer_doc,
+"frombuffer(typecode, buffer) -> array\n\
+\n\
+Return a new array whose items are the contents of buffer, such as a\n\
+string or an mmap, as machine values.  If the buffer is read-only, the\n\
+array shares its memory without copying it until the array is first\n\
+modified, and the buffer can't be resized or closed meanwhile.  The items\n\
+of a writable buffer are copied.");
+
+static PyObject *
+a_frombuffer(PyObject *module, PyObject *args)
+{
+    char c;
+    PyObject *obj;
+    struct arraydescr *descr;
+    Py_buffer *view;
+    arrayobject *a;
+    Py_ssize_t n;
+
+    if (!PyArg_ParseTuple(args, "cO:frombuffer", &c, &obj))
+        return NULL;
+    for (descr = descriptors; descr->typecode != '\0'; descr++)
+        if (descr->typecode == c)
+            break;
+    if (descr->typecode == '\0') {
+        PyErr_SetString(PyExc_ValueError,
+            "bad typecode (must be c, b, B, u, h, H, i, I, l, L, f or d)");
+        return NULL;
+    }
+    view = PyMem_NEW(Py_buffer, 1);
+    if (view == NULL)
+        return PyErr_NoMemory();
+    if (PyObject_GetBuffer(obj, view, PyBUF_SIMPLE) < 0) {
+        PyMem_DEL(view);
+        return NULL;
+    }
+    if (view->len % descr->itemsize != 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "buffer length not a multiple of item size");
+        goto error;
+    }
+    n = view->len / descr->itemsize;
+    /* Copy if there is nothing to share, if the items wouldn't be aligned
+       in the buffer's memory, or if the buffer is writable: its owner
+       could change the items under the array */
+    if (n == 0 || (Py_uintptr_t)view->buf % descr->itemsize != 0 ||
+        !view->readonly) {
+        a = (arrayobject *)newarrayobject(&Arraytype, n, descr);
+        if (a == NULL)
+            goto error;
+        if (n > 0)
+            memcpy(a->ob_item, view->buf, view->len);
+        PyBuffer_Release(view);
+        PyMem_DEL(view);
+        return (PyObject *)a;
+    }
+    a = (arrayobject *)newarrayobject(&Arraytype, 0, descr);
+    if (a == NULL)
+        goto error;
+    a->ob_item = view->buf;
+    Py_SIZE(a) = n;
+    a->allocated = n;
+    a->ob_shared = view;
+    return (PyObject *)a;
+
+  error:
+    PyBuffer_Release(view);
+    PyMem_DEL(view);
+    return NULL;
+}
+
 static PyMethodDef a_methods[] = {
+    {"frombuffer",      a_frombuffer,           METH_VARARGS,
+     frombuffer_doc},
     {NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
@@ -2228,6 +3532,7 @@ initarray(void)
 
     Arraytype.ob_type = &PyType_Type;
     PyArrayIter_Type.ob_type = &PyType_Type;
+    ArrayExport_Type.ob_type = &PyType_Type;
     m = Py_InitModule3("array", a_methods, module_doc);
     if (m == NULL)
         return;
@@ -0,0 +1,99 @@
+/* Common code for use by all hashlib related modules. */
+
+#ifdef WITH_THREAD
+#include "pythread.h"
+    #define ENTER_HASHLIB(obj) \
+        if ((obj)->lock) { \
+            if (!PyThread_acquire_lock((obj)->lock, 0)) { \
+                Py_BEGIN_ALLOW_THREADS \
+                PyThread_acquire_lock((obj)->lock, 1); \
+                Py_END_ALLOW_THREADS \
+            } \
+        }
+    #define LEAVE_HASHLIB(obj) \
+        if ((obj)->lock) { \
+            PyThread_release_lock((obj)->lock); \
+        }
+#else
+    #define ENTER_HASHLIB(obj)
+    #define LEAVE_HASHLIB(obj)
+#endif
+
+/* Updates of at least this many bytes release the GIL.  The hash object
+ * then gets a lock, which it keeps, to serialize the threads sharing it.
+ * TODO(gps): We should probably make this a module or object attribute
+ * to allow the user to optimize based on the platform they're using. */
+#define HASHLIB_GIL_MINSIZE 2048
+
+/* Helpers for the digest_many() methods, which hash each buffer of a
+ * sequence on top of a copy of the object's state, with the GIL released
+ * once for the whole batch. */
+
+/* Get a view of each item of the sequence fast (from PySequence_Fast).
+ * Returns a PyMem array of *n views, to be given back to
+ * hashlib_release_views(), and sets *total to the sum of their lengths.
+ * Returns NULL with an exception set on error. */
+static Py_buffer *
+hashlib_get_views(PyObject *fast, Py_ssize_t *n, Py_ssize_t *total)
+{
+    Py_ssize_t i, len = PySequence_Fast_GET_SIZE(fast);
+    Py_buffer *views;
+
+    views = PyMem_New(Py_buffer, len > 0 ? len : 1);
+    if (views == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    *total = 0;
+    for (i = 0; i < len; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        if (!PyArg_Parse(item, "s*;digest_many() needs a sequence of buffers",
+                         &views[i])) {
+            while (--i >= 0)
+                PyBuffer_Release(&views[i]);
+            PyMem_Free(views);
+            return NULL;
+        }
+        if (*total <= PY_SSIZE_T_MAX - views[i].len)
+            *total += views[i].len;
+    }
+    *n = len;
+    return views;
+}
+
+static void
+hashlib_release_views(Py_buffer *views, Py_ssize_t n)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < n; i++)
+        PyBuffer_Release(&views[i]);
+    PyMem_Free(views);
+}
+
+/* Returns a list of n new strings of the given size, for the digests.
+ * Nothing else refers to them, so they can be filled without the GIL. */
+static PyObject *
+hashlib_new_digests(Py_ssize_t n, Py_ssize_t size)
+{
+    PyObject *list = PyList_New(n);
+    Py_ssize_t i;
+
+    if (list == NULL)
+        return NULL;
+    for (i = 0; i < n; i++) {
+        PyObject *digest = PyString_FromStringAndSize(NULL, size);
+        if (digest == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, digest);
+    }
+    return list;
+}
+
+PyDoc_STRVAR(hashlib_digest_many__doc__,
+"digest_many(buffers) -> list of digests\n\
+\n\
+Return, for each of the buffers, the digest of the data hashed so far\n\
+followed by that buffer.  The hash object itself is not updated.");
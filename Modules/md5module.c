@@ -12,10 +12,14 @@
 #include "Python.h"
 #include "structmember.h"
 #include "md5.h"
+#include "hashlib.h"
 
 typedef struct {
     PyObject_HEAD
     md5_state_t         md5;            /* the context holder */
+#ifdef WITH_THREAD
+    PyThread_type_lock  lock;
+#endif
 } md5object;
 
 static PyTypeObject MD5type;
@@ -32,15 +36,36 @@ newmd5object(void)
         return NULL;
 
     md5_init(&md5p->md5);       /* actual initialisation */
+#ifdef WITH_THREAD
+    md5p->lock = NULL;
+#endif
     return md5p;
 }
 
+/* md5_append() for lengths which may not fit in an unsigned int */
+static void
+md5_hash(md5_state_t *pms, const void *vp, Py_ssize_t len)
+{
+    const md5_byte_t *cp = (const md5_byte_t *)vp;
+
+    while (len > 0) {
+        unsigned int process = len > INT_MAX ? INT_MAX : (unsigned int)len;
+        md5_append(pms, cp, process);
+        len -= process;
+        cp += process;
+    }
+}
+
 
 /* MD5 methods */
 
 static void
 md5_dealloc(md5object *md5p)
 {
+#ifdef WITH_THREAD
+    if (md5p->lock != NULL)
+        PyThread_free_lock(md5p->lock);
+#endif
     PyObject_Del(md5p);
 }
 
@@ -55,8 +80,24 @@ md5_update(md5object *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s*:update", &view))
         return NULL;
 
-    md5_append(&self->md5, (unsigned char*)view.buf,
-               Py_SAFE_DOWNCAST(view.len, Py_ssize_t, unsigned int));
+#ifdef WITH_THREAD
+    if (self->lock == NULL && view.len >= HASHLIB_GIL_MINSIZE) {
+        self->lock = PyThread_allocate_lock();
+        /* fail? lock = NULL and we fail over to non-threaded code. */
+    }
+
+    if (self->lock != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        md5_hash(&self->md5, view.buf, view.len);
+        PyThread_release_lock(self->lock);
+        Py_END_ALLOW_THREADS
+    }
+    else
+#endif
+    {
+        md5_hash(&self->md5, view.buf, view.len);
+    }
 
     PyBuffer_Release(&view);
     Py_RETURN_NONE;
@@ -77,7 +118,9 @@ md5_digest(md5object *self)
     unsigned char aDigest[16];
 
     /* make a temporary copy, and perform the final */
+    ENTER_HASHLIB(self);
     mdContext = self->md5;
+    LEAVE_HASHLIB(self);
     md5_finish(&mdContext, aDigest);
 
     return PyString_FromStringAndSize((char *)aDigest, 16);
@@ -100,7 +143,9 @@ md5_hexdigest(md5object *self)
     int i, j;
 
     /* make a temporary copy, and perform the final */
+    ENTER_HASHLIB(self);
     mdContext = self->md5;
+    LEAVE_HASHLIB(self);
     md5_finish(&mdContext, digest);
 
     /* Make hex version of the digest */
@@ -131,7 +176,9 @@ md5_copy(md5object *self)
     if ((md5p = newmd5object()) == NULL)
         return NULL;
 
+    ENTER_HASHLIB(self);
     md5p->md5 = self->md5;
+    LEAVE_HASHLIB(self);
 
     return (PyObject *)md5p;
 }
@@ -142,11 +189,52 @@ PyDoc_STRVAR(copy_doc,
 Return a copy (``clone'') of the md5 object.");
 
 
+static PyObject *
+md5_digest_many(md5object *self, PyObject *buffers)
+{
+    PyObject *fast, *result;
+    Py_buffer *views;
+    Py_ssize_t n, i, total;
+    md5_state_t base, mdContext;
+    PyThreadState *_save = NULL;
+
+    fast = PySequence_Fast(buffers, "digest_many() needs a sequence");
+    if (fast == NULL)
+        return NULL;
+    views = hashlib_get_views(fast, &n, &total);
+    if (views == NULL) {
+        Py_DECREF(fast);
+        return NULL;
+    }
+    result = hashlib_new_digests(n, 16);
+    if (result != NULL) {
+        ENTER_HASHLIB(self);
+        base = self->md5;
+        LEAVE_HASHLIB(self);
+
+        if (total >= HASHLIB_GIL_MINSIZE)
+            _save = PyEval_SaveThread();
+        for (i = 0; i < n; i++) {
+            mdContext = base;
+            md5_hash(&mdContext, views[i].buf, views[i].len);
+            md5_finish(&mdContext, (md5_byte_t *)
+                       PyString_AS_STRING(PyList_GET_ITEM(result, i)));
+        }
+        if (_save != NULL)
+            PyEval_RestoreThread(_save);
+    }
+    hashlib_release_views(views, n);
+    Py_DECREF(fast);
+    return result;
+}
+
 static PyMethodDef md5_methods[] = {
     {"update",    (PyCFunction)md5_update,    METH_VARARGS, update_doc},
     {"digest",    (PyCFunction)md5_digest,    METH_NOARGS,  digest_doc},
     {"hexdigest", (PyCFunction)md5_hexdigest, METH_NOARGS,  hexdigest_doc},
     {"copy",      (PyCFunction)md5_copy,      METH_NOARGS,  copy_doc},
+    {"digest_many", (PyCFunction)md5_digest_many, METH_O,
+     hashlib_digest_many__doc__},
     {NULL, NULL}                             /* sentinel */
 };
 
@@ -218,7 +306,9 @@ Methods:\n\
 update() -- updates the current digest with an additional string\n\
 digest() -- return the current digest value\n\
 hexdigest() -- return the current digest as a string of hexadecimal digits\n\
-copy() -- return a copy of the current md5 object");
+copy() -- return a copy of the current md5 object\n\
+digest_many() -- return the digests of the current data followed by\n\
+                 each of a sequence of strings");
 
 static PyTypeObject MD5type = {
     PyVarObject_HEAD_INIT(NULL, 0)
@@ -271,9 +361,13 @@ MD5_new(PyObject *self, PyObject *args)
         return NULL;
     }
 
-    if (view.len > 0) {
-        md5_append(&md5p->md5, (unsigned char*)view.buf,
-               Py_SAFE_DOWNCAST(view.len, Py_ssize_t, unsigned int));
+    if (view.len >= HASHLIB_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        md5_hash(&md5p->md5, view.buf, view.len);
+        Py_END_ALLOW_THREADS
+    }
+    else if (view.len > 0) {
+        md5_hash(&md5p->md5, view.buf, view.len);
     }
     PyBuffer_Release(&view);
 
@@ -103,8 +103,31 @@ typedef struct {
 #endif
 
     access_mode access;
+    int         busy;   /* threads using the data without the GIL */
+    Py_ssize_t  exports; /* number of exported buffers */
 } mmap_object;
 
+/* Searches of at least this many bytes, madvise() and prefetch() release
+   the GIL.  Meanwhile close() and resize() refuse to unmap the data. */
+#define MMAP_GIL_MINSIZE (64 * 1024)
+
+static int
+check_not_busy(mmap_object *self)
+{
+    if (self->busy) {
+        PyErr_SetString(PyExc_BufferError,
+                        "mmap is in use by another thread");
+        return 0;
+    }
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError,
+                        "cannot close or resize an mmap that is "
+                        "exporting buffers");
+        return 0;
+    }
+    return 1;
+}
+
 
 static void
 mmap_object_dealloc(mmap_object *m_obj)
@@ -135,6 +158,8 @@ mmap_object_dealloc(mmap_object *m_obj)
 static PyObject *
 mmap_close_method(mmap_object *self, PyObject *unused)
 {
+    if (!check_not_busy(self))
+        return NULL;
 #ifdef MS_WINDOWS
     /* For each resource we maintain, we need to check
        the value is valid, and if so, free the resource
@@ -258,6 +283,26 @@ mmap_read_method(mmap_object *self,
     return result;
 }
 
+/* Returns the offset of needle in data[0:size], or -1.  Only looks at the
+   bytes in that range, so it can run without the GIL. */
+static Py_ssize_t
+mmap_search(const char *data, Py_ssize_t size,
+            const char *needle, Py_ssize_t len, int reverse)
+{
+    const char *p, *end_p = data + size;
+    int sign = reverse ? -1 : 1;
+
+    for (p = (reverse ? end_p - len : data);
+         (p >= data) && (p + len <= end_p); p += sign) {
+        Py_ssize_t i;
+        for (i = 0; i < len && needle[i] == p[i]; ++i)
+            /* nothing */;
+        if (i == len)
+            return p - data;
+    }
+    return -1;
+}
+
 static PyObject *
 mmap_gfind(mmap_object *self,
            PyObject *args,
@@ -265,17 +310,14 @@ mmap_gfind(mmap_object *self,
 {
     Py_ssize_t start = self->pos;
     Py_ssize_t end = self->size;
-    const char *needle;
-    Py_ssize_t len;
+    Py_buffer needle;
+    Py_ssize_t found;
 
     CHECK_VALID(NULL);
-    if (!PyArg_ParseTuple(args, reverse ? "s#|nn:rfind" : "s#|nn:find",
-                          &needle, &len, &start, &end)) {
+    if (!PyArg_ParseTuple(args, reverse ? "s*|nn:rfind" : "s*|nn:find",
+                          &needle, &start, &end)) {
         return NULL;
     } else {
-        const char *p, *start_p, *end_p;
-        int sign = reverse ? -1 : 1;
-
         if (start < 0)
             start += self->size;
         if (start < 0)
@@ -290,19 +332,21 @@ mmap_gfind(mmap_object *self,
         else if ((size_t)end > self->size)
             end = self->size;
 
-        start_p = self->data + start;
-        end_p = self->data + end;
-
-        for (p = (reverse ? end_p - len : start_p);
-             (p >= start_p) && (p + len <= end_p); p += sign) {
-            Py_ssize_t i;
-            for (i = 0; i < len && needle[i] == p[i]; ++i)
-                /* nothing */;
-            if (i == len) {
-                return PyInt_FromSsize_t(p - self->data);
-            }
+        if (end - start >= MMAP_GIL_MINSIZE) {
+            self->busy++;
+            Py_BEGIN_ALLOW_THREADS
+            found = mmap_search(self->data + start, end - start,
+                                needle.buf, needle.len, reverse);
+            Py_END_ALLOW_THREADS
+            self->busy--;
         }
-        return PyInt_FromLong(-1);
+        else
+            found = mmap_search(self->data + start, end - start,
+                                needle.buf, needle.len, reverse);
+        PyBuffer_Release(&needle);
+        if (found < 0)
+            return PyInt_FromLong(-1);
+        return PyInt_FromSsize_t(start + found);
     }
 }
 
@@ -444,7 +488,7 @@ mmap_resize_method(mmap_object *self,
     Py_ssize_t new_size;
     CHECK_VALID(NULL);
     if (!PyArg_ParseTuple(args, "n:resize", &new_size) ||
-        !is_resizeable(self)) {
+        !is_resizeable(self) || !check_not_busy(self)) {
         return NULL;
 #ifdef MS_WINDOWS
     } else {
@@ -617,6 +661,94 @@ mmap_seek_method(mmap_object *self, PyObject *args)
     return NULL;
 }
 
+/* Checks that data[start:start + *length] is a valid area, clipping the
+   length to the end of the map. */
+static int
+check_area(mmap_object *self, Py_ssize_t start, Py_ssize_t *length)
+{
+    if (start < 0 || (size_t)start > self->size) {
+        PyErr_SetString(PyExc_ValueError, "start out of range");
+        return 0;
+    }
+    if (*length < 0) {
+        PyErr_SetString(PyExc_ValueError, "length must be non-negative");
+        return 0;
+    }
+    if ((size_t)*length > self->size - start)
+        *length = self->size - start;
+    return 1;
+}
+
+#ifdef HAVE_MADVISE
+static PyObject *
+mmap_madvise_method(mmap_object *self, PyObject *args)
+{
+    int option, result;
+    Py_ssize_t start = 0, length = self->size;
+
+    CHECK_VALID(NULL);
+    if (!PyArg_ParseTuple(args, "i|nn:madvise", &option, &start, &length) ||
+        !check_area(self, start, &length))
+        return NULL;
+    if (length == 0) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    self->busy++;
+    Py_BEGIN_ALLOW_THREADS
+    result = madvise(self->data + start, length, option);
+    Py_END_ALLOW_THREADS
+    self->busy--;
+    if (result == -1) {
+        PyErr_SetFromErrno(mmap_module_error);
+        return NULL;
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+#endif /* HAVE_MADVISE */
+
+/* Faults in the pages under data[0:length], after asking the kernel to
+   read them ahead where it can.  Used without the GIL. */
+static void
+mmap_touch_pages(const char *data, size_t length, size_t pagesize)
+{
+    const char *p, *end = data + length;
+    volatile char sink;
+
+    if (length == 0)
+        return;
+#if defined(HAVE_MADVISE) && defined(MADV_WILLNEED)
+    {
+        const char *page = data - ((Py_uintptr_t)data % pagesize);
+        (void)madvise((void *)page, end - page, MADV_WILLNEED);
+    }
+#endif
+    for (p = data; p < end; p += pagesize)
+        sink = *p;
+    /* data need not start on a page boundary, so the steps may miss it */
+    sink = end[-1];
+    (void)sink;
+}
+
+static PyObject *
+mmap_prefetch_method(mmap_object *self, PyObject *args)
+{
+    Py_ssize_t start = 0, length = self->size;
+
+    CHECK_VALID(NULL);
+    if (!PyArg_ParseTuple(args, "|nn:prefetch", &start, &length) ||
+        !check_area(self, start, &length))
+        return NULL;
+    self->busy++;
+    Py_BEGIN_ALLOW_THREADS
+    mmap_touch_pages(self->data + start, length, my_getpagesize());
+    Py_END_ALLOW_THREADS
+    self->busy--;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject *
 mmap_move_method(mmap_object *self, PyObject *args)
 {
@@ -645,7 +777,11 @@ static struct PyMethodDef mmap_object_methods[] = {
     {"find",            (PyCFunction) mmap_find_method,         METH_VARARGS},
     {"rfind",           (PyCFunction) mmap_rfind_method,        METH_VARARGS},
     {"flush",           (PyCFunction) mmap_flush_method,        METH_VARARGS},
+#ifdef HAVE_MADVISE
+    {"madvise",         (PyCFunction) mmap_madvise_method,      METH_VARARGS},
+#endif
     {"move",            (PyCFunction) mmap_move_method,         METH_VARARGS},
+    {"prefetch",        (PyCFunction) mmap_prefetch_method,     METH_VARARGS},
     {"read",            (PyCFunction) mmap_read_method,         METH_VARARGS},
     {"read_byte",       (PyCFunction) mmap_read_byte_method,    METH_NOARGS},
     {"readline",        (PyCFunction) mmap_read_line_method,    METH_NOARGS},
@@ -709,6 +845,106 @@ mmap_buffer_getcharbuffer(mmap_object *self, Py_ssize_t index, const void **ptr)
     return self->size;
 }
 
+/* Buffers exported through the new buffer interface are owned by one of
+   these, which keeps the mmap from being closed or resized while they are
+   alive.  The mmap itself has no bf_releasebuffer, since that would make
+   "s#" and friends refuse it. */
+
+typedef struct {
+    PyObject_HEAD
+    mmap_object *mmap;
+} mmap_export_object;
+
+static PyTypeObject mmap_export_type;
+
+static int
+mmap_buffer_getbuf(mmap_object *self, Py_buffer *view, int flags)
+{
+    mmap_export_object *export;
+
+    CHECK_VALID(-1);
+    if (view == NULL) {
+        PyErr_SetString(PyExc_BufferError,
+            "mmap_buffer_getbuf: view==NULL argument is obsolete");
+        return -1;
+    }
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE &&
+        self->access == ACCESS_READ) {
+        PyErr_SetString(PyExc_BufferError, "mmap is not writable");
+        return -1;
+    }
+    export = PyObject_GC_New(mmap_export_object, &mmap_export_type);
+    if (export == NULL)
+        return -1;
+    Py_INCREF(self);
+    export->mmap = self;
+    self->exports++;
+    PyObject_GC_Track(export);
+
+    /* The view takes its own reference to the export. */
+    PyBuffer_FillInfo(view, (PyObject *)export, self->data, self->size,
+                      self->access == ACCESS_READ, flags);
+    Py_DECREF(export);
+    return 0;
+}
+
+static int
+mmap_export_getbuf(mmap_export_object *export, Py_buffer *view, int flags)
+{
+    return mmap_buffer_getbuf(export->mmap, view, flags);
+}
+
+static void
+mmap_export_dealloc(mmap_export_object *export)
+{
+    PyObject_GC_UnTrack(export);
+    export->mmap->exports--;
+    Py_DECREF(export->mmap);
+    PyObject_GC_Del(export);
+}
+
+static int
+mmap_export_traverse(mmap_export_object *export, visitproc visit, void *arg)
+{
+    Py_VISIT(export->mmap);
+    return 0;
+}
+
+static PyBufferProcs mmap_export_as_buffer = {
+    0,                                          /* bf_getreadbuffer */
+    0,                                          /* bf_getwritebuffer */
+    0,                                          /* bf_getsegcount */
+    0,                                          /* bf_getcharbuffer */
+    (getbufferproc)mmap_export_getbuf,          /* bf_getbuffer */
+    0,                                          /* bf_releasebuffer */
+};
+
+static PyTypeObject mmap_export_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mmap.export",                              /* tp_name */
+    sizeof(mmap_export_object),                 /* tp_basicsize */
+    0,                                          /* tp_itemsize */
+    (destructor)mmap_export_dealloc,            /* tp_dealloc */
+    0,                                          /* tp_print */
+    0,                                          /* tp_getattr */
+    0,                                          /* tp_setattr */
+    0,                                          /* tp_compare */
+    0,                                          /* tp_repr */
+    0,                                          /* tp_as_number */
+    0,                                          /* tp_as_sequence */
+    0,                                          /* tp_as_mapping */
+    0,                                          /* tp_hash */
+    0,                                          /* tp_call */
+    0,                                          /* tp_str */
+    0,                                          /* tp_getattro */
+    0,                                          /* tp_setattro */
+    &mmap_export_as_buffer,                     /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC |
+        Py_TPFLAGS_HAVE_NEWBUFFER,              /* tp_flags */
+    0,                                          /* tp_doc */
+    (traverseproc)mmap_export_traverse,         /* tp_traverse */
+};
+
 static Py_ssize_t
 mmap_length(mmap_object *self)
 {
@@ -994,6 +1230,8 @@ static PyBufferProcs mmap_as_buffer = {
     (writebufferproc)mmap_buffer_getwritebuf,
     (segcountproc)mmap_buffer_getsegcount,
     (charbufferproc)mmap_buffer_getcharbuffer,
+    (getbufferproc)mmap_buffer_getbuf,
+    0,
 };
 
 static PyObject *
@@ -1044,7 +1282,8 @@ static PyTypeObject mmap_object_type = {
     PyObject_GenericGetAttr,                    /*tp_getattro*/
     0,                                          /*tp_setattro*/
     &mmap_as_buffer,                            /*tp_as_buffer*/
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GETCHARBUFFER,                   /*tp_flags*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GETCHARBUFFER |
+        Py_TPFLAGS_HAVE_NEWBUFFER,              /*tp_flags*/
     mmap_doc,                                   /*tp_doc*/
     0,                                          /* tp_traverse */
     0,                                          /* tp_clear */
@@ -1104,6 +1343,7 @@ new_mmap_object(PyTypeObject *type, PyObject *args, PyObject *kwdict)
     PyObject *map_size_obj = NULL, *offset_obj = NULL;
     Py_ssize_t map_size, offset;
     int fd, flags = MAP_SHARED, prot = PROT_WRITE | PROT_READ;
+    int extra_flags;
     int devzero = -1;
     int access = (int)ACCESS_DEFAULT;
     static char *keywords[] = {"fileno", "length",
@@ -1121,21 +1361,25 @@ new_mmap_object(PyTypeObject *type, PyObject *args, PyObject *kwdict)
     if (offset < 0)
         return NULL;
 
+    /* access chooses between MAP_SHARED and MAP_PRIVATE, but flags
+       such as MAP_POPULATE can still be given with it */
+    extra_flags = flags & ~(MAP_SHARED | MAP_PRIVATE);
     if ((access != (int)ACCESS_DEFAULT) &&
-        ((flags != MAP_SHARED) || (prot != (PROT_WRITE | PROT_READ))))
+        ((flags != (MAP_SHARED | extra_flags)) ||
+         (prot != (PROT_WRITE | PROT_READ))))
         return PyErr_Format(PyExc_ValueError,
                             "mmap can't specify both access and flags, prot.");
     switch ((access_mode)access) {
     case ACCESS_READ:
-        flags = MAP_SHARED;
+        flags = MAP_SHARED | extra_flags;
         prot = PROT_READ;
         break;
     case ACCESS_WRITE:
-        flags = MAP_SHARED;
+        flags = MAP_SHARED | extra_flags;
         prot = PROT_READ | PROT_WRITE;
         break;
     case ACCESS_COPY:
-        flags = MAP_PRIVATE;
+        flags = MAP_PRIVATE | extra_flags;
         prot = PROT_READ | PROT_WRITE;
         break;
     case ACCESS_DEFAULT:
@@ -1422,6 +1666,8 @@ initmmap(void)
 
     if (PyType_Ready(&mmap_object_type) < 0)
         return;
+    if (PyType_Ready(&mmap_export_type) < 0)
+        return;
 
     module = Py_InitModule("mmap", NULL);
     if (module == NULL)
@@ -1461,6 +1707,53 @@ initmmap(void)
     setint(dict, "MAP_ANON", MAP_ANONYMOUS);
     setint(dict, "MAP_ANONYMOUS", MAP_ANONYMOUS);
 #endif
+#ifdef MAP_POPULATE
+    setint(dict, "MAP_POPULATE", MAP_POPULATE);
+#endif
+#ifdef MAP_HUGETLB
+    setint(dict, "MAP_HUGETLB", MAP_HUGETLB);
+#endif
+#ifdef MAP_NORESERVE
+    setint(dict, "MAP_NORESERVE", MAP_NORESERVE);
+#endif
+
+#ifdef HAVE_MADVISE
+    setint(dict, "MADV_NORMAL", MADV_NORMAL);
+    setint(dict, "MADV_RANDOM", MADV_RANDOM);
+    setint(dict, "MADV_SEQUENTIAL", MADV_SEQUENTIAL);
+    setint(dict, "MADV_WILLNEED", MADV_WILLNEED);
+    setint(dict, "MADV_DONTNEED", MADV_DONTNEED);
+#ifdef MADV_FREE
+    setint(dict, "MADV_FREE", MADV_FREE);
+#endif
+#ifdef MADV_REMOVE
+    setint(dict, "MADV_REMOVE", MADV_REMOVE);
+#endif
+#ifdef MADV_DONTFORK
+    setint(dict, "MADV_DONTFORK", MADV_DONTFORK);
+#endif
+#ifdef MADV_DOFORK
+    setint(dict, "MADV_DOFORK", MADV_DOFORK);
+#endif
+#ifdef MADV_MERGEABLE
+    setint(dict, "MADV_MERGEABLE", MADV_MERGEABLE);
+#endif
+#ifdef MADV_UNMERGEABLE
+    setint(dict, "MADV_UNMERGEABLE", MADV_UNMERGEABLE);
+#endif
+#ifdef MADV_HUGEPAGE
+    setint(dict, "MADV_HUGEPAGE", MADV_HUGEPAGE);
+#endif
+#ifdef MADV_NOHUGEPAGE
+    setint(dict, "MADV_NOHUGEPAGE", MADV_NOHUGEPAGE);
+#endif
+#ifdef MADV_DONTDUMP
+    setint(dict, "MADV_DONTDUMP", MADV_DONTDUMP);
+#endif
+#ifdef MADV_DODUMP
+    setint(dict, "MADV_DODUMP", MADV_DODUMP);
+#endif
+#endif /* HAVE_MADVISE */
 
     setint(dict, "PAGESIZE", (long)my_getpagesize());
 
@@ -96,6 +96,10 @@ corresponding Unix manual entries for more information on calls.");
 #include <sys/loadavg.h>
 #endif
 
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
 /* Various compilers have only certain posix functions */
 /* XXX Gosh I wish these were all moved into pyconfig.h */
 #if defined(PYCC_VACPP) && defined(PYOS_OS2)
@@ -6545,6 +6549,118 @@ posix_write(PyObject *self, PyObject *args)
 }
 
 
+#if (defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)) || \
+    defined(HAVE_SPLICE)
+/* Convert an optional file offset argument: None means "use and update
+   the current file position" and leaves *pass_offset at 0. */
+static int
+_parse_offset(PyObject *obj, PY_LONG_LONG *offset, int *pass_offset)
+{
+    *pass_offset = 0;
+    if (obj == Py_None)
+        return 1;
+    if (PyFloat_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "integer argument expected, got float");
+        return 0;
+    }
+    *offset = PyLong_Check(obj) ?
+        PyLong_AsLongLong(obj) : PyInt_AsLong(obj);
+    if (*offset == -1 && PyErr_Occurred())
+        return 0;
+    if (*offset < 0) {
+        PyErr_SetString(PyExc_ValueError, "negative file offset");
+        return 0;
+    }
+    *pass_offset = 1;
+    return 1;
+}
+#endif
+
+
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+PyDoc_STRVAR(posix_sendfile__doc__,
+"sendfile(out, in, offset, count) -> bytessent\n\n\
+Copy count bytes from file descriptor in to file descriptor out inside\n\
+the kernel, starting at offset in the input file.  If offset is None,\n\
+the current position of in is used and updated; otherwise it is left\n\
+unchanged.  Returns 0 at end of file.");
+
+static PyObject *
+posix_sendfile(PyObject *self, PyObject *args)
+{
+    int in, out, pass_offset;
+    PyObject *offobj;
+    PY_LONG_LONG offset = 0;
+    off_t off;
+    Py_ssize_t count, sent;
+
+    if (!PyArg_ParseTuple(args, "iiOn:sendfile", &out, &in, &offobj, &count))
+        return NULL;
+    if (!_parse_offset(offobj, &offset, &pass_offset))
+        return NULL;
+    if (count < 0) {
+        errno = EINVAL;
+        return posix_error();
+    }
+    if (!_PyVerify_fd(in) || !_PyVerify_fd(out))
+        return posix_error();
+    off = (off_t)offset;
+    Py_BEGIN_ALLOW_THREADS
+    sent = sendfile(out, in, pass_offset ? &off : NULL, (size_t)count);
+    Py_END_ALLOW_THREADS
+    if (sent < 0)
+        return posix_error();
+    return PyInt_FromSsize_t(sent);
+}
+#endif /* HAVE_SENDFILE && HAVE_SYS_SENDFILE_H */
+
+
+#ifdef HAVE_SPLICE
+PyDoc_STRVAR(posix_splice__doc__,
+"splice(src, dst, count[, offset_src[, offset_dst[, flags]]]) -> bytesmoved\n\n\
+Move up to count bytes from file descriptor src to file descriptor dst\n\
+without copying them through user space.  At least one of the two must\n\
+refer to a pipe.  An offset of None (the default) means the current file\n\
+position is used and updated.  flags is a combination of the SPLICE_F_*\n\
+constants.  Returns 0 at end of input.");
+
+static PyObject *
+posix_splice(PyObject *self, PyObject *args)
+{
+    int src, dst, pass_src, pass_dst;
+    unsigned int flags = 0;
+    PyObject *srcobj = Py_None, *dstobj = Py_None;
+    PY_LONG_LONG src_offset = 0, dst_offset = 0;
+    loff_t off_src, off_dst;
+    Py_ssize_t count, moved;
+
+    if (!PyArg_ParseTuple(args, "iin|OOI:splice", &src, &dst, &count,
+                          &srcobj, &dstobj, &flags))
+        return NULL;
+    if (!_parse_offset(srcobj, &src_offset, &pass_src) ||
+        !_parse_offset(dstobj, &dst_offset, &pass_dst))
+        return NULL;
+    if (count < 0) {
+        errno = EINVAL;
+        return posix_error();
+    }
+    if (!_PyVerify_fd(src) || !_PyVerify_fd(dst))
+        return posix_error();
+    off_src = (loff_t)src_offset;
+    off_dst = (loff_t)dst_offset;
+    Py_BEGIN_ALLOW_THREADS
+    moved = splice(src, pass_src ? &off_src : NULL,
+                   dst, pass_dst ? &off_dst : NULL,
+                   (size_t)count, flags);
+    Py_END_ALLOW_THREADS
+    if (moved < 0)
+        return posix_error();
+    return PyInt_FromSsize_t(moved);
+}
+#endif /* HAVE_SPLICE */
+
+
 PyDoc_STRVAR(posix_fstat__doc__,
 "fstat(fd) -> stat result\n\n\
 Like stat(), but for an open file descriptor.");
@@ -8781,6 +8897,12 @@ static PyMethodDef posix_methods[] = {
     {"lseek",           posix_lseek, METH_VARARGS, posix_lseek__doc__},
     {"read",            posix_read, METH_VARARGS, posix_read__doc__},
     {"write",           posix_write, METH_VARARGS, posix_write__doc__},
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+    {"sendfile",        posix_sendfile, METH_VARARGS, posix_sendfile__doc__},
+#endif
+#ifdef HAVE_SPLICE
+    {"splice",          posix_splice, METH_VARARGS, posix_splice__doc__},
+#endif
     {"fstat",           posix_fstat, METH_VARARGS, posix_fstat__doc__},
     {"fdopen",          posix_fdopen, METH_VARARGS, posix_fdopen__doc__},
     {"isatty",          posix_isatty, METH_VARARGS, posix_isatty__doc__},
@@ -9089,6 +9211,16 @@ all_ins(PyObject *d)
     /* Do not update the access time. */
     if (ins(d, "O_NOATIME", (long)O_NOATIME)) return -1;
 #endif
+#ifdef SPLICE_F_MOVE
+    /* Flags for splice(). */
+    if (ins(d, "SPLICE_F_MOVE", (long)SPLICE_F_MOVE)) return -1;
+#endif
+#ifdef SPLICE_F_NONBLOCK
+    if (ins(d, "SPLICE_F_NONBLOCK", (long)SPLICE_F_NONBLOCK)) return -1;
+#endif
+#ifdef SPLICE_F_MORE
+    if (ins(d, "SPLICE_F_MORE", (long)SPLICE_F_MORE)) return -1;
+#endif
 
     /* These come from sysexits.h */
 #ifdef EX_OK
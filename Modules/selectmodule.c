@@ -705,8 +705,16 @@ static int select_have_broken_poll(void)
 typedef struct {
     PyObject_HEAD
     SOCKET epfd;                        /* epoll control file descriptor */
+    PyObject *data;                     /* fd -> user data, or NULL */
+    struct epoll_event *evs;            /* reusable buffer for poll() */
+    int evs_size;                       /* number of items in evs */
+    int evs_busy;                       /* evs in use by a poll() call */
 } pyEpoll_Object;
 
+/* The data of a registered fd is the fd itself; this flag in the upper
+   half says that self->data holds a user object to report instead. */
+#define EPOLL_HAS_DATA ((uint64_t)1 << 32)
+
 static PyTypeObject pyEpoll_Type;
 #define pyepoll_CHECK(op) (PyObject_TypeCheck((op), &pyEpoll_Type))
 
@@ -751,6 +759,10 @@ newPyEpoll_Object(PyTypeObject *type, int sizehint, SOCKET fd)
     self = (pyEpoll_Object *) type->tp_alloc(type, 0);
     if (self == NULL)
         return NULL;
+    self->data = NULL;
+    self->evs = NULL;
+    self->evs_size = 0;
+    self->evs_busy = 0;
 
     if (fd == -1) {
         Py_BEGIN_ALLOW_THREADS
@@ -783,16 +795,34 @@ pyepoll_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 }
 
 
+static int
+pyepoll_traverse(pyEpoll_Object *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->data);
+    return 0;
+}
+
+static int
+pyepoll_clear(pyEpoll_Object *self)
+{
+    Py_CLEAR(self->data);
+    return 0;
+}
+
 static void
 pyepoll_dealloc(pyEpoll_Object *self)
 {
+    PyObject_GC_UnTrack(self);
     (void)pyepoll_internal_close(self);
+    Py_CLEAR(self->data);
+    PyMem_Free(self->evs);
     Py_TYPE(self)->tp_free(self);
 }
 
 static PyObject*
 pyepoll_close(pyEpoll_Object *self)
 {
+    Py_CLEAR(self->data);
     errno = pyepoll_internal_close(self);
     if (errno < 0) {
         PyErr_SetFromErrno(PyExc_IOError);
@@ -845,14 +875,19 @@ PyDoc_STRVAR(pyepoll_fromfd_doc,
 \n\
 Create an epoll object from a given control fd.");
 
+/* Add, modify or delete the registration of pfd.  For EPOLL_CTL_ADD,
+   data is the user object to report in place of the fd, or NULL; for
+   EPOLL_CTL_MOD the current user object, if any, is kept. */
 static PyObject *
-pyepoll_internal_ctl(int epfd, int op, PyObject *pfd, unsigned int events)
+pyepoll_internal_ctl(pyEpoll_Object *self, int op, PyObject *pfd,
+                     unsigned int events, PyObject *data)
 {
     struct epoll_event ev;
     int result;
     int fd;
+    PyObject *key;
 
-    if (epfd < 0)
+    if (self->epfd < 0)
         return pyepoll_err_closed();
 
     fd = PyObject_AsFileDescriptor(pfd);
@@ -860,13 +895,37 @@ pyepoll_internal_ctl(int epfd, int op, PyObject *pfd, unsigned int events)
         return NULL;
     }
 
+    key = PyInt_FromLong(fd);
+    if (key == NULL)
+        return NULL;
+
+    ev.events = events;
+    ev.data.u64 = (uint64_t)(unsigned int)fd;
     switch(op) {
         case EPOLL_CTL_ADD:
+        if (data != NULL) {
+            if (self->data == NULL && (self->data = PyDict_New()) == NULL)
+                goto error;
+            ev.data.u64 |= EPOLL_HAS_DATA;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        result = epoll_ctl(self->epfd, op, fd, &ev);
+        Py_END_ALLOW_THREADS
+        if (result == 0 && self->data != NULL) {
+            /* Forget the data of a closed fd whose number is reused */
+            if (data != NULL) {
+                if (PyDict_SetItem(self->data, key, data) < 0)
+                    goto error;
+            }
+            else if (PyDict_DelItem(self->data, key) < 0)
+                PyErr_Clear();
+        }
+        break;
         case EPOLL_CTL_MOD:
-        ev.events = events;
-        ev.data.fd = fd;
+        if (self->data != NULL && PyDict_GetItem(self->data, key) != NULL)
+            ev.data.u64 |= EPOLL_HAS_DATA;
         Py_BEGIN_ALLOW_THREADS
-        result = epoll_ctl(epfd, op, fd, &ev);
+        result = epoll_ctl(self->epfd, op, fd, &ev);
         Py_END_ALLOW_THREADS
         break;
         case EPOLL_CTL_DEL:
@@ -874,49 +933,58 @@ pyepoll_internal_ctl(int epfd, int op, PyObject *pfd, unsigned int events)
          * operation required a non-NULL pointer in event, even
          * though this argument is ignored. */
         Py_BEGIN_ALLOW_THREADS
-        result = epoll_ctl(epfd, op, fd, &ev);
+        result = epoll_ctl(self->epfd, op, fd, &ev);
         if (errno == EBADF) {
             /* fd already closed */
             result = 0;
             errno = 0;
         }
         Py_END_ALLOW_THREADS
+        if (self->data != NULL && PyDict_DelItem(self->data, key) < 0)
+            PyErr_Clear();
         break;
         default:
         result = -1;
         errno = EINVAL;
     }
 
+    Py_DECREF(key);
     if (result < 0) {
         PyErr_SetFromErrno(PyExc_IOError);
         return NULL;
     }
     Py_RETURN_NONE;
+
+  error:
+    Py_DECREF(key);
+    return NULL;
 }
 
 static PyObject *
 pyepoll_register(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
 {
-    PyObject *pfd;
+    PyObject *pfd, *data = NULL;
     unsigned int events = EPOLLIN | EPOLLOUT | EPOLLPRI;
-    static char *kwlist[] = {"fd", "eventmask", NULL};
+    static char *kwlist[] = {"fd", "eventmask", "data", NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|I:register", kwlist,
-                                     &pfd, &events)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|IO:register", kwlist,
+                                     &pfd, &events, &data)) {
         return NULL;
     }
 
-    return pyepoll_internal_ctl(self->epfd, EPOLL_CTL_ADD, pfd, events);
+    return pyepoll_internal_ctl(self, EPOLL_CTL_ADD, pfd, events, data);
 }
 
 PyDoc_STRVAR(pyepoll_register_doc,
-"register(fd[, eventmask]) -> bool\n\
+"register(fd[, eventmask[, data]]) -> None\n\
 \n\
-Registers a new fd or modifies an already registered fd. register() returns\n\
-True if a new fd was registered or False if the event mask for fd was modified.\n\
+Registers a new fd with the epoll object.\n\
 fd is the target file descriptor of the operation.\n\
 events is a bit set composed of the various EPOLL constants; the default\n\
-is EPOLL_IN | EPOLL_OUT | EPOLL_PRI.\n\
+is EPOLL_IN | EPOLL_OUT | EPOLL_PRI.  EPOLLONESHOT disables fd after one\n\
+event until it is rearmed with modify(); EPOLLEXCLUSIVE wakes up only one\n\
+of several epoll objects waiting on fd.\n\
+If data is given, poll() reports it instead of fd.\n\
 \n\
 The epoll interface supports all file descriptors that support poll.");
 
@@ -932,14 +1000,15 @@ pyepoll_modify(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    return pyepoll_internal_ctl(self->epfd, EPOLL_CTL_MOD, pfd, events);
+    return pyepoll_internal_ctl(self, EPOLL_CTL_MOD, pfd, events, NULL);
 }
 
 PyDoc_STRVAR(pyepoll_modify_doc,
 "modify(fd, eventmask) -> None\n\
 \n\
 fd is the target file descriptor of the operation\n\
-events is a bit set composed of the various EPOLL constants");
+events is a bit set composed of the various EPOLL constants.\n\
+The data given to register(), if any, is kept.");
 
 static PyObject *
 pyepoll_unregister(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
@@ -952,7 +1021,7 @@ pyepoll_unregister(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    return pyepoll_internal_ctl(self->epfd, EPOLL_CTL_DEL, pfd, 0);
+    return pyepoll_internal_ctl(self, EPOLL_CTL_DEL, pfd, 0, NULL);
 }
 
 PyDoc_STRVAR(pyepoll_unregister_doc,
@@ -960,6 +1029,56 @@ PyDoc_STRVAR(pyepoll_unregister_doc,
 \n\
 fd is the target file descriptor of the operation.");
 
+/* Convert a timeout in seconds to milliseconds for epoll_wait() */
+static int
+pyepoll_timeout(double dtimeout, int *timeout)
+{
+    if (dtimeout < 0) {
+        *timeout = -1;
+    }
+    else if (dtimeout * 1000.0 > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "timeout is too large");
+        return -1;
+    }
+    else {
+        *timeout = (int)(dtimeout * 1000.0);
+    }
+    return 0;
+}
+
+/* Get a buffer for maxevents events: the one kept in self from one call
+   to the next, unless another thread is polling with it right now, in
+   which case *own is set and the caller must free the buffer. */
+static struct epoll_event *
+pyepoll_get_evs(pyEpoll_Object *self, int maxevents, int *own)
+{
+    *own = 0;
+    if (self->evs_busy) {
+        *own = 1;
+        return PyMem_New(struct epoll_event, maxevents);
+    }
+    if (maxevents > self->evs_size) {
+        PyMem_Free(self->evs);
+        self->evs_size = 0;
+        self->evs = PyMem_New(struct epoll_event, maxevents);
+        if (self->evs == NULL)
+            return NULL;
+        self->evs_size = maxevents;
+    }
+    self->evs_busy = 1;
+    return self->evs;
+}
+
+static void
+pyepoll_put_evs(pyEpoll_Object *self, struct epoll_event *evs, int own)
+{
+    if (own)
+        PyMem_Free(evs);
+    else
+        self->evs_busy = 0;
+}
+
 static PyObject *
 pyepoll_poll(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
 {
@@ -967,8 +1086,9 @@ pyepoll_poll(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
     int timeout;
     int maxevents = -1;
     int nfds, i;
-    PyObject *elist = NULL, *etuple = NULL;
+    PyObject *elist = NULL, *etuple, *item;
     struct epoll_event *evs = NULL;
+    int own_evs = 0;
     static char *kwlist[] = {"timeout", "maxevents", NULL};
 
     if (self->epfd < 0)
@@ -979,17 +1099,8 @@ pyepoll_poll(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    if (dtimeout < 0) {
-        timeout = -1;
-    }
-    else if (dtimeout * 1000.0 > INT_MAX) {
-        PyErr_SetString(PyExc_OverflowError,
-                        "timeout is too large");
+    if (pyepoll_timeout(dtimeout, &timeout) < 0)
         return NULL;
-    }
-    else {
-        timeout = (int)(dtimeout * 1000.0);
-    }
 
     if (maxevents == -1) {
         maxevents = FD_SETSIZE-1;
@@ -1001,9 +1112,8 @@ pyepoll_poll(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    evs = PyMem_New(struct epoll_event, maxevents);
+    evs = pyepoll_get_evs(self, maxevents, &own_evs);
     if (evs == NULL) {
-        Py_DECREF(self);
         PyErr_NoMemory();
         return NULL;
     }
@@ -1022,16 +1132,39 @@ pyepoll_poll(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
     }
 
     for (i = 0; i < nfds; i++) {
-        etuple = Py_BuildValue("iI", evs[i].data.fd, evs[i].events);
+        int fd = (int)(evs[i].data.u64 & 0xffffffffU);
+
+        etuple = PyTuple_New(2);
         if (etuple == NULL) {
             Py_CLEAR(elist);
             goto error;
         }
         PyList_SET_ITEM(elist, i, etuple);
+        item = PyInt_FromLong(fd);
+        if (item != NULL && (evs[i].data.u64 & EPOLL_HAS_DATA) &&
+            self->data != NULL) {
+            PyObject *data = PyDict_GetItem(self->data, item);
+            if (data != NULL) {
+                Py_DECREF(item);
+                Py_INCREF(data);
+                item = data;
+            }
+        }
+        if (item == NULL) {
+            Py_CLEAR(elist);
+            goto error;
+        }
+        PyTuple_SET_ITEM(etuple, 0, item);
+        item = PyInt_FromLong((long)evs[i].events);
+        if (item == NULL) {
+            Py_CLEAR(elist);
+            goto error;
+        }
+        PyTuple_SET_ITEM(etuple, 1, item);
     }
 
     error:
-    PyMem_Free(evs);
+    pyepoll_put_evs(self, evs, own_evs);
     return elist;
 }
 
@@ -1040,7 +1173,78 @@ PyDoc_STRVAR(pyepoll_poll_doc,
 \n\
 Wait for events on the epoll file descriptor for a maximum time of timeout\n\
 in seconds (as float). -1 makes poll wait indefinitely.\n\
-Up to maxevents are returned to the caller.");
+Up to maxevents are returned to the caller.  For the fds registered\n\
+with user data, the data is returned instead of the fd.");
+
+static PyObject *
+pyepoll_poll_into(pyEpoll_Object *self, PyObject *args, PyObject *kwds)
+{
+    double dtimeout = -1.;
+    int timeout;
+    int maxevents, nfds, i, own_evs;
+    Py_buffer buf;
+    int *out;
+    struct epoll_event *evs;
+    static char *kwlist[] = {"buffer", "timeout", NULL};
+
+    if (self->epfd < 0)
+        return pyepoll_err_closed();
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "w*|d:poll_into", kwlist,
+                                     &buf, &dtimeout))
+        return NULL;
+
+    if (pyepoll_timeout(dtimeout, &timeout) < 0)
+        goto error;
+    if (buf.len / (2 * sizeof(int)) > INT_MAX)
+        maxevents = INT_MAX;
+    else
+        maxevents = (int)(buf.len / (2 * sizeof(int)));
+    if (maxevents < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "buffer too small for a single event");
+        goto error;
+    }
+
+    evs = pyepoll_get_evs(self, maxevents, &own_evs);
+    if (evs == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    nfds = epoll_wait(self->epfd, evs, maxevents, timeout);
+    Py_END_ALLOW_THREADS
+    if (nfds < 0) {
+        PyErr_SetFromErrno(PyExc_IOError);
+        pyepoll_put_evs(self, evs, own_evs);
+        goto error;
+    }
+
+    out = (int *)buf.buf;
+    for (i = 0; i < nfds; i++) {
+        int fd = (int)(evs[i].data.u64 & 0xffffffffU);
+        int events = (int)evs[i].events;
+        out[2 * i] = fd;
+        out[2 * i + 1] = events;
+    }
+    pyepoll_put_evs(self, evs, own_evs);
+    PyBuffer_Release(&buf);
+    return PyInt_FromLong(nfds);
+
+  error:
+    PyBuffer_Release(&buf);
+    return NULL;
+}
+
+PyDoc_STRVAR(pyepoll_poll_into_doc,
+"poll_into(buffer[, timeout=-1]) -> nevents\n\
+\n\
+Like poll(), but store the events in the writable buffer, typically an\n\
+array.array('i'), as consecutive pairs of C ints fd, events, and return\n\
+the number of events stored.  The buffer holds len(buffer) / 2 events at\n\
+most.  No object is allocated for the events; user data is not\n\
+reported, only the fds.");
 
 static PyMethodDef pyepoll_methods[] = {
     {"fromfd",          (PyCFunction)pyepoll_fromfd,
@@ -1057,6 +1261,8 @@ static PyMethodDef pyepoll_methods[] = {
      METH_VARARGS | METH_KEYWORDS,      pyepoll_unregister_doc},
     {"poll",            (PyCFunction)pyepoll_poll,
      METH_VARARGS | METH_KEYWORDS,      pyepoll_poll_doc},
+    {"poll_into",       (PyCFunction)pyepoll_poll_into,
+     METH_VARARGS | METH_KEYWORDS,      pyepoll_poll_into_doc},
     {NULL,      NULL},
 };
 
@@ -1095,10 +1301,10 @@ static PyTypeObject pyEpoll_Type = {
     PyObject_GenericGetAttr,                            /* tp_getattro */
     0,                                                  /* tp_setattro */
     0,                                                  /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT,                                 /* tp_flags */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,            /* tp_flags */
     pyepoll_doc,                                        /* tp_doc */
-    0,                                                  /* tp_traverse */
-    0,                                                  /* tp_clear */
+    (traverseproc)pyepoll_traverse,                     /* tp_traverse */
+    (inquiry)pyepoll_clear,                             /* tp_clear */
     0,                                                  /* tp_richcompare */
     0,                                                  /* tp_weaklistoffset */
     0,                                                  /* tp_iter */
@@ -1826,7 +2032,14 @@ initselect(void)
     /* Kernel 2.6.2+ */
     PyModule_AddIntConstant(m, "EPOLLONESHOT", EPOLLONESHOT);
 #endif
-    /* PyModule_AddIntConstant(m, "EPOLL_RDHUP", EPOLLRDHUP); */
+#ifdef EPOLLEXCLUSIVE
+    /* Kernel 4.5+ */
+    PyModule_AddIntConstant(m, "EPOLLEXCLUSIVE", EPOLLEXCLUSIVE);
+#endif
+#ifdef EPOLLRDHUP
+    /* Kernel 2.6.17+ */
+    PyModule_AddIntConstant(m, "EPOLLRDHUP", EPOLLRDHUP);
+#endif
     PyModule_AddIntConstant(m, "EPOLLRDNORM", EPOLLRDNORM);
     PyModule_AddIntConstant(m, "EPOLLRDBAND", EPOLLRDBAND);
     PyModule_AddIntConstant(m, "EPOLLWRNORM", EPOLLWRNORM);
@@ -18,6 +18,7 @@
 
 #include "Python.h"
 #include "structmember.h"
+#include "hashlib.h"
 
 
 /* Endianness testing and definitions */
@@ -52,6 +53,9 @@ typedef struct {
     int Endianness;
     int local;                          /* unprocessed amount in data */
     int digestsize;
+#ifdef WITH_THREAD
+    PyThread_type_lock lock;
+#endif
 } SHAobject;
 
 /* When run on a little-endian CPU we need to perform byte reversal on an
@@ -382,13 +386,23 @@ static PyTypeObject SHA256type;
 static SHAobject *
 newSHA224object(void)
 {
-    return (SHAobject *)PyObject_New(SHAobject, &SHA224type);
+    SHAobject *sha = (SHAobject *)PyObject_New(SHAobject, &SHA224type);
+#ifdef WITH_THREAD
+    if (sha != NULL)
+        sha->lock = NULL;
+#endif
+    return sha;
 }
 
 static SHAobject *
 newSHA256object(void)
 {
-    return (SHAobject *)PyObject_New(SHAobject, &SHA256type);
+    SHAobject *sha = (SHAobject *)PyObject_New(SHAobject, &SHA256type);
+#ifdef WITH_THREAD
+    if (sha != NULL)
+        sha->lock = NULL;
+#endif
+    return sha;
 }
 
 /* Internal methods for a hash object */
@@ -396,9 +410,27 @@ newSHA256object(void)
 static void
 SHA_dealloc(PyObject *ptr)
 {
+#ifdef WITH_THREAD
+    if (((SHAobject *)ptr)->lock != NULL)
+        PyThread_free_lock(((SHAobject *)ptr)->lock);
+#endif
     PyObject_Del(ptr);
 }
 
+/* sha_update() for lengths which may not fit in an int */
+static void
+sha_hash(SHAobject *sha_info, const void *vp, Py_ssize_t len)
+{
+    SHA_BYTE *cp = (SHA_BYTE *)vp;
+
+    while (len > 0) {
+        int process = len > INT_MAX ? INT_MAX : (int)len;
+        sha_update(sha_info, cp, process);
+        len -= process;
+        cp += process;
+    }
+}
+
 
 /* External methods for a hash object */
 
@@ -417,7 +449,9 @@ SHA256_copy(SHAobject *self, PyObject *unused)
             return NULL;
     }
 
+    ENTER_HASHLIB(self);
     SHAcopy(self, newobj);
+    LEAVE_HASHLIB(self);
     return (PyObject *)newobj;
 }
 
@@ -430,7 +464,9 @@ SHA256_digest(SHAobject *self, PyObject *unused)
     unsigned char digest[SHA_DIGESTSIZE];
     SHAobject temp;
 
+    ENTER_HASHLIB(self);
     SHAcopy(self, &temp);
+    LEAVE_HASHLIB(self);
     sha_final(digest, &temp);
     return PyString_FromStringAndSize((const char *)digest, self->digestsize);
 }
@@ -448,7 +484,9 @@ SHA256_hexdigest(SHAobject *self, PyObject *unused)
     int i, j;
 
     /* Get the raw (binary) digest value */
+    ENTER_HASHLIB(self);
     SHAcopy(self, &temp);
+    LEAVE_HASHLIB(self);
     sha_final(digest, &temp);
 
     /* Create a new string */
@@ -485,14 +523,74 @@ SHA256_update(SHAobject *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s*:update", &buf))
         return NULL;
 
-    sha_update(self, buf.buf, buf.len);
+#ifdef WITH_THREAD
+    if (self->lock == NULL && buf.len >= HASHLIB_GIL_MINSIZE) {
+        self->lock = PyThread_allocate_lock();
+        /* fail? lock = NULL and we fail over to non-threaded code. */
+    }
+
+    if (self->lock != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        sha_hash(self, buf.buf, buf.len);
+        PyThread_release_lock(self->lock);
+        Py_END_ALLOW_THREADS
+    }
+    else
+#endif
+    {
+        sha_hash(self, buf.buf, buf.len);
+    }
 
     PyBuffer_Release(&buf);
     Py_RETURN_NONE;
 }
 
+static PyObject *
+SHA256_digest_many(SHAobject *self, PyObject *buffers)
+{
+    PyObject *fast, *result;
+    Py_buffer *views;
+    Py_ssize_t n, i, total;
+    SHAobject base, temp;
+    unsigned char digest[SHA_DIGESTSIZE];
+    PyThreadState *_save = NULL;
+
+    fast = PySequence_Fast(buffers, "digest_many() needs a sequence");
+    if (fast == NULL)
+        return NULL;
+    views = hashlib_get_views(fast, &n, &total);
+    if (views == NULL) {
+        Py_DECREF(fast);
+        return NULL;
+    }
+    result = hashlib_new_digests(n, self->digestsize);
+    if (result != NULL) {
+        ENTER_HASHLIB(self);
+        SHAcopy(self, &base);
+        LEAVE_HASHLIB(self);
+
+        if (total >= HASHLIB_GIL_MINSIZE)
+            _save = PyEval_SaveThread();
+        for (i = 0; i < n; i++) {
+            SHAcopy(&base, &temp);
+            sha_hash(&temp, views[i].buf, views[i].len);
+            sha_final(digest, &temp);
+            memcpy(PyString_AS_STRING(PyList_GET_ITEM(result, i)), digest,
+                   self->digestsize);
+        }
+        if (_save != NULL)
+            PyEval_RestoreThread(_save);
+    }
+    hashlib_release_views(views, n);
+    Py_DECREF(fast);
+    return result;
+}
+
 static PyMethodDef SHA_methods[] = {
     {"copy",      (PyCFunction)SHA256_copy,      METH_NOARGS,  SHA256_copy__doc__},
+    {"digest_many", (PyCFunction)SHA256_digest_many, METH_O,
+     hashlib_digest_many__doc__},
     {"digest",    (PyCFunction)SHA256_digest,    METH_NOARGS,  SHA256_digest__doc__},
     {"hexdigest", (PyCFunction)SHA256_hexdigest, METH_NOARGS,  SHA256_hexdigest__doc__},
     {"update",    (PyCFunction)SHA256_update,    METH_VARARGS, SHA256_update__doc__},
@@ -632,8 +730,13 @@ SHA256_new(PyObject *self, PyObject *args, PyObject *kwdict)
         PyBuffer_Release(&buf);
         return NULL;
     }
-    if (buf.len > 0) {
-        sha_update(new, buf.buf, buf.len);
+    if (buf.len >= HASHLIB_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        sha_hash(new, buf.buf, buf.len);
+        Py_END_ALLOW_THREADS
+    }
+    else if (buf.len > 0) {
+        sha_hash(new, buf.buf, buf.len);
     }
     PyBuffer_Release(&buf);
 
@@ -667,8 +770,13 @@ SHA224_new(PyObject *self, PyObject *args, PyObject *kwdict)
         PyBuffer_Release(&buf);
         return NULL;
     }
-    if (buf.len > 0) {
-        sha_update(new, buf.buf, buf.len);
+    if (buf.len >= HASHLIB_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        sha_hash(new, buf.buf, buf.len);
+        Py_END_ALLOW_THREADS
+    }
+    else if (buf.len > 0) {
+        sha_hash(new, buf.buf, buf.len);
     }
     PyBuffer_Release(&buf);
 
@@ -18,6 +18,7 @@
 
 #include "Python.h"
 #include "structmember.h"
+#include "hashlib.h"
 
 #ifdef PY_LONG_LONG /* If no PY_LONG_LONG, don't compile anything! */
 
@@ -54,6 +55,9 @@ typedef struct {
     int Endianness;
     int local;                          /* unprocessed amount in data */
     int digestsize;
+#ifdef WITH_THREAD
+    PyThread_type_lock lock;
+#endif
 } SHAobject;
 
 /* When run on a little-endian CPU we need to perform byte reversal on an
@@ -448,13 +452,23 @@ static PyTypeObject SHA512type;
 static SHAobject *
 newSHA384object(void)
 {
-    return (SHAobject *)PyObject_New(SHAobject, &SHA384type);
+    SHAobject *sha = (SHAobject *)PyObject_New(SHAobject, &SHA384type);
+#ifdef WITH_THREAD
+    if (sha != NULL)
+        sha->lock = NULL;
+#endif
+    return sha;
 }
 
 static SHAobject *
 newSHA512object(void)
 {
-    return (SHAobject *)PyObject_New(SHAobject, &SHA512type);
+    SHAobject *sha = (SHAobject *)PyObject_New(SHAobject, &SHA512type);
+#ifdef WITH_THREAD
+    if (sha != NULL)
+        sha->lock = NULL;
+#endif
+    return sha;
 }
 
 /* Internal methods for a hash object */
@@ -462,9 +476,27 @@ newSHA512object(void)
 static void
 SHA512_dealloc(PyObject *ptr)
 {
+#ifdef WITH_THREAD
+    if (((SHAobject *)ptr)->lock != NULL)
+        PyThread_free_lock(((SHAobject *)ptr)->lock);
+#endif
     PyObject_Del(ptr);
 }
 
+/* sha512_update() for lengths which may not fit in an int */
+static void
+sha512_hash(SHAobject *sha_info, const void *vp, Py_ssize_t len)
+{
+    SHA_BYTE *cp = (SHA_BYTE *)vp;
+
+    while (len > 0) {
+        int process = len > INT_MAX ? INT_MAX : (int)len;
+        sha512_update(sha_info, cp, process);
+        len -= process;
+        cp += process;
+    }
+}
+
 
 /* External methods for a hash object */
 
@@ -483,7 +515,9 @@ SHA512_copy(SHAobject *self, PyObject *unused)
             return NULL;
     }
 
+    ENTER_HASHLIB(self);
     SHAcopy(self, newobj);
+    LEAVE_HASHLIB(self);
     return (PyObject *)newobj;
 }
 
@@ -496,7 +530,9 @@ SHA512_digest(SHAobject *self, PyObject *unused)
     unsigned char digest[SHA_DIGESTSIZE];
     SHAobject temp;
 
+    ENTER_HASHLIB(self);
     SHAcopy(self, &temp);
+    LEAVE_HASHLIB(self);
     sha512_final(digest, &temp);
     return PyString_FromStringAndSize((const char *)digest, self->digestsize);
 }
@@ -514,7 +550,9 @@ SHA512_hexdigest(SHAobject *self, PyObject *unused)
     int i, j;
 
     /* Get the raw (binary) digest value */
+    ENTER_HASHLIB(self);
     SHAcopy(self, &temp);
+    LEAVE_HASHLIB(self);
     sha512_final(digest, &temp);
 
     /* Create a new string */
@@ -551,14 +589,74 @@ SHA512_update(SHAobject *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s*:update", &buf))
         return NULL;
 
-    sha512_update(self, buf.buf, buf.len);
+#ifdef WITH_THREAD
+    if (self->lock == NULL && buf.len >= HASHLIB_GIL_MINSIZE) {
+        self->lock = PyThread_allocate_lock();
+        /* fail? lock = NULL and we fail over to non-threaded code. */
+    }
+
+    if (self->lock != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        sha512_hash(self, buf.buf, buf.len);
+        PyThread_release_lock(self->lock);
+        Py_END_ALLOW_THREADS
+    }
+    else
+#endif
+    {
+        sha512_hash(self, buf.buf, buf.len);
+    }
 
     PyBuffer_Release(&buf);
     Py_RETURN_NONE;
 }
 
+static PyObject *
+SHA512_digest_many(SHAobject *self, PyObject *buffers)
+{
+    PyObject *fast, *result;
+    Py_buffer *views;
+    Py_ssize_t n, i, total;
+    SHAobject base, temp;
+    unsigned char digest[SHA_DIGESTSIZE];
+    PyThreadState *_save = NULL;
+
+    fast = PySequence_Fast(buffers, "digest_many() needs a sequence");
+    if (fast == NULL)
+        return NULL;
+    views = hashlib_get_views(fast, &n, &total);
+    if (views == NULL) {
+        Py_DECREF(fast);
+        return NULL;
+    }
+    result = hashlib_new_digests(n, self->digestsize);
+    if (result != NULL) {
+        ENTER_HASHLIB(self);
+        SHAcopy(self, &base);
+        LEAVE_HASHLIB(self);
+
+        if (total >= HASHLIB_GIL_MINSIZE)
+            _save = PyEval_SaveThread();
+        for (i = 0; i < n; i++) {
+            SHAcopy(&base, &temp);
+            sha512_hash(&temp, views[i].buf, views[i].len);
+            sha512_final(digest, &temp);
+            memcpy(PyString_AS_STRING(PyList_GET_ITEM(result, i)), digest,
+                   self->digestsize);
+        }
+        if (_save != NULL)
+            PyEval_RestoreThread(_save);
+    }
+    hashlib_release_views(views, n);
+    Py_DECREF(fast);
+    return result;
+}
+
 static PyMethodDef SHA_methods[] = {
     {"copy",      (PyCFunction)SHA512_copy,      METH_NOARGS, SHA512_copy__doc__},
+    {"digest_many", (PyCFunction)SHA512_digest_many, METH_O,
+     hashlib_digest_many__doc__},
     {"digest",    (PyCFunction)SHA512_digest,    METH_NOARGS, SHA512_digest__doc__},
     {"hexdigest", (PyCFunction)SHA512_hexdigest, METH_NOARGS, SHA512_hexdigest__doc__},
     {"update",    (PyCFunction)SHA512_update,    METH_VARARGS, SHA512_update__doc__},
@@ -698,8 +796,13 @@ SHA512_new(PyObject *self, PyObject *args, PyObject *kwdict)
         PyBuffer_Release(&buf);
         return NULL;
     }
-    if (buf.len > 0) {
-        sha512_update(new, buf.buf, buf.len);
+    if (buf.len >= HASHLIB_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        sha512_hash(new, buf.buf, buf.len);
+        Py_END_ALLOW_THREADS
+    }
+    else if (buf.len > 0) {
+        sha512_hash(new, buf.buf, buf.len);
     }
     PyBuffer_Release(&buf);
 
@@ -733,8 +836,13 @@ SHA384_new(PyObject *self, PyObject *args, PyObject *kwdict)
         PyBuffer_Release(&buf);
         return NULL;
     }
-    if (buf.len > 0) {
-        sha512_update(new, buf.buf, buf.len);
+    if (buf.len >= HASHLIB_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        sha512_hash(new, buf.buf, buf.len);
+        Py_END_ALLOW_THREADS
+    }
+    else if (buf.len > 0) {
+        sha512_hash(new, buf.buf, buf.len);
     }
     PyBuffer_Release(&buf);
 
@@ -17,6 +17,7 @@
 
 #include "Python.h"
 #include "structmember.h"
+#include "hashlib.h"
 
 
 /* Endianness testing and definitions */
@@ -50,6 +51,9 @@ typedef struct {
     SHA_BYTE data[SHA_BLOCKSIZE];       /* SHA data buffer */
     int Endianness;
     int local;                          /* unprocessed amount in data */
+#ifdef WITH_THREAD
+    PyThread_type_lock lock;
+#endif
 } SHAobject;
 
 /* When run on a little-endian CPU we need to perform byte reversal on an
@@ -341,7 +345,12 @@ static PyTypeObject SHAtype;
 static SHAobject *
 newSHAobject(void)
 {
-    return (SHAobject *)PyObject_New(SHAobject, &SHAtype);
+    SHAobject *sha = (SHAobject *)PyObject_New(SHAobject, &SHAtype);
+#ifdef WITH_THREAD
+    if (sha != NULL)
+        sha->lock = NULL;
+#endif
+    return sha;
 }
 
 /* Internal methods for a hashing object */
@@ -349,9 +358,27 @@ newSHAobject(void)
 static void
 SHA_dealloc(PyObject *ptr)
 {
+#ifdef WITH_THREAD
+    if (((SHAobject *)ptr)->lock != NULL)
+        PyThread_free_lock(((SHAobject *)ptr)->lock);
+#endif
     PyObject_Del(ptr);
 }
 
+/* sha_update() for lengths which may not fit in an int */
+static void
+sha_hash(SHAobject *sha_info, const void *vp, Py_ssize_t len)
+{
+    SHA_BYTE *cp = (SHA_BYTE *)vp;
+
+    while (len > 0) {
+        int process = len > INT_MAX ? INT_MAX : (int)len;
+        sha_update(sha_info, cp, process);
+        len -= process;
+        cp += process;
+    }
+}
+
 
 /* External methods for a hashing object */
 
@@ -365,7 +392,9 @@ SHA_copy(SHAobject *self, PyObject *unused)
     if ( (newobj = newSHAobject())==NULL)
         return NULL;
 
+    ENTER_HASHLIB(self);
     SHAcopy(self, newobj);
+    LEAVE_HASHLIB(self);
     return (PyObject *)newobj;
 }
 
@@ -378,7 +407,9 @@ SHA_digest(SHAobject *self, PyObject *unused)
     unsigned char digest[SHA_DIGESTSIZE];
     SHAobject temp;
 
+    ENTER_HASHLIB(self);
     SHAcopy(self, &temp);
+    LEAVE_HASHLIB(self);
     sha_final(digest, &temp);
     return PyString_FromStringAndSize((const char *)digest, sizeof(digest));
 }
@@ -396,7 +427,9 @@ SHA_hexdigest(SHAobject *self, PyObject *unused)
     int i, j;
 
     /* Get the raw (binary) digest value */
+    ENTER_HASHLIB(self);
     SHAcopy(self, &temp);
+    LEAVE_HASHLIB(self);
     sha_final(digest, &temp);
 
     /* Create a new string */
@@ -433,15 +466,74 @@ SHA_update(SHAobject *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s*:update", &view))
         return NULL;
 
-    sha_update(self, (unsigned char*)view.buf,
-               Py_SAFE_DOWNCAST(view.len, Py_ssize_t, unsigned int));
+#ifdef WITH_THREAD
+    if (self->lock == NULL && view.len >= HASHLIB_GIL_MINSIZE) {
+        self->lock = PyThread_allocate_lock();
+        /* fail? lock = NULL and we fail over to non-threaded code. */
+    }
+
+    if (self->lock != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        sha_hash(self, view.buf, view.len);
+        PyThread_release_lock(self->lock);
+        Py_END_ALLOW_THREADS
+    }
+    else
+#endif
+    {
+        sha_hash(self, view.buf, view.len);
+    }
 
     PyBuffer_Release(&view);
     Py_RETURN_NONE;
 }
 
+static PyObject *
+SHA_digest_many(SHAobject *self, PyObject *buffers)
+{
+    PyObject *fast, *result;
+    Py_buffer *views;
+    Py_ssize_t n, i, total;
+    SHAobject base, temp;
+    unsigned char digest[SHA_DIGESTSIZE];
+    PyThreadState *_save = NULL;
+
+    fast = PySequence_Fast(buffers, "digest_many() needs a sequence");
+    if (fast == NULL)
+        return NULL;
+    views = hashlib_get_views(fast, &n, &total);
+    if (views == NULL) {
+        Py_DECREF(fast);
+        return NULL;
+    }
+    result = hashlib_new_digests(n, SHA_DIGESTSIZE);
+    if (result != NULL) {
+        ENTER_HASHLIB(self);
+        SHAcopy(self, &base);
+        LEAVE_HASHLIB(self);
+
+        if (total >= HASHLIB_GIL_MINSIZE)
+            _save = PyEval_SaveThread();
+        for (i = 0; i < n; i++) {
+            SHAcopy(&base, &temp);
+            sha_hash(&temp, views[i].buf, views[i].len);
+            sha_final(digest, &temp);
+            memcpy(PyString_AS_STRING(PyList_GET_ITEM(result, i)), digest,
+                   SHA_DIGESTSIZE);
+        }
+        if (_save != NULL)
+            PyEval_RestoreThread(_save);
+    }
+    hashlib_release_views(views, n);
+    Py_DECREF(fast);
+    return result;
+}
+
 static PyMethodDef SHA_methods[] = {
     {"copy",      (PyCFunction)SHA_copy,      METH_NOARGS,  SHA_copy__doc__},
+    {"digest_many", (PyCFunction)SHA_digest_many, METH_O,
+     hashlib_digest_many__doc__},
     {"digest",    (PyCFunction)SHA_digest,    METH_NOARGS,  SHA_digest__doc__},
     {"hexdigest", (PyCFunction)SHA_hexdigest, METH_NOARGS,  SHA_hexdigest__doc__},
     {"update",    (PyCFunction)SHA_update,    METH_VARARGS, SHA_update__doc__},
@@ -554,9 +646,13 @@ SHA_new(PyObject *self, PyObject *args, PyObject *kwdict)
         PyBuffer_Release(&view);
         return NULL;
     }
-    if (view.len > 0) {
-        sha_update(new, (unsigned char*)view.buf,
-                   Py_SAFE_DOWNCAST(view.len, Py_ssize_t, unsigned int));
+    if (view.len >= HASHLIB_GIL_MINSIZE) {
+        Py_BEGIN_ALLOW_THREADS
+        sha_hash(new, view.buf, view.len);
+        Py_END_ALLOW_THREADS
+    }
+    else if (view.len > 0) {
+        sha_hash(new, view.buf, view.len);
     }
     PyBuffer_Release(&view);
 
@@ -252,10 +252,20 @@ shutdown(how) -- shut down traffic in one or both directions\n\
 #include <sys/types.h>
 #endif
 
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
 /* Generic socket object definitions and includes */
 #define PySocket_BUILDING_SOCKET
 #include "socketmodule.h"
 
+/* sendmsg() and recvmsg() need struct iovec and the RFC 3542 CMSG_*()
+   macros to build and parse ancillary data. */
+#if defined(HAVE_SYS_UIO_H) && defined(CMSG_LEN) && defined(CMSG_SPACE)
+#define HAVE_SOCKET_MSG 1
+#endif
+
 /* Addressing includes */
 
 #ifndef MS_WINDOWS
@@ -2849,6 +2859,594 @@ Like send(data, flags) but allows specifying the destination address.\n\
 For IP sockets, the address is a pair (hostaddr, port).");
 
 
+#ifdef HAVE_SOCKET_MSG
+
+/* Get the buffers of the sequence seq into a new array of iovecs, for
+   sendmsg() and friends.  format is the PyArg_Parse() format used for
+   each item: "s*;" or "w*;" followed by the error message, which is also
+   used if seq is not a sequence.  On success, returns
+   the number of buffers and sets *piov and *pbufs, to be passed to
+   sock_release_iov() once done; on error, returns -1.  Each buffer holds
+   a reference to its item, so that the memory stays valid after the
+   (possibly temporary) sequence is gone. */
+static Py_ssize_t
+sock_get_iov(PyObject *seq, const char *format,
+             struct iovec **piov, Py_buffer **pbufs)
+{
+    PyObject *fast;
+    struct iovec *iov;
+    Py_buffer *bufs;
+    Py_ssize_t i, n;
+
+    fast = PySequence_Fast(seq, format + 3);
+    if (fast == NULL)
+        return -1;
+    n = PySequence_Fast_GET_SIZE(fast);
+    if (n > INT_MAX) {
+        Py_DECREF(fast);
+        PyErr_SetString(PyExc_OverflowError, "too many buffers");
+        return -1;
+    }
+    /* Allocate one extra item so that an empty sequence is not a failure */
+    iov = PyMem_New(struct iovec, n + 1);
+    bufs = PyMem_New(Py_buffer, n + 1);
+    if (iov == NULL || bufs == NULL) {
+        PyMem_Free(iov);
+        PyMem_Free(bufs);
+        Py_DECREF(fast);
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        if (!PyArg_Parse(item, format, &bufs[i])) {
+            while (--i >= 0)
+                PyBuffer_Release(&bufs[i]);
+            PyMem_Free(iov);
+            PyMem_Free(bufs);
+            Py_DECREF(fast);
+            return -1;
+        }
+        /* Old-style buffers are parsed without an owner */
+        if (bufs[i].obj == NULL) {
+            Py_INCREF(item);
+            bufs[i].obj = item;
+        }
+        iov[i].iov_base = bufs[i].buf;
+        iov[i].iov_len = bufs[i].len;
+    }
+    Py_DECREF(fast);
+    *piov = iov;
+    *pbufs = bufs;
+    return n;
+}
+
+static void
+sock_release_iov(struct iovec *iov, Py_buffer *bufs, Py_ssize_t n)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < n; i++)
+        PyBuffer_Release(&bufs[i]);
+    PyMem_Free(iov);
+    PyMem_Free(bufs);
+}
+
+
+/* s.sendmsg(buffers[, ancdata[, flags[, address]]]) method */
+
+static PyObject *
+sock_sendmsg(PySocketSockObject *s, PyObject *args)
+{
+    PyObject *data_arg, *anc_arg = NULL, *addr_arg = Py_None;
+    PyObject *ancfast = NULL, *retval = NULL;
+    struct msghdr msg;
+    struct iovec *iov = NULL;
+    Py_buffer *bufs = NULL;
+    Py_ssize_t niov = 0, nanc = 0, nancbufs = 0, i;
+    struct {
+        int level, type;
+        Py_buffer data;
+    } *anc = NULL;
+    char *controlbuf = NULL;
+    size_t controllen = 0;
+    sock_addr_t addrbuf;
+    int addrlen, flags = 0, timeout;
+    ssize_t n = -1;
+
+    if (!PyArg_ParseTuple(args, "O|OiO:sendmsg",
+                          &data_arg, &anc_arg, &flags, &addr_arg))
+        return NULL;
+
+    memset(&msg, 0, sizeof(msg));
+    if (addr_arg != Py_None) {
+        if (!getsockaddrarg(s, addr_arg, SAS2SA(&addrbuf), &addrlen))
+            return NULL;
+        msg.msg_name = &addrbuf;
+        msg.msg_namelen = addrlen;
+    }
+
+    niov = sock_get_iov(data_arg, "s*;sendmsg() argument 1 must be an "
+                        "iterable of buffers", &iov, &bufs);
+    if (niov < 0)
+        return NULL;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = niov;
+
+    /* Collect the ancillary data items and work out the space they need */
+    if (anc_arg != NULL && anc_arg != Py_None) {
+        ancfast = PySequence_Fast(anc_arg, "sendmsg() argument 2 must be "
+                                  "an iterable of (level, type, data)");
+        if (ancfast == NULL)
+            goto finally;
+        nanc = PySequence_Fast_GET_SIZE(ancfast);
+    }
+    if (nanc > 0) {
+        anc = PyMem_Malloc(nanc * sizeof(*anc));
+        if (anc == NULL) {
+            PyErr_NoMemory();
+            goto finally;
+        }
+        for (; nancbufs < nanc; nancbufs++) {
+            PyObject *item = PySequence_Fast_GET_ITEM(ancfast, nancbufs);
+            if (!PyArg_ParseTuple(item, "iis*:[sendmsg() ancillary data "
+                                  "items]", &anc[nancbufs].level,
+                                  &anc[nancbufs].type, &anc[nancbufs].data))
+                goto finally;
+            controllen += CMSG_SPACE(anc[nancbufs].data.len);
+        }
+        controlbuf = PyMem_Malloc(controllen);
+        if (controlbuf == NULL) {
+            PyErr_NoMemory();
+            goto finally;
+        }
+        /* CMSG_NXTHDR() expects the unused part of the buffer zeroed */
+        memset(controlbuf, 0, controllen);
+        msg.msg_control = controlbuf;
+        msg.msg_controllen = controllen;
+        {
+            struct cmsghdr *cmsgh = CMSG_FIRSTHDR(&msg);
+            for (i = 0; i < nanc && cmsgh != NULL; i++) {
+                cmsgh->cmsg_level = anc[i].level;
+                cmsgh->cmsg_type = anc[i].type;
+                cmsgh->cmsg_len = CMSG_LEN(anc[i].data.len);
+                memcpy(CMSG_DATA(cmsgh), anc[i].data.buf,
+                       anc[i].data.len);
+                cmsgh = CMSG_NXTHDR(&msg, cmsgh);
+            }
+        }
+    }
+
+    if (!IS_SELECTABLE(s)) {
+        select_error();
+        goto finally;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    timeout = internal_select(s, 1);
+    if (!timeout)
+        n = sendmsg(s->sock_fd, &msg, flags);
+    Py_END_ALLOW_THREADS
+
+    if (timeout == 1) {
+        PyErr_SetString(socket_timeout, "timed out");
+        goto finally;
+    }
+    if (n < 0) {
+        s->errorhandler();
+        goto finally;
+    }
+    retval = PyInt_FromSsize_t(n);
+
+finally:
+    for (i = 0; i < nancbufs; i++)
+        PyBuffer_Release(&anc[i].data);
+    PyMem_Free(anc);
+    PyMem_Free(controlbuf);
+    Py_XDECREF(ancfast);
+    sock_release_iov(iov, bufs, niov);
+    return retval;
+}
+
+PyDoc_STRVAR(sendmsg_doc,
+"sendmsg(buffers[, ancdata[, flags[, address]]]) -> count\n\
+\n\
+Send the data of the buffers in the iterable buffers as a single message\n\
+(scatter/gather I/O).  ancdata is an iterable of (level, type, data)\n\
+tuples of ancillary data, such as SCM_RIGHTS file descriptors.  flags\n\
+has the same meaning as for send(), and address gives the destination\n\
+of an unconnected socket.  Return the number of bytes sent.");
+
+
+/* Common code for recvmsg() and recvmsg_into(): receive into the iovlen
+   buffers of iov and return (nbytes, ancdata, msg_flags, address). */
+
+static PyObject *
+sock_recvmsg_guts(PySocketSockObject *s, struct iovec *iov, int iovlen,
+                  Py_ssize_t ancbufsize, int flags)
+{
+    struct msghdr msg;
+    struct cmsghdr *cmsgh;
+    sock_addr_t addrbuf;
+    socklen_t addrlen;
+    char *controlbuf = NULL;
+    PyObject *anclist = NULL, *addr = NULL, *retval = NULL;
+    int timeout;
+    ssize_t n = -1;
+
+    if (ancbufsize < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "negative buffer size in recvmsg");
+        return NULL;
+    }
+    if (!getsockaddrlen(s, &addrlen))
+        return NULL;
+    if (!IS_SELECTABLE(s))
+        return select_error();
+    if (ancbufsize > 0) {
+        controlbuf = PyMem_Malloc(ancbufsize);
+        if (controlbuf == NULL)
+            return PyErr_NoMemory();
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&addrbuf, 0, addrlen);
+    msg.msg_name = SAS2SA(&addrbuf);
+    msg.msg_namelen = addrlen;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovlen;
+    msg.msg_control = controlbuf;
+    msg.msg_controllen = ancbufsize;
+
+    Py_BEGIN_ALLOW_THREADS
+    timeout = internal_select(s, 0);
+    if (!timeout)
+        n = recvmsg(s->sock_fd, &msg, flags);
+    Py_END_ALLOW_THREADS
+
+    if (timeout == 1) {
+        PyErr_SetString(socket_timeout, "timed out");
+        goto finally;
+    }
+    if (n < 0) {
+        s->errorhandler();
+        goto finally;
+    }
+
+    anclist = PyList_New(0);
+    if (anclist == NULL)
+        goto finally;
+    for (cmsgh = (controlbuf != NULL && msg.msg_controllen > 0) ?
+             CMSG_FIRSTHDR(&msg) : NULL;
+         cmsgh != NULL; cmsgh = CMSG_NXTHDR(&msg, cmsgh)) {
+        char *data = (char *)CMSG_DATA(cmsgh);
+        char *end = controlbuf + msg.msg_controllen;
+        Py_ssize_t datalen;
+        PyObject *item;
+
+        if (cmsgh->cmsg_len < CMSG_LEN(0) || data > end)
+            break;
+        datalen = cmsgh->cmsg_len - CMSG_LEN(0);
+        /* The last item may have been truncated (MSG_CTRUNC) */
+        if (datalen > end - data)
+            datalen = end - data;
+        item = Py_BuildValue("iiN", cmsgh->cmsg_level, cmsgh->cmsg_type,
+                             PyString_FromStringAndSize(data, datalen));
+        if (item == NULL || PyList_Append(anclist, item) < 0) {
+            Py_XDECREF(item);
+            goto finally;
+        }
+        Py_DECREF(item);
+    }
+
+    addr = makesockaddr(s->sock_fd, SAS2SA(&addrbuf), msg.msg_namelen,
+                        s->sock_proto);
+    if (addr == NULL)
+        goto finally;
+    retval = Py_BuildValue("nOiO", (Py_ssize_t)n, anclist, msg.msg_flags,
+                           addr);
+
+finally:
+    Py_XDECREF(anclist);
+    Py_XDECREF(addr);
+    PyMem_Free(controlbuf);
+    return retval;
+}
+
+
+/* s.recvmsg(bufsize[, ancbufsize[, flags]]) method */
+
+static PyObject *
+sock_recvmsg(PySocketSockObject *s, PyObject *args)
+{
+    Py_ssize_t bufsize, ancbufsize = 0;
+    int flags = 0;
+    struct iovec iov;
+    PyObject *buf, *retval;
+
+    if (!PyArg_ParseTuple(args, "n|ni:recvmsg", &bufsize, &ancbufsize,
+                          &flags))
+        return NULL;
+    if (bufsize < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "negative buffer size in recvmsg");
+        return NULL;
+    }
+
+    buf = PyString_FromStringAndSize(NULL, bufsize);
+    if (buf == NULL)
+        return NULL;
+    iov.iov_base = PyString_AS_STRING(buf);
+    iov.iov_len = bufsize;
+
+    retval = sock_recvmsg_guts(s, &iov, 1, ancbufsize, flags);
+    if (retval == NULL) {
+        Py_DECREF(buf);
+        return NULL;
+    }
+    /* Replace the byte count with the data actually received */
+    if (_PyString_Resize(&buf, PyInt_AsSsize_t(
+                             PyTuple_GET_ITEM(retval, 0))) < 0) {
+        Py_DECREF(retval);
+        return NULL;
+    }
+    PyTuple_SetItem(retval, 0, buf);
+    return retval;
+}
+
+PyDoc_STRVAR(recvmsg_doc,
+"recvmsg(bufsize[, ancbufsize[, flags]]) -> (data, ancdata, msg_flags, address)\n\
+\n\
+Receive up to bufsize bytes and up to ancbufsize bytes of ancillary\n\
+data (use CMSG_SPACE() to compute it).  ancdata is a list of\n\
+(level, type, data) tuples, msg_flags the flags set on the received\n\
+message (such as MSG_TRUNC or MSG_CTRUNC), and address the sender's\n\
+address if the socket is not connected, else None.");
+
+
+/* s.recvmsg_into(buffers[, ancbufsize[, flags]]) method */
+
+static PyObject *
+sock_recvmsg_into(PySocketSockObject *s, PyObject *args)
+{
+    PyObject *buffers_arg, *retval;
+    Py_ssize_t ancbufsize = 0, niov;
+    int flags = 0;
+    struct iovec *iov;
+    Py_buffer *bufs;
+
+    if (!PyArg_ParseTuple(args, "O|ni:recvmsg_into",
+                          &buffers_arg, &ancbufsize, &flags))
+        return NULL;
+
+    niov = sock_get_iov(buffers_arg, "w*;recvmsg_into() argument 1 must "
+                        "be an iterable of writable buffers", &iov, &bufs);
+    if (niov < 0)
+        return NULL;
+    retval = sock_recvmsg_guts(s, iov, (int)niov, ancbufsize, flags);
+    sock_release_iov(iov, bufs, niov);
+    return retval;
+}
+
+PyDoc_STRVAR(recvmsg_into_doc,
+"recvmsg_into(buffers[, ancbufsize[, flags]]) -> (nbytes, ancdata, msg_flags, address)\n\
+\n\
+Like recvmsg() but scatter the data received into the writable buffers\n\
+of the iterable buffers, filling each one in turn, and return the\n\
+number of bytes received instead of the data.");
+
+#endif /* HAVE_SOCKET_MSG */
+
+
+#if defined(HAVE_SOCKET_MSG) && defined(HAVE_RECVMMSG)
+
+/* s.recvmmsg_into(buffers[, flags]) method */
+
+static PyObject *
+sock_recvmmsg_into(PySocketSockObject *s, PyObject *args)
+{
+    PyObject *buffers_arg, *retval = NULL;
+    struct iovec *iov;
+    Py_buffer *bufs;
+    struct mmsghdr *msgvec = NULL;
+    sock_addr_t *addrs = NULL;
+    socklen_t addrlen;
+    Py_ssize_t niov, i;
+    int flags = 0, timeout, count = -1;
+
+    if (!PyArg_ParseTuple(args, "O|i:recvmmsg_into", &buffers_arg, &flags))
+        return NULL;
+    if (!getsockaddrlen(s, &addrlen))
+        return NULL;
+    if (!IS_SELECTABLE(s))
+        return select_error();
+
+    niov = sock_get_iov(buffers_arg, "w*;recvmmsg_into() argument 1 must "
+                        "be an iterable of writable buffers", &iov, &bufs);
+    if (niov < 0)
+        return NULL;
+    if (niov == 0) {
+        retval = PyList_New(0);
+        goto finally;
+    }
+    msgvec = PyMem_New(struct mmsghdr, niov);
+    addrs = PyMem_New(sock_addr_t, niov);
+    if (msgvec == NULL || addrs == NULL) {
+        PyErr_NoMemory();
+        goto finally;
+    }
+    memset(msgvec, 0, niov * sizeof(struct mmsghdr));
+    memset(addrs, 0, niov * sizeof(sock_addr_t));
+    for (i = 0; i < niov; i++) {
+        msgvec[i].msg_hdr.msg_name = SAS2SA(&addrs[i]);
+        msgvec[i].msg_hdr.msg_namelen = addrlen;
+        msgvec[i].msg_hdr.msg_iov = &iov[i];
+        msgvec[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    timeout = internal_select(s, 0);
+    if (!timeout)
+        count = recvmmsg(s->sock_fd, msgvec, (unsigned int)niov, flags, NULL);
+    Py_END_ALLOW_THREADS
+
+    if (timeout == 1) {
+        PyErr_SetString(socket_timeout, "timed out");
+        goto finally;
+    }
+    if (count < 0) {
+        s->errorhandler();
+        goto finally;
+    }
+
+    retval = PyList_New(count);
+    if (retval == NULL)
+        goto finally;
+    for (i = 0; i < count; i++) {
+        PyObject *addr, *item;
+
+        addr = makesockaddr(s->sock_fd, SAS2SA(&addrs[i]),
+                            msgvec[i].msg_hdr.msg_namelen, s->sock_proto);
+        if (addr == NULL) {
+            Py_CLEAR(retval);
+            goto finally;
+        }
+        item = Py_BuildValue("IN", msgvec[i].msg_len, addr);
+        if (item == NULL) {
+            Py_CLEAR(retval);
+            goto finally;
+        }
+        PyList_SET_ITEM(retval, i, item);
+    }
+
+finally:
+    PyMem_Free(msgvec);
+    PyMem_Free(addrs);
+    sock_release_iov(iov, bufs, niov);
+    return retval;
+}
+
+PyDoc_STRVAR(recvmmsg_into_doc,
+"recvmmsg_into(buffers[, flags]) -> list of (nbytes, address info)\n\
+\n\
+Receive up to one message per writable buffer of the iterable buffers\n\
+with a single system call.  Return a list with the size and sender of\n\
+each message received; the data of message i is at the start of\n\
+buffers[i].  Unless MSG_WAITFORONE is passed in flags, a blocking socket\n\
+waits until all the buffers are filled.");
+
+#endif /* HAVE_SOCKET_MSG && HAVE_RECVMMSG */
+
+
+#if defined(HAVE_SOCKET_MSG) && defined(HAVE_SENDMMSG)
+
+/* s.sendmmsg(messages[, flags]) method */
+
+static PyObject *
+sock_sendmmsg(PySocketSockObject *s, PyObject *args)
+{
+    PyObject *msgs_arg, *fast, *retval = NULL;
+    struct iovec *iov = NULL;
+    Py_buffer *bufs = NULL;
+    struct mmsghdr *msgvec = NULL;
+    sock_addr_t *addrs = NULL;
+    Py_ssize_t n, nbufs = 0, i;
+    int flags = 0, timeout, count = -1;
+
+    if (!PyArg_ParseTuple(args, "O|i:sendmmsg", &msgs_arg, &flags))
+        return NULL;
+    if (!IS_SELECTABLE(s))
+        return select_error();
+
+    fast = PySequence_Fast(msgs_arg, "sendmmsg() argument 1 must be an "
+                           "iterable of messages");
+    if (fast == NULL)
+        return NULL;
+    n = PySequence_Fast_GET_SIZE(fast);
+    if (n == 0) {
+        Py_DECREF(fast);
+        return PyInt_FromLong(0L);
+    }
+    if (n > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "too many messages");
+        goto finally;
+    }
+    iov = PyMem_New(struct iovec, n);
+    bufs = PyMem_New(Py_buffer, n);
+    msgvec = PyMem_New(struct mmsghdr, n);
+    addrs = PyMem_New(sock_addr_t, n);
+    if (iov == NULL || bufs == NULL || msgvec == NULL || addrs == NULL) {
+        PyErr_NoMemory();
+        goto finally;
+    }
+    memset(msgvec, 0, n * sizeof(struct mmsghdr));
+    for (; nbufs < n; nbufs++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, nbufs);
+        PyObject *addro = NULL;
+        int addrlen;
+
+        /* Either a buffer or a (data, address) pair */
+        if (PyTuple_Check(item)) {
+            if (!PyArg_ParseTuple(item, "s*O:sendmmsg",
+                                  &bufs[nbufs], &addro))
+                goto finally;
+        }
+        else if (!PyArg_Parse(item, "s*;sendmmsg() messages must be "
+                              "buffers or (data, address) tuples",
+                              &bufs[nbufs]))
+            goto finally;
+        iov[nbufs].iov_base = bufs[nbufs].buf;
+        iov[nbufs].iov_len = bufs[nbufs].len;
+        msgvec[nbufs].msg_hdr.msg_iov = &iov[nbufs];
+        msgvec[nbufs].msg_hdr.msg_iovlen = 1;
+        if (addro != NULL) {
+            if (!getsockaddrarg(s, addro, SAS2SA(&addrs[nbufs]), &addrlen)) {
+                PyBuffer_Release(&bufs[nbufs]);
+                goto finally;
+            }
+            msgvec[nbufs].msg_hdr.msg_name = SAS2SA(&addrs[nbufs]);
+            msgvec[nbufs].msg_hdr.msg_namelen = addrlen;
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    timeout = internal_select(s, 1);
+    if (!timeout)
+        count = sendmmsg(s->sock_fd, msgvec, (unsigned int)n, flags);
+    Py_END_ALLOW_THREADS
+
+    if (timeout == 1) {
+        PyErr_SetString(socket_timeout, "timed out");
+        goto finally;
+    }
+    if (count < 0) {
+        s->errorhandler();
+        goto finally;
+    }
+    retval = PyInt_FromLong((long)count);
+
+finally:
+    for (i = 0; i < nbufs; i++)
+        PyBuffer_Release(&bufs[i]);
+    PyMem_Free(iov);
+    PyMem_Free(bufs);
+    PyMem_Free(msgvec);
+    PyMem_Free(addrs);
+    Py_DECREF(fast);
+    return retval;
+}
+
+PyDoc_STRVAR(sendmmsg_doc,
+"sendmmsg(messages[, flags]) -> count\n\
+\n\
+Send several messages with a single system call.  Each item of the\n\
+iterable messages is either a buffer, for a connected socket, or a\n\
+(data, address) pair.  Return the number of messages sent, which may be\n\
+less than the number given.");
+
+#endif /* HAVE_SOCKET_MSG && HAVE_SENDMMSG */
+
+
 /* s.shutdown(how) method */
 
 static PyObject *
@@ -2971,6 +3569,22 @@ static PyMethodDef sock_methods[] = {
                       sendall_doc},
     {"sendto",            (PyCFunction)sock_sendto, METH_VARARGS,
                       sendto_doc},
+#ifdef HAVE_SOCKET_MSG
+    {"recvmsg",           (PyCFunction)sock_recvmsg, METH_VARARGS,
+                      recvmsg_doc},
+    {"recvmsg_into",      (PyCFunction)sock_recvmsg_into, METH_VARARGS,
+                      recvmsg_into_doc},
+    {"sendmsg",           (PyCFunction)sock_sendmsg, METH_VARARGS,
+                      sendmsg_doc},
+#endif
+#if defined(HAVE_SOCKET_MSG) && defined(HAVE_RECVMMSG)
+    {"recvmmsg_into",     (PyCFunction)sock_recvmmsg_into, METH_VARARGS,
+                      recvmmsg_into_doc},
+#endif
+#if defined(HAVE_SOCKET_MSG) && defined(HAVE_SENDMMSG)
+    {"sendmmsg",          (PyCFunction)sock_sendmmsg, METH_VARARGS,
+                      sendmmsg_doc},
+#endif
     {"setblocking",       (PyCFunction)sock_setblocking, METH_O,
                       setblocking_doc},
     {"settimeout",    (PyCFunction)sock_settimeout, METH_O,
@@ -4252,6 +4866,57 @@ Set the default timeout in floating seconds for new socket objects.\n\
 A value of None indicates that new socket objects have no timeout.\n\
 When the socket module is first imported, the default is None.");
 
+#ifdef HAVE_SOCKET_MSG
+/* Python interface to CMSG_LEN(length) and CMSG_SPACE(length), for sizing
+   the ancillary data buffer of recvmsg(). */
+
+static int
+cmsg_length_arg(PyObject *args, const char *format, Py_ssize_t *length)
+{
+    if (!PyArg_ParseTuple(args, format, length))
+        return 0;
+    if (*length < 0 || (size_t)*length > (size_t)INT_MAX - CMSG_SPACE(0)) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "ancillary data length out of range");
+        return 0;
+    }
+    return 1;
+}
+
+static PyObject *
+socket_CMSG_LEN(PyObject *self, PyObject *args)
+{
+    Py_ssize_t length;
+
+    if (!cmsg_length_arg(args, "n:CMSG_LEN", &length))
+        return NULL;
+    return PyInt_FromSsize_t((Py_ssize_t)CMSG_LEN(length));
+}
+
+PyDoc_STRVAR(CMSG_LEN_doc,
+"CMSG_LEN(length) -> control message length\n\
+\n\
+Return the total length of an ancillary data item carrying length\n\
+bytes of data, without trailing padding.");
+
+static PyObject *
+socket_CMSG_SPACE(PyObject *self, PyObject *args)
+{
+    Py_ssize_t length;
+
+    if (!cmsg_length_arg(args, "n:CMSG_SPACE", &length))
+        return NULL;
+    return PyInt_FromSsize_t((Py_ssize_t)CMSG_SPACE(length));
+}
+
+PyDoc_STRVAR(CMSG_SPACE_doc,
+"CMSG_SPACE(length) -> buffer size\n\
+\n\
+Return the buffer size recvmsg() needs to receive an ancillary data\n\
+item carrying length bytes of data, including trailing padding.  Add\n\
+up the values for several items.");
+#endif /* HAVE_SOCKET_MSG */
+
 
 /* List of functions exported by this module. */
 
@@ -4304,6 +4969,12 @@ static PyMethodDef socket_methods[] = {
      METH_NOARGS, getdefaulttimeout_doc},
     {"setdefaulttimeout",       socket_setdefaulttimeout,
      METH_O, setdefaulttimeout_doc},
+#ifdef HAVE_SOCKET_MSG
+    {"CMSG_LEN",                socket_CMSG_LEN,
+     METH_VARARGS, CMSG_LEN_doc},
+    {"CMSG_SPACE",              socket_CMSG_SPACE,
+     METH_VARARGS, CMSG_SPACE_doc},
+#endif
     {NULL,                      NULL}            /* Sentinel */
 };
 
@@ -4730,6 +5401,9 @@ init_socket(void)
 #ifdef  SO_REUSEADDR
     PyModule_AddIntConstant(m, "SO_REUSEADDR", SO_REUSEADDR);
 #endif
+#ifdef  SO_PASSCRED
+    PyModule_AddIntConstant(m, "SO_PASSCRED", SO_PASSCRED);
+#endif
 #ifdef SO_EXCLUSIVEADDRUSE
     PyModule_AddIntConstant(m, "SO_EXCLUSIVEADDRUSE", SO_EXCLUSIVEADDRUSE);
 #endif
@@ -4821,6 +5495,29 @@ init_socket(void)
 #ifdef  MSG_ETAG
     PyModule_AddIntConstant(m, "MSG_ETAG", MSG_ETAG);
 #endif
+#ifdef  MSG_NOSIGNAL
+    PyModule_AddIntConstant(m, "MSG_NOSIGNAL", MSG_NOSIGNAL);
+#endif
+#ifdef  MSG_ERRQUEUE
+    PyModule_AddIntConstant(m, "MSG_ERRQUEUE", MSG_ERRQUEUE);
+#endif
+#ifdef  MSG_CMSG_CLOEXEC
+    PyModule_AddIntConstant(m, "MSG_CMSG_CLOEXEC", MSG_CMSG_CLOEXEC);
+#endif
+#ifdef  MSG_WAITFORONE
+    PyModule_AddIntConstant(m, "MSG_WAITFORONE", MSG_WAITFORONE);
+#endif
+
+    /* Ancillary message types, for sendmsg() and recvmsg() */
+#ifdef  SCM_RIGHTS
+    PyModule_AddIntConstant(m, "SCM_RIGHTS", SCM_RIGHTS);
+#endif
+#ifdef  SCM_CREDENTIALS
+    PyModule_AddIntConstant(m, "SCM_CREDENTIALS", SCM_CREDENTIALS);
+#endif
+#ifdef  SCM_CREDS
+    PyModule_AddIntConstant(m, "SCM_CREDS", SCM_CREDS);
+#endif
 
     /* Protocol level and numbers, usable for [gs]etsockopt */
 #ifdef  SOL_SOCKET
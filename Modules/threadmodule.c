@@ -13,9 +13,84 @@
 
 #include "pythread.h"
 
+#if !defined(HAVE_GETTIMEOFDAY) && defined(HAVE_FTIME)
+#include <sys/timeb.h>
+#endif
+
 static PyObject *ThreadError;
+static double timeout_max;      /* PY_TIMEOUT_MAX in whole seconds */
 static long nb_threads = 0;
 
+/* Convert a wait in seconds to microseconds, rounding up, for
+   acquire_timed(). */
+static PY_TIMEOUT_T
+wait_microseconds(double seconds)
+{
+    PY_TIMEOUT_T microseconds;
+
+    if (seconds <= 0)
+        return 0;
+    if (seconds > timeout_max)
+        seconds = timeout_max;
+    microseconds = (PY_TIMEOUT_T)(seconds * 1e6);
+    if (microseconds < seconds * 1e6)
+        microseconds++;
+    return microseconds;
+}
+
+static double
+floattime(void)
+{
+#ifdef HAVE_GETTIMEOFDAY
+    struct timeval t;
+#ifdef GETTIMEOFDAY_NO_TZ
+    gettimeofday(&t);
+#else
+    gettimeofday(&t, (struct timezone *)NULL);
+#endif
+    return (double)t.tv_sec + t.tv_usec * 0.000001;
+#elif defined(HAVE_FTIME)
+    struct timeb t;
+    ftime(&t);
+    return (double)t.time + (double)t.millitm * 0.001;
+#else
+    return (double)time(NULL);
+#endif
+}
+
+/* Acquire lock, first without releasing the GIL since it's usually free,
+   then waiting with the GIL released for at most microseconds, or
+   forever if that's negative.  If a signal interrupts the wait, run the
+   Python signal handlers and wait again for the time left.  Return
+   PY_LOCK_INTR, with an exception set, if a handler raised one. */
+static PyLockStatus
+acquire_timed(PyThread_type_lock lock, PY_TIMEOUT_T microseconds)
+{
+    PyLockStatus r;
+    double deadline = 0;
+
+    if (microseconds > 0)
+        deadline = floattime() + microseconds * 1e-6;
+    for (;;) {
+        r = PyThread_acquire_lock_timed(lock, 0, 0);
+        if (r == PY_LOCK_FAILURE && microseconds != 0) {
+            Py_BEGIN_ALLOW_THREADS
+            r = PyThread_acquire_lock_timed(lock, microseconds, 1);
+            Py_END_ALLOW_THREADS
+        }
+        if (r != PY_LOCK_INTR)
+            return r;
+        if (PyErr_CheckSignals() < 0)
+            return PY_LOCK_INTR;
+        if (microseconds > 0) {
+            double remaining = deadline - floattime();
+            if (remaining <= 0)
+                return PY_LOCK_FAILURE;
+            microseconds = wait_microseconds(remaining);
+        }
+    }
+}
+
 /* Lock objects */
 
 typedef struct {
@@ -39,31 +114,67 @@ lock_dealloc(lockobject *self)
     PyObject_Del(self);
 }
 
-static PyObject *
-lock_PyThread_acquire_lock(lockobject *self, PyObject *args)
+/* Convert the blocking and timeout arguments of acquire() to a timeout in
+   microseconds for PyThread_acquire_lock_timed().  Return -2, with an
+   exception set, if they are invalid. */
+static PY_TIMEOUT_T
+lock_acquire_timeout(int blocking, double timeout)
 {
-    int i = 1;
+    if (!blocking && timeout != -1) {
+        PyErr_SetString(PyExc_ValueError, "can't specify a timeout "
+                        "for a non-blocking call");
+        return -2;
+    }
+    if (timeout < 0 && timeout != -1) {
+        PyErr_SetString(PyExc_ValueError, "timeout value must be "
+                        "positive");
+        return -2;
+    }
+    if (!blocking)
+        return 0;
+    if (timeout == -1)
+        return -1;
+    if (timeout > timeout_max) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "timeout value is too large");
+        return -2;
+    }
+    return (PY_TIMEOUT_T)(timeout * 1e6);
+}
 
-    if (!PyArg_ParseTuple(args, "|i:acquire", &i))
+static PyObject *
+lock_PyThread_acquire_lock(lockobject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"blocking", "timeout", NULL};
+    int blocking = 1;
+    double timeout = -1;
+    PY_TIMEOUT_T microseconds;
+    PyLockStatus r;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|id:acquire", kwlist,
+                                     &blocking, &timeout))
+        return NULL;
+    microseconds = lock_acquire_timeout(blocking, timeout);
+    if (microseconds == -2)
         return NULL;
 
-    Py_BEGIN_ALLOW_THREADS
-    i = PyThread_acquire_lock(self->lock_lock, i);
-    Py_END_ALLOW_THREADS
-
-    return PyBool_FromLong((long)i);
+    r = acquire_timed(self->lock_lock, microseconds);
+    if (r == PY_LOCK_INTR)
+        return NULL;
+    return PyBool_FromLong(r == PY_LOCK_ACQUIRED);
 }
 
 PyDoc_STRVAR(acquire_doc,
-"acquire([wait]) -> None or bool\n\
+"acquire([blocking[, timeout]]) -> bool\n\
 (acquire_lock() is an obsolete synonym)\n\
 \n\
 Lock the lock.  Without argument, this blocks if the lock is already\n\
 locked (even by the same thread), waiting for another thread to release\n\
-the lock, and return None once the lock is acquired.\n\
-With an argument, this will only block if the argument is true,\n\
-and the return value reflects whether the lock is acquired.\n\
-The blocking operation is not interruptible.");
+the lock, and return True once the lock is acquired.\n\
+If blocking is False, this doesn't block, and if timeout is given and\n\
+not -1, this blocks for at most timeout seconds.  The return value\n\
+reflects whether the lock is acquired.\n\
+A signal interrupts the wait only if its handler raises an exception.");
 
 static PyObject *
 lock_PyThread_release_lock(lockobject *self)
@@ -106,9 +217,9 @@ Return whether the lock is in the locked state.");
 
 static PyMethodDef lock_methods[] = {
     {"acquire_lock", (PyCFunction)lock_PyThread_acquire_lock,
-     METH_VARARGS, acquire_doc},
+     METH_VARARGS | METH_KEYWORDS, acquire_doc},
     {"acquire",      (PyCFunction)lock_PyThread_acquire_lock,
-     METH_VARARGS, acquire_doc},
+     METH_VARARGS | METH_KEYWORDS, acquire_doc},
     {"release_lock", (PyCFunction)lock_PyThread_release_lock,
      METH_NOARGS, release_doc},
     {"release",      (PyCFunction)lock_PyThread_release_lock,
@@ -118,7 +229,7 @@ static PyMethodDef lock_methods[] = {
     {"locked",       (PyCFunction)lock_locked_lock,
      METH_NOARGS, locked_doc},
     {"__enter__",    (PyCFunction)lock_PyThread_acquire_lock,
-     METH_VARARGS, acquire_doc},
+     METH_VARARGS | METH_KEYWORDS, acquire_doc},
     {"__exit__",    (PyCFunction)lock_PyThread_release_lock,
      METH_VARARGS, release_doc},
     {NULL}              /* sentinel */
@@ -173,6 +284,1134 @@ newlockobject(void)
     return self;
 }
 
+/* Reentrant locks */
+
+typedef struct {
+    PyObject_HEAD
+    PyThread_type_lock rlock_lock;
+    long rlock_owner;
+    unsigned long rlock_count;
+    PyObject *in_weakreflist;
+} rlockobject;
+
+static PyTypeObject RLocktype;
+
+static void
+rlock_dealloc(rlockobject *self)
+{
+    if (self->in_weakreflist != NULL)
+        PyObject_ClearWeakRefs((PyObject *) self);
+    /* Unlock the lock so it's safe to free it */
+    if (self->rlock_count > 0)
+        PyThread_release_lock(self->rlock_lock);
+    PyThread_free_lock(self->rlock_lock);
+    Py_TYPE(self)->tp_free(self);
+}
+
+/* Take back the underlying lock, releasing the GIL if it must wait.
+   Signals don't interrupt this: it restores the state of a lock that
+   was held, as in Condition.wait(). */
+static void
+rlock_acquire_lock(PyThread_type_lock lock)
+{
+    if (!PyThread_acquire_lock(lock, NOWAIT_LOCK)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(lock, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+static PyObject *
+rlock_acquire(rlockobject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"blocking", "timeout", NULL};
+    int blocking = 1;
+    double timeout = -1;
+    PY_TIMEOUT_T microseconds;
+    PyLockStatus r;
+    long tid;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|id:acquire", kwlist,
+                                     &blocking, &timeout))
+        return NULL;
+    microseconds = lock_acquire_timeout(blocking, timeout);
+    if (microseconds == -2)
+        return NULL;
+
+    tid = PyThread_get_thread_ident();
+    if (self->rlock_count > 0 && tid == self->rlock_owner) {
+        unsigned long count = self->rlock_count + 1;
+        if (count <= self->rlock_count) {
+            PyErr_SetString(PyExc_OverflowError,
+                            "Internal lock count overflowed");
+            return NULL;
+        }
+        self->rlock_count = count;
+        Py_RETURN_TRUE;
+    }
+    r = acquire_timed(self->rlock_lock, microseconds);
+    if (r == PY_LOCK_INTR)
+        return NULL;
+    if (r == PY_LOCK_FAILURE)
+        Py_RETURN_FALSE;
+    assert(self->rlock_count == 0);
+    self->rlock_owner = tid;
+    self->rlock_count = 1;
+    Py_RETURN_TRUE;
+}
+
+PyDoc_STRVAR(rlock_acquire_doc,
+"acquire(blocking=True, timeout=-1) -> bool\n\
+\n\
+Lock the lock.  `blocking` indicates whether we should wait\n\
+for the lock to be available or not.  If `blocking` is False\n\
+and another thread holds the lock, the method will return False\n\
+immediately.  If `blocking` is True and another thread holds\n\
+the lock, the method will wait for the lock to be released,\n\
+take it and then return True.\n\
+(note: a signal interrupts the wait only if its handler raises.)\n\
+\n\
+In all other cases, the method will return True immediately.\n\
+Precisely, if the current thread already holds the lock, its\n\
+internal counter is simply incremented.  If nobody holds the lock,\n\
+the lock is taken and its internal counter initialized to 1.");
+
+static PyObject *
+rlock_release(rlockobject *self)
+{
+    long tid = PyThread_get_thread_ident();
+
+    if (self->rlock_count == 0 || self->rlock_owner != tid) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "cannot release un-acquired lock");
+        return NULL;
+    }
+    if (--self->rlock_count == 0) {
+        self->rlock_owner = 0;
+        PyThread_release_lock(self->rlock_lock);
+    }
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(rlock_release_doc,
+"release()\n\
+\n\
+Release the lock, allowing another thread that is blocked waiting for\n\
+the lock to acquire the lock.  The lock must be in the locked state,\n\
+and must be locked by the same thread that unlocks it; otherwise a\n\
+`RuntimeError` is raised.\n\
+\n\
+Do note that if the lock was acquire()d several times in a row by the\n\
+current thread, release() needs to be called as many times for the lock\n\
+to be available for other threads.");
+
+static PyObject *
+rlock_acquire_restore(rlockobject *self, PyObject *arg)
+{
+    long owner;
+    unsigned long count;
+
+    if (!PyArg_ParseTuple(arg, "kl:_acquire_restore", &count, &owner))
+        return NULL;
+    rlock_acquire_lock(self->rlock_lock);
+    assert(self->rlock_count == 0);
+    self->rlock_owner = owner;
+    self->rlock_count = count;
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(rlock_acquire_restore_doc,
+"_acquire_restore(state) -> None\n\
+\n\
+For internal use by `threading.Condition`.");
+
+static PyObject *
+rlock_release_save(rlockobject *self)
+{
+    long owner;
+    unsigned long count;
+
+    if (self->rlock_count == 0) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "cannot release un-acquired lock");
+        return NULL;
+    }
+    owner = self->rlock_owner;
+    count = self->rlock_count;
+    self->rlock_count = 0;
+    self->rlock_owner = 0;
+    PyThread_release_lock(self->rlock_lock);
+    return Py_BuildValue("kl", count, owner);
+}
+
+PyDoc_STRVAR(rlock_release_save_doc,
+"_release_save() -> tuple\n\
+\n\
+For internal use by `threading.Condition`.");
+
+static int
+rlock_owned(rlockobject *self)
+{
+    return self->rlock_count > 0 &&
+           self->rlock_owner == PyThread_get_thread_ident();
+}
+
+static PyObject *
+rlock_is_owned(rlockobject *self)
+{
+    return PyBool_FromLong(rlock_owned(self));
+}
+
+PyDoc_STRVAR(rlock_is_owned_doc,
+"_is_owned() -> bool\n\
+\n\
+For internal use by `threading.Condition`.");
+
+static PyObject *
+rlock_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    rlockobject *self;
+
+    if (!_PyArg_NoKeywords("RLock()", kwds) ||
+        !PyArg_ParseTuple(args, ":RLock"))
+        return NULL;
+    self = (rlockobject *) type->tp_alloc(type, 0);
+    if (self != NULL) {
+        self->rlock_lock = PyThread_allocate_lock();
+        if (self->rlock_lock == NULL) {
+            type->tp_free(self);
+            PyErr_SetString(ThreadError, "can't allocate lock");
+            return NULL;
+        }
+        self->in_weakreflist = NULL;
+        self->rlock_owner = 0;
+        self->rlock_count = 0;
+    }
+    return (PyObject *) self;
+}
+
+static PyObject *
+rlock_repr(rlockobject *self)
+{
+    return PyString_FromFormat("<%s owner=%ld count=%lu>",
+        Py_TYPE(self)->tp_name, self->rlock_owner, self->rlock_count);
+}
+
+static PyMethodDef rlock_methods[] = {
+    {"acquire",      (PyCFunction)rlock_acquire,
+     METH_VARARGS | METH_KEYWORDS, rlock_acquire_doc},
+    {"release",      (PyCFunction)rlock_release,
+     METH_NOARGS, rlock_release_doc},
+    {"_is_owned",     (PyCFunction)rlock_is_owned,
+     METH_NOARGS, rlock_is_owned_doc},
+    {"_acquire_restore", (PyCFunction)rlock_acquire_restore,
+     METH_O, rlock_acquire_restore_doc},
+    {"_release_save", (PyCFunction)rlock_release_save,
+     METH_NOARGS, rlock_release_save_doc},
+    {"__enter__",    (PyCFunction)rlock_acquire,
+     METH_VARARGS | METH_KEYWORDS, rlock_acquire_doc},
+    {"__exit__",    (PyCFunction)rlock_release,
+     METH_VARARGS, rlock_release_doc},
+    {NULL}              /* sentinel */
+};
+
+PyDoc_STRVAR(rlock_doc,
+"RLock() -> reentrant lock\n\
+\n\
+A reentrant lock can be acquired several times by the thread owning it,\n\
+and must be released as many times before another thread can take it.");
+
+static PyTypeObject RLocktype = {
+    PyVarObject_HEAD_INIT(&PyType_Type, 0)
+    "thread.RLock",                     /*tp_name*/
+    sizeof(rlockobject),                /*tp_size*/
+    0,                                  /*tp_itemsize*/
+    /* methods */
+    (destructor)rlock_dealloc,          /*tp_dealloc*/
+    0,                                  /*tp_print*/
+    0,                                  /*tp_getattr*/
+    0,                                  /*tp_setattr*/
+    0,                                  /*tp_compare*/
+    (reprfunc)rlock_repr,               /*tp_repr*/
+    0,                                  /* tp_as_number */
+    0,                                  /* tp_as_sequence */
+    0,                                  /* tp_as_mapping */
+    0,                                  /* tp_hash */
+    0,                                  /* tp_call */
+    0,                                  /* tp_str */
+    0,                                  /* tp_getattro */
+    0,                                  /* tp_setattro */
+    0,                                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    rlock_doc,                          /* tp_doc */
+    0,                                  /* tp_traverse */
+    0,                                  /* tp_clear */
+    0,                                  /* tp_richcompare */
+    offsetof(rlockobject, in_weakreflist), /* tp_weaklistoffset */
+    0,                                  /* tp_iter */
+    0,                                  /* tp_iternext */
+    rlock_methods,                      /* tp_methods */
+    0,                                  /* tp_members */
+    0,                                  /* tp_getset */
+    0,                                  /* tp_base */
+    0,                                  /* tp_dict */
+    0,                                  /* tp_descr_get */
+    0,                                  /* tp_descr_set */
+    0,                                  /* tp_dictoffset */
+    0,                                  /* tp_init */
+    PyType_GenericAlloc,                /* tp_alloc */
+    rlock_new                           /* tp_new */
+};
+
+/* Waiters, for the condition variables and queues below.
+
+   A thread waits for a notification by blocking on the lock of a waiter,
+   which it holds itself, after putting the waiter in a wait queue.  The
+   notifying thread takes the waiter out of the queue and releases its
+   lock.  The wait queues are only used with the GIL held, which protects
+   them.  Waiters are recycled through a free list, so that a wait doesn't
+   allocate a new lock every time. */
+
+typedef struct _waiter {
+    PyThread_type_lock lock;
+    struct _waiter *next;
+} waiter;
+
+typedef struct {
+    waiter *head;
+    waiter *tail;
+    Py_ssize_t len;
+} waitqueue;
+
+#define MAXFREEWAITERS 64
+static waiter *free_waiters = NULL;
+static int numfree_waiters = 0;
+
+/* Return a waiter whose lock is held */
+static waiter *
+waiter_new(void)
+{
+    waiter *w = free_waiters;
+
+    if (w != NULL) {
+        free_waiters = w->next;
+        numfree_waiters--;
+    }
+    else {
+        w = PyMem_NEW(waiter, 1);
+        if (w == NULL) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+        w->lock = PyThread_allocate_lock();
+        if (w->lock == NULL) {
+            PyMem_FREE(w);
+            PyErr_SetString(ThreadError, "can't allocate lock");
+            return NULL;
+        }
+        PyThread_acquire_lock(w->lock, NOWAIT_LOCK);
+    }
+    w->next = NULL;
+    return w;
+}
+
+/* Give back a waiter, whose lock must be held */
+static void
+waiter_free(waiter *w)
+{
+    if (numfree_waiters < MAXFREEWAITERS) {
+        w->next = free_waiters;
+        free_waiters = w;
+        numfree_waiters++;
+    }
+    else {
+        PyThread_release_lock(w->lock);
+        PyThread_free_lock(w->lock);
+        PyMem_FREE(w);
+    }
+}
+
+static void
+waitq_append(waitqueue *q, waiter *w)
+{
+    w->next = NULL;
+    if (q->tail != NULL)
+        q->tail->next = w;
+    else
+        q->head = w;
+    q->tail = w;
+    q->len++;
+}
+
+/* Take w out of q.  Return 0 if it isn't there. */
+static int
+waitq_remove(waitqueue *q, waiter *w)
+{
+    waiter **p, *prev = NULL;
+
+    for (p = &q->head; *p != NULL; prev = *p, p = &(*p)->next) {
+        if (*p == w) {
+            *p = w->next;
+            if (q->tail == w)
+                q->tail = prev;
+            q->len--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Wake up the first n waiters of q */
+static void
+waitq_notify(waitqueue *q, Py_ssize_t n)
+{
+    while (n-- > 0 && q->head != NULL) {
+        waiter *w = q->head;
+        q->head = w->next;
+        if (q->head == NULL)
+            q->tail = NULL;
+        q->len--;
+        PyThread_release_lock(w->lock);
+    }
+}
+
+/* Wait, with the GIL released, until w, which is in q, is notified, or for
+   at most microseconds if that's not negative.  Return 1 if w was
+   notified, 0 if the wait timed out, -1 if a signal handler raised an
+   exception.  In any case w is out of q and its lock is held again. */
+static int
+waiter_wait(waiter *w, waitqueue *q, PY_TIMEOUT_T microseconds)
+{
+    PyLockStatus r = acquire_timed(w->lock, microseconds);
+
+    if (r == PY_LOCK_ACQUIRED)
+        return 1;
+    if (!waitq_remove(q, w)) {
+        /* Notified after the timeout or the signal but before we got the
+           GIL back: the lock is released already, take the notification,
+           or pass it on to the next waiter if we're leaving with an
+           exception. */
+        PyThread_acquire_lock(w->lock, WAIT_LOCK);
+        if (r == PY_LOCK_FAILURE)
+            return 1;
+        waitq_notify(q, 1);
+    }
+    return r == PY_LOCK_INTR ? -1 : 0;
+}
+
+/* Condition variables */
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *lock;             /* a thread.lock or a thread.RLock */
+    waitqueue waiters;
+    PyObject *in_weakreflist;
+} condobject;
+
+#define COND_RLOCK(c) (Py_TYPE((c)->lock) == &RLocktype)
+
+static void
+cond_dealloc(condobject *self)
+{
+    if (self->in_weakreflist != NULL)
+        PyObject_ClearWeakRefs((PyObject *) self);
+    /* No thread can be waiting: it would hold a reference to self */
+    assert(self->waiters.head == NULL);
+    Py_XDECREF(self->lock);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject *
+cond_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"lock", NULL};
+    condobject *self;
+    PyObject *lock = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:Condition", kwlist,
+                                     &lock))
+        return NULL;
+    if (lock == Py_None) {
+        lock = PyObject_CallObject((PyObject *)&RLocktype, NULL);
+        if (lock == NULL)
+            return NULL;
+    }
+    else if (Py_TYPE(lock) == &Locktype || Py_TYPE(lock) == &RLocktype)
+        Py_INCREF(lock);
+    else {
+        PyErr_SetString(PyExc_TypeError,
+                        "lock must be a thread.lock or a thread.RLock");
+        return NULL;
+    }
+    self = (condobject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_DECREF(lock);
+        return NULL;
+    }
+    self->lock = lock;
+    self->waiters.head = self->waiters.tail = NULL;
+    self->waiters.len = 0;
+    self->in_weakreflist = NULL;
+    return (PyObject *) self;
+}
+
+/* Whether the current thread holds the lock.  For a plain lock, whether
+   it is locked at all: its owner is unknown. */
+static int
+cond_owned(condobject *self)
+{
+    PyThread_type_lock lock;
+
+    if (COND_RLOCK(self))
+        return rlock_owned((rlockobject *)self->lock);
+    lock = ((lockobject *)self->lock)->lock_lock;
+    if (PyThread_acquire_lock(lock, NOWAIT_LOCK)) {
+        PyThread_release_lock(lock);
+        return 0;
+    }
+    return 1;
+}
+
+static PyObject *
+cond_acquire(condobject *self, PyObject *args, PyObject *kwds)
+{
+    if (COND_RLOCK(self))
+        return rlock_acquire((rlockobject *)self->lock, args, kwds);
+    return lock_PyThread_acquire_lock((lockobject *)self->lock, args, kwds);
+}
+
+static PyObject *
+cond_release(condobject *self)
+{
+    if (COND_RLOCK(self))
+        return rlock_release((rlockobject *)self->lock);
+    return lock_PyThread_release_lock((lockobject *)self->lock);
+}
+
+static PyObject *
+cond_wait(condobject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"timeout", NULL};
+    PyObject *timeout = Py_None;
+    PY_TIMEOUT_T microseconds = -1;
+    PyThread_type_lock lock;
+    unsigned long count = 0;
+    long owner = 0;
+    waiter *w;
+    int r;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:wait", kwlist,
+                                     &timeout))
+        return NULL;
+    if (timeout != Py_None) {
+        double seconds = PyFloat_AsDouble(timeout);
+        if (seconds == -1 && PyErr_Occurred())
+            return NULL;
+        microseconds = wait_microseconds(seconds);
+    }
+    if (!cond_owned(self)) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "cannot wait on un-acquired lock");
+        return NULL;
+    }
+    w = waiter_new();
+    if (w == NULL)
+        return NULL;
+    waitq_append(&self->waiters, w);
+
+    /* Release the lock completely, even if an RLock was acquired several
+       times, then wait, then restore it as it was. */
+    if (COND_RLOCK(self)) {
+        rlockobject *rlock = (rlockobject *)self->lock;
+        lock = rlock->rlock_lock;
+        owner = rlock->rlock_owner;
+        count = rlock->rlock_count;
+        rlock->rlock_owner = 0;
+        rlock->rlock_count = 0;
+    }
+    else
+        lock = ((lockobject *)self->lock)->lock_lock;
+    PyThread_release_lock(lock);
+
+    r = waiter_wait(w, &self->waiters, microseconds);
+    waiter_free(w);
+
+    rlock_acquire_lock(lock);
+    if (COND_RLOCK(self)) {
+        rlockobject *rlock = (rlockobject *)self->lock;
+        rlock->rlock_owner = owner;
+        rlock->rlock_count = count;
+    }
+    if (r < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(cond_wait_doc,
+"wait([timeout])\n\
+\n\
+Release the lock, wait until notified or until timeout seconds have\n\
+elapsed, then acquire the lock again.  The lock must be held.");
+
+static PyObject *
+cond_notify(condobject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"n", NULL};
+    Py_ssize_t n = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n:notify", kwlist, &n))
+        return NULL;
+    if (!cond_owned(self)) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "cannot notify on un-acquired lock");
+        return NULL;
+    }
+    waitq_notify(&self->waiters, n);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(cond_notify_doc,
+"notify(n=1)\n\
+\n\
+Wake up at most n of the threads waiting on the condition.\n\
+The lock must be held.");
+
+static PyObject *
+cond_notify_all(condobject *self)
+{
+    if (!cond_owned(self)) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "cannot notify on un-acquired lock");
+        return NULL;
+    }
+    waitq_notify(&self->waiters, self->waiters.len);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(cond_notify_all_doc,
+"notify_all()\n\
+(notifyAll() is an obsolete synonym)\n\
+\n\
+Wake up all the threads waiting on the condition.  The lock must be held.");
+
+static PyObject *
+cond_is_owned(condobject *self)
+{
+    return PyBool_FromLong(cond_owned(self));
+}
+
+static PyObject *
+cond_repr(condobject *self)
+{
+    PyObject *lock, *result;
+
+    lock = PyObject_Repr(self->lock);
+    if (lock == NULL)
+        return NULL;
+    result = PyString_FromFormat("<Condition(%s, %zd)>",
+                                 PyString_AS_STRING(lock),
+                                 self->waiters.len);
+    Py_DECREF(lock);
+    return result;
+}
+
+static PyMethodDef cond_methods[] = {
+    {"acquire",      (PyCFunction)cond_acquire,
+     METH_VARARGS | METH_KEYWORDS, acquire_doc},
+    {"release",      (PyCFunction)cond_release,
+     METH_NOARGS, release_doc},
+    {"wait",         (PyCFunction)cond_wait,
+     METH_VARARGS | METH_KEYWORDS, cond_wait_doc},
+    {"notify",       (PyCFunction)cond_notify,
+     METH_VARARGS | METH_KEYWORDS, cond_notify_doc},
+    {"notify_all",   (PyCFunction)cond_notify_all,
+     METH_NOARGS, cond_notify_all_doc},
+    {"notifyAll",    (PyCFunction)cond_notify_all,
+     METH_NOARGS, cond_notify_all_doc},
+    {"_is_owned",    (PyCFunction)cond_is_owned,
+     METH_NOARGS, rlock_is_owned_doc},
+    {"__enter__",    (PyCFunction)cond_acquire,
+     METH_VARARGS | METH_KEYWORDS, acquire_doc},
+    {"__exit__",     (PyCFunction)cond_release,
+     METH_VARARGS, release_doc},
+    {NULL}              /* sentinel */
+};
+
+PyDoc_STRVAR(cond_doc,
+"Condition([lock]) -> condition variable\n\
+\n\
+A condition variable associated with lock, a thread lock or RLock, or\n\
+a new RLock if not given.  Its acquire() and release() methods are those\n\
+of the lock.");
+
+static PyTypeObject Condtype = {
+    PyVarObject_HEAD_INIT(&PyType_Type, 0)
+    "thread.Condition",                 /*tp_name*/
+    sizeof(condobject),                 /*tp_size*/
+    0,                                  /*tp_itemsize*/
+    /* methods */
+    (destructor)cond_dealloc,           /*tp_dealloc*/
+    0,                                  /*tp_print*/
+    0,                                  /*tp_getattr*/
+    0,                                  /*tp_setattr*/
+    0,                                  /*tp_compare*/
+    (reprfunc)cond_repr,                /*tp_repr*/
+    0,                                  /* tp_as_number */
+    0,                                  /* tp_as_sequence */
+    0,                                  /* tp_as_mapping */
+    0,                                  /* tp_hash */
+    0,                                  /* tp_call */
+    0,                                  /* tp_str */
+    0,                                  /* tp_getattro */
+    0,                                  /* tp_setattro */
+    0,                                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+    cond_doc,                           /* tp_doc */
+    0,                                  /* tp_traverse */
+    0,                                  /* tp_clear */
+    0,                                  /* tp_richcompare */
+    offsetof(condobject, in_weakreflist), /* tp_weaklistoffset */
+    0,                                  /* tp_iter */
+    0,                                  /* tp_iternext */
+    cond_methods,                       /* tp_methods */
+    0,                                  /* tp_members */
+    0,                                  /* tp_getset */
+    0,                                  /* tp_base */
+    0,                                  /* tp_dict */
+    0,                                  /* tp_descr_get */
+    0,                                  /* tp_descr_set */
+    0,                                  /* tp_dictoffset */
+    0,                                  /* tp_init */
+    PyType_GenericAlloc,                /* tp_alloc */
+    cond_new                            /* tp_new */
+};
+
+/* Queues
+
+   A FIFO of objects in a ring buffer, with the blocking behaviour of
+   Queue.Queue.  Everything is protected by the GIL, so a put() or get()
+   which doesn't have to wait takes no lock at all.  Threads waiting for
+   an item, for a free slot or for all tasks to be done are queued on
+   waiters, which are notified one at a time as items come and go. */
+
+typedef struct {
+    PyObject_HEAD
+    PyObject **items;
+    Py_ssize_t allocated;
+    Py_ssize_t first;           /* index of the oldest item */
+    Py_ssize_t count;
+    Py_ssize_t maxsize;         /* <= 0 for no limit */
+    Py_ssize_t unfinished_tasks;
+    waitqueue getters;
+    waitqueue putters;
+    waitqueue joiners;
+    PyObject *in_weakreflist;
+} queueobject;
+
+#define QUEUE_FULL(q) ((q)->maxsize > 0 && (q)->count >= (q)->maxsize)
+
+/* Queue.Empty and Queue.Full, looked up when first needed: Queue imports
+   threading, which imports this module. */
+static PyObject *QueueEmpty = NULL;
+static PyObject *QueueFull = NULL;
+
+static void
+queue_set_error(PyObject **exc, const char *name)
+{
+    if (*exc == NULL) {
+        PyObject *mod = PyImport_ImportModuleNoBlock("Queue");
+        if (mod == NULL)
+            return;
+        *exc = PyObject_GetAttrString(mod, name);
+        Py_DECREF(mod);
+        if (*exc == NULL)
+            return;
+    }
+    PyErr_SetNone(*exc);
+}
+
+static PyObject *
+queue_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"maxsize", NULL};
+    queueobject *self;
+    Py_ssize_t maxsize = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n:SimpleQueue", kwlist,
+                                     &maxsize))
+        return NULL;
+    self = (queueobject *) type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    self->maxsize = maxsize;
+    /* tp_alloc zeroed everything else */
+    return (PyObject *) self;
+}
+
+static int
+queue_traverse(queueobject *self, visitproc visit, void *arg)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < self->count; i++)
+        Py_VISIT(self->items[(self->first + i) % self->allocated]);
+    return 0;
+}
+
+static int
+queue_clear(queueobject *self)
+{
+    PyObject **items = self->items;
+    Py_ssize_t i, first = self->first, count = self->count;
+    Py_ssize_t allocated = self->allocated;
+
+    /* Detach the items before releasing them: that may run code */
+    self->items = NULL;
+    self->allocated = self->first = self->count = 0;
+    for (i = 0; i < count; i++)
+        Py_DECREF(items[(first + i) % allocated]);
+    PyMem_FREE(items);
+    return 0;
+}
+
+static void
+queue_dealloc(queueobject *self)
+{
+    PyObject_GC_UnTrack(self);
+    if (self->in_weakreflist != NULL)
+        PyObject_ClearWeakRefs((PyObject *) self);
+    queue_clear(self);
+    Py_TYPE(self)->tp_free(self);
+}
+
+/* Append item, growing the ring buffer as needed */
+static int
+queue_append(queueobject *self, PyObject *item)
+{
+    if (self->count == self->allocated) {
+        Py_ssize_t i, n = self->allocated < 8 ? 16 : self->allocated * 2;
+        PyObject **items;
+
+        items = PyMem_NEW(PyObject *, n);
+        if (items == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        for (i = 0; i < self->count; i++)
+            items[i] = self->items[(self->first + i) % self->allocated];
+        PyMem_FREE(self->items);
+        self->items = items;
+        self->allocated = n;
+        self->first = 0;
+    }
+    Py_INCREF(item);
+    self->items[(self->first + self->count) % self->allocated] = item;
+    self->count++;
+    return 0;
+}
+
+static PyObject *
+queue_popleft(queueobject *self)
+{
+    PyObject *item = self->items[self->first];
+
+    self->first = (self->first + 1) % self->allocated;
+    if (--self->count == 0)
+        self->first = 0;
+    return item;
+}
+
+/* Wait on q until notified, or until deadline if timeout isn't None.
+   Return 0 if the deadline has passed already, -1 on error. */
+static int
+queue_wait(waitqueue *q, PyObject *timeout, double deadline)
+{
+    PY_TIMEOUT_T microseconds = -1;
+    waiter *w;
+    int r;
+
+    if (timeout != Py_None) {
+        double remaining = deadline - floattime();
+        if (remaining <= 0.0)
+            return 0;
+        microseconds = wait_microseconds(remaining);
+    }
+    w = waiter_new();
+    if (w == NULL)
+        return -1;
+    waitq_append(q, w);
+    r = waiter_wait(w, q, microseconds);
+    waiter_free(w);
+    return r < 0 ? -1 : 1;
+}
+
+/* Compute the deadline of a blocking put() or get() */
+static int
+queue_deadline(PyObject *timeout, double *deadline)
+{
+    double seconds;
+
+    if (timeout == Py_None)
+        return 0;
+    seconds = PyFloat_AsDouble(timeout);
+    if (seconds == -1 && PyErr_Occurred())
+        return -1;
+    if (seconds < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "'timeout' must be a positive number");
+        return -1;
+    }
+    *deadline = floattime() + seconds;
+    return 0;
+}
+
+static PyObject *
+queue_put(queueobject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"item", "block", "timeout", NULL};
+    PyObject *item, *block = Py_True, *timeout = Py_None;
+    double deadline = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OO:put", kwlist,
+                                     &item, &block, &timeout))
+        return NULL;
+    if (QUEUE_FULL(self)) {
+        int r = PyObject_IsTrue(block);
+        if (r < 0)
+            return NULL;
+        if (!r) {
+            queue_set_error(&QueueFull, "Full");
+            return NULL;
+        }
+        if (queue_deadline(timeout, &deadline) < 0)
+            return NULL;
+        while (QUEUE_FULL(self)) {
+            r = queue_wait(&self->putters, timeout, deadline);
+            if (r <= 0) {
+                if (r == 0)
+                    queue_set_error(&QueueFull, "Full");
+                return NULL;
+            }
+        }
+    }
+    if (queue_append(self, item) < 0)
+        return NULL;
+    self->unfinished_tasks++;
+    waitq_notify(&self->getters, 1);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(queue_put_doc,
+"put(item[, block[, timeout]])\n\
+\n\
+Put an item into the queue, like Queue.Queue.put().");
+
+static PyObject *
+queue_put_nowait(queueobject *self, PyObject *item)
+{
+    if (QUEUE_FULL(self)) {
+        queue_set_error(&QueueFull, "Full");
+        return NULL;
+    }
+    if (queue_append(self, item) < 0)
+        return NULL;
+    self->unfinished_tasks++;
+    waitq_notify(&self->getters, 1);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(queue_put_nowait_doc,
+"put_nowait(item)\n\
+\n\
+Put an item into the queue without blocking; raise Queue.Full if the\n\
+queue is full.");
+
+static PyObject *
+queue_get(queueobject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"block", "timeout", NULL};
+    PyObject *block = Py_True, *timeout = Py_None;
+    double deadline = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO:get", kwlist,
+                                     &block, &timeout))
+        return NULL;
+    if (self->count == 0) {
+        int r = PyObject_IsTrue(block);
+        if (r < 0)
+            return NULL;
+        if (!r) {
+            queue_set_error(&QueueEmpty, "Empty");
+            return NULL;
+        }
+        if (queue_deadline(timeout, &deadline) < 0)
+            return NULL;
+        while (self->count == 0) {
+            r = queue_wait(&self->getters, timeout, deadline);
+            if (r <= 0) {
+                if (r == 0)
+                    queue_set_error(&QueueEmpty, "Empty");
+                return NULL;
+            }
+        }
+    }
+    waitq_notify(&self->putters, 1);
+    return queue_popleft(self);
+}
+
+PyDoc_STRVAR(queue_get_doc,
+"get([block[, timeout]]) -> item\n\
+\n\
+Remove and return an item from the queue, like Queue.Queue.get().");
+
+static PyObject *
+queue_get_nowait(queueobject *self)
+{
+    if (self->count == 0) {
+        queue_set_error(&QueueEmpty, "Empty");
+        return NULL;
+    }
+    waitq_notify(&self->putters, 1);
+    return queue_popleft(self);
+}
+
+PyDoc_STRVAR(queue_get_nowait_doc,
+"get_nowait() -> item\n\
+\n\
+Remove and return an item from the queue without blocking; raise\n\
+Queue.Empty if the queue is empty.");
+
+static PyObject *
+queue_task_done(queueobject *self)
+{
+    if (self->unfinished_tasks <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "task_done() called too many times");
+        return NULL;
+    }
+    if (--self->unfinished_tasks == 0)
+        waitq_notify(&self->joiners, self->joiners.len);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(queue_task_done_doc,
+"task_done()\n\
+\n\
+Indicate that a formerly enqueued task is complete.");
+
+static PyObject *
+queue_join(queueobject *self)
+{
+    while (self->unfinished_tasks > 0) {
+        if (queue_wait(&self->joiners, Py_None, 0) < 0)
+            return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(queue_join_doc,
+"join()\n\
+\n\
+Block until all items in the queue have been gotten and processed.");
+
+static PyObject *
+queue_qsize(queueobject *self)
+{
+    return PyInt_FromSsize_t(self->count);
+}
+
+static PyObject *
+queue_empty(queueobject *self)
+{
+    return PyBool_FromLong(self->count == 0);
+}
+
+static PyObject *
+queue_full(queueobject *self)
+{
+    return PyBool_FromLong(QUEUE_FULL(self));
+}
+
+static PyMethodDef queue_methods[] = {
+    {"put",          (PyCFunction)queue_put,
+     METH_VARARGS | METH_KEYWORDS, queue_put_doc},
+    {"put_nowait",   (PyCFunction)queue_put_nowait,
+     METH_O, queue_put_nowait_doc},
+    {"get",          (PyCFunction)queue_get,
+     METH_VARARGS | METH_KEYWORDS, queue_get_doc},
+    {"get_nowait",   (PyCFunction)queue_get_nowait,
+     METH_NOARGS, queue_get_nowait_doc},
+    {"task_done",    (PyCFunction)queue_task_done,
+     METH_NOARGS, queue_task_done_doc},
+    {"join",         (PyCFunction)queue_join,
+     METH_NOARGS, queue_join_doc},
+    {"qsize",        (PyCFunction)queue_qsize,
+     METH_NOARGS, "Return the approximate size of the queue."},
+    {"empty",        (PyCFunction)queue_empty,
+     METH_NOARGS, "Return True if the queue is empty."},
+    {"full",         (PyCFunction)queue_full,
+     METH_NOARGS, "Return True if the queue is full."},
+    {NULL}              /* sentinel */
+};
+
+static PyMemberDef queue_members[] = {
+    {"maxsize", T_PYSSIZET, offsetof(queueobject, maxsize), READONLY,
+     "Maximum size of the queue, or 0 for no limit."},
+    {"unfinished_tasks", T_PYSSIZET,
+     offsetof(queueobject, unfinished_tasks), READONLY,
+     "Number of items put and not marked done yet."},
+    {NULL}              /* sentinel */
+};
+
+PyDoc_STRVAR(queue_doc,
+"SimpleQueue(maxsize=0) -> queue\n\
+\n\
+A multi-producer, multi-consumer FIFO queue with the interface of\n\
+Queue.Queue, holding at most maxsize items if maxsize is positive.");
+
+static PyTypeObject Queuetype = {
+    PyVarObject_HEAD_INIT(&PyType_Type, 0)
+    "thread.SimpleQueue",               /*tp_name*/
+    sizeof(queueobject),                /*tp_size*/
+    0,                                  /*tp_itemsize*/
+    /* methods */
+    (destructor)queue_dealloc,          /*tp_dealloc*/
+    0,                                  /*tp_print*/
+    0,                                  /*tp_getattr*/
+    0,                                  /*tp_setattr*/
+    0,                                  /*tp_compare*/
+    0,                                  /*tp_repr*/
+    0,                                  /* tp_as_number */
+    0,                                  /* tp_as_sequence */
+    0,                                  /* tp_as_mapping */
+    0,                                  /* tp_hash */
+    0,                                  /* tp_call */
+    0,                                  /* tp_str */
+    0,                                  /* tp_getattro */
+    0,                                  /* tp_setattro */
+    0,                                  /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC, /* tp_flags */
+    queue_doc,                          /* tp_doc */
+    (traverseproc)queue_traverse,       /* tp_traverse */
+    (inquiry)queue_clear,               /* tp_clear */
+    0,                                  /* tp_richcompare */
+    offsetof(queueobject, in_weakreflist), /* tp_weaklistoffset */
+    0,                                  /* tp_iter */
+    0,                                  /* tp_iternext */
+    queue_methods,                      /* tp_methods */
+    queue_members,                      /* tp_members */
+    0,                                  /* tp_getset */
+    0,                                  /* tp_base */
+    0,                                  /* tp_dict */
+    0,                                  /* tp_descr_get */
+    0,                                  /* tp_descr_set */
+    0,                                  /* tp_dictoffset */
+    0,                                  /* tp_init */
+    PyType_GenericAlloc,                /* tp_alloc */
+    queue_new,                          /* tp_new */
+    PyObject_GC_Del,                    /* tp_free */
+};
+
 /* Thread-local objects */
 
 #include "structmember.h"
@@ -740,11 +1979,30 @@ initthread(void)
     d = PyModule_GetDict(m);
     ThreadError = PyErr_NewException("thread.error", NULL, NULL);
     PyDict_SetItemString(d, "error", ThreadError);
+    timeout_max = (double)(PY_TIMEOUT_MAX / 1000000);
+    if (PyModule_AddObject(m, "TIMEOUT_MAX",
+                           PyFloat_FromDouble(timeout_max)) < 0)
+        return;
     Locktype.tp_doc = lock_doc;
     if (PyType_Ready(&Locktype) < 0)
         return;
     Py_INCREF(&Locktype);
     PyDict_SetItemString(d, "LockType", (PyObject *)&Locktype);
+    if (PyType_Ready(&RLocktype) < 0)
+        return;
+    Py_INCREF(&RLocktype);
+    if (PyModule_AddObject(m, "RLock", (PyObject *)&RLocktype) < 0)
+        return;
+    if (PyType_Ready(&Condtype) < 0)
+        return;
+    Py_INCREF(&Condtype);
+    if (PyModule_AddObject(m, "Condition", (PyObject *)&Condtype) < 0)
+        return;
+    if (PyType_Ready(&Queuetype) < 0)
+        return;
+    Py_INCREF(&Queuetype);
+    if (PyModule_AddObject(m, "SimpleQueue", (PyObject *)&Queuetype) < 0)
+        return;
 
     Py_INCREF(&localtype);
     if (PyModule_AddObject(m, "_local", (PyObject *)&localtype) < 0)
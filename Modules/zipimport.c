@@ -4,6 +4,11 @@
 #include "marshal.h"
 #include <time.h>
 
+#if defined(HAVE_PREAD) && defined(HAVE_FSTAT) && defined(HAVE_FCNTL_H)
+#include <fcntl.h>
+#define USE_ARCHIVE_FILE
+#endif
+
 
 #define IS_SOURCE   0x0
 #define IS_BYTECODE 0x1
@@ -42,6 +47,9 @@ struct _zipimporter {
 
 static PyObject *ZipImportError;
 static PyObject *zip_directory_cache = NULL;
+#ifdef USE_ARCHIVE_FILE
+static PyObject *zip_archive_files = NULL;  /* {archive: capsule} */
+#endif
 
 /* forward decls */
 static PyObject *read_directory(char *archive);
@@ -661,6 +669,143 @@ get_long(unsigned char *buf) {
     return x;
 }
 
+/* Same for a 2-byte little endian short.  Unlike marshal.c:r_short()
+   this is not sign extended: all the 2-byte fields of a Zip header are
+   unsigned. */
+static long
+get_short(unsigned char *buf) {
+    long x;
+    x =  buf[0];
+    x |= (long)buf[1] << 8;
+    return x;
+}
+
+/* Archives are opened once and the descriptor is shared by all
+   zipimporters for the archive, so reading a member costs a stat() and
+   two pread() calls instead of opening, seeking and reading the file.
+   The file isn't mapped: reading from a mapping of a file which another
+   process truncates raises SIGBUS, where read() just comes up short.
+   The descriptor is dropped when its archive's directory is read again,
+   and replaced when the path names another file. */
+
+#ifdef USE_ARCHIVE_FILE
+#define ARCHIVE_FILE_NAME "zipimport.archive_file"
+
+typedef struct {
+    int fd;
+    struct stat st;     /* of the file when it was opened */
+} archive_file;
+
+static void
+release_archive_file(PyObject *capsule)
+{
+    archive_file *af = (archive_file *)PyCapsule_GetPointer(capsule,
+                                                            ARCHIVE_FILE_NAME);
+    close(af->fd);
+    PyMem_Free(af);
+}
+
+static void
+forget_archive_file(char *archive)
+{
+    if (zip_archive_files != NULL &&
+        PyDict_GetItemString(zip_archive_files, archive) != NULL) {
+        if (PyDict_DelItemString(zip_archive_files, archive) != 0)
+            PyErr_Clear();
+    }
+}
+
+/* Return the open archive, or NULL without an exception set if it can't
+   be opened; callers then fall back to stdio. */
+static archive_file *
+get_archive_file(char *archive)
+{
+    PyObject *capsule;
+    archive_file *af;
+    struct stat st;
+    int fd, flags;
+
+    if (stat(archive, &st) != 0)
+        return NULL;
+    if (zip_archive_files == NULL) {
+        zip_archive_files = PyDict_New();
+        if (zip_archive_files == NULL)
+            goto error;
+    }
+    capsule = PyDict_GetItemString(zip_archive_files, archive);
+    if (capsule != NULL) {
+        af = (archive_file *)PyCapsule_GetPointer(capsule,
+                                                  ARCHIVE_FILE_NAME);
+        /* A file rewritten in place is read afresh through the same
+           descriptor; one renamed over the archive is opened again. */
+        if (af->st.st_ino == st.st_ino && af->st.st_dev == st.st_dev)
+            return af;
+        forget_archive_file(archive);
+    }
+    if (!S_ISREG(st.st_mode))
+        return NULL;
+    fd = open(archive, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    flags = fcntl(fd, F_GETFD);
+    if (flags < 0 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) < 0 ||
+        fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    af = (archive_file *)PyMem_Malloc(sizeof(archive_file));
+    if (af == NULL) {
+        close(fd);
+        goto error;
+    }
+    af->fd = fd;
+    af->st = st;
+    capsule = PyCapsule_New(af, ARCHIVE_FILE_NAME, release_archive_file);
+    if (capsule == NULL) {
+        close(fd);
+        PyMem_Free(af);
+        goto error;
+    }
+    if (PyDict_SetItemString(zip_archive_files, archive, capsule) != 0) {
+        Py_DECREF(capsule);
+        goto error;
+    }
+    Py_DECREF(capsule);
+    return af;
+
+  error:
+    PyErr_Clear();
+    return NULL;
+}
+
+/* Read up to n bytes at offset; return the number of bytes read, which
+   is less than n at the end of the file, or -1 on error. */
+static Py_ssize_t
+read_archive_at(archive_file *af, char *buf, Py_ssize_t n, long offset)
+{
+    Py_ssize_t done = 0, got;
+
+    while (done < n) {
+        got = pread(af->fd, buf + done, (size_t)(n - done),
+                    (off_t)offset + done);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (got == 0)
+            break;
+        done += got;
+    }
+    return done;
+}
+#else
+#define forget_archive_file(archive)
+#define get_archive_file(archive) ((archive_file *)NULL)
+typedef struct archive_file archive_file;
+#define read_archive_at(af, buf, n, offset) ((Py_ssize_t)-1)
+#endif
+
 /*
    read_directory(archive) -> files dict (new reference)
 
@@ -689,11 +834,12 @@ read_directory(char *archive)
     FILE *fp;
     long compress, crc, data_size, file_size, file_offset, date, time;
     long header_offset, name_size, header_size, header_position;
-    long i, l, count;
+    long cdir_size, i, pos, count;
     size_t length;
     char path[MAXPATHLEN + 5];
     char name[MAXPATHLEN + 5];
     char *p, endof_central_dir[22];
+    unsigned char *cdir, *cdir_buf = NULL;
     long arc_offset; /* offset from beginning of file to start of zip-archive */
 
     if (strlen(archive) > MAXPATHLEN) {
@@ -703,6 +849,9 @@ read_directory(char *archive)
     }
     strcpy(path, archive);
 
+    /* Whoever reads the directory again also wants fresh data. */
+    forget_archive_file(archive);
+
     fp = fopen(archive, "rb");
     if (fp == NULL) {
         PyErr_Format(ZipImportError, "can't open Zip file: "
@@ -725,10 +874,36 @@ read_directory(char *archive)
         return NULL;
     }
 
-    header_size = get_long((unsigned char *)endof_central_dir + 12);
+    cdir_size = get_long((unsigned char *)endof_central_dir + 12);
     header_offset = get_long((unsigned char *)endof_central_dir + 16);
-    arc_offset = header_position - header_offset - header_size;
+    arc_offset = header_position - header_offset - cdir_size;
     header_offset += arc_offset;
+    if (cdir_size < 0 || header_offset < 0 ||
+        header_offset + cdir_size > header_position) {
+        fclose(fp);
+        PyErr_Format(ZipImportError, "bad central directory in Zip file: "
+                     "'%.200s'", archive);
+        return NULL;
+    }
+
+    /* Read the central directory in one go and parse it from memory.
+       Seeking around the file for every field costs several read()
+       calls per member. */
+    cdir = cdir_buf = (unsigned char *)PyMem_Malloc(cdir_size + 1);
+    if (cdir_buf == NULL) {
+        fclose(fp);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    if (fseek(fp, header_offset, 0) != 0 ||
+        fread(cdir_buf, 1, cdir_size, fp) != (size_t)cdir_size) {
+        fclose(fp);
+        PyMem_Free(cdir_buf);
+        PyErr_Format(ZipImportError, "can't read Zip file: "
+                     "'%.200s'", archive);
+        return NULL;
+    }
+    fclose(fp);
 
     files = PyDict_New();
     if (files == NULL)
@@ -739,39 +914,37 @@ read_directory(char *archive)
 
     /* Start of Central Directory */
     count = 0;
-    for (;;) {
+    for (pos = 0; pos + 46 <= cdir_size; pos += header_size) {
         PyObject *t;
         int err;
+        unsigned char *h = cdir + pos;
 
-        fseek(fp, header_offset, 0);  /* Start of file header */
-        l = PyMarshal_ReadLongFromFile(fp);
-        if (l != 0x02014B50)
+        if (get_long(h) != 0x02014B50)
             break;              /* Bad: Central Dir File Header */
-        fseek(fp, header_offset + 10, 0);
-        compress = PyMarshal_ReadShortFromFile(fp);
-        time = PyMarshal_ReadShortFromFile(fp);
-        date = PyMarshal_ReadShortFromFile(fp);
-        crc = PyMarshal_ReadLongFromFile(fp);
-        data_size = PyMarshal_ReadLongFromFile(fp);
-        file_size = PyMarshal_ReadLongFromFile(fp);
-        name_size = PyMarshal_ReadShortFromFile(fp);
+        compress = get_short(h + 10);
+        time = get_short(h + 12);
+        date = get_short(h + 14);
+        crc = get_long(h + 16);
+        data_size = get_long(h + 20);
+        file_size = get_long(h + 24);
+        name_size = get_short(h + 28);
         header_size = 46 + name_size +
-           PyMarshal_ReadShortFromFile(fp) +
-           PyMarshal_ReadShortFromFile(fp);
-        fseek(fp, header_offset + 42, 0);
-        file_offset = PyMarshal_ReadLongFromFile(fp) + arc_offset;
+           get_short(h + 30) +
+           get_short(h + 32);
+        file_offset = get_long(h + 42) + arc_offset;
+        if (pos + header_size > cdir_size)
+            break;              /* Bad: header runs past the directory */
         if (name_size > MAXPATHLEN)
             name_size = MAXPATHLEN;
 
         p = name;
         for (i = 0; i < name_size; i++) {
-            *p = (char)getc(fp);
+            *p = (char)h[46 + i];
             if (*p == '/')
                 *p = SEP;
             p++;
         }
         *p = 0;         /* Add terminating null byte */
-        header_offset += header_size;
 
         strncpy(path + length + 1, name, MAXPATHLEN - length - 1);
 
@@ -785,13 +958,15 @@ read_directory(char *archive)
             goto error;
         count++;
     }
-    fclose(fp);
+    if (cdir_buf != NULL)
+        PyMem_Free(cdir_buf);
     if (Py_VerboseFlag)
         PySys_WriteStderr("# zipimport: found %ld names in %s\n",
             count, archive);
     return files;
 error:
-    fclose(fp);
+    if (cdir_buf != NULL)
+        PyMem_Free(cdir_buf);
     Py_XDECREF(files);
     return NULL;
 }
@@ -844,6 +1019,7 @@ get_data(char *archive, PyObject *toc_entry)
     char *datapath;
     long compress, data_size, file_size, file_offset;
     long time, date, crc;
+    archive_file *af;
 
     if (!PyArg_ParseTuple(toc_entry, "slllllll", &datapath, &compress,
                           &data_size, &file_size, &file_offset, &time,
@@ -851,46 +1027,82 @@ get_data(char *archive, PyObject *toc_entry)
         return NULL;
     }
 
-    fp = fopen(archive, "rb");
-    if (!fp) {
-        PyErr_Format(PyExc_IOError,
-           "zipimport: can not open file %s", archive);
-        return NULL;
+    af = get_archive_file(archive);
+    if (af != NULL) {
+        unsigned char header[30];
+
+        /* Check to make sure the local file header is correct */
+        if (file_offset < 0 ||
+            read_archive_at(af, (char *)header, 30, file_offset) != 30 ||
+            get_long(header) != 0x04034B50) {
+            /* Bad: Local File Header */
+            PyErr_Format(ZipImportError,
+                         "bad local file header in %s",
+                         archive);
+            return NULL;
+        }
+        l = 30 + get_short(header + 26) +
+            get_short(header + 28);             /* local header size */
+        file_offset += l;           /* Start of file data */
+        if (data_size < 0) {
+            PyErr_SetString(PyExc_IOError,
+                            "zipimport: can't read data");
+            return NULL;
+        }
+        raw_data = PyString_FromStringAndSize((char *)NULL, compress == 0 ?
+                                              data_size : data_size + 1);
+        if (raw_data == NULL)
+            return NULL;
+        buf = PyString_AsString(raw_data);
+        if (read_archive_at(af, buf, data_size, file_offset) != data_size) {
+            PyErr_SetString(PyExc_IOError,
+                            "zipimport: can't read data");
+            Py_DECREF(raw_data);
+            return NULL;
+        }
     }
+    else {
+        fp = fopen(archive, "rb");
+        if (!fp) {
+            PyErr_Format(PyExc_IOError,
+               "zipimport: can not open file %s", archive);
+            return NULL;
+        }
 
-    /* Check to make sure the local file header is correct */
-    fseek(fp, file_offset, 0);
-    l = PyMarshal_ReadLongFromFile(fp);
-    if (l != 0x04034B50) {
-        /* Bad: Local File Header */
-        PyErr_Format(ZipImportError,
-                     "bad local file header in %s",
-                     archive);
-        fclose(fp);
-        return NULL;
-    }
-    fseek(fp, file_offset + 26, 0);
-    l = 30 + PyMarshal_ReadShortFromFile(fp) +
-        PyMarshal_ReadShortFromFile(fp);        /* local header size */
-    file_offset += l;           /* Start of file data */
-
-    raw_data = PyString_FromStringAndSize((char *)NULL, compress == 0 ?
-                                          data_size : data_size + 1);
-    if (raw_data == NULL) {
-        fclose(fp);
-        return NULL;
-    }
-    buf = PyString_AsString(raw_data);
+        /* Check to make sure the local file header is correct */
+        fseek(fp, file_offset, 0);
+        l = PyMarshal_ReadLongFromFile(fp);
+        if (l != 0x04034B50) {
+            /* Bad: Local File Header */
+            PyErr_Format(ZipImportError,
+                         "bad local file header in %s",
+                         archive);
+            fclose(fp);
+            return NULL;
+        }
+        fseek(fp, file_offset + 26, 0);
+        l = 30 + PyMarshal_ReadShortFromFile(fp) +
+            PyMarshal_ReadShortFromFile(fp);        /* local header size */
+        file_offset += l;           /* Start of file data */
+
+        raw_data = PyString_FromStringAndSize((char *)NULL, compress == 0 ?
+                                              data_size : data_size + 1);
+        if (raw_data == NULL) {
+            fclose(fp);
+            return NULL;
+        }
+        buf = PyString_AsString(raw_data);
 
-    err = fseek(fp, file_offset, 0);
-    if (err == 0)
-        bytes_read = fread(buf, 1, data_size, fp);
-    fclose(fp);
-    if (err || bytes_read != data_size) {
-        PyErr_SetString(PyExc_IOError,
-                        "zipimport: can't read data");
-        Py_DECREF(raw_data);
-        return NULL;
+        err = fseek(fp, file_offset, 0);
+        if (err == 0)
+            bytes_read = fread(buf, 1, data_size, fp);
+        fclose(fp);
+        if (err || bytes_read != data_size) {
+            PyErr_SetString(PyExc_IOError,
+                            "zipimport: can't read data");
+            Py_DECREF(raw_data);
+            return NULL;
+        }
     }
 
     if (compress != 0) {
@@ -7,38 +7,34 @@
 #include "Python.h"
 #include "zlib.h"
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #ifdef WITH_THREAD
 #include "pythread.h"
 
-/* #defs ripped off from _tkinter.c, even though the situation here is much
-   simpler, because we don't have to worry about waiting for Tcl
-   events!  And, since zlib itself is threadsafe, we don't need to worry
-   about re-entering zlib functions.
-
-   N.B.
-
-   Since ENTER_ZLIB and LEAVE_ZLIB only need to be called on functions
-   that modify the components of preexisting de/compress objects, it
-   could prove to be a performance gain on multiprocessor machines if
-   there was an de/compress object-specific lock.  However, for the
-   moment the ENTER_ZLIB and LEAVE_ZLIB calls are global for ALL
-   de/compress objects.
+/* zlib itself is threadsafe, so we don't need to worry about re-entering
+   zlib functions.  ENTER_ZLIB and LEAVE_ZLIB only need to be called on
+   functions that modify the components of preexisting de/compress objects,
+   and each object has its own lock: the GIL is released while deflating
+   or inflating, and threads working on different objects run in parallel.
  */
 
-static PyThread_type_lock zlib_lock = NULL; /* initialized on module load */
-
-#define ENTER_ZLIB \
-        Py_BEGIN_ALLOW_THREADS \
-        PyThread_acquire_lock(zlib_lock, 1); \
-        Py_END_ALLOW_THREADS
+#define ENTER_ZLIB(obj) \
+        if (!PyThread_acquire_lock((obj)->lock, 0)) { \
+            Py_BEGIN_ALLOW_THREADS \
+            PyThread_acquire_lock((obj)->lock, 1); \
+            Py_END_ALLOW_THREADS \
+        }
 
-#define LEAVE_ZLIB \
-        PyThread_release_lock(zlib_lock);
+#define LEAVE_ZLIB(obj) \
+        PyThread_release_lock((obj)->lock);
 
 #else
 
-#define ENTER_ZLIB
-#define LEAVE_ZLIB
+#define ENTER_ZLIB(obj)
+#define LEAVE_ZLIB(obj)
 
 #endif
 
@@ -67,6 +63,9 @@ typedef struct
     PyObject *unused_data;
     PyObject *unconsumed_tail;
     int is_initialised;
+#ifdef WITH_THREAD
+    PyThread_type_lock lock;
+#endif
 } compobject;
 
 static void
@@ -110,6 +109,16 @@ newcompobject(PyTypeObject *type)
     if (self == NULL)
         return NULL;
     self->is_initialised = 0;
+    self->unconsumed_tail = NULL;
+#ifdef WITH_THREAD
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == NULL) {
+        self->unused_data = NULL;
+        Py_DECREF(self);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate lock");
+        return NULL;
+    }
+#endif
     self->unused_data = PyString_FromString("");
     if (self->unused_data == NULL) {
         Py_DECREF(self);
@@ -132,29 +141,42 @@ static PyObject *
 PyZlib_compress(PyObject *self, PyObject *args)
 {
     PyObject *ReturnVal = NULL;
-    Byte *input, *output;
+    Py_buffer pinput;
+    Byte *input;
     int length, level=Z_DEFAULT_COMPRESSION, err;
+    uLong bound;
     z_stream zst;
 
-    /* require Python string object, optional 'level' arg */
-    if (!PyArg_ParseTuple(args, "s#|i:compress", &input, &length, &level))
+    /* require a buffer, optional 'level' arg */
+    if (!PyArg_ParseTuple(args, "s*|i:compress", &pinput, &level))
         return NULL;
+    if (pinput.len > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an int");
+        goto error;
+    }
+    input = pinput.buf;
+    length = (int)pinput.len;
 
-    zst.avail_out = length + length/1000 + 12 + 1;
-
-    output = (Byte*)malloc(zst.avail_out);
-    if (output == NULL) {
-        PyErr_SetString(PyExc_MemoryError,
-                        "Can't allocate memory to compress data");
-        return NULL;
+    bound = compressBound((uLong)length);
+    if (bound > (uLong)PY_SSIZE_T_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an int");
+        goto error;
     }
+    zst.avail_out = (uInt)bound;
+
+    /* Compress straight into the result, which is shrunk at the end */
+    ReturnVal = PyString_FromStringAndSize(NULL, zst.avail_out);
+    if (ReturnVal == NULL)
+        goto error;
 
     /* Past the point of no return.  From here on out, we need to make sure
        we clean up mallocs & INCREFs. */
 
     zst.zalloc = (alloc_func)NULL;
     zst.zfree = (free_func)Z_NULL;
-    zst.next_out = (Byte *)output;
+    zst.next_out = (Byte *)PyString_AS_STRING(ReturnVal);
     zst.next_in = (Byte *)input;
     zst.avail_in = length;
     err = deflateInit(&zst, level);
@@ -187,16 +209,94 @@ PyZlib_compress(PyObject *self, PyObject *args)
     }
 
     err=deflateEnd(&zst);
-    if (err == Z_OK)
-        ReturnVal = PyString_FromStringAndSize((char *)output,
-                                               zst.total_out);
-    else
-        zlib_error(zst, err, "while finishing compression");
+    if (err == Z_OK) {
+        _PyString_Resize(&ReturnVal, zst.total_out);
+        PyBuffer_Release(&pinput);
+        return ReturnVal;
+    }
+    zlib_error(zst, err, "while finishing compression");
 
  error:
-    free(output);
+    PyBuffer_Release(&pinput);
+    Py_XDECREF(ReturnVal);
+    return NULL;
+}
 
-    return ReturnVal;
+PyDoc_STRVAR(compress_into__doc__,
+"compress_into(string, buffer[, level]) -- Compress string into buffer.\n"
+"\n"
+"Write the compressed data to the writable buffer, such as a bytearray,\n"
+"and return the number of bytes written.  zlib.error is raised if the\n"
+"buffer is too small.  Optional arg level is the compression level, in 1-9.");
+
+static PyObject *
+PyZlib_compress_into(PyObject *self, PyObject *args)
+{
+    Py_buffer input, output;
+    int level = Z_DEFAULT_COMPRESSION, err;
+    z_stream zst;
+
+    if (!PyArg_ParseTuple(args, "s*w*|i:compress_into",
+                          &input, &output, &level))
+        return NULL;
+    if ((size_t)input.len > UINT_MAX || (size_t)output.len > UINT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an unsigned int");
+        goto error;
+    }
+
+    zst.zalloc = (alloc_func)NULL;
+    zst.zfree = (free_func)Z_NULL;
+    zst.opaque = Z_NULL;
+    zst.next_in = (Byte *)input.buf;
+    zst.avail_in = (uInt)input.len;
+    zst.next_out = (Byte *)output.buf;
+    zst.avail_out = (uInt)output.len;
+    err = deflateInit(&zst, level);
+    switch(err) {
+    case(Z_OK):
+        break;
+    case(Z_MEM_ERROR):
+        PyErr_SetString(PyExc_MemoryError,
+                        "Out of memory while compressing data");
+        goto error;
+    case(Z_STREAM_ERROR):
+        PyErr_SetString(ZlibError,
+                        "Bad compression level");
+        goto error;
+    default:
+        deflateEnd(&zst);
+        zlib_error(zst, err, "while compressing data");
+        goto error;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    err = deflate(&zst, Z_FINISH);
+    Py_END_ALLOW_THREADS
+
+    if (err != Z_STREAM_END) {
+        if (err == Z_OK || err == Z_BUF_ERROR)
+            PyErr_SetString(ZlibError,
+                            "Error -5 while compressing data: "
+                            "output buffer too small");
+        else
+            zlib_error(zst, err, "while compressing data");
+        deflateEnd(&zst);
+        goto error;
+    }
+    err = deflateEnd(&zst);
+    if (err != Z_OK) {
+        zlib_error(zst, err, "while finishing compression");
+        goto error;
+    }
+    PyBuffer_Release(&input);
+    PyBuffer_Release(&output);
+    return PyInt_FromSize_t(zst.total_out);
+
+ error:
+    PyBuffer_Release(&input);
+    PyBuffer_Release(&output);
+    return NULL;
 }
 
 PyDoc_STRVAR(decompress__doc__,
@@ -208,16 +308,24 @@ PyDoc_STRVAR(decompress__doc__,
 static PyObject *
 PyZlib_decompress(PyObject *self, PyObject *args)
 {
-    PyObject *result_str;
+    PyObject *result_str = NULL;
+    Py_buffer pinput;
     Byte *input;
     int length, err;
     int wsize=DEF_WBITS;
     Py_ssize_t r_strlen=DEFAULTALLOC;
     z_stream zst;
 
-    if (!PyArg_ParseTuple(args, "s#|in:decompress",
-                          &input, &length, &wsize, &r_strlen))
+    if (!PyArg_ParseTuple(args, "s*|in:decompress",
+                          &pinput, &wsize, &r_strlen))
         return NULL;
+    if (pinput.len > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an int");
+        goto error;
+    }
+    input = pinput.buf;
+    length = (int)pinput.len;
 
     if (r_strlen <= 0)
         r_strlen = 1;
@@ -226,7 +334,7 @@ PyZlib_decompress(PyObject *self, PyObject *args)
     zst.avail_out = r_strlen;
 
     if (!(result_str = PyString_FromStringAndSize(NULL, r_strlen)))
-        return NULL;
+        goto error;
 
     zst.zalloc = (alloc_func)NULL;
     zst.zfree = (free_func)Z_NULL;
@@ -292,13 +400,88 @@ PyZlib_decompress(PyObject *self, PyObject *args)
     }
 
     _PyString_Resize(&result_str, zst.total_out);
+    PyBuffer_Release(&pinput);
     return result_str;
 
  error:
+    PyBuffer_Release(&pinput);
     Py_XDECREF(result_str);
     return NULL;
 }
 
+PyDoc_STRVAR(decompress_into__doc__,
+"decompress_into(string, buffer[, wbits]) -- Decompress string into buffer.\n"
+"\n"
+"Write the decompressed data to the writable buffer, such as a bytearray,\n"
+"and return the number of bytes written.  zlib.error is raised if the\n"
+"buffer is too small.  Optional arg wbits is the window buffer size.");
+
+static PyObject *
+PyZlib_decompress_into(PyObject *self, PyObject *args)
+{
+    Py_buffer input, output;
+    int wsize = DEF_WBITS, err;
+    z_stream zst;
+
+    if (!PyArg_ParseTuple(args, "s*w*|i:decompress_into",
+                          &input, &output, &wsize))
+        return NULL;
+    if ((size_t)input.len > UINT_MAX || (size_t)output.len > UINT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an unsigned int");
+        goto error;
+    }
+
+    zst.zalloc = (alloc_func)NULL;
+    zst.zfree = (free_func)Z_NULL;
+    zst.opaque = Z_NULL;
+    zst.next_in = (Byte *)input.buf;
+    zst.avail_in = (uInt)input.len;
+    zst.next_out = (Byte *)output.buf;
+    zst.avail_out = (uInt)output.len;
+    err = inflateInit2(&zst, wsize);
+    switch(err) {
+    case(Z_OK):
+        break;
+    case(Z_MEM_ERROR):
+        PyErr_SetString(PyExc_MemoryError,
+                        "Out of memory while decompressing data");
+        goto error;
+    default:
+        inflateEnd(&zst);
+        zlib_error(zst, err, "while preparing to decompress data");
+        goto error;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    err = inflate(&zst, Z_FINISH);
+    Py_END_ALLOW_THREADS
+
+    if (err != Z_STREAM_END) {
+        if ((err == Z_OK || err == Z_BUF_ERROR) && zst.avail_out == 0)
+            PyErr_SetString(ZlibError,
+                            "Error -5 while decompressing data: "
+                            "output buffer too small");
+        else
+            zlib_error(zst, err, "while decompressing data");
+        inflateEnd(&zst);
+        goto error;
+    }
+    err = inflateEnd(&zst);
+    if (err != Z_OK) {
+        zlib_error(zst, err, "while finishing data decompression");
+        goto error;
+    }
+    PyBuffer_Release(&input);
+    PyBuffer_Release(&output);
+    return PyInt_FromSize_t(zst.total_out);
+
+ error:
+    PyBuffer_Release(&input);
+    PyBuffer_Release(&output);
+    return NULL;
+}
+
 static PyObject *
 PyZlib_compressobj(PyObject *selfptr, PyObject *args)
 {
@@ -381,6 +564,10 @@ Comp_dealloc(compobject *self)
         deflateEnd(&self->zst);
     Py_XDECREF(self->unused_data);
     Py_XDECREF(self->unconsumed_tail);
+#ifdef WITH_THREAD
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+#endif
     PyObject_Del(self);
 }
 
@@ -391,6 +578,10 @@ Decomp_dealloc(compobject *self)
         inflateEnd(&self->zst);
     Py_XDECREF(self->unused_data);
     Py_XDECREF(self->unconsumed_tail);
+#ifdef WITH_THREAD
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+#endif
     PyObject_Del(self);
 }
 
@@ -408,16 +599,27 @@ PyZlib_objcompress(compobject *self, PyObject *args)
     int err, inplen;
     Py_ssize_t length = DEFAULTALLOC;
     PyObject *RetVal;
+    Py_buffer pinput;
     Byte *input;
     unsigned long start_total_out;
 
-    if (!PyArg_ParseTuple(args, "s#:compress", &input, &inplen))
+    if (!PyArg_ParseTuple(args, "s*:compress", &pinput))
         return NULL;
+    if (pinput.len > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an int");
+        PyBuffer_Release(&pinput);
+        return NULL;
+    }
+    input = pinput.buf;
+    inplen = (int)pinput.len;
 
-    if (!(RetVal = PyString_FromStringAndSize(NULL, length)))
+    if (!(RetVal = PyString_FromStringAndSize(NULL, length))) {
+        PyBuffer_Release(&pinput);
         return NULL;
+    }
 
-    ENTER_ZLIB
+    ENTER_ZLIB(self)
 
     start_total_out = self->zst.total_out;
     self->zst.avail_in = inplen;
@@ -457,7 +659,8 @@ PyZlib_objcompress(compobject *self, PyObject *args)
     _PyString_Resize(&RetVal, self->zst.total_out - start_total_out);
 
  error:
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
+    PyBuffer_Release(&pinput);
     return RetVal;
 }
 
@@ -478,25 +681,37 @@ PyZlib_objdecompress(compobject *self, PyObject *args)
     int err, inplen, max_length = 0;
     Py_ssize_t old_length, length = DEFAULTALLOC;
     PyObject *RetVal;
+    Py_buffer pinput;
     Byte *input;
     unsigned long start_total_out;
 
-    if (!PyArg_ParseTuple(args, "s#|i:decompress", &input,
-                          &inplen, &max_length))
+    if (!PyArg_ParseTuple(args, "s*|i:decompress", &pinput,
+                          &max_length))
         return NULL;
+    if (pinput.len > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an int");
+        PyBuffer_Release(&pinput);
+        return NULL;
+    }
     if (max_length < 0) {
         PyErr_SetString(PyExc_ValueError,
                         "max_length must be greater than zero");
+        PyBuffer_Release(&pinput);
         return NULL;
     }
+    input = pinput.buf;
+    inplen = (int)pinput.len;
 
     /* limit amount of data allocated to max_length */
     if (max_length && length > max_length)
         length = max_length;
-    if (!(RetVal = PyString_FromStringAndSize(NULL, length)))
+    if (!(RetVal = PyString_FromStringAndSize(NULL, length))) {
+        PyBuffer_Release(&pinput);
         return NULL;
+    }
 
-    ENTER_ZLIB
+    ENTER_ZLIB(self)
 
     start_total_out = self->zst.total_out;
     self->zst.avail_in = inplen;
@@ -560,6 +775,7 @@ PyZlib_objdecompress(compobject *self, PyObject *args)
             (char *)self->zst.next_in, self->zst.avail_in);
         if (self->unused_data == NULL) {
             Py_DECREF(RetVal);
+            RetVal = NULL;
             goto error;
         }
         /* We will only get Z_BUF_ERROR if the output buffer was full
@@ -576,11 +792,80 @@ PyZlib_objdecompress(compobject *self, PyObject *args)
     _PyString_Resize(&RetVal, self->zst.total_out - start_total_out);
 
  error:
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
+    PyBuffer_Release(&pinput);
 
     return RetVal;
 }
 
+PyDoc_STRVAR(decomp_decompress_into__doc__,
+"decompress_into(data, buffer) -- Decompress data into buffer.\n"
+"\n"
+"Write as much decompressed data as fits into the writable buffer and\n"
+"return the number of bytes written.  The input data which was not\n"
+"consumed is stored in the unconsumed_tail attribute, to be passed to\n"
+"the next call, as with the max_length parameter of decompress().");
+
+static PyObject *
+PyZlib_objdecompress_into(compobject *self, PyObject *args)
+{
+    Py_buffer input, output;
+    int err;
+    unsigned long start_total_out;
+    PyObject *result = NULL, *tail;
+
+    if (!PyArg_ParseTuple(args, "s*w*:decompress_into", &input, &output))
+        return NULL;
+    if ((size_t)input.len > UINT_MAX || (size_t)output.len > UINT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an unsigned int");
+        PyBuffer_Release(&input);
+        PyBuffer_Release(&output);
+        return NULL;
+    }
+
+    ENTER_ZLIB(self)
+
+    start_total_out = self->zst.total_out;
+    self->zst.avail_in = (uInt)input.len;
+    self->zst.next_in = (Byte *)input.buf;
+    self->zst.avail_out = (uInt)output.len;
+    self->zst.next_out = (Byte *)output.buf;
+
+    Py_BEGIN_ALLOW_THREADS
+    err = inflate(&(self->zst), Z_SYNC_FLUSH);
+    Py_END_ALLOW_THREADS
+
+    /* We will only get Z_BUF_ERROR if the output buffer was full or
+       there was no input, so it is not an error condition. */
+    if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+        zlib_error(self->zst, err, "while decompressing");
+        goto error;
+    }
+
+    tail = PyString_FromStringAndSize((char *)self->zst.next_in,
+                                      self->zst.avail_in);
+    if (tail == NULL)
+        goto error;
+    if (err == Z_STREAM_END) {
+        Py_DECREF(self->unused_data);
+        self->unused_data = tail;
+        tail = PyString_FromString("");
+        if (tail == NULL)
+            goto error;
+    }
+    Py_DECREF(self->unconsumed_tail);
+    self->unconsumed_tail = tail;
+
+    result = PyInt_FromSize_t(self->zst.total_out - start_total_out);
+
+ error:
+    LEAVE_ZLIB(self)
+    PyBuffer_Release(&input);
+    PyBuffer_Release(&output);
+    return result;
+}
+
 PyDoc_STRVAR(comp_flush__doc__,
 "flush( [mode] ) -- Return a string containing any remaining compressed data.\n"
 "\n"
@@ -609,7 +894,7 @@ PyZlib_flush(compobject *self, PyObject *args)
     if (!(RetVal = PyString_FromStringAndSize(NULL, length)))
         return NULL;
 
-    ENTER_ZLIB
+    ENTER_ZLIB(self)
 
     start_total_out = self->zst.total_out;
     self->zst.avail_in = 0;
@@ -663,7 +948,7 @@ PyZlib_flush(compobject *self, PyObject *args)
     _PyString_Resize(&RetVal, self->zst.total_out - start_total_out);
 
  error:
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
 
     return RetVal;
 }
@@ -684,7 +969,7 @@ PyZlib_copy(compobject *self)
     /* Copy the zstream state
      * We use ENTER_ZLIB / LEAVE_ZLIB to make this thread-safe
      */
-    ENTER_ZLIB
+    ENTER_ZLIB(self)
     err = deflateCopy(&retval->zst, &self->zst);
     switch(err) {
     case(Z_OK):
@@ -711,11 +996,11 @@ PyZlib_copy(compobject *self)
     /* Mark it as being initialized */
     retval->is_initialised = 1;
 
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
     return (PyObject *)retval;
 
 error:
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
     Py_XDECREF(retval);
     return NULL;
 }
@@ -735,7 +1020,7 @@ PyZlib_uncopy(compobject *self)
     /* Copy the zstream state
      * We use ENTER_ZLIB / LEAVE_ZLIB to make this thread-safe
      */
-    ENTER_ZLIB
+    ENTER_ZLIB(self)
     err = inflateCopy(&retval->zst, &self->zst);
     switch(err) {
     case(Z_OK):
@@ -762,11 +1047,11 @@ PyZlib_uncopy(compobject *self)
     /* Mark it as being initialized */
     retval->is_initialised = 1;
 
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
     return (PyObject *)retval;
 
 error:
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
     Py_XDECREF(retval);
     return NULL;
 }
@@ -796,7 +1081,7 @@ PyZlib_unflush(compobject *self, PyObject *args)
         return NULL;
 
 
-    ENTER_ZLIB
+    ENTER_ZLIB(self)
 
     start_total_out = self->zst.total_out;
     self->zst.avail_out = length;
@@ -837,7 +1122,7 @@ PyZlib_unflush(compobject *self, PyObject *args)
 
 error:
 
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
 
     return retval;
 }
@@ -859,6 +1144,8 @@ static PyMethodDef Decomp_methods[] =
 {
     {"decompress", (binaryfunc)PyZlib_objdecompress, METH_VARARGS,
                    decomp_decompress__doc__},
+    {"decompress_into", (binaryfunc)PyZlib_objdecompress_into, METH_VARARGS,
+                        decomp_decompress_into__doc__},
     {"flush", (binaryfunc)PyZlib_unflush, METH_VARARGS,
               decomp_flush__doc__},
 #ifdef HAVE_ZLIB_COPY
@@ -882,7 +1169,7 @@ Decomp_getattr(compobject *self, char *name)
 {
     PyObject * retval;
 
-    ENTER_ZLIB
+    ENTER_ZLIB(self)
 
     if (strcmp(name, "unused_data") == 0) {
         Py_INCREF(self->unused_data);
@@ -893,7 +1180,7 @@ Decomp_getattr(compobject *self, char *name)
     } else
         retval = Py_FindMethod(Decomp_methods, (PyObject *)self, name);
 
-    LEAVE_ZLIB
+    LEAVE_ZLIB(self)
 
     return retval;
 }
@@ -908,16 +1195,23 @@ static PyObject *
 PyZlib_adler32(PyObject *self, PyObject *args)
 {
     unsigned int adler32val = 1;  /* adler32(0L, Z_NULL, 0) */
-    Byte *buf;
-    int len, signed_val;
+    Py_buffer pbuf;
+    int signed_val;
 
-    if (!PyArg_ParseTuple(args, "s#|I:adler32", &buf, &len, &adler32val))
+    if (!PyArg_ParseTuple(args, "s*|I:adler32", &pbuf, &adler32val))
         return NULL;
+    if (pbuf.len > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an int");
+        PyBuffer_Release(&pbuf);
+        return NULL;
+    }
     /* In Python 2.x we return a signed integer regardless of native platform
      * long size (the 32bit unsigned long is treated as 32-bit signed and sign
      * extended into a 64-bit long inside the integer object).  3.0 does the
      * right thing and returns unsigned. http://bugs.python.org/issue1202 */
-    signed_val = adler32(adler32val, buf, len);
+    signed_val = adler32(adler32val, pbuf.buf, (int)pbuf.len);
+    PyBuffer_Release(&pbuf);
     return PyInt_FromLong(signed_val);
 }
 
@@ -931,19 +1225,302 @@ static PyObject *
 PyZlib_crc32(PyObject *self, PyObject *args)
 {
     unsigned int crc32val = 0;  /* crc32(0L, Z_NULL, 0) */
-    Byte *buf;
-    int len, signed_val;
+    Py_buffer pbuf;
+    int signed_val;
 
-    if (!PyArg_ParseTuple(args, "s#|I:crc32", &buf, &len, &crc32val))
+    if (!PyArg_ParseTuple(args, "s*|I:crc32", &pbuf, &crc32val))
         return NULL;
+    if (pbuf.len > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError,
+                        "size does not fit in an int");
+        PyBuffer_Release(&pbuf);
+        return NULL;
+    }
     /* In Python 2.x we return a signed integer regardless of native platform
      * long size (the 32bit unsigned long is treated as 32-bit signed and sign
      * extended into a 64-bit long inside the integer object).  3.0 does the
      * right thing and returns unsigned. http://bugs.python.org/issue1202 */
-    signed_val = crc32(crc32val, buf, len);
+    signed_val = crc32(crc32val, pbuf.buf, (int)pbuf.len);
+    PyBuffer_Release(&pbuf);
     return PyInt_FromLong(signed_val);
 }
 
+/* compress_parallel() needs adler32_combine(), new in zlib 1.2.2.1 */
+#if defined(ZLIB_VERNUM) && ZLIB_VERNUM >= 0x1221
+#define HAVE_PARALLEL_DEFLATE
+
+/* As in pigz, the input is cut in blocks which are compressed separately
+   as raw deflate data, each with the end of the previous block as preset
+   dictionary so that little compression is lost.  All blocks but the last
+   end with a sync flush, which aligns them on a byte boundary, so the
+   compressed blocks can simply be concatenated.  The zlib header and the
+   Adler-32 trailer are added around them, the latter combined from the
+   checksums of the blocks. */
+
+#define PZ_DICT_SIZE 32768
+#define PZ_DEFAULT_BLOCKSIZE (128*1024)
+
+typedef struct {
+    Byte *in;
+    uInt in_len;
+    uInt dict_len;              /* the dictionary is in[-dict_len:0] */
+    Byte *out;
+    uInt out_size;
+    uInt out_len;
+    uLong adler;
+    int last;
+    int err;
+    char *msg;
+} pz_block;
+
+typedef struct {
+    pz_block *blocks;
+    Py_ssize_t nblocks;
+    Py_ssize_t next;            /* the next block to compress */
+    int level;
+#ifdef WITH_THREAD
+    int running;                /* workers which haven't finished */
+    PyThread_type_lock lock;    /* protects next and running */
+    PyThread_type_lock done;    /* released by the last worker */
+#endif
+} pz_job;
+
+/* Doesn't need the GIL: it doesn't touch any Python object */
+static void
+pz_compress_block(pz_job *job, pz_block *b)
+{
+    z_stream zst;
+    int err;
+
+    memset(&zst, 0, sizeof(zst));
+    err = deflateInit2(&zst, job->level, DEFLATED, -MAX_WBITS,
+                       DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (err != Z_OK) {
+        b->err = err;
+        return;
+    }
+    if (b->dict_len > 0)
+        err = deflateSetDictionary(&zst, b->in - b->dict_len, b->dict_len);
+    if (err == Z_OK) {
+        zst.next_in = b->in;
+        zst.avail_in = b->in_len;
+        zst.next_out = b->out;
+        zst.avail_out = b->out_size;
+        err = deflate(&zst, b->last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (b->last ? err == Z_STREAM_END
+                    : (err == Z_OK && zst.avail_out > 0 && zst.avail_in == 0))
+            err = Z_OK;
+        else if (err == Z_OK || err == Z_STREAM_END)
+            err = Z_BUF_ERROR;
+    }
+    b->msg = zst.msg;
+    b->err = err;
+    b->out_len = b->out_size - zst.avail_out;
+    b->adler = adler32(adler32(0L, Z_NULL, 0), b->in, b->in_len);
+    deflateEnd(&zst);
+}
+
+static void
+pz_worker(void *arg)
+{
+    pz_job *job = (pz_job *)arg;
+    Py_ssize_t i;
+#ifdef WITH_THREAD
+    int last;
+#endif
+
+    for (;;) {
+#ifdef WITH_THREAD
+        PyThread_acquire_lock(job->lock, 1);
+#endif
+        i = job->next++;
+#ifdef WITH_THREAD
+        PyThread_release_lock(job->lock);
+#endif
+        if (i >= job->nblocks)
+            break;
+        pz_compress_block(job, &job->blocks[i]);
+    }
+#ifdef WITH_THREAD
+    PyThread_acquire_lock(job->lock, 1);
+    last = (--job->running == 0);
+    PyThread_release_lock(job->lock);
+    /* The job may be freed as soon as done is released */
+    if (last)
+        PyThread_release_lock(job->done);
+#endif
+}
+
+static int
+pz_cpu_count(void)
+{
+#if defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n >= 1)
+        return n > 64 ? 64 : (int)n;
+#endif
+    return 1;
+}
+
+PyDoc_STRVAR(compress_parallel__doc__,
+"compress_parallel(string[, level[, threads[, blocksize]]]) -- Return\n"
+"compressed string, compressed by several threads.\n"
+"\n"
+"The string is cut in blocks of blocksize bytes, 128 KB by default, which\n"
+"are compressed in parallel by threads threads, by default as many as\n"
+"there are CPUs, with the GIL released.  The result is one zlib stream,\n"
+"which decompress() accepts, usually a little larger than what compress()\n"
+"returns.  Optional arg level is the compression level, in 1-9.");
+
+static PyObject *
+PyZlib_compress_parallel(PyObject *self, PyObject *args)
+{
+    Py_buffer input;
+    int level = Z_DEFAULT_COMPRESSION, nthreads = 0, flevel, i;
+    Py_ssize_t blocksize = PZ_DEFAULT_BLOCKSIZE, n, pos, total;
+    pz_job job;
+    pz_block *b;
+    PyObject *result = NULL;
+    Byte *out;
+    uLong adler;
+    unsigned int header;
+
+    if (!PyArg_ParseTuple(args, "s*|iin:compress_parallel",
+                          &input, &level, &nthreads, &blocksize))
+        return NULL;
+    memset(&job, 0, sizeof(job));
+    if (level != Z_DEFAULT_COMPRESSION && (level < 0 || level > 9)) {
+        PyErr_SetString(ZlibError, "Bad compression level");
+        goto error;
+    }
+    if (nthreads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+        goto error;
+    }
+    if (blocksize <= 0 || blocksize > INT_MAX / 2) {
+        PyErr_SetString(PyExc_ValueError, "blocksize out of range");
+        goto error;
+    }
+    if (nthreads == 0)
+        nthreads = pz_cpu_count();
+
+    /* Lay out the blocks: their output goes to the result string, each
+       one at an offset leaving room for the worst case, then is moved
+       down next to the previous one. */
+    job.level = level;
+    job.nblocks = input.len > 0 ? (input.len - 1) / blocksize + 1 : 1;
+    job.blocks = PyMem_New(pz_block, job.nblocks);
+    if (job.blocks == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    total = 2;
+    for (n = 0, pos = 0; n < job.nblocks; n++, pos += blocksize) {
+        Py_ssize_t len = input.len - pos < blocksize ? input.len - pos
+                                                     : blocksize;
+        b = &job.blocks[n];
+        memset(b, 0, sizeof(*b));
+        b->in = (Byte *)input.buf + pos;
+        b->in_len = (uInt)len;
+        b->dict_len = (uInt)(pos < PZ_DICT_SIZE ? pos : PZ_DICT_SIZE);
+        b->out_size = (uInt)compressBound((uLong)len) + 16;
+        b->last = (n == job.nblocks - 1);
+        if (total > PY_SSIZE_T_MAX - b->out_size - 4) {
+            PyErr_NoMemory();
+            goto error;
+        }
+        total += b->out_size;
+    }
+    result = PyString_FromStringAndSize(NULL, total + 4);
+    if (result == NULL)
+        goto error;
+    out = (Byte *)PyString_AS_STRING(result) + 2;
+    for (n = 0; n < job.nblocks; n++) {
+        job.blocks[n].out = out;
+        out += job.blocks[n].out_size;
+    }
+
+    if (nthreads > job.nblocks)
+        nthreads = (int)job.nblocks;
+#ifdef WITH_THREAD
+    job.lock = PyThread_allocate_lock();
+    job.done = PyThread_allocate_lock();
+    if (job.lock == NULL || job.done == NULL) {
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate lock");
+        goto error;
+    }
+    PyThread_acquire_lock(job.done, 1);
+    job.running = 1;
+#endif
+
+    Py_BEGIN_ALLOW_THREADS
+#ifdef WITH_THREAD
+    for (i = 1; i < nthreads; i++) {
+        PyThread_acquire_lock(job.lock, 1);
+        job.running++;
+        PyThread_release_lock(job.lock);
+        if (PyThread_start_new_thread(pz_worker, &job) == -1) {
+            /* Do with the threads we have */
+            PyThread_acquire_lock(job.lock, 1);
+            job.running--;
+            PyThread_release_lock(job.lock);
+            break;
+        }
+    }
+#endif
+    pz_worker(&job);
+#ifdef WITH_THREAD
+    PyThread_acquire_lock(job.done, 1);
+#endif
+    Py_END_ALLOW_THREADS
+
+    /* Check the blocks, and put them together */
+    out = (Byte *)PyString_AS_STRING(result);
+    flevel = level == Z_DEFAULT_COMPRESSION ? 2 :
+             level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    header = (0x78 << 8) | (flevel << 6);
+    header += 31 - header % 31;
+    out[0] = (Byte)(header >> 8);
+    out[1] = (Byte)header;
+    pos = 2;
+    adler = adler32(0L, Z_NULL, 0);
+    for (n = 0; n < job.nblocks; n++) {
+        b = &job.blocks[n];
+        if (b->err != Z_OK) {
+            if (b->err == Z_MEM_ERROR)
+                PyErr_SetString(PyExc_MemoryError,
+                                "Out of memory while compressing data");
+            else if (b->msg != NULL)
+                PyErr_Format(ZlibError, "Error %d while compressing data: "
+                             "%.200s", b->err, b->msg);
+            else
+                PyErr_Format(ZlibError, "Error %d while compressing data",
+                             b->err);
+            Py_CLEAR(result);
+            goto error;
+        }
+        memmove(out + pos, b->out, b->out_len);
+        pos += b->out_len;
+        adler = adler32_combine(adler, b->adler, (z_off_t)b->in_len);
+    }
+    out[pos++] = (Byte)(adler >> 24);
+    out[pos++] = (Byte)(adler >> 16);
+    out[pos++] = (Byte)(adler >> 8);
+    out[pos++] = (Byte)adler;
+    _PyString_Resize(&result, pos);
+
+ error:
+#ifdef WITH_THREAD
+    if (job.lock != NULL)
+        PyThread_free_lock(job.lock);
+    if (job.done != NULL)
+        PyThread_free_lock(job.done);
+#endif
+    PyMem_Free(job.blocks);
+    PyBuffer_Release(&input);
+    return result;
+}
+#endif /* ZLIB_VERNUM >= 0x1221 */
 
 static PyMethodDef zlib_methods[] =
 {
@@ -951,12 +1528,20 @@ static PyMethodDef zlib_methods[] =
                 adler32__doc__},
     {"compress", (PyCFunction)PyZlib_compress,  METH_VARARGS,
                  compress__doc__},
+    {"compress_into", (PyCFunction)PyZlib_compress_into, METH_VARARGS,
+                      compress_into__doc__},
+#ifdef HAVE_PARALLEL_DEFLATE
+    {"compress_parallel", (PyCFunction)PyZlib_compress_parallel, METH_VARARGS,
+                          compress_parallel__doc__},
+#endif
     {"compressobj", (PyCFunction)PyZlib_compressobj, METH_VARARGS,
                     compressobj__doc__},
     {"crc32", (PyCFunction)PyZlib_crc32, METH_VARARGS,
               crc32__doc__},
     {"decompress", (PyCFunction)PyZlib_decompress, METH_VARARGS,
                    decompress__doc__},
+    {"decompress_into", (PyCFunction)PyZlib_decompress_into, METH_VARARGS,
+                        decompress_into__doc__},
     {"decompressobj", (PyCFunction)PyZlib_decompressobj, METH_VARARGS,
                    decompressobj__doc__},
     {NULL, NULL}
@@ -1000,9 +1585,13 @@ PyDoc_STRVAR(zlib_module_documentation,
 "\n"
 "adler32(string[, start]) -- Compute an Adler-32 checksum.\n"
 "compress(string[, level]) -- Compress string, with compression level in 1-9.\n"
+"compress_into(string, buffer[, level]) -- Compress string into buffer.\n"
+"compress_parallel(string[, level[, threads[, blocksize]]]) -- Compress\n"
+"    string using several threads.\n"
 "compressobj([level]) -- Return a compressor object.\n"
 "crc32(string[, start]) -- Compute a CRC-32 checksum.\n"
 "decompress(string,[wbits],[bufsize]) -- Decompresses a compressed string.\n"
+"decompress_into(string, buffer[, wbits]) -- Decompress string into buffer.\n"
 "decompressobj([wbits]) -- Return a decompressor object.\n"
 "\n"
 "'wbits' is window buffer size.\n"
@@ -1046,8 +1635,4 @@ PyInit_zlib(void)
         PyModule_AddObject(m, "ZLIB_VERSION", ver);
 
     PyModule_AddStringConstant(m, "__version__", "1.0");
-
-#ifdef WITH_THREAD
-    zlib_lock = PyThread_allocate_lock();
-#endif /* WITH_THREAD */
 }
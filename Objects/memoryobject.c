@@ -37,10 +37,19 @@ memory_getbuf(PyMemoryViewObject *self, Py_buffer *view, int flags)
     /* XXX for whatever reason fixing the flags seems necessary */
     if (self->view.readonly)
         flags &= ~PyBUF_WRITABLE;
-    if (self->view.obj != NULL)
+    if (self->view.obj != NULL) {
         res = PyObject_GetBuffer(self->view.obj, view, flags);
-    if (view)
+        if (res < 0)
+            return res;
+    }
+    if (view) {
+        /* Keep the object owning the new export, which need not be
+           self->view.obj itself (array and mmap hand out a new owner
+           for each export). */
+        PyObject *obj = self->view.obj != NULL ? view->obj : NULL;
         dup_buffer(view, &self->view);
+        view->obj = obj;
+    }
     return res;
 }
 
@@ -423,39 +432,101 @@ memory_tobytes(PyMemoryViewObject *self, PyObject *noargs)
     return res;
 }
 
-/* TODO: rewrite this function using the struct module to unpack
-   each buffer item */
+/* Unpack one item of a native single character struct format, as exported
+   by bytearray, array and mmap.  Returns NULL without an exception set if
+   the format is not one of these. */
+
+#define UNPACK_ITEM(type, ptr, conv) \
+    do { \
+        type x; \
+        if (itemsize != sizeof(type)) \
+            return NULL; \
+        memcpy(&x, ptr, sizeof(type)); \
+        return conv(x); \
+    } while (0)
+
+static PyObject *
+unpack_item(const char *fmt, Py_ssize_t itemsize, const char *ptr)
+{
+    if (fmt[0] == '\0' || fmt[1] != '\0')
+        return NULL;
+    if (itemsize == 1) {
+        switch (fmt[0]) {
+        case 'B':
+            return PyInt_FromLong(*(unsigned char *)ptr);
+        case 'b':
+            return PyInt_FromLong(*(signed char *)ptr);
+        case 'c':
+            return PyString_FromStringAndSize(ptr, 1);
+        case '?':
+            return PyBool_FromLong(*ptr != 0);
+        }
+    }
+    switch (fmt[0]) {
+    case 'h':
+        UNPACK_ITEM(short, ptr, PyInt_FromLong);
+    case 'H':
+        UNPACK_ITEM(unsigned short, ptr, PyInt_FromLong);
+    case 'i':
+        UNPACK_ITEM(int, ptr, PyInt_FromLong);
+    case 'I':
+        UNPACK_ITEM(unsigned int, ptr, PyLong_FromUnsignedLong);
+    case 'l':
+        UNPACK_ITEM(long, ptr, PyInt_FromLong);
+    case 'L':
+        UNPACK_ITEM(unsigned long, ptr, PyLong_FromUnsignedLong);
+#ifdef HAVE_LONG_LONG
+    case 'q':
+        UNPACK_ITEM(PY_LONG_LONG, ptr, PyLong_FromLongLong);
+    case 'Q':
+        UNPACK_ITEM(unsigned PY_LONG_LONG, ptr, PyLong_FromUnsignedLongLong);
+#endif
+    case 'f':
+        UNPACK_ITEM(float, ptr, PyFloat_FromDouble);
+    case 'd':
+        UNPACK_ITEM(double, ptr, PyFloat_FromDouble);
+#ifdef Py_USING_UNICODE
+    case 'u':
+        if (itemsize == sizeof(Py_UNICODE))
+            return PyUnicode_FromUnicode((Py_UNICODE *)ptr, 1);
+        return NULL;
+#endif
+    }
+    return NULL;
+}
+
+#undef UNPACK_ITEM
 
 static PyObject *
 memory_tolist(PyMemoryViewObject *mem, PyObject *noargs)
 {
     Py_buffer *view = &(mem->view);
-    Py_ssize_t i;
+    const char *fmt = view->format != NULL ? view->format : "B";
+    Py_ssize_t i, n;
     PyObject *res, *item;
     char *buf;
 
-    if (strcmp(view->format, "B") || view->itemsize != 1) {
-        PyErr_SetString(PyExc_NotImplementedError, 
-                "tolist() only supports byte views");
-        return NULL;
-    }
     if (view->ndim != 1) {
         PyErr_SetString(PyExc_NotImplementedError, 
                 "tolist() only supports one-dimensional objects");
         return NULL;
     }
-    res = PyList_New(view->len);
+    n = view->itemsize > 0 ? view->len / view->itemsize : 0;
+    res = PyList_New(n);
     if (res == NULL)
         return NULL;
     buf = view->buf;
-    for (i = 0; i < view->len; i++) {
-        item = PyInt_FromLong((unsigned char) *buf);
+    for (i = 0; i < n; i++) {
+        item = unpack_item(fmt, view->itemsize, buf);
         if (item == NULL) {
+            if (!PyErr_Occurred())
+                PyErr_Format(PyExc_NotImplementedError,
+                    "tolist() does not support format '%.20s'", fmt);
             Py_DECREF(res);
             return NULL;
         }
         PyList_SET_ITEM(res, i, item);
-        buf++;
+        buf += view->itemsize;
     }
     return res;
 }
@@ -610,7 +681,11 @@ memory_subscript(PyMemoryViewObject *self, PyObject *key)
             else {
                 newview = *view;
             }
+            /* The new export may describe the memory differently (as
+               bytes of an array, say): keep the layout of this view */
             newview.buf = newbuf;
+            newview.itemsize = view->itemsize;
+            newview.readonly = view->readonly;
             newview.len = slicelength * newview.itemsize;
             newview.format = view->format;
             newview.shape = &(newview.smalltable[0]);
@@ -1270,6 +1270,12 @@ convertsimple(PyObject *arg, const char **p_format, va_list *p_va, int flags,
                 PyErr_Clear();
                 return converterr("read-write buffer", arg, msgbuf, bufsize);
             }
+            if (((Py_buffer*)p)->readonly) {
+                /* memoryview hands out read-only views whatever the
+                   flags ask for */
+                PyBuffer_Release((Py_buffer*)p);
+                return converterr("read-write buffer", arg, msgbuf, bufsize);
+            }
             if (addcleanup(p, freelist, cleanup_buffer)) {
                 return converterr(
                     "(cleanup problem)",
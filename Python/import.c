@@ -243,6 +243,9 @@ _PyImport_Fini(void)
 {
     Py_XDECREF(extensions);
     extensions = NULL;
+#ifdef USE_DIRCACHE
+    Py_CLEAR(dircache);
+#endif
     PyMem_DEL(_PyImport_Filetab);
     _PyImport_Filetab = NULL;
 }
@@ -1106,6 +1109,189 @@ is_builtin(char *name)
 }
 
 
+/* Directory listing cache for the builtin path finder.
+
+   Without it, every sys.path entry costs a stat() plus one fopen() per
+   suffix in _PyImport_Filetab for every module looked up, and nearly all
+   of those fail.  Instead we keep, per directory, the set of names it
+   contains together with the directory's device, inode and mtime; a
+   lookup then costs one stat() of the directory and answers "no such
+   entry" from memory.  A
+   hit still goes through the usual stat()/fopen()/case_ok() dance, so
+   the cache can only ever turn a probe into a known miss.
+
+   Listings are keyed on the absolute path of the directory, so that ''
+   follows the current directory.  A directory replaced by another one
+   shows up as a new inode, and the mtime is compared to the nanosecond
+   where struct stat has it.  Listings of directories modified within the
+   last second are never stored all the same, since a change in the same
+   clock tick would not change st_mtime.
+   The entry for a path item is dropped whenever path_importer_cache has
+   to be consulted afresh for it, so clearing sys.path_importer_cache
+   also forces a rescan.  The cache is bypassed under PYTHONCASEOK, where
+   names on disk need not match the requested spelling. */
+
+#if defined(HAVE_STAT) && defined(HAVE_DIRENT_H) && defined(HAVE_GETCWD) \
+    && !defined(MS_WINDOWS) && !defined(PYOS_OS2) && !defined(RISCOS)
+#define USE_DIRCACHE
+#include <dirent.h>
+#endif
+
+#ifdef USE_DIRCACHE
+/* Maps absolute directory name to a (stamp, dict-of-entries) tuple. */
+static PyObject *dircache = NULL;
+
+#if defined(HAVE_STAT_TV_NSEC)
+#define DIRCACHE_MTIME_NSEC(st) ((long)(st).st_mtim.tv_nsec)
+#elif defined(HAVE_STAT_TV_NSEC2)
+#define DIRCACHE_MTIME_NSEC(st) ((long)(st).st_mtimespec.tv_nsec)
+#else
+#define DIRCACHE_MTIME_NSEC(st) 0L
+#endif
+
+/* Return a new reference to the cache key of directory 'dirname': its
+   name, made absolute if it isn't.  Returns NULL with an exception set
+   on failure. */
+static PyObject *
+dircache_key(const char *dirname)
+{
+    char cwd[MAXPATHLEN + 1];
+
+    if (*dirname == SEP)
+        return PyString_FromString(dirname);
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+        return PyErr_SetFromErrno(PyExc_OSError);
+    if (*dirname == '\0')
+        return PyString_FromString(cwd);
+    return PyString_FromFormat("%s%c%s", cwd, SEP, dirname);
+}
+
+/* Return a new reference to the entry dict of directory 'dirname', or
+   NULL if the listing isn't available, in which case the caller must
+   probe the filesystem.  Never sets an exception. */
+static PyObject *
+dircache_listing(const char *dirname)
+{
+    struct stat statbuf;
+    PyObject *key = NULL, *stamp = NULL, *cached, *entries, *item;
+    DIR *dirp;
+    struct dirent *dp;
+    int cmp;
+
+    if (Py_GETENV("PYTHONCASEOK") != NULL)
+        return NULL;
+    if (stat(*dirname == '\0' ? "." : dirname, &statbuf) != 0 ||
+        !S_ISDIR(statbuf.st_mode))
+        return NULL;
+    if (dircache == NULL) {
+        dircache = PyDict_New();
+        if (dircache == NULL)
+            goto error;
+    }
+    key = dircache_key(dirname);
+    if (key == NULL)
+        goto error;
+    stamp = Py_BuildValue("(NNll)",
+                          PyLong_FromLongLong((PY_LONG_LONG)statbuf.st_dev),
+                          PyLong_FromLongLong((PY_LONG_LONG)statbuf.st_ino),
+                          (long)statbuf.st_mtime,
+                          DIRCACHE_MTIME_NSEC(statbuf));
+    if (stamp == NULL)
+        goto error;
+    cached = PyDict_GetItem(dircache, key);
+    if (cached != NULL) {
+        cmp = PyObject_RichCompareBool(PyTuple_GET_ITEM(cached, 0), stamp,
+                                       Py_EQ);
+        if (cmp < 0)
+            goto error;
+        if (cmp) {
+            entries = PyTuple_GET_ITEM(cached, 1);
+            Py_INCREF(entries);
+            Py_DECREF(key);
+            Py_DECREF(stamp);
+            return entries;
+        }
+    }
+    if (statbuf.st_mtime >= time(NULL) - 1)
+        goto done;              /* too recent to be trusted */
+
+    dirp = opendir(*dirname == '\0' ? "." : dirname);
+    if (dirp == NULL)
+        goto done;
+    entries = PyDict_New();
+    if (entries == NULL) {
+        (void)closedir(dirp);
+        goto error;
+    }
+    while ((dp = readdir(dirp)) != NULL) {
+        if (PyDict_SetItemString(entries, dp->d_name, Py_None) != 0) {
+            (void)closedir(dirp);
+            Py_DECREF(entries);
+            goto error;
+        }
+    }
+    (void)closedir(dirp);
+    item = PyTuple_Pack(2, stamp, entries);
+    if (item == NULL || PyDict_SetItem(dircache, key, item) != 0) {
+        Py_XDECREF(item);
+        Py_DECREF(entries);
+        goto error;
+    }
+    Py_DECREF(item);
+    Py_DECREF(key);
+    Py_DECREF(stamp);
+    return entries;
+
+  error:
+    PyErr_Clear();
+  done:
+    Py_XDECREF(key);
+    Py_XDECREF(stamp);
+    return NULL;
+}
+
+/* Return 1 if 'listing' is NULL (nothing known) or contains 'name'. */
+static int
+dircache_may_exist(PyObject *listing, char *name)
+{
+    PyObject *v;
+
+    if (listing == NULL)
+        return 1;
+    v = PyDict_GetItemString(listing, name);
+    if (v == NULL && PyErr_Occurred()) {
+        PyErr_Clear();
+        return 1;
+    }
+    return v != NULL;
+}
+
+/* Drop the listing of sys.path item 'p', if any. */
+static void
+dircache_forget(PyObject *p)
+{
+    PyObject *key;
+
+    if (dircache == NULL || !PyString_Check(p) ||
+        strlen(PyString_AS_STRING(p)) != (size_t)PyString_GET_SIZE(p))
+        return;
+    key = dircache_key(PyString_AS_STRING(p));
+    if (key == NULL) {
+        PyErr_Clear();
+        return;
+    }
+    if (PyDict_GetItem(dircache, key) != NULL) {
+        if (PyDict_DelItem(dircache, key) != 0)
+            PyErr_Clear();
+    }
+    Py_DECREF(key);
+}
+#else
+#define dircache_may_exist(listing, name) 1
+#define dircache_forget(p)
+#endif
+
+
 /* Return an importer object for a sys.path/pkg.__path__ item 'p',
    possibly by fetching it from the path_importer_cache dict. If it
    wasn't yet cached, traverse path_hooks until a hook is found
@@ -1133,6 +1319,9 @@ get_path_importer(PyObject *path_importer_cache, PyObject *path_hooks,
     if (importer != NULL)
         return importer;
 
+    /* a fresh (or evicted) path entry also gets a fresh listing */
+    dircache_forget(p);
+
     /* set path_importer_cache[p] to None to avoid recursion */
     if (PyDict_SetItem(path_importer_cache, p, Py_None) != 0)
         return NULL;
@@ -1207,6 +1396,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
     char *filemode;
     FILE *fp = NULL;
     PyObject *path_hooks, *path_importer_cache;
+    PyObject *listing = NULL;
 #ifndef RISCOS
     struct stat statbuf;
 #endif
@@ -1384,6 +1574,9 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
         }
         /* no hook was found, use builtin import */
 
+#ifdef USE_DIRCACHE
+        listing = dircache_listing(buf);
+#endif
         if (len > 0 && buf[len-1] != SEP
 #ifdef ALTSEP
             && buf[len-1] != ALTSEP
@@ -1396,10 +1589,12 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
         /* Check for package import (buf holds a directory name,
            and there's an __init__ module in that directory */
 #ifdef HAVE_STAT
-        if (stat(buf, &statbuf) == 0 &&         /* it exists */
+        if (dircache_may_exist(listing, name) &&
+            stat(buf, &statbuf) == 0 &&         /* it exists */
             S_ISDIR(statbuf.st_mode) &&         /* it's a directory */
             case_ok(buf, len, namelen, name)) { /* case matches */
             if (find_init_module(buf)) { /* and has __init__.py */
+                Py_XDECREF(listing);
                 Py_XDECREF(copy);
                 return &fd_package;
             }
@@ -1410,6 +1605,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
                     MAXPATHLEN, buf);
                 if (PyErr_Warn(PyExc_ImportWarning,
                                warnstr)) {
+                    Py_XDECREF(listing);
                     Py_XDECREF(copy);
                     return NULL;
                 }
@@ -1472,6 +1668,8 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
             }
 #endif /* PYOS_OS2 */
             strcpy(buf+len, fdp->suffix);
+            if (!dircache_may_exist(listing, buf+len-namelen))
+                continue;
             if (Py_VerboseFlag > 1)
                 PySys_WriteStderr("# trying %s\n", buf);
             filemode = fdp->mode;
@@ -1501,6 +1699,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
             saved_buf = NULL;
         }
 #endif
+        Py_CLEAR(listing);
         Py_XDECREF(copy);
         if (fp != NULL)
             break;
@@ -1722,6 +1921,8 @@ find_init_module(char *buf)
     size_t i = save_len;
     char *pname;  /* pointer to start of __init__ */
     struct stat statbuf;
+    PyObject *listing = NULL;
+    int found = 0;
 
 /*      For calling case_ok(buf, len, namelen, name):
  *      /a/b/c/d/e/f/g/h/i/j/k/some_long_module_name.py\0
@@ -1733,31 +1934,36 @@ find_init_module(char *buf)
  */
     if (save_len + 13 >= MAXPATHLEN)
         return 0;
+#ifdef USE_DIRCACHE
+    listing = dircache_listing(buf);
+#endif
     buf[i++] = SEP;
     pname = buf + i;
     strcpy(pname, "__init__.py");
-    if (stat(buf, &statbuf) == 0) {
+    if (dircache_may_exist(listing, pname) && stat(buf, &statbuf) == 0) {
         if (case_ok(buf,
                     save_len + 9,               /* len("/__init__") */
                 8,                              /* len("__init__") */
                 pname)) {
-            buf[save_len] = '\0';
-            return 1;
+            found = 1;
+            goto done;
         }
     }
     i += strlen(pname);
     strcpy(buf+i, Py_OptimizeFlag ? "o" : "c");
-    if (stat(buf, &statbuf) == 0) {
+    if (dircache_may_exist(listing, pname) && stat(buf, &statbuf) == 0) {
         if (case_ok(buf,
                     save_len + 9,               /* len("/__init__") */
                 8,                              /* len("__init__") */
                 pname)) {
-            buf[save_len] = '\0';
-            return 1;
+            found = 1;
+            goto done;
         }
     }
+  done:
+    Py_XDECREF(listing);
     buf[save_len] = '\0';
-    return 0;
+    return found;
 }
 
 #else
@@ -2033,6 +2239,113 @@ err_return:
 }
 
 
+/* Frozen images.
+
+   A frozen image is a file holding the same data as a frozen.c table
+   generated by Tools/freeze, so that an application's modules can be
+   frozen without relinking the interpreter (see Tools/freeze/mkimage.py).
+   The file starts with FROZEN_IMAGE_TAG and the .pyc magic number, both
+   as marshal longs, followed by a marshalled tuple of
+   (name, marshalled code, ispackage) tuples.
+
+   Loading an image prepends its modules to PyImport_FrozenModules; the
+   code pointers refer directly to the unmarshalled strings, which are
+   kept alive for the life of the process. */
+
+#define FROZEN_IMAGE_TAG ('F' | ((long)'R'<<8) | ((long)'Z'<<16) | \
+                          ((long)'I'<<24))
+
+static PyObject *frozen_images = NULL;          /* list of loaded images */
+static struct _frozen *frozen_image_table = NULL; /* PyMem-allocated */
+
+int
+_PyImport_LoadFrozenImage(const char *pathname)
+{
+    FILE *fp;
+    PyObject *image;
+    struct _frozen *p, *table;
+    Py_ssize_t i, n, nold;
+
+    fp = fopen(pathname, "rb");
+    if (fp == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)pathname);
+        return -1;
+    }
+    if (PyMarshal_ReadLongFromFile(fp) != FROZEN_IMAGE_TAG) {
+        fclose(fp);
+        PyErr_Format(PyExc_ImportError,
+                     "%.200s is not a frozen image", pathname);
+        return -1;
+    }
+    if (PyMarshal_ReadLongFromFile(fp) != pyc_magic) {
+        fclose(fp);
+        PyErr_Format(PyExc_ImportError,
+                     "Bad magic number in %.200s", pathname);
+        return -1;
+    }
+    image = PyMarshal_ReadLastObjectFromFile(fp);
+    fclose(fp);
+    if (image == NULL)
+        return -1;
+    if (!PyTuple_Check(image))
+        goto bad_image;
+    n = PyTuple_GET_SIZE(image);
+    for (i = 0; i < n; i++) {
+        PyObject *entry = PyTuple_GET_ITEM(image, i);
+        if (!PyTuple_Check(entry) || PyTuple_GET_SIZE(entry) != 3 ||
+            !PyString_Check(PyTuple_GET_ITEM(entry, 0)) ||
+            !PyString_Check(PyTuple_GET_ITEM(entry, 1)) ||
+            !PyInt_Check(PyTuple_GET_ITEM(entry, 2)) ||
+            PyString_GET_SIZE(PyTuple_GET_ITEM(entry, 1)) > INT_MAX)
+            goto bad_image;
+    }
+
+    if (frozen_images == NULL) {
+        frozen_images = PyList_New(0);
+        if (frozen_images == NULL)
+            goto error;
+    }
+    for (nold = 0, p = PyImport_FrozenModules; p->name != NULL; p++)
+        nold++;
+    table = PyMem_NEW(struct _frozen, n + nold + 1);
+    if (table == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    if (PyList_Append(frozen_images, image) < 0) {
+        PyMem_DEL(table);
+        goto error;
+    }
+    for (i = 0; i < n; i++) {
+        PyObject *entry = PyTuple_GET_ITEM(image, i);
+        PyObject *code = PyTuple_GET_ITEM(entry, 1);
+        long ispackage = PyInt_AS_LONG(PyTuple_GET_ITEM(entry, 2));
+        table[i].name = PyString_AS_STRING(PyTuple_GET_ITEM(entry, 0));
+        table[i].code = (unsigned char *)PyString_AS_STRING(code);
+        table[i].size = (int)PyString_GET_SIZE(code);
+        if (ispackage)
+            table[i].size = -table[i].size;
+    }
+    memcpy(table + n, PyImport_FrozenModules,
+           (nold + 1) * sizeof(struct _frozen));
+    if (frozen_image_table != NULL)
+        PyMem_DEL(frozen_image_table);
+    PyImport_FrozenModules = frozen_image_table = table;
+    if (Py_VerboseFlag)
+        PySys_WriteStderr("# loaded %d frozen modules from %s\n",
+                          (int)n, pathname);
+    Py_DECREF(image);
+    return 0;
+
+bad_image:
+    PyErr_Format(PyExc_ImportError,
+                 "Malformed frozen image %.200s", pathname);
+error:
+    Py_DECREF(image);
+    return -1;
+}
+
+
 /* Import a module, either built-in, frozen, or external, and return
    its module object WITH INCREMENTED REFERENCE COUNT */
 
@@ -2938,6 +3251,19 @@ imp_is_frozen(PyObject *self, PyObject *args)
     return PyBool_FromLong((long) (p == NULL ? 0 : p->size));
 }
 
+static PyObject *
+imp_load_frozen_image(PyObject *self, PyObject *args)
+{
+    char *pathname;
+
+    if (!PyArg_ParseTuple(args, "s:load_frozen_image", &pathname))
+        return NULL;
+    if (_PyImport_LoadFrozenImage(pathname) < 0)
+        return NULL;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static FILE *
 get_file(char *pathname, PyObject *fob, char *mode)
 {
@@ -3160,6 +3486,7 @@ static PyMethodDef imp_methods[] = {
     {"is_builtin",              imp_is_builtin,         METH_VARARGS},
     {"is_frozen",               imp_is_frozen,          METH_VARARGS},
     {"load_compiled",           imp_load_compiled,      METH_VARARGS},
+    {"load_frozen_image",       imp_load_frozen_image,  METH_VARARGS},
 #ifdef HAVE_DYNAMIC_LOADING
     {"load_dynamic",            imp_load_dynamic,       METH_VARARGS},
 #endif
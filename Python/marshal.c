@@ -11,6 +11,10 @@
 #include "code.h"
 #include "marshal.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #define ABS(x) ((x) < 0 ? -(x) : (x))
 
 /* High water mark to determine when the marshalled object is dangerously deep
@@ -1117,9 +1121,45 @@ getfilesize(FILE *fp)
 }
 #endif
 
-/* If we can get the size of the file up-front, and it's reasonably small,
- * read it in one gulp and delegate to ...FromString() instead.  Much quicker
- * than reading a byte at a time from file; speeds .pyc imports.
+#if defined(HAVE_FSTAT) && defined(HAVE_SYS_MMAN_H) && defined(MAP_FAILED)
+/* Map the file read-only and unmarshal the remainder straight out of the
+ * page cache, avoiding the intermediate heap buffer and the size limit of
+ * the fread() path.  Returns 0 if the file could not be mapped (e.g. a
+ * pipe), in which case *pv is untouched and the caller should fall back
+ * to reading it.  Otherwise returns 1 and stores the result in *pv.
+ * A mapped file that shrinks raises SIGBUS, so the writers of .pyc files
+ * (open_exclusive() in import.c, and py_compile) replace them with a new
+ * file instead of truncating them.
+ */
+static int
+read_mapped_object(FILE *fp, off_t filesize, PyObject **pv)
+{
+    char *map;
+    long pos;
+
+    if ((unsigned PY_LONG_LONG)filesize > (unsigned PY_LONG_LONG)PY_SSIZE_T_MAX)
+        return 0;
+    pos = ftell(fp);
+    if (pos < 0 || pos > filesize)
+        return 0;
+    map = (char *)mmap(NULL, (size_t)filesize, PROT_READ, MAP_PRIVATE,
+                       fileno(fp), 0);
+    if (map == (char *)MAP_FAILED)
+        return 0;
+    *pv = PyMarshal_ReadObjectFromString(map + pos,
+                                         (Py_ssize_t)(filesize - pos));
+    munmap(map, (size_t)filesize);
+    /* Leave fp where a full read would have left it. */
+    fseek(fp, 0L, SEEK_END);
+    return 1;
+}
+#define HAVE_READ_MAPPED_OBJECT
+#endif
+
+/* If we can get the size of the file up-front, map it (or, if it's
+ * reasonably small, read it in one gulp) and delegate to ...FromString()
+ * instead.  Much quicker than reading a byte at a time from file; speeds
+ * .pyc imports.
  * CAUTION:  since this may read the entire remainder of the file, don't
  * call it unless you know you're done with the file.
  */
@@ -1131,6 +1171,13 @@ PyMarshal_ReadLastObjectFromFile(FILE *fp)
 #ifdef HAVE_FSTAT
     off_t filesize;
     filesize = getfilesize(fp);
+#ifdef HAVE_READ_MAPPED_OBJECT
+    if (filesize > 0) {
+        PyObject *v;
+        if (read_mapped_object(fp, filesize, &v))
+            return v;
+    }
+#endif
     if (filesize > 0 && filesize <= REASONABLE_FILE_LIMIT) {
         char* pBuf = (char *)PyMem_MALLOC(filesize);
         if (pBuf != NULL) {
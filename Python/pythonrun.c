@@ -235,6 +235,13 @@ Py_InitializeEx(int install_sigs)
 
     _PyImportHooks_Init();
 
+    if ((p = Py_GETENV("PYTHONFROZENIMAGE")) && *p != '\0') {
+        if (_PyImport_LoadFrozenImage(p) < 0) {
+            PyErr_Print();
+            Py_FatalError("Py_Initialize: can't load PYTHONFROZENIMAGE");
+        }
+    }
+
     if (install_sigs)
         initsigs(); /* Signal handling stuff, including initintr() */
 
@@ -151,6 +151,48 @@ static size_t _pythread_stacksize = 0;
 #endif
 */
 
+#ifndef Py_HAVE_NATIVE_TIMED_LOCK
+/* If the platform can't wait on a lock with a timeout, poll it, sleeping
+   for a growing delay between tries, from 500 microseconds up to 50
+   milliseconds, as threading.Condition used to do in Python.  The wait
+   is never interrupted. */
+
+#ifdef HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+
+PyLockStatus
+PyThread_acquire_lock_timed(PyThread_type_lock lock, PY_TIMEOUT_T microseconds,
+                            int intr_flag)
+{
+    PY_TIMEOUT_T delay = 500;
+
+    if (microseconds < 0)
+        return PyThread_acquire_lock(lock, WAIT_LOCK) ?
+            PY_LOCK_ACQUIRED : PY_LOCK_FAILURE;
+    for (;;) {
+        if (PyThread_acquire_lock(lock, NOWAIT_LOCK))
+            return PY_LOCK_ACQUIRED;
+        if (microseconds <= 0)
+            return PY_LOCK_FAILURE;
+        if (delay > microseconds)
+            delay = microseconds;
+#ifdef HAVE_SELECT
+        {
+            struct timeval tv;
+            tv.tv_sec = (long)(delay / 1000000);
+            tv.tv_usec = (long)(delay % 1000000);
+            select(0, NULL, NULL, NULL, &tv);
+        }
+#endif
+        microseconds -= delay;
+        delay *= 2;
+        if (delay > 50000)
+            delay = 50000;
+    }
+}
+#endif /* Py_HAVE_NATIVE_TIMED_LOCK */
+
 /* return the current thread stack size */
 size_t
 PyThread_get_stacksize(void)
@@ -0,0 +1,146 @@
+#! /usr/bin/env python
+
+"""Freeze the modules used by a script into a frozen image file.
+
+usage: mkimage [options...] script [module]...
+
+A frozen image holds the byte code of the pure Python modules a program
+imports, in the same form as the frozen.c tables written by freeze.  It
+can be loaded at startup by pointing the PYTHONFROZENIMAGE environment
+variable at it, or later with imp.load_frozen_image().  The modules are
+then imported as frozen modules: no sys.path search, no .pyc files.
+
+Unlike freeze, no C compiler is needed and the interpreter is not
+relinked.  Since a frozen package can only import frozen submodules,
+packages are always frozen whole.  Only modules that don't rely on
+__file__ pointing at their source (or on data files next to it) should
+be put in an image; exclude the others with -x.
+
+Options:
+
+-o file:      Name of the image file to write; default 'frozen.img'.
+
+-m:           Additional arguments are module names instead of filenames.
+
+-x module:    Exclude the specified module (and anything only it imports).
+              More than one -x option may be given.
+
+-s:           Also freeze the modules imported by site, so that
+              interpreter startup itself is served from the image.
+
+-d:           Debugging mode for the module finder.
+
+-q:           Make the module finder totally quiet.
+
+-h:           Print this help message.
+
+Arguments:
+
+script:       The Python script whose imports are frozen.  The script
+              itself is not put in the image.
+
+module ...:   Additional Python modules (referenced by pathname) that
+              will be included.  If -m is specified, these are module
+              names that are searched in the path instead.
+"""
+
+import getopt
+import imp
+import marshal
+import modulefinder
+import sys
+
+# Must match FROZEN_IMAGE_TAG in Python/import.c.
+IMAGE_TAG = 'FRZI'
+
+
+def write_image(filename, modules):
+    """Write an image holding the code of modules, a ModuleFinder dict."""
+    entries = []
+    for name in sorted(modules):
+        m = modules[name]
+        if m.__code__ is None or name == '__main__':
+            continue
+        entries.append((name, marshal.dumps(m.__code__), bool(m.__path__)))
+    with open(filename, 'wb') as f:
+        f.write(IMAGE_TAG)
+        f.write(imp.get_magic())
+        marshal.dump(tuple(entries), f)
+    return len(entries)
+
+
+def usage(msg):
+    sys.stdout = sys.stderr
+    print "Error:", msg
+    print "Use ``%s -h'' for help" % sys.argv[0]
+    sys.exit(2)
+
+
+def main():
+    output = 'frozen.img'
+    exclude = []
+    modargs = 0
+    with_site = 0
+    debug = 1
+
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], 'dhmo:qsx:')
+    except getopt.error, msg:
+        usage('getopt error: ' + str(msg))
+
+    for o, a in opts:
+        if o == '-h':
+            print __doc__
+            return
+        if o == '-d':
+            debug = debug + 1
+        if o == '-m':
+            modargs = 1
+        if o == '-o':
+            output = a
+        if o == '-q':
+            debug = 0
+        if o == '-s':
+            with_site = 1
+        if o == '-x':
+            exclude.append(a)
+
+    if not args:
+        usage('at least one filename argument required')
+
+    mf = modulefinder.ModuleFinder(sys.path[:], debug, exclude)
+    if with_site:
+        mf.import_hook('site')
+    if modargs:
+        for mod in args:
+            if mod[-2:] == '.*':
+                mf.import_hook(mod[:-2], None, ["*"])
+            else:
+                mf.import_hook(mod)
+    else:
+        mf.run_script(args[0])
+        for mod in args[1:]:
+            mf.load_file(mod)
+
+    # A frozen package only finds frozen submodules, so take all of every
+    # package, including the ones only imported dynamically (encodings).
+    done = set()
+    while True:
+        packages = [name for name, m in mf.modules.items()
+                    if m.__path__ and name not in done]
+        if not packages:
+            break
+        for name in packages:
+            done.add(name)
+            mf.import_hook(name, None, ["*"])
+
+    if debug > 0:
+        mf.report()
+        print
+    n = write_image(output, mf.modules)
+    if debug > 0:
+        print "froze %d modules into %s" % (n, output)
+
+
+if __name__ == '__main__':
+    main()
@@ -543,6 +543,11 @@ class PyBuildExt(build_ext):
 
         # select(2); not on ancient System V
         exts.append( Extension('select', ['selectmodule.c']) )
+        # epoll based event loop engine for asyncore
+        if sysconfig.get_config_var('HAVE_EPOLL'):
+            exts.append( Extension('_asyncore', ['_asyncoremodule.c']) )
+        else:
+            missing.append('_asyncore')
 
         # Fred Drake's interface to the Python parser
         exts.append( Extension('parser', ['parsermodule.c']) )
@@ -727,6 +732,7 @@ class PyBuildExt(build_ext):
                 # The _hashlib module wraps optimized implementations
                 # of hash functions from the OpenSSL library.
                 exts.append( Extension('_hashlib', ['_hashopenssl.c'],
+                                       depends = ['hashlib.h'],
                                        include_dirs = ssl_incs,
                                        library_dirs = ssl_libs,
                                        libraries = ['ssl', 'crypto']) )
@@ -736,19 +742,22 @@ class PyBuildExt(build_ext):
                 missing.append('_hashlib')
         if COMPILED_WITH_PYDEBUG or not have_usable_openssl:
             # The _sha module implements the SHA1 hash algorithm.
-            exts.append( Extension('_sha', ['shamodule.c']) )
+            exts.append( Extension('_sha', ['shamodule.c'],
+                                   depends = ['hashlib.h']) )
             # The _md5 module implements the RSA Data Security, Inc. MD5
             # Message-Digest Algorithm, described in RFC 1321.  The
             # necessary files md5.c and md5.h are included here.
             exts.append( Extension('_md5',
                             sources = ['md5module.c', 'md5.c'],
-                            depends = ['md5.h']) )
+                            depends = ['md5.h', 'hashlib.h']) )
 
         min_sha2_openssl_ver = 0x00908000
         if COMPILED_WITH_PYDEBUG or openssl_ver < min_sha2_openssl_ver:
             # OpenSSL doesn't do these until 0.9.8 so we'll bring our own hash
-            exts.append( Extension('_sha256', ['sha256module.c']) )
-            exts.append( Extension('_sha512', ['sha512module.c']) )
+            exts.append( Extension('_sha256', ['sha256module.c'],
+                                   depends = ['hashlib.h']) )
+            exts.append( Extension('_sha512', ['sha512module.c'],
+                                   depends = ['hashlib.h']) )
 
         # Modules that provide persistent dictionary-like semantics.  You will
         # probably want to arrange for at least one of them to be available on
@@ -1431,6 +1440,7 @@ class PyBuildExt(build_ext):
             if (sysconfig.get_config_var('HAVE_SEM_OPEN') and not
                 sysconfig.get_config_var('POSIX_SEMAPHORES_NOT_ENABLED')):
                 multiprocessing_srcs.append('_multiprocessing/semaphore.c')
+                multiprocessing_srcs.append('_multiprocessing/channel.c')
 
         if sysconfig.get_config_var('WITH_THREAD'):
             exts.append ( Extension('_multiprocessing', multiprocessing_srcs,